@@ -0,0 +1,388 @@
+#include "appcore/compactTransformCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+using Baseline = compactTransform::Baseline;
+
+enum Flag : std::uint8_t {
+	KEYFRAME = 1u << 0,
+	ROTATION_DELTA = 1u << 1
+};
+
+constexpr std::size_t targetOffset = 0;
+constexpr std::size_t flagsOffset = 1;
+constexpr std::size_t sequenceOffset = 2;
+constexpr std::size_t objectIdOffset = 3;
+constexpr std::size_t peerIdOffset = 7;
+constexpr std::size_t fixedSize = 11;
+
+constexpr std::size_t packedRotationSize = 6;
+constexpr int rotationBits = 15;
+constexpr double rotationScale = (1u << rotationBits) - 1;
+constexpr double sqrt2 = 1.41421356237309504880;
+
+//=============================================================================
+void writeUInt32(std::uint32_t value, std::vector<std::uint8_t>& buffer)
+{
+	for (int i = 0; i < 4; ++i) {
+		buffer.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+	}
+}
+
+std::uint32_t readUInt32(const std::uint8_t* bytes)
+{
+	std::uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		value |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+	}
+
+	return value;
+}
+//=============================================================================
+
+//=============================================================================
+// Signed deltas are zigzag mapped so that small magnitudes of either sign
+// take few varint bytes
+void writeDelta(std::int64_t delta, std::vector<std::uint8_t>& buffer)
+{
+	auto value = (static_cast<std::uint64_t>(delta) << 1) ^
+		static_cast<std::uint64_t>(delta >> 63);
+
+	while (value >= 0x80) {
+		buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool readDelta(
+	const std::uint8_t*& current, const std::uint8_t* end, std::int64_t& delta)
+{
+	std::uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (current == end) {
+			return false;
+		}
+
+		const auto byte = *current++;
+		value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			delta = static_cast<std::int64_t>(value >> 1) ^
+				-static_cast<std::int64_t>(value & 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+//=============================================================================
+
+//=============================================================================
+// Smallest-three: drop the largest quaternion component (recovered from the
+// unit norm) and send the index plus the other three, which all lie within
+// +/- 1/sqrt(2)
+void quantizeRotation(const Eigen::Matrix3d& rotation, Baseline& baseline)
+{
+	Eigen::Quaterniond quaternion(rotation);
+	quaternion.normalize();
+
+	Eigen::Vector4d coeffs = quaternion.coeffs();
+	Eigen::Index largest;
+	coeffs.cwiseAbs().maxCoeff(&largest);
+
+	if (coeffs(largest) < 0.0) {
+		coeffs = -coeffs;
+	}
+
+	for (int i = 0, j = 0; i < 4; ++i) {
+		if (i != largest) {
+			auto normalized = (coeffs(i) * sqrt2 + 1.0) * 0.5;
+			baseline.rotation[j++] = static_cast<std::uint16_t>(
+				std::lround(std::clamp(normalized, 0.0, 1.0) * rotationScale));
+		}
+	}
+	baseline.largestComponent = static_cast<std::uint8_t>(largest);
+}
+
+Eigen::Matrix3d dequantizeRotation(const Baseline& baseline)
+{
+	Eigen::Vector4d coeffs;
+	double sumOfSquares = 0.0;
+
+	for (int i = 0, j = 0; i < 4; ++i) {
+		if (i != baseline.largestComponent) {
+			coeffs(i) =
+				((baseline.rotation[j++] / rotationScale) * 2.0 - 1.0) /
+				sqrt2;
+			sumOfSquares += coeffs(i) * coeffs(i);
+		}
+	}
+	coeffs(baseline.largestComponent) =
+		std::sqrt(std::max(0.0, 1.0 - sumOfSquares));
+
+	Eigen::Quaterniond quaternion(coeffs);
+	quaternion.normalize();
+
+	return quaternion.toRotationMatrix();
+}
+//=============================================================================
+
+//=============================================================================
+void writePackedRotation(
+	const Baseline& baseline, std::vector<std::uint8_t>& buffer)
+{
+	auto packed = static_cast<std::uint64_t>(baseline.largestComponent);
+	for (int i = 0; i < 3; ++i) {
+		packed |= static_cast<std::uint64_t>(baseline.rotation[i])
+			<< (2 + rotationBits * i);
+	}
+
+	for (std::size_t i = 0; i < packedRotationSize; ++i) {
+		buffer.push_back(static_cast<std::uint8_t>(packed >> (8 * i)));
+	}
+}
+
+void readPackedRotation(const std::uint8_t* bytes, Baseline& baseline)
+{
+	std::uint64_t packed = 0;
+	for (std::size_t i = 0; i < packedRotationSize; ++i) {
+		packed |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+	}
+
+	baseline.largestComponent = static_cast<std::uint8_t>(packed & 0x3);
+	for (int i = 0; i < 3; ++i) {
+		baseline.rotation[i] = static_cast<std::uint16_t>(
+			(packed >> (2 + rotationBits * i)) & ((1u << rotationBits) - 1));
+	}
+}
+//=============================================================================
+}  // namespace
+
+namespace compactTransform
+{
+//=============================================================================
+void encode(const TransformUpdate& update, BaselineMapType& baselines,
+	std::vector<std::uint8_t>& buffer)
+{
+	Baseline current;
+	for (int i = 0; i < 3; ++i) {
+		current.translation[i] = static_cast<std::int32_t>(
+			std::lround(update.transform.translation()(i) / translationStep));
+	}
+	quantizeRotation(update.transform.linear(), current);
+
+	auto it = baselines.find({update.target, update.objectId});
+
+	std::uint8_t flags = 0;
+	if (it == baselines.end()) {
+		current.sequence = 0;
+		flags |= KEYFRAME;
+	}
+	else {
+		current.sequence = static_cast<std::uint8_t>(it->second.sequence + 1);
+		if ((current.sequence % keyframeInterval) == 0) {
+			flags |= KEYFRAME;
+		}
+	}
+
+	const bool rotationDelta = !(flags & KEYFRAME) &&
+		(current.largestComponent == it->second.largestComponent);
+	if (rotationDelta) {
+		flags |= ROTATION_DELTA;
+	}
+
+	buffer.clear();
+	buffer.reserve(fixedSize + packedRotationSize + 12);
+
+	buffer.push_back(static_cast<std::uint8_t>(update.target));
+	buffer.push_back(flags);
+	buffer.push_back(current.sequence);
+	writeUInt32(static_cast<std::uint32_t>(update.objectId), buffer);
+	writeUInt32(static_cast<std::uint32_t>(update.peerId), buffer);
+
+	if (rotationDelta) {
+		for (int i = 0; i < 3; ++i) {
+			writeDelta(static_cast<std::int64_t>(current.rotation[i]) -
+					it->second.rotation[i],
+				buffer);
+		}
+	}
+	else {
+		writePackedRotation(current, buffer);
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		if (flags & KEYFRAME) {
+			writeUInt32(static_cast<std::uint32_t>(current.translation[i]),
+				buffer);
+		}
+		else {
+			writeDelta(static_cast<std::int64_t>(current.translation[i]) -
+					it->second.translation[i],
+				buffer);
+		}
+	}
+
+	baselines[{update.target, update.objectId}] = current;
+}
+//=============================================================================
+
+//=============================================================================
+bool decode(const std::uint8_t* data, std::size_t size,
+	BaselineMapType& baselines, TransformUpdate& update)
+{
+	if (size < fixedSize) {
+		return false;
+	}
+
+	const auto target = data[targetOffset];
+	if (target > static_cast<std::uint8_t>(Target::WIDGET)) {
+		return false;
+	}
+
+	const auto flags = data[flagsOffset];
+	const bool keyframe = (flags & KEYFRAME) != 0;
+
+	update.target = static_cast<Target>(target);
+	update.objectId = readUInt32(data + objectIdOffset);
+	update.peerId = readUInt32(data + peerIdOffset);
+
+	Baseline current;
+	current.sequence = data[sequenceOffset];
+
+	auto it = baselines.find({update.target, update.objectId});
+	if (!keyframe &&
+		((it == baselines.end()) ||
+			(static_cast<std::uint8_t>(it->second.sequence + 1) !=
+				current.sequence))) {
+		return false;
+	}
+
+	const auto end = data + size;
+	auto bytes = data + fixedSize;
+
+	if (flags & ROTATION_DELTA) {
+		if (keyframe) {
+			return false;
+		}
+
+		current.largestComponent = it->second.largestComponent;
+		for (int i = 0; i < 3; ++i) {
+			std::int64_t delta;
+			if (!readDelta(bytes, end, delta)) {
+				return false;
+			}
+
+			auto value = it->second.rotation[i] + delta;
+			if ((value < 0) || (value > rotationScale)) {
+				return false;
+			}
+			current.rotation[i] = static_cast<std::uint16_t>(value);
+		}
+	}
+	else {
+		if (static_cast<std::size_t>(end - bytes) < packedRotationSize) {
+			return false;
+		}
+
+		readPackedRotation(bytes, current);
+		bytes += packedRotationSize;
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		if (keyframe) {
+			if ((end - bytes) < 4) {
+				return false;
+			}
+
+			current.translation[i] =
+				static_cast<std::int32_t>(readUInt32(bytes));
+			bytes += 4;
+		}
+		else {
+			std::int64_t delta;
+			if (!readDelta(bytes, end, delta)) {
+				return false;
+			}
+
+			auto value = it->second.translation[i] + delta;
+			if ((value < std::numeric_limits<std::int32_t>::min()) ||
+				(value > std::numeric_limits<std::int32_t>::max())) {
+				return false;
+			}
+			current.translation[i] = static_cast<std::int32_t>(value);
+		}
+	}
+
+	if (bytes != end) {
+		return false;
+	}
+
+	update.transform = TransformType::Identity();
+	update.transform.linear() = dequantizeRotation(current);
+	for (int i = 0; i < 3; ++i) {
+		update.transform.translation()(i) =
+			current.translation[i] * translationStep;
+	}
+
+	baselines[{update.target, update.objectId}] = current;
+
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+std::optional<Header> readHeader(const std::uint8_t* data, std::size_t size)
+{
+	if ((size < fixedSize) ||
+		(data[targetOffset] > static_cast<std::uint8_t>(Target::WIDGET))) {
+		return std::nullopt;
+	}
+
+	Header header;
+	header.target = static_cast<Target>(data[targetOffset]);
+	header.objectId = readUInt32(data + objectIdOffset);
+	header.keyframe = (data[flagsOffset] & KEYFRAME) != 0;
+
+	return header;
+}
+//=============================================================================
+
+//=============================================================================
+std::optional<TransformType> fromPropertyList(const PropertyListType& propList)
+{
+	if ((propList.size() != 1) ||
+		(propList.front().first.getId() != common::PropertyId::TRANSFORM)) {
+		return std::nullopt;
+	}
+
+	auto transform = std::get_if<TransformType>(&propList.front().second);
+	if (!transform) {
+		return std::nullopt;
+	}
+
+	// Scaling or shearing cannot be represented by a quaternion
+	const Eigen::Matrix3d linear = transform->linear();
+	if (!linear.allFinite() ||
+		!(linear * linear.transpose()).isIdentity(1.0e-6) ||
+		(linear.determinant() < 0.0)) {
+		return std::nullopt;
+	}
+
+	constexpr double maxSteps = std::numeric_limits<std::int32_t>::max();
+	for (int i = 0; i < 3; ++i) {
+		auto steps = transform->translation()(i) / translationStep;
+		if (!std::isfinite(steps) || (std::abs(steps) >= maxSteps)) {
+			return std::nullopt;
+		}
+	}
+
+	return *transform;
+}
+//=============================================================================
+}  // namespace compactTransform
@@ -0,0 +1,23 @@
+#include "appcore/fullStateChunk.h"
+#include "widgets/laserWidget.h"
+#include "widgets/splineWidget.h"
+#include "widgets/volumeWidget.h"
+#include "widgets/planeWidget.h"
+
+//==============================================================================
+FullStateChunk::FullStateChunk() : type{Type::END}, id{0}
+{
+}
+//==============================================================================
+
+//==============================================================================
+FullStateChunk::~FullStateChunk() = default;
+//==============================================================================
+
+//==============================================================================
+FullStateChunk::FullStateChunk(FullStateChunk&&) = default;
+//==============================================================================
+
+//==============================================================================
+FullStateChunk& FullStateChunk::operator=(FullStateChunk&&) = default;
+//==============================================================================
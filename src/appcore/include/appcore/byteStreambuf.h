@@ -0,0 +1,90 @@
+#ifndef byteStreambuf_h
+#define byteStreambuf_h
+
+#include <cstdint>
+#include <ios>
+#include <streambuf>
+#include <vector>
+
+namespace serialization
+{
+// Read-only stream buffer over bytes owned by someone else, such as the
+// payload of a NetworkMessage, so that an archive can read them in place.
+// The bytes must outlive the buffer and stay unmodified
+class SpanStreambuf : public std::streambuf
+{
+public:
+	SpanStreambuf(const std::uint8_t* data, std::size_t size)
+	{
+		// The get area is never written through, despite the pointer type
+		auto begin = reinterpret_cast<char*>(const_cast<std::uint8_t*>(data));
+		setg(begin, begin, begin + size);
+	}
+
+protected:
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+		std::ios_base::openmode which = std::ios_base::in) override
+	{
+		if (!(which & std::ios_base::in)) {
+			return pos_type(off_type(-1));
+		}
+
+		off_type position = offset;
+		if (direction == std::ios_base::cur) {
+			position += gptr() - eback();
+		}
+		else if (direction == std::ios_base::end) {
+			position += egptr() - eback();
+		}
+
+		return seekpos(pos_type(position), which);
+	}
+
+	pos_type seekpos(pos_type position,
+		std::ios_base::openmode which = std::ios_base::in) override
+	{
+		const off_type offset = position;
+		if (!(which & std::ios_base::in) || (offset < 0) ||
+			(offset > (egptr() - eback()))) {
+			return pos_type(off_type(-1));
+		}
+
+		setg(eback(), eback() + offset, egptr());
+		return position;
+	}
+};
+
+// Write-only stream buffer appending to a byte vector, so that an archive can
+// write the payload of a NetworkMessage without an intermediate string
+class VectorStreambuf : public std::streambuf
+{
+public:
+	explicit VectorStreambuf(std::vector<std::uint8_t>& bytes) : m_Bytes{bytes}
+	{
+	}
+
+protected:
+	int_type overflow(int_type ch) override
+	{
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			m_Bytes.push_back(
+				static_cast<std::uint8_t>(traits_type::to_char_type(ch)));
+		}
+
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char* data, std::streamsize count) override
+	{
+		auto bytes = reinterpret_cast<const std::uint8_t*>(data);
+		m_Bytes.insert(m_Bytes.end(), bytes, bytes + count);
+
+		return count;
+	}
+
+private:
+	std::vector<std::uint8_t>& m_Bytes;
+};
+}  // namespace serialization
+
+#endif
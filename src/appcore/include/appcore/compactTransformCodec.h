@@ -0,0 +1,94 @@
+#ifndef compactTransformCodec_h
+#define compactTransformCodec_h
+
+#include "common/coreTypes.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Compact encoding of transform updates for the volume, cut plane and spline
+// widgets. Translations are quantized to a fixed grid and rotations are sent
+// as smallest-three quaternions. The first update of an object is a keyframe;
+// later ones are delta coded against the previous update of that object in
+// the same stream. Connections are reliable and ordered, so whatever was last
+// written is also the receiver's baseline. Layout (little-endian):
+//
+//   offset  size  field
+//        0     1  target (volume, plane or widget)
+//        1     1  flags (keyframe, rotation delta)
+//        2     1  sequence number of the update for this object
+//        3     4  object id (widget id, zero otherwise)
+//        7     4  peer id (update id or widget owner)
+//       11     -  rotation: 6 bytes packed, or 3 zigzag varint deltas
+//        -     -  translation: 3 x int32, or 3 zigzag varint deltas
+namespace compactTransform
+{
+using IdType = common::IdType;
+using TransformType = common::TransformType;
+using PropertyListType = common::PropertyListType;
+
+enum class Target : std::uint8_t {
+	VOLUME,
+	PLANE,
+	WIDGET
+};
+
+struct TransformUpdate
+{
+	Target target = Target::VOLUME;
+	IdType objectId = 0;
+	IdType peerId = 0;
+	TransformType transform = TransformType::Identity();
+};
+
+// Size of one translation step, in scene units
+inline constexpr double translationStep = 1.0e-4;
+
+// Every keyframeInterval-th update of an object is sent as a keyframe so a
+// receiver which lost its baseline recovers without a round trip
+inline constexpr unsigned int keyframeInterval = 64;
+
+// Quantized form of the last transform exchanged for an object
+struct Baseline
+{
+	std::array<std::int32_t, 3> translation{0, 0, 0};
+	std::array<std::uint16_t, 3> rotation{0, 0, 0};
+	std::uint8_t largestComponent = 0;
+	std::uint8_t sequence = 0;
+};
+
+using BaselineKeyType = std::pair<Target, IdType>;
+using BaselineMapType = std::map<BaselineKeyType, Baseline>;
+
+// Replaces the contents of the buffer with the encoded update and advances
+// the object's baseline
+void encode(const TransformUpdate& update, BaselineMapType& baselines,
+	std::vector<std::uint8_t>& buffer);
+
+// Returns false if the data is malformed, or is a delta which does not
+// follow the stored baseline; the baseline is only advanced on success
+bool decode(const std::uint8_t* data, std::size_t size,
+	BaselineMapType& baselines, TransformUpdate& update);
+
+// Fields of an encoded update which can be read without decoding it
+struct Header
+{
+	Target target = Target::VOLUME;
+	IdType objectId = 0;
+	bool keyframe = false;
+};
+
+// Returns nothing if the data is too short or names no valid target
+std::optional<Header> readHeader(const std::uint8_t* data, std::size_t size);
+
+// Returns the transform if the property list holds nothing but a rigid
+// transform within the quantization range, or nothing if the generic
+// property path is required
+std::optional<TransformType> fromPropertyList(const PropertyListType& propList);
+}  // namespace compactTransform
+
+#endif
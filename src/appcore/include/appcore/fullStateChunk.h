@@ -0,0 +1,53 @@
+#ifndef fullStateChunk_h
+#define fullStateChunk_h
+
+#include "common/coreTypes.h"
+#include "appcore/messages.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class LaserWidget;
+class VolumeWidget;
+class SplineWidget;
+class PlaneWidget;
+
+// One part of the state sent to a joining peer in FULL_STATE_CHUNK messages:
+// the peer list, which opens the state, a single object, or the marker which
+// closes it. Only the member matching the type is set. Object chunks are
+// also sent on their own, when a peer subscribes to objects it skipped so
+// far, and replace just that object
+class FullStateChunk
+{
+public:
+	using IdType = common::IdType;
+
+	enum class Type : std::uint8_t {
+		PEERS,
+		VOLUME,
+		PLANE,
+		LASER,
+		WIDGET,
+		END
+	};
+
+	FullStateChunk();
+	~FullStateChunk();
+
+	FullStateChunk(const FullStateChunk&) = delete;
+	FullStateChunk& operator=(const FullStateChunk&) = delete;
+
+	FullStateChunk(FullStateChunk&&);
+	FullStateChunk& operator=(FullStateChunk&&);
+
+	Type type;
+	IdType id;	// laser or widget id
+	std::vector<PeerInfo> peers;
+	std::unique_ptr<VolumeWidget> volume;
+	std::unique_ptr<PlaneWidget> cutplane;
+	std::unique_ptr<LaserWidget> laser;
+	std::unique_ptr<SplineWidget> widget;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef laserPoseCodec_h
+#define laserPoseCodec_h
+
+#include "common/coreTypes.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+struct LaserUpdate;
+
+// Fixed-layout binary encoding of laser pose updates, the highest-rate
+// traffic in a session. Encoding and decoding work on caller-provided
+// buffers and never allocate. Layout (little-endian):
+//
+//   offset  size  field
+//        0     4  laser id
+//        4     4  sequence number
+//        8     1  field mask (which of base/tip/color are present)
+//        9     3  color as 8-bit RGB
+//       12    24  base as 3 x float64
+//       36    24  tip as 3 x float64
+namespace laserPose
+{
+using IdType = common::IdType;
+using PointType = common::Point3dType;
+using ColorVectorType = common::ColorVectorType;
+
+enum Field : std::uint8_t {
+	BASE = 1u << 0,
+	TIP = 1u << 1,
+	COLOR = 1u << 2
+};
+
+struct LaserPose
+{
+	IdType id = 0;
+	std::uint32_t sequence = 0;
+	std::uint8_t fields = 0;
+	PointType base{0.0, 0.0, 0.0};
+	PointType tip{0.0, 0.0, 0.0};
+	ColorVectorType color{0.0, 0.0, 0.0};
+};
+
+inline constexpr std::size_t encodedSize = 60;
+
+using BufferType = std::array<std::uint8_t, encodedSize>;
+
+void encode(const LaserPose& pose, BufferType& buffer);
+
+// Returns false if the buffer does not hold exactly one encoded pose
+bool decode(const std::uint8_t* data, std::size_t size, LaserPose& pose);
+
+// Returns a pose if every property in the update has a fixed-layout
+// representation, or nothing if the generic property path is required
+std::optional<LaserPose> fromLaserUpdate(const LaserUpdate& laserUpdate);
+
+LaserUpdate toLaserUpdate(const LaserPose& pose);
+}  // namespace laserPose
+
+#endif
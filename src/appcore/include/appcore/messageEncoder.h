@@ -3,27 +3,45 @@
 
 #include "common/coreTypes.h"
 #include "networking/networkMessage.h"
+#include "appcore/serializationTypes.h"
+#include "appcore/compactTransformCodec.h"
+#include "appcore/updateCoalescer.h"
 
 #include <functional>
 #include <array>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 class PeerInfo;
 class PeerCredentials;
+class PeerCapabilities;
+class DatagramChannelOffer;
 class LaserUpdate;
 class VolumeUpdate;
 class WidgetUpdate;
 class PlaneUpdate;
+class Subscription;
 class ApplicationObjects;
+class SceneState;
+class FullStateChunk;
 
 class MessageEncoder
 {
 public:
 	using ColorVectorType = common::ColorVectorType;
 	using IdType = common::IdType;
-	using PeerCredentialsRequetedCallbackType = std::function<void()>;
+	using ObjectType = UpdateCoalescer::ObjectType;
+	using ArchiveFormat = serialization::ArchiveFormat;
+	using PeerCredentialsRequetedCallbackType =
+		std::function<void(const PeerCapabilities&)>;
 	using PeerCredentialsReceivedCallbackType =
 		std::function<void(const PeerCredentials&, IdType)>;
+	using PeerCapabilitiesReceivedCallbackType =
+		std::function<void(const PeerCapabilities&, IdType)>;
+	using DatagramChannelOfferedCallbackType =
+		std::function<void(const DatagramChannelOffer&)>;
 
 	using AuthorizationSuccessCallbackType =
 		std::function<void(const PeerInfo&)>;
@@ -48,7 +66,15 @@ public:
 	using FullStateUpdateCallbackType =
 		std::function<void(const std::vector<PeerInfo>&, ApplicationObjects&&)>;
 
-	MessageEncoder() = default;
+	using FullStateChunkCallbackType = std::function<void(FullStateChunk&&)>;
+	using StatisticsRequestedCallbackType = std::function<void(IdType)>;
+	using StatisticsReceivedCallbackType =
+		std::function<void(const std::string&)>;
+	using SubscriptionReceivedCallbackType =
+		std::function<void(const Subscription&, IdType)>;
+	using MessageSinkType = std::function<void(NetworkMessage&&)>;
+
+	explicit MessageEncoder(ArchiveFormat format = ArchiveFormat::JSON);
 	~MessageEncoder() = default;
 
 	MessageEncoder(const MessageEncoder&) = default;
@@ -65,13 +91,49 @@ public:
 	NetworkMessage createPlaneUpdateMsg(const PlaneUpdate&);
 	NetworkMessage createPeerAddedMsg(const PeerInfo&);
 	NetworkMessage createPeerRemovedMsg(const PeerInfo&);
-	NetworkMessage createRequestCredentialsMsg();
+	NetworkMessage createRequestCredentialsMsg(const PeerCapabilities&);
 	NetworkMessage createPeerCredentialsMsg(const PeerCredentials&);
+	NetworkMessage createPeerCapabilitiesMsg(const PeerCapabilities&);
 	NetworkMessage createAuthenticationSucceededMsg(const PeerInfo&);
 	NetworkMessage createAuthenticationFailedMsg();
 	NetworkMessage createFullStateMsg(const std::vector<PeerInfo>&,
 		const ApplicationObjects&);
 
+	// Same message from the scene state of the server, which peers load
+	// into ApplicationObjects just the same
+	NetworkMessage createFullStateMsg(
+		const std::vector<PeerInfo>&, const SceneState&);
+	NetworkMessage createDatagramChannelMsg(const DatagramChannelOffer&);
+
+	// Query of the message statistics of the server, and its answer: the
+	// report of MessageStatistics::format
+	NetworkMessage createStatisticsRequestMsg();
+	NetworkMessage createStatisticsMsg(const std::string& report);
+	NetworkMessage createSubscriptionMsg(const Subscription&);
+
+	// Splits the full state into FULL_STATE_CHUNK messages: the peers first,
+	// then one message per object and a closing one. Each message is handed
+	// to the sink as soon as it is encoded, so only one is held at a time
+	// and the receiver can start applying the state before all of it is in
+	void createFullStateChunks(const std::vector<PeerInfo>&,
+		const ApplicationObjects&, const MessageSinkType& sink);
+	void createFullStateChunks(const std::vector<PeerInfo>&,
+		const SceneState&, const MessageSinkType& sink);
+
+	// The chunk of a single object of the scene, which peers apply on its
+	// own, to bring that object up to date without disturbing the rest of
+	// their state. Nothing is sent if the scene does not hold the object
+	void createFullStateChunk(const SceneState&, ObjectType, IdType,
+		const MessageSinkType& sink);
+
+	// Messages which hold the complete latest state of a single stream, such
+	// as a laser pose or a transform keyframe, may be sent over an unreliable
+	// datagram channel, where a newer one makes up for a lost one. Returns
+	// the key of their stream, or nothing for any message which has to be
+	// delivered reliably and in order
+	static std::optional<std::uint64_t> getLatestWinsKey(
+		const NetworkMessage&);
+
 	void setOnCredentialsRequestedCallback(
 		PeerCredentialsRequetedCallbackType clbk);
 	void setOnPeerCredentialsReceivedCallback(
@@ -86,10 +148,72 @@ public:
 	void setOnWidgetUpdatedCallback(WidgetUpdateCallbackType);
 	void setOnPlaneUpdatedCallback(PlaneUpdateCallbackType);
 	void setOnFullStateUpdatedCallback(FullStateUpdateCallbackType);
+	void setOnFullStateChunkReceivedCallback(FullStateChunkCallbackType);
+	void setOnPeerCapabilitiesReceivedCallback(
+		PeerCapabilitiesReceivedCallbackType clbk);
+	void setOnDatagramChannelOfferedCallback(
+		DatagramChannelOfferedCallbackType clbk);
+	void setOnStatisticsRequestedCallback(StatisticsRequestedCallbackType clbk);
+	void setOnStatisticsReceivedCallback(StatisticsReceivedCallbackType clbk);
+	void setOnSubscriptionReceivedCallback(
+		SubscriptionReceivedCallbackType clbk);
+
+	// Archive used for outgoing non-handshake messages. Handshake messages
+	// are always JSON so that peers which predate negotiation understand them
+	void setArchiveFormat(ArchiveFormat format);
+	ArchiveFormat getArchiveFormat() const;
+
+	// Whether laser updates use the fixed-layout LASER_POSE encoding when
+	// their properties allow it
+	void setLaserPoseEnabled(bool enabled);
+	bool isLaserPoseEnabled() const;
+
+	// Whether volume, plane and widget transform updates use the compact
+	// delta-coded TRANSFORM_UPDATE encoding when their properties allow it
+	void setCompactTransformEnabled(bool enabled);
+	bool isCompactTransformEnabled() const;
+
+	// Whether every compact transform update is sent as a keyframe, so that
+	// each one stands on its own when sent over a datagram channel
+	void setDatagramChannelEnabled(bool enabled);
+	bool isDatagramChannelEnabled() const;
+
+	// Restarts every compact transform stream, in both directions, so that
+	// the next update of each object is a keyframe. Call whenever the peer on
+	// the other end may not hold the current baselines
+	void resetTransformBaselines();
+
+	// Whether messages in the binary archive are read from the sender, which
+	// only sends them once it negotiated BINARY_ARCHIVE. Others are dropped
+	// unread. An encoder set to the binary archive reads it from any sender,
+	// as that of a client, which only hears from the server it negotiated with
+	void setBinaryArchiveAccepted(IdType senderId, bool accepted);
+	bool acceptsBinaryArchive(IdType senderId) const;
+
+	// Drops what is kept of a sender which has gone away: the transform
+	// baselines received from it, and whether it may send the binary archive
+	void removeSender(IdType senderId);
+
+	// Configures the outgoing encodings from a negotiated capability set
+	void setPeerCapabilities(const PeerCapabilities& capabilities);
 
 private:
+	NetworkMessage createTransformUpdateMsg(
+		const compactTransform::TransformUpdate&);
+
+	ArchiveFormat m_ArchiveFormat;
+	bool m_LaserPoseEnabled;
+	std::uint32_t m_LaserPoseSequence;
+	bool m_CompactTransformEnabled;
+	bool m_DatagramChannelEnabled;
+	compactTransform::BaselineMapType m_SentTransformBaselines;
+	std::unordered_map<IdType, compactTransform::BaselineMapType>
+		m_ReceivedTransformBaselines;
+	std::unordered_set<IdType> m_BinaryArchiveSenders;
 	PeerCredentialsRequetedCallbackType m_PeerCredentialsRequestedCallback;
 	PeerCredentialsReceivedCallbackType m_PeerCredentialsReceivedCallback;
+	PeerCapabilitiesReceivedCallbackType m_PeerCapabilitiesReceivedCallback;
+	DatagramChannelOfferedCallbackType m_DatagramChannelOfferedCallback;
 	AuthorizationSuccessCallbackType m_PeerAuthSuccessCallback;
 	AuthorizationFailedCallbackType m_PeerAuthFailedCallback;
 	PeerAddedCallbackType m_PeerAddedCallback;
@@ -99,6 +223,10 @@ private:
 	WidgetUpdateCallbackType m_WidgetUpdateCallback;
 	PlaneUpdateCallbackType m_PlaneUpdateCallback;
 	FullStateUpdateCallbackType m_FullStateUpdateCallback;
+	FullStateChunkCallbackType m_FullStateChunkCallback;
+	StatisticsRequestedCallbackType m_StatisticsRequestedCallback;
+	StatisticsReceivedCallbackType m_StatisticsReceivedCallback;
+	SubscriptionReceivedCallbackType m_SubscriptionReceivedCallback;
 };
 
 #endif
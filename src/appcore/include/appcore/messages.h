@@ -3,7 +3,10 @@
 
 #include "common/coreTypes.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 struct PeerInfo
 {
@@ -32,6 +35,50 @@ struct PeerCredentials
 	std::string alias;
 };
 
+// Optional protocol features a peer understands. The server advertises its
+// set with REQUEST_CREDENTIALS and the client answers with its own; features
+// are only used when present in both
+struct PeerCapabilities
+{
+	using FlagsType = std::uint32_t;
+
+	enum Flag : FlagsType {
+		BINARY_ARCHIVE = 1u << 0,
+		LASER_POSE = 1u << 1,
+		COMPACT_TRANSFORM = 1u << 2,
+		MESSAGE_BATCH = 1u << 3,
+		DATAGRAM_CHANNEL = 1u << 4,
+		CHUNKED_FULL_STATE = 1u << 5,
+		FRAME_V2 = 1u << 6,
+		SUBSCRIPTIONS = 1u << 7
+	};
+
+	// Capabilities implemented by this build
+	static constexpr FlagsType supported = BINARY_ARCHIVE | LASER_POSE |
+		COMPACT_TRANSFORM | MESSAGE_BATCH | DATAGRAM_CHANNEL |
+		CHUNKED_FULL_STATE | FRAME_V2 | SUBSCRIPTIONS;
+
+	explicit PeerCapabilities(FlagsType flags = 0) : flags{flags} {}
+
+	bool has(Flag flag) const { return (flags & flag) != 0; }
+
+	FlagsType flags;
+};
+
+// Sent by the server once a peer is authorized, if it serves a datagram
+// channel: the peer probes the port with the token to set up its endpoint
+struct DatagramChannelOffer
+{
+	explicit DatagramChannelOffer(std::uint16_t port = 0,
+		std::uint64_t token = 0) :
+		port{port},
+		token{token}
+	{}
+
+	std::uint16_t port;
+	std::uint64_t token;
+};
+
 struct LaserUpdate
 {
 	using IdType = common::IdType;
@@ -116,4 +163,43 @@ struct PlaneUpdate
 	PropertyListType propList;
 };
 
+// Declared by a peer once authorized, if the server offered SUBSCRIPTIONS:
+// which property updates it wants of each type of object, and how often.
+// Events, such as peers joining and widgets being created or destroyed,
+// reach every peer regardless. Peers which declare nothing get everything
+// at full rate. Objects a peer starts to take updates of are sent to it as
+// FULL_STATE_CHUNKs of their own, so subscriptions are only honored if
+// CHUNKED_FULL_STATE was negotiated as well
+struct Subscription
+{
+	using IdType = common::IdType;
+
+	enum class RateClass : std::uint8_t {
+		FULL_RATE,	// every broadcast of the server
+		PREVIEW,	// the latest values, at previewRate
+		EVENTS_ONLY	// no property updates
+	};
+
+	struct Filter
+	{
+		// Whether property updates of the object are wanted at all
+		bool includes(IdType id) const
+		{
+			return (rateClass != RateClass::EVENTS_ONLY) &&
+				(ids.empty() ||
+					(std::find(ids.begin(), ids.end(), id) != ids.end()));
+		}
+
+		RateClass rateClass = RateClass::FULL_RATE;
+		std::vector<IdType> ids;	// every object if empty
+	};
+
+	static constexpr double previewRate = 10.0;
+
+	Filter lasers;	// by peer id
+	Filter volume;
+	Filter plane;
+	Filter widgets;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef sceneState_h
+#define sceneState_h
+
+#include "common/coreTypes.h"
+#include "appcore/updateCoalescer.h"
+
+#include <vector>
+
+// The shared scene as the server holds it: the properties peers exchange,
+// as plain values, without the VTK objects which render them on the
+// clients. Lasers and widgets are kept in vectors sorted by id. Property
+// updates are applied the way the widgets apply them, and what was applied
+// is returned for rebroadcast. FULL_STATE saves it in the same form as the
+// widgets of ApplicationObjects, so peers load either alike
+class SceneState
+{
+public:
+	using IdType = common::IdType;
+	using PointType = common::Point3dType;
+	using TransformType = common::TransformType;
+	using ColorVectorType = common::ColorVectorType;
+	using PropertyListType = common::PropertyListType;
+	using ObjectType = UpdateCoalescer::ObjectType;
+	using NodeListType = std::vector<PointType>;
+
+	static constexpr double defaultLaserLength = 150.0;
+
+	struct Laser
+	{
+		IdType id;
+		PointType base;
+		PointType tip;
+		ColorVectorType color;
+	};
+
+	struct Volume
+	{
+		TransformType transform;
+	};
+
+	struct Plane
+	{
+		TransformType transform;
+	};
+
+	// Nodes are held relative to the transform, so they move along with it.
+	// Widgets follow the volume from where they were created, as they are
+	// attached to it
+	struct Widget
+	{
+		NodeListType getNodes() const;
+
+		IdType id;
+		NodeListType nodes;
+		TransformType transform;
+		TransformType volumeOffset;
+	};
+
+	// Properties of an object as applied, to be rebroadcast
+	struct Update
+	{
+		ObjectType type;
+		IdType id;
+		PropertyListType propList;
+	};
+
+	using UpdateListType = std::vector<Update>;
+
+	SceneState();
+
+	// Adds an object with default properties, or returns the existing one
+	const Laser& addLaser(IdType, const ColorVectorType& color);
+	const Widget& addWidget(IdType);
+
+	bool removeLaser(IdType);
+	bool removeWidget(IdType);
+
+	// Null if there is no object with the id
+	const Laser* findLaser(IdType) const;
+	const Widget* findWidget(IdType) const;
+
+	const std::vector<Laser>& getLasers() const;
+	const std::vector<Widget>& getWidgets() const;
+	const Volume& getVolume() const;
+	const Plane& getPlane() const;
+
+	// Applies the properties of an object. Properties the object does not
+	// have, and values of the wrong type, non-finite or out of range, are
+	// skipped. Returns the update of the object, if anything was applied,
+	// followed by those of any objects which moved along with it
+	UpdateListType updateLaser(IdType, const PropertyListType&);
+	UpdateListType updateVolume(const PropertyListType&);
+	UpdateListType updatePlane(const PropertyListType&);
+	UpdateListType updateWidget(IdType, const PropertyListType&);
+
+	// Replaces the objects which outlive the peers, as saved by a
+	// SessionJournal. Widgets are taken as they are, in any order
+	void restore(std::vector<Widget>, const Volume&, const Plane&);
+
+private:
+	Laser* getLaser(IdType);
+	Widget* getWidget(IdType);
+
+	std::vector<Laser> m_Lasers;
+	std::vector<Widget> m_Widgets;
+	Volume m_Volume;
+	Plane m_Plane;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "common/coreTypes.h"
 #include "appcore/applicationObjects.h"
 #include "appcore/messages.h"
+#include "appcore/sceneState.h"
 
 #include <cereal/types/vector.hpp>
 #include <cereal/types/variant.hpp>
@@ -12,6 +13,72 @@
 #include <cereal/types/utility.hpp>
 #include <cereal/types/optional.hpp>
 #include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace serialization
+{
+// Views which save an object of the scene state as cereal saves a non-null
+// std::unique_ptr to it, and a list of them as a map from id to such
+// pointers. The scene state thus saves exactly as ApplicationObjects does,
+// with its widgets held by unique_ptr in unordered_maps
+template <class T>
+struct UniquePtrView
+{
+	const T& object;
+};
+
+template <class T>
+struct PtrWrapperView
+{
+	const T& object;
+};
+
+template <class T>
+struct ObjectMapView
+{
+	const std::vector<T>& objects;
+};
+
+template <class T>
+UniquePtrView<T> asUniquePtr(const T& object)
+{
+	return UniquePtrView<T>{object};
+}
+
+template <class T>
+ObjectMapView<T> asObjectMap(const std::vector<T>& objects)
+{
+	return ObjectMapView<T>{objects};
+}
+
+template <class Archive, class T>
+void save(Archive& archive, const UniquePtrView<T>& view)
+{
+	archive(cereal::make_nvp("ptr_wrapper", PtrWrapperView<T>{view.object}));
+}
+
+template <class Archive, class T>
+void save(Archive& archive, const PtrWrapperView<T>& view)
+{
+	archive(cereal::make_nvp("valid", std::uint8_t{1}));
+	archive(cereal::make_nvp("data", view.object));
+}
+
+template <class Archive, class T>
+void save(Archive& archive, const ObjectMapView<T>& view)
+{
+	archive(cereal::make_size_tag(
+		static_cast<cereal::size_type>(view.objects.size())));
+
+	for (const auto& object : view.objects) {
+		archive(cereal::make_map_item(object.id, asUniquePtr(object)));
+	}
+}
+}  // namespace serialization
 
 namespace cereal
 {
@@ -58,6 +125,37 @@ void load(Archive& archive, common::Vector3dType& vector)
 	archive(vector(2));
 }
 //==============================================================================
+// Property keys travel by name in text archives, as they always have, so
+// that JSON peers stay compatible, and names this build does not know are
+// written back as read. Binary archives carry the registry id, which holds
+// no name, so such keys go out as UNKNOWN
+template <class Archive,
+	traits::EnableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+std::string save_minimal(const Archive&, const common::PropertyKey& key)
+{
+	return std::string(key.getName());
+}
+template <class Archive,
+	traits::EnableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+void load_minimal(
+	const Archive&, common::PropertyKey& key, const std::string& name)
+{
+	key = common::PropertyKey::fromName(name);
+}
+template <class Archive,
+	traits::DisableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+std::uint16_t save_minimal(const Archive&, const common::PropertyKey& key)
+{
+	return static_cast<std::uint16_t>(key.getId());
+}
+template <class Archive,
+	traits::DisableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+void load_minimal(
+	const Archive&, common::PropertyKey& key, const std::uint16_t& id)
+{
+	key = common::PropertyKey{static_cast<common::PropertyId>(id)};
+}
+//==============================================================================
 template <class Archive>
 void serialize(Archive& archive, PeerInfo& peerInfo)
 {
@@ -74,6 +172,19 @@ void serialize(Archive& archive, PeerCredentials& credentials)
 }
 //==============================================================================
 template <class Archive>
+void serialize(Archive& archive, PeerCapabilities& capabilities)
+{
+	archive(cereal::make_nvp("flags", capabilities.flags));
+}
+//==============================================================================
+template <class Archive>
+void serialize(Archive& archive, DatagramChannelOffer& offer)
+{
+	archive(cereal::make_nvp("port", offer.port),
+		cereal::make_nvp("token", offer.token));
+}
+//==============================================================================
+template <class Archive>
 void serialize(Archive& archive, LaserUpdate& l)
 {
 	archive(
@@ -105,6 +216,22 @@ void serialize(Archive& archive, PlaneUpdate& p)
 }
 //==============================================================================
 template <class Archive>
+void serialize(Archive& archive, Subscription::Filter& filter)
+{
+	archive(cereal::make_nvp("rateClass", filter.rateClass),
+		cereal::make_nvp("ids", filter.ids));
+}
+//==============================================================================
+template <class Archive>
+void serialize(Archive& archive, Subscription& subscription)
+{
+	archive(cereal::make_nvp("lasers", subscription.lasers),
+		cereal::make_nvp("volume", subscription.volume),
+		cereal::make_nvp("plane", subscription.plane),
+		cereal::make_nvp("widgets", subscription.widgets));
+}
+//==============================================================================
+template <class Archive>
 void serialize(Archive& archive, ApplicationObjects& objects)
 {
 	archive(cereal::make_nvp("lasers", objects.lasers));
@@ -113,6 +240,43 @@ void serialize(Archive& archive, ApplicationObjects& objects)
 	archive(cereal::make_nvp("planeWidget", objects.cutplane));
 }
 //==============================================================================
+// Same fields as the widgets save
+template <class Archive>
+void save(Archive& archive, const SceneState::Laser& laser)
+{
+	archive(cereal::make_nvp("base", laser.base),
+		cereal::make_nvp("tip", laser.tip),
+		cereal::make_nvp("color", laser.color));
+}
+template <class Archive>
+void save(Archive& archive, const SceneState::Volume& volume)
+{
+	archive(cereal::make_nvp("transform", volume.transform));
+}
+template <class Archive>
+void save(Archive& archive, const SceneState::Plane& plane)
+{
+	archive(cereal::make_nvp("transform", plane.transform));
+}
+template <class Archive>
+void save(Archive& archive, const SceneState::Widget& widget)
+{
+	archive(cereal::make_nvp("nodes", widget.getNodes()));
+	archive(cereal::make_nvp("transform", widget.transform));
+}
+//==============================================================================
+template <class Archive>
+void save(Archive& archive, const SceneState& scene)
+{
+	using serialization::asObjectMap;
+	using serialization::asUniquePtr;
+
+	archive(cereal::make_nvp("lasers", asObjectMap(scene.getLasers())));
+	archive(cereal::make_nvp("volume", asUniquePtr(scene.getVolume())));
+	archive(cereal::make_nvp("widgets", asObjectMap(scene.getWidgets())));
+	archive(cereal::make_nvp("planeWidget", asUniquePtr(scene.getPlane())));
+}
+//==============================================================================
 }  // end namespace cereal
 
 #endif
\ No newline at end of file
@@ -3,12 +3,54 @@
 
 #include <cereal/archives/json.hpp>
 #include <cereal/archives/binary.hpp>
+#include <cereal/archives/portable_binary.hpp>
 #include <cereal/archives/xml.hpp>
+#include <cereal/archives/adapters.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <ios>
+#include <streambuf>
 
 namespace serialization
 {
 	using InputArchiveType = cereal::JSONInputArchive;
 	using OutputArchiveType = cereal::JSONOutputArchive;
+
+	// Compact, endian-independent archives used once both peers have
+	// negotiated support for them. The input archive is constructed with the
+	// buffer it reads from, against which the lengths it reads are checked
+	using BinaryInputArchiveType = cereal::UserDataAdapter<std::streambuf,
+		cereal::PortableBinaryInputArchive>;
+	using BinaryOutputArchiveType = cereal::PortableBinaryOutputArchive;
+
+	enum class ArchiveFormat : std::uint8_t {
+		JSON,
+		BINARY
+	};
+
+	inline constexpr std::size_t archiveFormatCount = 2;
+}
+
+namespace cereal
+{
+	// Lengths of strings and containers read by the binary archive, which
+	// are sized to them before their elements are read. As every element
+	// takes at least a byte, a length beyond the bytes left in the buffer
+	// cannot be right, and is refused before a few bytes of a peer can make
+	// a container allocate gigabytes. Preferred over the template of cereal
+	// for the same archive
+	inline void serialize(
+		PortableBinaryInputArchive& archive, SizeTag<size_type&>& tag)
+	{
+		archive(tag.size);
+
+		const auto available = std::max<std::streamsize>(
+			get_user_data<std::streambuf>(archive).in_avail(), 0);
+		if (tag.size > static_cast<size_type>(available)) {
+			throw Exception("Length exceeds the bytes left in the archive");
+		}
+	}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,138 @@
+#ifndef session_h
+#define session_h
+
+#include "common/coreTypes.h"
+#include "appcore/messageEncoder.h"
+#include "appcore/messages.h"
+#include "appcore/sceneState.h"
+#include "appcore/sessionJournal.h"
+#include "appcore/updateCoalescer.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Everything the peers of a review session share: the scene, which peer
+// holds which object, and the encoders and coalescers of its broadcasts.
+// Nothing in it refers to another session, so what happens in one never
+// reaches the peers, the scene or the transform baselines of another
+struct Session
+{
+	using IdType = common::IdType;
+	using ColorVectorType = common::ColorVectorType;
+	using ObjectType = UpdateCoalescer::ObjectType;
+	using RateClass = Subscription::RateClass;
+	using WidgetOwnershipMap =
+		std::unordered_map<IdType, std::optional<IdType>>;
+	using OutputEncoderMap =
+		std::unordered_map<PeerCapabilities::FlagsType, MessageEncoder>;
+
+	struct Object
+	{
+		ObjectType type;
+		IdType id;
+	};
+
+	using ObjectListType = std::vector<Object>;
+
+	struct Peer
+	{
+		// Whether the peer wants property updates of the object at the
+		// rate class
+		bool wants(RateClass, ObjectType, IdType) const;
+
+		IdType id;
+		Subscription subscription;
+	};
+
+	// Adds the peer, with a laser of the color, if it has not joined yet
+	void addPeer(IdType, const ColorVectorType& color);
+
+	// Drops the peer and its laser, and releases whatever it held. Returns
+	// false if it is no peer of the session
+	bool removePeer(IdType);
+
+	// Null if the peer has not joined the session
+	Peer* findPeer(IdType);
+	const Peer* findPeer(IdType) const;
+
+	// Replaces the subscription of the peer. Returns the objects of the
+	// scene it now takes property updates of but did not before, of which it
+	// may hold stale copies. Objects it holds itself, its laser and whatever
+	// it owns, are left out, as are objects merely switching rate class,
+	// which lose nothing as long as both coalescers are flushed first
+	ObjectListType setSubscription(IdType, const Subscription&);
+
+	// Peers which want property updates of the object at the rate class, in
+	// the order they joined
+	std::vector<IdType> getSubscribers(RateClass, ObjectType, IdType) const;
+	bool hasSubscribers(RateClass, ObjectType, IdType) const;
+
+	// Encoder of the broadcasts of the rate class to peers with the
+	// capabilities. Each capability set and rate class is a separate
+	// outgoing stream, with its own baselines for delta-coded transforms
+	MessageEncoder& getEncoder(RateClass, const PeerCapabilities&);
+
+	// Restarts the transform streams of both rate classes for the peers
+	// with the capabilities, as for a peer which holds no baselines
+	void resetTransformBaselines(const PeerCapabilities&);
+
+	std::string code;
+	std::vector<Peer> peers;	// validated, in the order they joined
+	SceneState sceneState;
+	WidgetOwnershipMap widgetOwnershipMap;
+	std::optional<IdType> volumeOwner;
+	std::optional<IdType> planeOwner;
+	IdType nextAvailableWidgetId = 0;
+	UpdateCoalescer updateCoalescer;
+	OutputEncoderMap outputEncoders;
+
+	// Property updates for peers which subscribed to a preview, sent at
+	// Subscription::previewRate as a separate encoded stream
+	UpdateCoalescer previewCoalescer;
+	OutputEncoderMap previewEncoders;
+
+	std::unique_ptr<SessionJournal> journal;
+};
+
+// The sessions of a server by their code, which peers give in their
+// credentials to join one. Codes are told apart regardless of case, as they
+// also name the directories of the session journals. Sessions are held by
+// pointer, which the peers having joined them keep
+class SessionRegistry
+{
+public:
+	using SessionMap =
+		std::unordered_map<std::string, std::unique_ptr<Session>>;
+
+	// Length of generated codes; long enough that a code cannot be guessed
+	// by trying, yet short enough to be read out to the other reviewers
+	static constexpr std::size_t codeLength = 8;
+
+	// Adds a session under a new random code
+	Session& create();
+
+	// Adds a session under the code; null if the code is taken
+	Session* add(const std::string& code);
+
+	// Session with exactly the code; null if there is none
+	Session* find(const std::string& code) const;
+
+	// Whether a session has the code, regardless of case
+	bool isTaken(const std::string& code) const;
+
+	// In alphabetical order
+	std::vector<std::string> getCodes() const;
+
+	const SessionMap& getSessions() const;
+
+	static std::string generateCode(std::size_t length = codeLength);
+
+private:
+	SessionMap m_Sessions;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef sessionJournal_h
+#define sessionJournal_h
+
+#include "common/coreTypes.h"
+#include "appcore/sceneState.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Keeps the part of the scene which outlives its peers, the widgets, the
+// volume and the cut plane, in a directory, so that a restarted server picks
+// up where the previous one stopped. Applied updates are appended to a
+// journal, and a snapshot of the whole scene replaces the journal every so
+// often. Records are encoded by the caller and written by a background
+// thread, which commits all records queued in the meantime with a single
+// write and flush, so callers never wait on the disk. Records reach the
+// operating system once committed, and thus survive the server process,
+// though not necessarily the machine
+class SessionJournal
+{
+public:
+	using IdType = common::IdType;
+	using PathType = std::filesystem::path;
+
+	static constexpr const char* journalFileName = "session.journal";
+	static constexpr const char* snapshotFileName = "session.snapshot";
+
+	struct Statistics
+	{
+		std::uint64_t records = 0;	// committed to the journal
+		std::uint64_t commits = 0;	// writes of one or more records
+		std::uint64_t snapshots = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	explicit SessionJournal(const PathType& directory);
+
+	// Commits whatever is still queued
+	~SessionJournal();
+
+	SessionJournal(const SessionJournal&) = delete;
+	SessionJournal& operator=(const SessionJournal&) = delete;
+
+	// Loads the snapshot and the journal records written after it into the
+	// scene. Reading stops at the first incomplete or corrupt record, as left
+	// by a server which died while writing it. Returns the number of records
+	// replayed, or nothing if the directory holds no session
+	std::optional<std::size_t> recover(SceneState&);
+
+	// Starts the writer with the scene as its first snapshot, which replaces
+	// any earlier session in the directory. Returns false if the directory
+	// cannot be written
+	bool start(const SceneState&);
+	void stop();
+	bool isStarted() const;
+
+	// Queue records of the widgets, the volume and the plane; updates of
+	// lasers are dropped, as their peers do not survive a restart
+	void recordUpdates(const SceneState::UpdateListType&);
+	void recordWidgetCreated(IdType);
+	void recordWidgetDestroyed(IdType);
+
+	// Queues a snapshot of the scene, which supersedes all records before it
+	void recordSnapshot(const SceneState&);
+
+	// Records queued since the last snapshot
+	std::uint64_t getRecordCountSinceSnapshot() const;
+
+	Statistics getStatistics() const;
+
+private:
+	// Encoded records and snapshots, each framed with its size and checksum
+	struct Entry
+	{
+		bool snapshot;
+		std::vector<std::uint8_t> bytes;
+	};
+
+	void enqueue(Entry&&);
+	void run();
+	void commit(std::vector<Entry>&);
+	bool writeSnapshot(const std::vector<std::uint8_t>&);
+
+	PathType m_Directory;
+	std::ofstream m_JournalFile;
+	std::uint64_t m_NextSequence;
+	std::uint64_t m_RecordCountSinceSnapshot;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::vector<Entry> m_Queue;
+	bool m_Stopping;
+	Statistics m_Statistics;
+	std::thread m_Thread;
+};
+
+#endif
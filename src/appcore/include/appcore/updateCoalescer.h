@@ -0,0 +1,72 @@
+#ifndef updateCoalescer_h
+#define updateCoalescer_h
+
+#include "common/coreTypes.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Holds property updates for rebroadcast until the next flush, keeping only
+// the latest value of each property of each object. Updates are sent in the
+// order in which their objects first became dirty; anything which must stay
+// ordered relative to them (interaction start/end, create/destroy) has to
+// flush first
+class UpdateCoalescer
+{
+public:
+	using IdType = common::IdType;
+	using PropertyListType = common::PropertyListType;
+	using SendCallbackType = std::function<void(const PropertyListType&)>;
+
+	enum class ObjectType {
+		LASER,
+		VOLUME,
+		PLANE,
+		WIDGET
+	};
+
+	struct Statistics
+	{
+		// Property updates handed to the coalescer
+		std::uint64_t receivedUpdates = 0;
+
+		// Updates sent on by a flush
+		std::uint64_t sentUpdates = 0;
+
+		// Updates merged into one already pending, i.e. messages not sent
+		std::uint64_t coalescedUpdates = 0;
+
+		// Property values replaced by a newer value before being sent
+		std::uint64_t supersededProperties = 0;
+	};
+
+	// Queues the properties of an object. The send callback of the latest
+	// update of the object is invoked with the merged properties on flush
+	void add(ObjectType type, IdType id, const PropertyListType& propList,
+		SendCallbackType send);
+
+	// Sends every pending update
+	void flush();
+
+	// Drops any pending update of an object which no longer exists
+	void discard(ObjectType type, IdType id);
+
+	bool isEmpty() const;
+
+	const Statistics& getStatistics() const;
+
+private:
+	struct PendingUpdate
+	{
+		ObjectType type;
+		IdType id;
+		PropertyListType propList;
+		SendCallbackType send;
+	};
+
+	std::vector<PendingUpdate> m_PendingUpdates;
+	Statistics m_Statistics;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "appcore/laserPoseCodec.h"
+#include "appcore/messages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+void writeUInt32(std::uint32_t value, std::uint8_t* bytes)
+{
+	for (int i = 0; i < 4; ++i) {
+		bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+	}
+}
+
+std::uint32_t readUInt32(const std::uint8_t* bytes)
+{
+	std::uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		value |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+	}
+
+	return value;
+}
+
+void writeDouble(double value, std::uint8_t* bytes)
+{
+	std::uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	for (int i = 0; i < 8; ++i) {
+		bytes[i] = static_cast<std::uint8_t>(bits >> (8 * i));
+	}
+}
+
+double readDouble(const std::uint8_t* bytes)
+{
+	std::uint64_t bits = 0;
+	for (int i = 0; i < 8; ++i) {
+		bits |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+	}
+
+	double value;
+	std::memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+std::uint8_t toColorByte(double channel)
+{
+	return static_cast<std::uint8_t>(
+		std::lround(std::clamp(channel, 0.0, 1.0) * 255.0));
+}
+
+constexpr std::size_t idOffset = 0;
+constexpr std::size_t sequenceOffset = 4;
+constexpr std::size_t fieldsOffset = 8;
+constexpr std::size_t colorOffset = 9;
+constexpr std::size_t baseOffset = 12;
+constexpr std::size_t tipOffset = 36;
+}  // namespace
+
+namespace laserPose
+{
+//=============================================================================
+void encode(const LaserPose& pose, BufferType& buffer)
+{
+	auto bytes = buffer.data();
+
+	writeUInt32(static_cast<std::uint32_t>(pose.id), bytes + idOffset);
+	writeUInt32(pose.sequence, bytes + sequenceOffset);
+	bytes[fieldsOffset] = pose.fields;
+
+	for (int i = 0; i < 3; ++i) {
+		bytes[colorOffset + i] = toColorByte(pose.color[i]);
+		writeDouble(pose.base(i), bytes + baseOffset + 8 * i);
+		writeDouble(pose.tip(i), bytes + tipOffset + 8 * i);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+bool decode(const std::uint8_t* data, std::size_t size, LaserPose& pose)
+{
+	if (size != encodedSize) {
+		return false;
+	}
+
+	pose.id = readUInt32(data + idOffset);
+	pose.sequence = readUInt32(data + sequenceOffset);
+	pose.fields = data[fieldsOffset];
+
+	for (int i = 0; i < 3; ++i) {
+		pose.color[i] = data[colorOffset + i] / 255.0;
+		pose.base(i) = readDouble(data + baseOffset + 8 * i);
+		pose.tip(i) = readDouble(data + tipOffset + 8 * i);
+	}
+
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+std::optional<LaserPose> fromLaserUpdate(const LaserUpdate& laserUpdate)
+{
+	LaserPose pose;
+	pose.id = laserUpdate.id;
+
+	for (const auto& [propKey, propValue] : laserUpdate.propList) {
+		switch (propKey.getId()) {
+			case common::PropertyId::BASE: {
+				auto base = std::get_if<PointType>(&propValue);
+				if (!base) {
+					return std::nullopt;
+				}
+				pose.base = *base;
+				pose.fields |= BASE;
+				break;
+			}
+			case common::PropertyId::TIP: {
+				auto tip = std::get_if<PointType>(&propValue);
+				if (!tip) {
+					return std::nullopt;
+				}
+				pose.tip = *tip;
+				pose.fields |= TIP;
+				break;
+			}
+			case common::PropertyId::COLOR: {
+				auto color = std::get_if<ColorVectorType>(&propValue);
+				if (!color) {
+					return std::nullopt;
+				}
+				pose.color = *color;
+				pose.fields |= COLOR;
+				break;
+			}
+			default:
+				return std::nullopt;
+		}
+	}
+
+	if (pose.fields == 0) {
+		return std::nullopt;
+	}
+
+	return pose;
+}
+//=============================================================================
+
+//=============================================================================
+LaserUpdate toLaserUpdate(const LaserPose& pose)
+{
+	LaserUpdate laserUpdate;
+	laserUpdate.id = pose.id;
+
+	if (pose.fields & COLOR) {
+		laserUpdate.propList.push_back({common::PropertyId::COLOR, pose.color});
+	}
+
+	if (pose.fields & BASE) {
+		laserUpdate.propList.push_back({common::PropertyId::BASE, pose.base});
+	}
+
+	if (pose.fields & TIP) {
+		laserUpdate.propList.push_back({common::PropertyId::TIP, pose.tip});
+	}
+
+	return laserUpdate;
+}
+//=============================================================================
+}  // namespace laserPose
@@ -3,33 +3,150 @@
 #include "appcore/serializationHelper.h"
 #include "appcore/serializationTypes.h"
 #include "appcore/applicationObjects.h"
+#include "appcore/sceneState.h"
+#include "appcore/byteStreambuf.h"
+#include "appcore/laserPoseCodec.h"
+#include "appcore/compactTransformCodec.h"
+#include "appcore/fullStateChunk.h"
 #include "widgets/laserWidget.h"
 #include "widgets/volumeWidget.h"
 #include "widgets/splineWidget.h"
 #include "widgets/planeWidget.h"
+#include "networking/messageStatistics.h"
 
-#include <sstream>
+#include <iostream>
+#include <istream>
+#include <ostream>
 #include <vector>
+
+namespace
+{
+using ArchiveFormat = serialization::ArchiveFormat;
+
+// Serializes the values into the payload of a new message of the given type
+template <class... Types>
+NetworkMessage encodeMessage(NetworkMessage::DescriptorType type,
+	ArchiveFormat format, Types&&... values)
+{
+	NetworkMessage msg;
+
+	// The archive writes straight into the payload
+	{
+		serialization::VectorStreambuf buffer(msg.data);
+		std::ostream ss(&buffer);
+
+		if (format == ArchiveFormat::BINARY) {
+			serialization::BinaryOutputArchiveType oarchive(ss);
+			oarchive(std::forward<Types>(values)...);
+
+			type |= NetworkMessage::binaryArchiveFlag;
+		}
+		else {
+			// The JSON archive only completes its output when destroyed
+			serialization::OutputArchiveType oarchive(ss);
+			oarchive(std::forward<Types>(values)...);
+		}
+	}
+
+	msg.header = 0x00;
+	msg.type = type;
+	msg.size = msg.data.size();
+
+	return msg;
+}
+
+// Calls the function with an input archive over the message payload, using
+// the archive indicated by the message type. For payloads whose later values
+// depend on earlier ones. Returns false for a payload which does not decode,
+// which is to be dropped along with whatever was read of it
+template <class Function>
+bool decodeMessageWith(const NetworkMessage& msg, Function&& function)
+{
+	// The archive reads the payload in place
+	serialization::SpanStreambuf buffer(msg.data.data(), msg.data.size());
+	std::istream ss(&buffer);
+
+	try {
+		if (msg.type & NetworkMessage::binaryArchiveFlag) {
+			serialization::BinaryInputArchiveType iarchive(buffer, ss);
+			function(iarchive);
+		}
+		else {
+			serialization::InputArchiveType iarchive(ss);
+			function(iarchive);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "MessageEncoder: Dropping message of type " << msg.type
+				  << " which does not decode: " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Deserializes the message payload into the values
+template <class... Types>
+bool decodeMessage(const NetworkMessage& msg, Types&... values)
+{
+	return decodeMessageWith(msg, [&values...](auto& iarchive) {
+		iarchive(values...);
+	});
+}
+}  // namespace
+
+//=============================================================================
+MessageEncoder::MessageEncoder(ArchiveFormat format) :
+	m_ArchiveFormat{format},
+	m_LaserPoseEnabled{false},
+	m_LaserPoseSequence{0},
+	m_CompactTransformEnabled{false},
+	m_DatagramChannelEnabled{false}
+{
+}
+//=============================================================================
+
 //=============================================================================
 void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 {
 	using MessageType = NetworkMessage::MessageType;
+	using Stage = MessageStatistics::Stage;
 
-	switch (msg.type) {
+	// The binary archive is only read from senders which negotiated it, as
+	// JSON is the only archive every peer may send
+	if ((msg.type & NetworkMessage::binaryArchiveFlag) &&
+		!acceptsBinaryArchive(senderId)) {
+		return;
+	}
+
+	// Each case ends its DECODE stage once the message is decoded, and the
+	// rest of it is timed as the HANDLE stage
+	MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+		msg.type, msg.data.size(), Stage::DECODE};
+
+	switch (msg.type & ~NetworkMessage::binaryArchiveFlag) {
 		case MessageType::REQUEST_CREDENTIALS: {
+			// Servers which predate capability negotiation send no payload
+			PeerCapabilities capabilities;
+			if (!msg.data.empty() && !decodeMessage(msg, capabilities)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
+
 			if (m_PeerCredentialsRequestedCallback) {
-				m_PeerCredentialsRequestedCallback();
+				m_PeerCredentialsRequestedCallback(capabilities);
 			}
 
 			break;
 		}
 		case MessageType::PEER_CREDENTIALS: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			PeerCredentials credentials;
-			iarchive(credentials);
+			if (!decodeMessage(msg, credentials)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_PeerCredentialsReceivedCallback) {
 				m_PeerCredentialsReceivedCallback(credentials, senderId);
@@ -37,15 +154,42 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 
 			break;
 		}
-		case MessageType::FULL_STATE: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
+		case MessageType::PEER_CAPABILITIES: {
+			PeerCapabilities capabilities;
+			if (!decodeMessage(msg, capabilities)) {
+				break;
+			}
 
+			timer.next(Stage::HANDLE);
+
+			if (m_PeerCapabilitiesReceivedCallback) {
+				m_PeerCapabilitiesReceivedCallback(capabilities, senderId);
+			}
+
+			break;
+		}
+		case MessageType::DATAGRAM_CHANNEL: {
+			DatagramChannelOffer offer;
+			if (!decodeMessage(msg, offer)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
+
+			if (m_DatagramChannelOfferedCallback) {
+				m_DatagramChannelOfferedCallback(offer);
+			}
+
+			break;
+		}
+		case MessageType::FULL_STATE: {
 			std::vector<PeerInfo> peers;
 			ApplicationObjects entities;
+			if (!decodeMessage(msg, peers, entities)) {
+				break;
+			}
 
-			serialization::InputArchiveType iarchive(ss);
-			iarchive(peers, entities);
+			timer.next(Stage::HANDLE);
 
 			if (m_FullStateUpdateCallback) {
 				m_FullStateUpdateCallback(peers, std::move(entities));
@@ -53,13 +197,63 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 
 			break;
 		}
-		case MessageType::AUTHORIZATION_SUCCEEDED: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
+		case MessageType::FULL_STATE_CHUNK: {
+			using Type = FullStateChunk::Type;
+
+			FullStateChunk chunk;
+			bool known{true};
+
+			auto loadChunk = [&chunk, &known](auto& iarchive) {
+				std::uint8_t type;
+				iarchive(cereal::make_nvp("type", type),
+					cereal::make_nvp("id", chunk.id));
+				chunk.type = static_cast<Type>(type);
+
+				switch (chunk.type) {
+					case Type::PEERS:
+						iarchive(cereal::make_nvp("peers", chunk.peers));
+						break;
+					case Type::VOLUME:
+						iarchive(cereal::make_nvp("volume", chunk.volume));
+						break;
+					case Type::PLANE:
+						iarchive(
+							cereal::make_nvp("planeWidget", chunk.cutplane));
+						break;
+					case Type::LASER:
+						iarchive(cereal::make_nvp("laser", chunk.laser));
+						break;
+					case Type::WIDGET:
+						iarchive(cereal::make_nvp("widget", chunk.widget));
+						break;
+					case Type::END:
+						break;
+					default:
+						// Objects added by newer peers are skipped
+						known = false;
+						break;
+				}
+			};
+
+			if (!decodeMessageWith(msg, loadChunk)) {
+				break;
+			}
 
-			serialization::InputArchiveType iarchive(ss);
+			timer.next(Stage::HANDLE);
+
+			if (known && m_FullStateChunkCallback) {
+				m_FullStateChunkCallback(std::move(chunk));
+			}
+
+			break;
+		}
+		case MessageType::AUTHORIZATION_SUCCEEDED: {
 			PeerInfo peerInfo;
-			iarchive(peerInfo);
+			if (!decodeMessage(msg, peerInfo)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_PeerAuthSuccessCallback) {
 				m_PeerAuthSuccessCallback(peerInfo);
@@ -68,6 +262,8 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::AUTHORIZATION_FAILED: {
+			timer.next(Stage::HANDLE);
+
 			if (m_PeerAuthFailedCallback) {
 				m_PeerAuthFailedCallback();
 			}
@@ -75,12 +271,12 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::PEER_ADDED: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			PeerInfo peerInfo;
-			iarchive(peerInfo);
+			if (!decodeMessage(msg, peerInfo)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_PeerAddedCallback) {
 				m_PeerAddedCallback(peerInfo);
@@ -89,12 +285,12 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::PEER_REMOVED: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			PeerInfo peerInfo;
-			iarchive(peerInfo);
+			if (!decodeMessage(msg, peerInfo)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_PeerRemovedCallback) {
 				m_PeerRemovedCallback(peerInfo);
@@ -103,12 +299,12 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::LASER_UPDATED: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			LaserUpdate laserUpdate;
-			iarchive(laserUpdate);
+			if (!decodeMessage(msg, laserUpdate)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_LaserUpdateCallback) {
 				m_LaserUpdateCallback(laserUpdate, senderId);
@@ -116,13 +312,75 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 
 			break;
 		}
-		case MessageType::VOLUME_UPDATED: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
+		case MessageType::LASER_POSE: {
+			laserPose::LaserPose pose;
+			if (!laserPose::decode(msg.data.data(), msg.data.size(), pose)) {
+				break;
+			}
 
-			serialization::InputArchiveType iarchive(ss);
+			timer.next(Stage::HANDLE);
+
+			if (m_LaserUpdateCallback) {
+				m_LaserUpdateCallback(laserPose::toLaserUpdate(pose), senderId);
+			}
+
+			break;
+		}
+		case MessageType::TRANSFORM_UPDATE: {
+			using Target = compactTransform::Target;
+
+			compactTransform::TransformUpdate update;
+			if (!compactTransform::decode(msg.data.data(), msg.data.size(),
+					m_ReceivedTransformBaselines[senderId], update)) {
+				break;
+			}
+
+			common::PropertyListType propList{
+				{common::PropertyId::TRANSFORM, update.transform}};
+
+			timer.next(Stage::HANDLE);
+
+			switch (update.target) {
+				case Target::VOLUME: {
+					VolumeUpdate volumeUpdate(
+						VolumeUpdate::MessageType::PROPERTY_UPDATE, propList,
+						update.peerId);
+
+					if (m_VolumeUpdateCallback) {
+						m_VolumeUpdateCallback(volumeUpdate, senderId);
+					}
+					break;
+				}
+				case Target::PLANE: {
+					PlaneUpdate planeUpdate(
+						PlaneUpdate::MessageType::PROPERTY_UPDATE, propList);
+
+					if (m_PlaneUpdateCallback) {
+						m_PlaneUpdateCallback(planeUpdate, senderId);
+					}
+					break;
+				}
+				case Target::WIDGET: {
+					WidgetUpdate widgetUpdate(
+						WidgetUpdate::MessageType::PROPERTY_UPDATE,
+						update.objectId, propList, update.peerId);
+
+					if (m_WidgetUpdateCallback) {
+						m_WidgetUpdateCallback(widgetUpdate, senderId);
+					}
+					break;
+				}
+			}
+
+			break;
+		}
+		case MessageType::VOLUME_UPDATED: {
 			VolumeUpdate volumeUpdate;
-			iarchive(volumeUpdate);
+			if (!decodeMessage(msg, volumeUpdate)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_VolumeUpdateCallback) {
 				m_VolumeUpdateCallback(volumeUpdate, senderId);
@@ -131,12 +389,12 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::WIDGET_EVENT: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			WidgetUpdate widgetUpdate;
-			iarchive(widgetUpdate);
+			if (!decodeMessage(msg, widgetUpdate)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_WidgetUpdateCallback) {
 				m_WidgetUpdateCallback(widgetUpdate, senderId);
@@ -145,17 +403,54 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 			break;
 		}
 		case MessageType::PLANE_EVENT: {
-			std::istringstream ss(
-				std::string(msg.data.cbegin(), msg.data.cend()));
-
-			serialization::InputArchiveType iarchive(ss);
 			PlaneUpdate planeUpdate;
-			iarchive(planeUpdate);
+			if (!decodeMessage(msg, planeUpdate)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
 
 			if (m_PlaneUpdateCallback) {
 				m_PlaneUpdateCallback(planeUpdate, senderId);
 			}
 
+			break;
+		}
+		case MessageType::STATISTICS_REQUEST: {
+			timer.next(Stage::HANDLE);
+
+			if (m_StatisticsRequestedCallback) {
+				m_StatisticsRequestedCallback(senderId);
+			}
+
+			break;
+		}
+		case MessageType::STATISTICS: {
+			std::string report;
+			if (!decodeMessage(msg, report)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
+
+			if (m_StatisticsReceivedCallback) {
+				m_StatisticsReceivedCallback(report);
+			}
+
+			break;
+		}
+		case MessageType::SUBSCRIPTION: {
+			Subscription subscription;
+			if (!decodeMessage(msg, subscription)) {
+				break;
+			}
+
+			timer.next(Stage::HANDLE);
+
+			if (m_SubscriptionReceivedCallback) {
+				m_SubscriptionReceivedCallback(subscription, senderId);
+			}
+
 			break;
 		}
 	}  // end switch
@@ -166,20 +461,25 @@ void MessageEncoder::processMessage(const NetworkMessage& msg, IdType senderId)
 auto MessageEncoder::createLaserUpdateMsg(const LaserUpdate& laserUpdate)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(laserUpdate);
-	}
-	auto byteString = ss.str();
+	if (m_LaserPoseEnabled) {
+		if (auto pose = laserPose::fromLaserUpdate(laserUpdate)) {
+			pose->sequence = m_LaserPoseSequence++;
 
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::LASER_UPDATED;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
+			laserPose::BufferType buffer;
+			laserPose::encode(pose.value(), buffer);
 
-	return msg;
+			NetworkMessage msg;
+			msg.header = 0x00;
+			msg.type = NetworkMessage::LASER_POSE;
+			msg.data = {buffer.begin(), buffer.end()};
+			msg.size = msg.data.size();
+
+			return msg;
+		}
+	}
+
+	return encodeMessage(
+		NetworkMessage::LASER_UPDATED, m_ArchiveFormat, laserUpdate);
 }
 //=============================================================================
 
@@ -187,20 +487,17 @@ auto MessageEncoder::createLaserUpdateMsg(const LaserUpdate& laserUpdate)
 auto MessageEncoder::createVolumeUpdateMsg(const VolumeUpdate& volumeUpdate)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(volumeUpdate);
+	if (m_CompactTransformEnabled &&
+		(volumeUpdate.msgType == VolumeUpdate::MessageType::PROPERTY_UPDATE)) {
+		if (auto transform =
+				compactTransform::fromPropertyList(volumeUpdate.propList)) {
+			return createTransformUpdateMsg({compactTransform::Target::VOLUME,
+				0, volumeUpdate.id, transform.value()});
+		}
 	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::VOLUME_UPDATED;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
 
-	return msg;
+	return encodeMessage(
+		NetworkMessage::VOLUME_UPDATED, m_ArchiveFormat, volumeUpdate);
 }
 //=============================================================================
 
@@ -208,20 +505,18 @@ auto MessageEncoder::createVolumeUpdateMsg(const VolumeUpdate& volumeUpdate)
 auto MessageEncoder::createWidgetUpdateMsg(const WidgetUpdate& widgetUpdate)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(widgetUpdate);
+	if (m_CompactTransformEnabled &&
+		(widgetUpdate.msgType == WidgetUpdate::MessageType::PROPERTY_UPDATE)) {
+		if (auto transform =
+				compactTransform::fromPropertyList(widgetUpdate.propList)) {
+			return createTransformUpdateMsg({compactTransform::Target::WIDGET,
+				widgetUpdate.widgetId, widgetUpdate.ownerId,
+				transform.value()});
+		}
 	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::WIDGET_EVENT;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
 
-	return msg;
+	return encodeMessage(
+		NetworkMessage::WIDGET_EVENT, m_ArchiveFormat, widgetUpdate);
 }
 //=============================================================================
 
@@ -229,17 +524,36 @@ auto MessageEncoder::createWidgetUpdateMsg(const WidgetUpdate& widgetUpdate)
 auto MessageEncoder::createPlaneUpdateMsg(const PlaneUpdate& planeUpdate)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(planeUpdate);
+	if (m_CompactTransformEnabled &&
+		(planeUpdate.msgType == PlaneUpdate::MessageType::PROPERTY_UPDATE)) {
+		if (auto transform =
+				compactTransform::fromPropertyList(planeUpdate.propList)) {
+			return createTransformUpdateMsg(
+				{compactTransform::Target::PLANE, 0, 0, transform.value()});
+		}
 	}
-	auto byteString = ss.str();
 
+	return encodeMessage(
+		NetworkMessage::PLANE_EVENT, m_ArchiveFormat, planeUpdate);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::createTransformUpdateMsg(
+	const compactTransform::TransformUpdate& update) -> NetworkMessage
+{
 	NetworkMessage msg;
 	msg.header = 0x00;
-	msg.type = NetworkMessage::PLANE_EVENT;
-	msg.data = {byteString.begin(), byteString.end()};
+	msg.type = NetworkMessage::TRANSFORM_UPDATE;
+
+	if (m_DatagramChannelEnabled) {
+		// Without a baseline the update is encoded as a keyframe
+		compactTransform::BaselineMapType baselines;
+		compactTransform::encode(update, baselines, msg.data);
+	}
+	else {
+		compactTransform::encode(update, m_SentTransformBaselines, msg.data);
+	}
 	msg.size = msg.data.size();
 
 	return msg;
@@ -250,20 +564,7 @@ auto MessageEncoder::createPlaneUpdateMsg(const PlaneUpdate& planeUpdate)
 auto MessageEncoder::createPeerAddedMsg(const PeerInfo& peerInfo)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(peerInfo);
-	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::PEER_ADDED;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
-
-	return msg;
+	return encodeMessage(NetworkMessage::PEER_ADDED, m_ArchiveFormat, peerInfo);
 }
 //=============================================================================
 
@@ -271,32 +572,18 @@ auto MessageEncoder::createPeerAddedMsg(const PeerInfo& peerInfo)
 auto MessageEncoder::createPeerRemovedMsg(const PeerInfo& peerInfo)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(peerInfo);
-	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::PEER_REMOVED;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
-
-	return msg;
+	return encodeMessage(
+		NetworkMessage::PEER_REMOVED, m_ArchiveFormat, peerInfo);
 }
 //=============================================================================
 
 //=============================================================================
-auto MessageEncoder::createRequestCredentialsMsg() -> NetworkMessage
+auto MessageEncoder::createRequestCredentialsMsg(
+	const PeerCapabilities& capabilities) -> NetworkMessage
 {
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::REQUEST_CREDENTIALS;
-	msg.size = 0;
-
-	return msg;
+	// Clients which predate capability negotiation ignore the payload
+	return encodeMessage(
+		NetworkMessage::REQUEST_CREDENTIALS, ArchiveFormat::JSON, capabilities);
 }
 //=============================================================================
 
@@ -304,20 +591,17 @@ auto MessageEncoder::createRequestCredentialsMsg() -> NetworkMessage
 auto MessageEncoder::createPeerCredentialsMsg(
 	const PeerCredentials& credentials) -> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(credentials);
-	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::PEER_CREDENTIALS;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
+	return encodeMessage(
+		NetworkMessage::PEER_CREDENTIALS, ArchiveFormat::JSON, credentials);
+}
+//=============================================================================
 
-	return msg;
+//=============================================================================
+auto MessageEncoder::createPeerCapabilitiesMsg(
+	const PeerCapabilities& capabilities) -> NetworkMessage
+{
+	return encodeMessage(
+		NetworkMessage::PEER_CAPABILITIES, ArchiveFormat::JSON, capabilities);
 }
 //=============================================================================
 
@@ -325,20 +609,8 @@ auto MessageEncoder::createPeerCredentialsMsg(
 auto MessageEncoder::createAuthenticationSucceededMsg(const PeerInfo& peerInfo)
 	-> NetworkMessage
 {
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(peerInfo);
-	}
-	auto byteString = ss.str();
-
-	NetworkMessage msg;
-	msg.header = 0x00;
-	msg.type = NetworkMessage::AUTHORIZATION_SUCCEEDED;
-	msg.data = {byteString.begin(), byteString.end()};
-	msg.size = msg.data.size();
-
-	return msg;
+	return encodeMessage(
+		NetworkMessage::AUTHORIZATION_SUCCEEDED, m_ArchiveFormat, peerInfo);
 }
 //=============================================================================
 
@@ -358,24 +630,200 @@ auto MessageEncoder::createAuthenticationFailedMsg() -> NetworkMessage
 auto MessageEncoder::createFullStateMsg(const std::vector<PeerInfo>& peers,
 	const ApplicationObjects& entities) -> NetworkMessage {
 
-	std::ostringstream ss;
-	{
-		serialization::OutputArchiveType oarchive(ss);
-		oarchive(cereal::make_nvp("peers", peers),
-			cereal::make_nvp("applicationEntities", entities));
+	return encodeMessage(NetworkMessage::FULL_STATE, m_ArchiveFormat,
+		cereal::make_nvp("peers", peers),
+		cereal::make_nvp("applicationEntities", entities));
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::createFullStateMsg(const std::vector<PeerInfo>& peers,
+	const SceneState& scene) -> NetworkMessage
+{
+	return encodeMessage(NetworkMessage::FULL_STATE, m_ArchiveFormat,
+		cereal::make_nvp("peers", peers),
+		cereal::make_nvp("applicationEntities", scene));
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::createFullStateChunks(const std::vector<PeerInfo>& peers,
+	const ApplicationObjects& entities, const MessageSinkType& sink)
+{
+	using Type = FullStateChunk::Type;
+
+	auto sendChunk = [this, &sink](Type type, IdType id, auto&&... values) {
+		sink(encodeMessage(NetworkMessage::FULL_STATE_CHUNK, m_ArchiveFormat,
+			cereal::make_nvp("type", static_cast<std::uint8_t>(type)),
+			cereal::make_nvp("id", id),
+			std::forward<decltype(values)>(values)...));
+	};
+
+	sendChunk(Type::PEERS, 0, cereal::make_nvp("peers", peers));
+	sendChunk(Type::VOLUME, 0, cereal::make_nvp("volume", entities.volume));
+	sendChunk(
+		Type::PLANE, 0, cereal::make_nvp("planeWidget", entities.cutplane));
+
+	for (const auto& [id, laser] : entities.lasers) {
+		sendChunk(Type::LASER, id, cereal::make_nvp("laser", laser));
+	}
+
+	for (const auto& [id, widget] : entities.widgets) {
+		sendChunk(Type::WIDGET, id, cereal::make_nvp("widget", widget));
+	}
+
+	sendChunk(Type::END, 0);
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::createFullStateChunks(const std::vector<PeerInfo>& peers,
+	const SceneState& scene, const MessageSinkType& sink)
+{
+	using Type = FullStateChunk::Type;
+
+	auto sendChunk = [this, &sink](Type type, IdType id, auto&&... values) {
+		sink(encodeMessage(NetworkMessage::FULL_STATE_CHUNK, m_ArchiveFormat,
+			cereal::make_nvp("type", static_cast<std::uint8_t>(type)),
+			cereal::make_nvp("id", id),
+			std::forward<decltype(values)>(values)...));
+	};
+
+	sendChunk(Type::PEERS, 0, cereal::make_nvp("peers", peers));
+	createFullStateChunk(scene, ObjectType::VOLUME, 0, sink);
+	createFullStateChunk(scene, ObjectType::PLANE, 0, sink);
+
+	for (const auto& laser : scene.getLasers()) {
+		createFullStateChunk(scene, ObjectType::LASER, laser.id, sink);
+	}
+
+	for (const auto& widget : scene.getWidgets()) {
+		createFullStateChunk(scene, ObjectType::WIDGET, widget.id, sink);
+	}
+
+	sendChunk(Type::END, 0);
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::createFullStateChunk(const SceneState& scene,
+	ObjectType type, IdType id, const MessageSinkType& sink)
+{
+	using Type = FullStateChunk::Type;
+	using serialization::asUniquePtr;
+
+	auto sendChunk = [this, &sink](
+						 Type chunkType, IdType chunkId, auto&&... values) {
+		sink(encodeMessage(NetworkMessage::FULL_STATE_CHUNK, m_ArchiveFormat,
+			cereal::make_nvp("type", static_cast<std::uint8_t>(chunkType)),
+			cereal::make_nvp("id", chunkId),
+			std::forward<decltype(values)>(values)...));
+	};
+
+	switch (type) {
+		case ObjectType::VOLUME: {
+			sendChunk(Type::VOLUME, 0,
+				cereal::make_nvp("volume", asUniquePtr(scene.getVolume())));
+			break;
+		}
+		case ObjectType::PLANE: {
+			sendChunk(Type::PLANE, 0,
+				cereal::make_nvp("planeWidget", asUniquePtr(scene.getPlane())));
+			break;
+		}
+		case ObjectType::LASER: {
+			if (auto laser = scene.findLaser(id)) {
+				sendChunk(Type::LASER, id,
+					cereal::make_nvp("laser", asUniquePtr(*laser)));
+			}
+			break;
+		}
+		case ObjectType::WIDGET: {
+			if (auto widget = scene.findWidget(id)) {
+				sendChunk(Type::WIDGET, id,
+					cereal::make_nvp("widget", asUniquePtr(*widget)));
+			}
+			break;
+		}
 	}
-	auto byteString = ss.str();
+}
+//=============================================================================
 
+//=============================================================================
+auto MessageEncoder::createDatagramChannelMsg(
+	const DatagramChannelOffer& offer) -> NetworkMessage
+{
+	return encodeMessage(
+		NetworkMessage::DATAGRAM_CHANNEL, m_ArchiveFormat, offer);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::createStatisticsRequestMsg() -> NetworkMessage
+{
 	NetworkMessage msg;
 	msg.header = 0x00;
-	msg.type = NetworkMessage::FULL_STATE;
-	msg.data = { byteString.begin(), byteString.end() };
-	msg.size = msg.data.size();
+	msg.type = NetworkMessage::STATISTICS_REQUEST;
+	msg.size = 0;
 
 	return msg;
 }
 //=============================================================================
 
+//=============================================================================
+auto MessageEncoder::createStatisticsMsg(const std::string& report)
+	-> NetworkMessage
+{
+	return encodeMessage(NetworkMessage::STATISTICS, m_ArchiveFormat, report);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::createSubscriptionMsg(const Subscription& subscription)
+	-> NetworkMessage
+{
+	return encodeMessage(
+		NetworkMessage::SUBSCRIPTION, m_ArchiveFormat, subscription);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::getLatestWinsKey(const NetworkMessage& msg)
+	-> std::optional<std::uint64_t>
+{
+	// Message type in the top 16 bits, the stream within it below
+	const auto typeKey = static_cast<std::uint64_t>(msg.type) << 48;
+
+	switch (msg.type) {
+		case NetworkMessage::LASER_POSE: {
+			laserPose::LaserPose pose;
+			if (!laserPose::decode(msg.data.data(), msg.data.size(), pose)) {
+				return std::nullopt;
+			}
+
+			// Poses leaving out some fields only supersede those with the
+			// same fields
+			return typeKey | (static_cast<std::uint64_t>(pose.fields) << 32) |
+				static_cast<std::uint32_t>(pose.id);
+		}
+		case NetworkMessage::TRANSFORM_UPDATE: {
+			// Deltas depend on every earlier update arriving
+			auto header =
+				compactTransform::readHeader(msg.data.data(), msg.data.size());
+			if (!header || !header->keyframe) {
+				return std::nullopt;
+			}
+
+			return typeKey |
+				(static_cast<std::uint64_t>(header->target) << 32) |
+				static_cast<std::uint32_t>(header->objectId);
+		}
+		default:
+			return std::nullopt;
+	}
+}
+//=============================================================================
+
 //=============================================================================
 void MessageEncoder::setOnCredentialsRequestedCallback(
 	PeerCredentialsRequetedCallbackType clbk)
@@ -457,3 +905,158 @@ void MessageEncoder::setOnFullStateUpdatedCallback(
 	m_FullStateUpdateCallback = clbk;
 }
 //=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnFullStateChunkReceivedCallback(
+	FullStateChunkCallbackType clbk)
+{
+	m_FullStateChunkCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnPeerCapabilitiesReceivedCallback(
+	PeerCapabilitiesReceivedCallbackType clbk)
+{
+	m_PeerCapabilitiesReceivedCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnDatagramChannelOfferedCallback(
+	DatagramChannelOfferedCallbackType clbk)
+{
+	m_DatagramChannelOfferedCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnStatisticsRequestedCallback(
+	StatisticsRequestedCallbackType clbk)
+{
+	m_StatisticsRequestedCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnStatisticsReceivedCallback(
+	StatisticsReceivedCallbackType clbk)
+{
+	m_StatisticsReceivedCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setOnSubscriptionReceivedCallback(
+	SubscriptionReceivedCallbackType clbk)
+{
+	m_SubscriptionReceivedCallback = clbk;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setArchiveFormat(ArchiveFormat format)
+{
+	m_ArchiveFormat = format;
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageEncoder::getArchiveFormat() const -> ArchiveFormat
+{
+	return m_ArchiveFormat;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setLaserPoseEnabled(bool enabled)
+{
+	m_LaserPoseEnabled = enabled;
+}
+//=============================================================================
+
+//=============================================================================
+bool MessageEncoder::isLaserPoseEnabled() const
+{
+	return m_LaserPoseEnabled;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setCompactTransformEnabled(bool enabled)
+{
+	m_CompactTransformEnabled = enabled;
+}
+//=============================================================================
+
+//=============================================================================
+bool MessageEncoder::isCompactTransformEnabled() const
+{
+	return m_CompactTransformEnabled;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setDatagramChannelEnabled(bool enabled)
+{
+	m_DatagramChannelEnabled = enabled;
+}
+//=============================================================================
+
+//=============================================================================
+bool MessageEncoder::isDatagramChannelEnabled() const
+{
+	return m_DatagramChannelEnabled;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::resetTransformBaselines()
+{
+	m_SentTransformBaselines.clear();
+	m_ReceivedTransformBaselines.clear();
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setBinaryArchiveAccepted(IdType senderId, bool accepted)
+{
+	if (accepted) {
+		m_BinaryArchiveSenders.insert(senderId);
+	}
+	else {
+		m_BinaryArchiveSenders.erase(senderId);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+bool MessageEncoder::acceptsBinaryArchive(IdType senderId) const
+{
+	return (m_ArchiveFormat == ArchiveFormat::BINARY) ||
+		(m_BinaryArchiveSenders.count(senderId) > 0);
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::removeSender(IdType senderId)
+{
+	m_ReceivedTransformBaselines.erase(senderId);
+	m_BinaryArchiveSenders.erase(senderId);
+}
+//=============================================================================
+
+//=============================================================================
+void MessageEncoder::setPeerCapabilities(const PeerCapabilities& capabilities)
+{
+	setArchiveFormat(capabilities.has(PeerCapabilities::BINARY_ARCHIVE)
+			? ArchiveFormat::BINARY
+			: ArchiveFormat::JSON);
+
+	setLaserPoseEnabled(capabilities.has(PeerCapabilities::LASER_POSE));
+	setCompactTransformEnabled(
+		capabilities.has(PeerCapabilities::COMPACT_TRANSFORM));
+	setDatagramChannelEnabled(
+		capabilities.has(PeerCapabilities::DATAGRAM_CHANNEL));
+}
+//=============================================================================
@@ -0,0 +1,430 @@
+#include "appcore/sceneState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <variant>
+
+namespace
+{
+using IdType = common::IdType;
+using PointType = common::Point3dType;
+using TransformType = common::TransformType;
+using ColorVectorType = common::ColorVectorType;
+using VariantType = common::VariantType;
+using PropertyVariantType = common::PropertyVariantType;
+using PropertyId = common::PropertyId;
+
+//=============================================================================
+template <class Objects>
+auto lowerBound(Objects& objects, IdType id)
+{
+	return std::lower_bound(std::begin(objects), std::end(objects), id,
+		[](const auto& object, IdType id) { return object.id < id; });
+}
+//=============================================================================
+
+//=============================================================================
+template <class Objects>
+auto findObject(Objects& objects, IdType id)
+{
+	auto it = lowerBound(objects, id);
+	return ((it != std::end(objects)) && (it->id == id)) ? &*it : nullptr;
+}
+//=============================================================================
+
+//=============================================================================
+template <class Objects>
+bool removeObject(Objects& objects, IdType id)
+{
+	auto it = lowerBound(objects, id);
+	if ((it == std::end(objects)) || (it->id != id)) {
+		return false;
+	}
+
+	objects.erase(it);
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+// Points come as property values and as elements of node lists
+template <class Variant>
+const PointType* getPoint(const Variant& value)
+{
+	auto point = std::get_if<PointType>(&value);
+	return (point && point->allFinite()) ? point : nullptr;
+}
+//=============================================================================
+
+//=============================================================================
+const TransformType* getTransform(const PropertyVariantType& value)
+{
+	auto transform = std::get_if<TransformType>(&value);
+	return (transform && transform->matrix().allFinite()) ? transform
+														  : nullptr;
+}
+//=============================================================================
+
+//=============================================================================
+// Color components are clamped, as a QColor holding the color would
+std::optional<ColorVectorType> getColor(const PropertyVariantType& value)
+{
+	auto color = std::get_if<ColorVectorType>(&value);
+	if (!color) {
+		return std::nullopt;
+	}
+
+	ColorVectorType clamped;
+	for (std::size_t i = 0; i < clamped.size(); ++i) {
+		if (!std::isfinite((*color)[i])) {
+			return std::nullopt;
+		}
+
+		clamped[i] = std::clamp((*color)[i], 0.0, 1.0);
+	}
+
+	return clamped;
+}
+//=============================================================================
+
+//=============================================================================
+std::vector<VariantType> toVariants(const SceneState::NodeListType& nodes)
+{
+	return std::vector<VariantType>(nodes.begin(), nodes.end());
+}
+//=============================================================================
+
+//=============================================================================
+void addUpdate(SceneState::UpdateListType& updates,
+	SceneState::ObjectType type, IdType id,
+	SceneState::PropertyListType&& propList)
+{
+	if (!propList.empty()) {
+		updates.push_back({type, id, std::move(propList)});
+	}
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+auto SceneState::Widget::getNodes() const -> NodeListType
+{
+	NodeListType positions;
+	positions.reserve(nodes.size());
+
+	std::transform(nodes.begin(), nodes.end(), std::back_inserter(positions),
+		[this](const auto& node) { return PointType{transform * node}; });
+
+	return positions;
+}
+//=============================================================================
+
+//=============================================================================
+SceneState::SceneState() :
+	m_Volume{TransformType::Identity()},
+	m_Plane{TransformType::Identity()}
+{
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::addLaser(IdType id, const ColorVectorType& color)
+	-> const Laser&
+{
+	auto it = lowerBound(m_Lasers, id);
+	if ((it == m_Lasers.end()) || (it->id != id)) {
+		// Pointing down the -z axis, as a LaserWidget does
+		const PointType base{0.0, 0.0, 0.0};
+		const PointType tip{0.0, 0.0, -defaultLaserLength};
+
+		it = m_Lasers.insert(it, Laser{id, base, tip, color});
+	}
+
+	return *it;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::addWidget(IdType id) -> const Widget&
+{
+	auto it = lowerBound(m_Widgets, id);
+	if ((it == m_Widgets.end()) || (it->id != id)) {
+		it = m_Widgets.insert(it,
+			Widget{id, {}, TransformType::Identity(),
+				m_Volume.transform.inverse()});
+	}
+
+	return *it;
+}
+//=============================================================================
+
+//=============================================================================
+bool SceneState::removeLaser(IdType id)
+{
+	return removeObject(m_Lasers, id);
+}
+//=============================================================================
+
+//=============================================================================
+bool SceneState::removeWidget(IdType id)
+{
+	return removeObject(m_Widgets, id);
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::findLaser(IdType id) const -> const Laser*
+{
+	return findObject(m_Lasers, id);
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::findWidget(IdType id) const -> const Widget*
+{
+	return findObject(m_Widgets, id);
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getLasers() const -> const std::vector<Laser>&
+{
+	return m_Lasers;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getWidgets() const -> const std::vector<Widget>&
+{
+	return m_Widgets;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getVolume() const -> const Volume&
+{
+	return m_Volume;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getPlane() const -> const Plane&
+{
+	return m_Plane;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::updateLaser(IdType id, const PropertyListType& propList)
+	-> UpdateListType
+{
+	UpdateListType updates;
+
+	auto laser = getLaser(id);
+	if (!laser) {
+		return updates;
+	}
+
+	PropertyListType applied;
+
+	for (const auto& [propKey, propValue] : propList) {
+		switch (propKey.getId()) {
+			case PropertyId::COLOR: {
+				if (auto color = getColor(propValue)) {
+					laser->color = color.value();
+					applied.push_back({propKey, laser->color});
+				}
+				break;
+			}
+			case PropertyId::BASE: {
+				if (auto base = getPoint(propValue)) {
+					laser->base = *base;
+					applied.push_back({propKey, laser->base});
+				}
+				break;
+			}
+			case PropertyId::TIP: {
+				if (auto tip = getPoint(propValue)) {
+					laser->tip = *tip;
+					applied.push_back({propKey, laser->tip});
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	addUpdate(updates, ObjectType::LASER, id, std::move(applied));
+	return updates;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::updateVolume(const PropertyListType& propList)
+	-> UpdateListType
+{
+	UpdateListType updates;
+	PropertyListType applied;
+
+	for (const auto& [propKey, propValue] : propList) {
+		if (propKey.getId() != PropertyId::TRANSFORM) {
+			continue;
+		}
+
+		if (auto transform = getTransform(propValue)) {
+			m_Volume.transform = *transform;
+			applied.push_back({propKey, m_Volume.transform});
+		}
+	}
+
+	if (applied.empty()) {
+		return updates;
+	}
+
+	addUpdate(updates, ObjectType::VOLUME, 0, std::move(applied));
+
+	// Attached widgets keep their offset from the volume
+	for (auto& widget : m_Widgets) {
+		widget.transform = m_Volume.transform * widget.volumeOffset;
+		addUpdate(updates, ObjectType::WIDGET, widget.id,
+			{{PropertyId::TRANSFORM, widget.transform}});
+	}
+
+	return updates;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::updatePlane(const PropertyListType& propList)
+	-> UpdateListType
+{
+	UpdateListType updates;
+	PropertyListType applied;
+
+	for (const auto& [propKey, propValue] : propList) {
+		if (propKey.getId() != PropertyId::TRANSFORM) {
+			continue;
+		}
+
+		if (auto transform = getTransform(propValue)) {
+			m_Plane.transform = *transform;
+			applied.push_back({propKey, m_Plane.transform});
+		}
+	}
+
+	addUpdate(updates, ObjectType::PLANE, 0, std::move(applied));
+	return updates;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::updateWidget(IdType id, const PropertyListType& propList)
+	-> UpdateListType
+{
+	UpdateListType updates;
+
+	auto widget = getWidget(id);
+	if (!widget) {
+		return updates;
+	}
+
+	PropertyListType applied;
+
+	for (const auto& [propKey, propValue] : propList) {
+		switch (propKey.getId()) {
+			case PropertyId::NODE_POSITION: {
+				// Node index and position
+				auto indexValuePair =
+					std::get_if<std::vector<VariantType>>(&propValue);
+				if (!indexValuePair || (indexValuePair->size() != 2)) {
+					break;
+				}
+
+				auto index = std::get_if<std::uint16_t>(&(*indexValuePair)[0]);
+				auto position = getPoint((*indexValuePair)[1]);
+				if (!index || !position || (*index >= widget->nodes.size())) {
+					break;
+				}
+
+				auto& node = widget->nodes[*index];
+				node = widget->transform.inverse() * *position;
+
+				applied.push_back({propKey,
+					std::vector<VariantType>{
+						*index, PointType{widget->transform * node}}});
+				break;
+			}
+			case PropertyId::NODES: {
+				auto nodeVector =
+					std::get_if<std::vector<VariantType>>(&propValue);
+				if (!nodeVector || nodeVector->empty()) {
+					break;
+				}
+
+				const auto inverse = widget->transform.inverse();
+
+				NodeListType nodes;
+				nodes.reserve(nodeVector->size());
+				for (const auto& value : *nodeVector) {
+					auto position = getPoint(value);
+					if (!position) {
+						break;
+					}
+
+					nodes.push_back(inverse * *position);
+				}
+
+				if (nodes.size() != nodeVector->size()) {
+					break;
+				}
+
+				widget->nodes = std::move(nodes);
+				applied.push_back({propKey, toVariants(widget->getNodes())});
+				break;
+			}
+			case PropertyId::TRANSFORM: {
+				if (auto transform = getTransform(propValue)) {
+					widget->transform = *transform;
+					applied.push_back({propKey, widget->transform});
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	addUpdate(updates, ObjectType::WIDGET, id, std::move(applied));
+	return updates;
+}
+//=============================================================================
+
+//=============================================================================
+void SceneState::restore(
+	std::vector<Widget> widgets, const Volume& volume, const Plane& plane)
+{
+	std::sort(widgets.begin(), widgets.end(),
+		[](const auto& a, const auto& b) { return a.id < b.id; });
+
+	m_Widgets = std::move(widgets);
+	m_Volume = volume;
+	m_Plane = plane;
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getLaser(IdType id) -> Laser*
+{
+	return findObject(m_Lasers, id);
+}
+//=============================================================================
+
+//=============================================================================
+auto SceneState::getWidget(IdType id) -> Widget*
+{
+	return findObject(m_Widgets, id);
+}
+//=============================================================================
@@ -0,0 +1,294 @@
+#include "appcore/session.h"
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <utility>
+
+namespace
+{
+using IdType = common::IdType;
+using ObjectType = Session::ObjectType;
+using OutputEncoderMap = Session::OutputEncoderMap;
+
+//=============================================================================
+const Subscription::Filter& getFilter(
+	const Subscription& subscription, ObjectType type)
+{
+	switch (type) {
+		case ObjectType::LASER:
+			return subscription.lasers;
+		case ObjectType::VOLUME:
+			return subscription.volume;
+		case ObjectType::PLANE:
+			return subscription.plane;
+		case ObjectType::WIDGET:
+		default:
+			return subscription.widgets;
+	}
+}
+//=============================================================================
+
+//=============================================================================
+MessageEncoder& getEncoder(
+	OutputEncoderMap& encoders, const PeerCapabilities& capabilities)
+{
+	auto [it, inserted] = encoders.try_emplace(capabilities.flags);
+	if (inserted) {
+		it->second.setPeerCapabilities(capabilities);
+	}
+
+	return it->second;
+}
+//=============================================================================
+
+//=============================================================================
+std::string toLower(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(),
+		[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return text;
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+bool Session::Peer::wants(
+	RateClass rateClass, ObjectType type, IdType objectId) const
+{
+	const auto& filter = getFilter(subscription, type);
+	return (filter.rateClass == rateClass) && filter.includes(objectId);
+}
+//=============================================================================
+
+//=============================================================================
+void Session::addPeer(IdType peerId, const ColorVectorType& color)
+{
+	if (findPeer(peerId)) {
+		return;
+	}
+
+	peers.push_back({peerId, Subscription{}});
+	sceneState.addLaser(peerId, color);
+}
+//=============================================================================
+
+//=============================================================================
+bool Session::removePeer(IdType peerId)
+{
+	auto it = std::find_if(peers.begin(), peers.end(),
+		[peerId](const Peer& peer) { return peer.id == peerId; });
+	if (it == peers.end()) {
+		return false;
+	}
+
+	peers.erase(it);
+
+	sceneState.removeLaser(peerId);
+	updateCoalescer.discard(ObjectType::LASER, peerId);
+	previewCoalescer.discard(ObjectType::LASER, peerId);
+
+	// Make sure to release any lingering object ownership
+	if (volumeOwner == peerId) {
+		volumeOwner = std::nullopt;
+	}
+
+	if (planeOwner == peerId) {
+		planeOwner = std::nullopt;
+	}
+
+	for (auto& [widgetId, widgetOwner] : widgetOwnershipMap) {
+		if (widgetOwner == peerId) {
+			widgetOwner = std::nullopt;
+		}
+	}
+
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+auto Session::findPeer(IdType peerId) -> Peer*
+{
+	auto it = std::find_if(peers.begin(), peers.end(),
+		[peerId](const Peer& peer) { return peer.id == peerId; });
+
+	return (it != peers.end()) ? &*it : nullptr;
+}
+//=============================================================================
+
+//=============================================================================
+auto Session::findPeer(IdType peerId) const -> const Peer*
+{
+	return const_cast<Session*>(this)->findPeer(peerId);
+}
+//=============================================================================
+
+//=============================================================================
+auto Session::setSubscription(IdType peerId, const Subscription& subscription)
+	-> ObjectListType
+{
+	auto peer = findPeer(peerId);
+	if (!peer) {
+		return {};
+	}
+
+	const auto previous = std::exchange(peer->subscription, subscription);
+
+	ObjectListType addedObjects;
+	auto addIfWidened = [&](ObjectType type, IdType objectId,
+							std::optional<IdType> holder) {
+		if ((holder != peerId) &&
+			getFilter(subscription, type).includes(objectId) &&
+			!getFilter(previous, type).includes(objectId)) {
+			addedObjects.push_back({type, objectId});
+		}
+	};
+
+	addIfWidened(ObjectType::VOLUME, 0, volumeOwner);
+	addIfWidened(ObjectType::PLANE, 0, planeOwner);
+
+	for (const auto& laser : sceneState.getLasers()) {
+		addIfWidened(ObjectType::LASER, laser.id, laser.id);
+	}
+
+	for (const auto& widget : sceneState.getWidgets()) {
+		auto it = widgetOwnershipMap.find(widget.id);
+		addIfWidened(ObjectType::WIDGET, widget.id,
+			(it != widgetOwnershipMap.end()) ? it->second : std::nullopt);
+	}
+
+	return addedObjects;
+}
+//=============================================================================
+
+//=============================================================================
+auto Session::getSubscribers(RateClass rateClass, ObjectType type,
+	IdType objectId) const -> std::vector<IdType>
+{
+	std::vector<IdType> subscribers;
+	for (const auto& peer : peers) {
+		if (peer.wants(rateClass, type, objectId)) {
+			subscribers.push_back(peer.id);
+		}
+	}
+
+	return subscribers;
+}
+//=============================================================================
+
+//=============================================================================
+bool Session::hasSubscribers(
+	RateClass rateClass, ObjectType type, IdType objectId) const
+{
+	return std::any_of(peers.begin(), peers.end(), [&](const Peer& peer) {
+		return peer.wants(rateClass, type, objectId);
+	});
+}
+//=============================================================================
+
+//=============================================================================
+MessageEncoder& Session::getEncoder(
+	RateClass rateClass, const PeerCapabilities& capabilities)
+{
+	return ::getEncoder(
+		(rateClass == RateClass::PREVIEW) ? previewEncoders : outputEncoders,
+		capabilities);
+}
+//=============================================================================
+
+//=============================================================================
+void Session::resetTransformBaselines(const PeerCapabilities& capabilities)
+{
+	::getEncoder(outputEncoders, capabilities).resetTransformBaselines();
+	::getEncoder(previewEncoders, capabilities).resetTransformBaselines();
+}
+//=============================================================================
+
+//=============================================================================
+Session& SessionRegistry::create()
+{
+	Session* session = nullptr;
+	while (!session) {
+		session = add(generateCode());
+	}
+
+	return *session;
+}
+//=============================================================================
+
+//=============================================================================
+Session* SessionRegistry::add(const std::string& code)
+{
+	if (code.empty() || isTaken(code)) {
+		return nullptr;
+	}
+
+	auto& session = m_Sessions[code];
+	session = std::make_unique<Session>();
+	session->code = code;
+
+	return session.get();
+}
+//=============================================================================
+
+//=============================================================================
+Session* SessionRegistry::find(const std::string& code) const
+{
+	auto it = m_Sessions.find(code);
+	return (it != m_Sessions.end()) ? it->second.get() : nullptr;
+}
+//=============================================================================
+
+//=============================================================================
+bool SessionRegistry::isTaken(const std::string& code) const
+{
+	const auto lowerCode = toLower(code);
+
+	return std::any_of(m_Sessions.begin(), m_Sessions.end(),
+		[&lowerCode](const auto& entry) {
+			return toLower(entry.first) == lowerCode;
+		});
+}
+//=============================================================================
+
+//=============================================================================
+std::vector<std::string> SessionRegistry::getCodes() const
+{
+	std::vector<std::string> codes;
+	for (const auto& [code, session] : m_Sessions) {
+		codes.push_back(code);
+	}
+
+	std::sort(codes.begin(), codes.end());
+	return codes;
+}
+//=============================================================================
+
+//=============================================================================
+auto SessionRegistry::getSessions() const -> const SessionMap&
+{
+	return m_Sessions;
+}
+//=============================================================================
+
+//=============================================================================
+std::string SessionRegistry::generateCode(std::size_t length)
+{
+	const std::string chars =
+		"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+	std::random_device device;
+	std::mt19937 generator(device());
+	std::uniform_int_distribution<std::size_t> distribution(
+		0, chars.size() - 1);
+
+	std::string code;
+	for (std::size_t i = 0; i < length; i++) {
+		code += chars[distribution(generator)];
+	}
+
+	return code;
+}
+//=============================================================================
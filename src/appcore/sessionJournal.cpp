@@ -0,0 +1,556 @@
+#include "appcore/sessionJournal.h"
+#include "appcore/byteStreambuf.h"
+#include "appcore/serializationHelper.h"
+#include "appcore/serializationTypes.h"
+#include "common/crcUtils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <system_error>
+
+namespace
+{
+using IdType = common::IdType;
+using TransformType = common::TransformType;
+using PropertyListType = common::PropertyListType;
+using ObjectType = SceneState::ObjectType;
+
+// Bumped whenever the layout of the snapshot or the records changes
+constexpr std::uint8_t formatVersion = 1;
+
+// Size and checksum of the payload, little-endian
+constexpr std::size_t frameHeaderSize = 8;
+
+enum class RecordType : std::uint8_t {
+	PROPERTY_UPDATE,
+	WIDGET_CREATED,
+	WIDGET_DESTROYED
+};
+
+// Payload of a frame whose checksum matched
+struct Frame
+{
+	const std::uint8_t* payload;
+	std::size_t size;
+};
+
+//=============================================================================
+void writeUint32(std::uint8_t* bytes, std::uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		bytes[i] = static_cast<std::uint8_t>(value >> (8 * i));
+	}
+}
+//=============================================================================
+
+//=============================================================================
+std::uint32_t readUint32(const std::uint8_t* bytes)
+{
+	std::uint32_t value{0};
+	for (int i = 0; i < 4; ++i) {
+		value |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+	}
+
+	return value;
+}
+//=============================================================================
+
+//=============================================================================
+template <class Save>
+std::vector<std::uint8_t> encodeFrame(Save&& save)
+{
+	std::vector<std::uint8_t> bytes(frameHeaderSize);
+	{
+		serialization::VectorStreambuf buffer{bytes};
+		std::ostream stream{&buffer};
+		serialization::BinaryOutputArchiveType archive{stream};
+		save(archive);
+	}
+
+	const auto payloadSize = bytes.size() - frameHeaderSize;
+	writeUint32(bytes.data(), static_cast<std::uint32_t>(payloadSize));
+	writeUint32(bytes.data() + 4,
+		crc::updateCRC32(bytes.data() + frameHeaderSize, payloadSize, 0));
+
+	return bytes;
+}
+//=============================================================================
+
+//=============================================================================
+// Frames up to the first incomplete or corrupt one
+std::vector<Frame> parseFrames(const std::vector<std::uint8_t>& bytes)
+{
+	std::vector<Frame> frames;
+
+	std::size_t offset{0};
+	while (bytes.size() - offset >= frameHeaderSize) {
+		const auto size = readUint32(bytes.data() + offset);
+		const auto checksum = readUint32(bytes.data() + offset + 4);
+
+		if (size > bytes.size() - offset - frameHeaderSize) {
+			break;
+		}
+
+		const auto payload = bytes.data() + offset + frameHeaderSize;
+		if (crc::updateCRC32(payload, size, 0) != checksum) {
+			break;
+		}
+
+		frames.push_back({payload, size});
+		offset += frameHeaderSize + size;
+	}
+
+	return frames;
+}
+//=============================================================================
+
+//=============================================================================
+template <class Load>
+bool decodeFrame(const Frame& frame, Load&& load)
+{
+	serialization::SpanStreambuf buffer{frame.payload, frame.size};
+	std::istream stream{&buffer};
+
+	try {
+		serialization::BinaryInputArchiveType archive{buffer, stream};
+		return load(archive);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+}
+//=============================================================================
+
+//=============================================================================
+std::optional<std::vector<std::uint8_t>> readFile(
+	const std::filesystem::path& path)
+{
+	std::ifstream file{path, std::ios::binary};
+	if (!file) {
+		return std::nullopt;
+	}
+
+	return std::vector<std::uint8_t>{std::istreambuf_iterator<char>{file},
+		std::istreambuf_iterator<char>{}};
+}
+//=============================================================================
+
+//=============================================================================
+// Widget nodes are saved relative to the widget, along with the offset from
+// the volume, which the FULL_STATE form of the scene leaves out
+std::vector<std::uint8_t> encodeSnapshot(
+	const SceneState& scene, std::uint64_t nextSequence)
+{
+	return encodeFrame([&](auto& archive) {
+		archive(formatVersion, nextSequence, scene.getVolume().transform,
+			scene.getPlane().transform);
+
+		const auto& widgets = scene.getWidgets();
+		archive(static_cast<std::uint64_t>(widgets.size()));
+
+		for (const auto& widget : widgets) {
+			archive(static_cast<std::uint64_t>(widget.id), widget.nodes,
+				widget.transform, widget.volumeOffset);
+		}
+	});
+}
+//=============================================================================
+
+//=============================================================================
+std::vector<std::uint8_t> encodeRecord(std::uint64_t sequence,
+	RecordType recordType, ObjectType objectType, IdType id,
+	const PropertyListType& propList)
+{
+	return encodeFrame([&](auto& archive) {
+		archive(sequence, static_cast<std::uint8_t>(recordType),
+			static_cast<std::uint8_t>(objectType),
+			static_cast<std::uint64_t>(id), propList);
+	});
+}
+//=============================================================================
+
+//=============================================================================
+void replayUpdate(SceneState& scene, ObjectType objectType, IdType id,
+	const PropertyListType& propList)
+{
+	switch (objectType) {
+		case ObjectType::VOLUME:
+			scene.updateVolume(propList);
+			break;
+		case ObjectType::PLANE:
+			scene.updatePlane(propList);
+			break;
+		case ObjectType::WIDGET:
+			scene.updateWidget(id, propList);
+			break;
+		case ObjectType::LASER:
+			break;
+	}
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+SessionJournal::SessionJournal(const PathType& directory) :
+	m_Directory{directory},
+	m_NextSequence{0},
+	m_RecordCountSinceSnapshot{0},
+	m_Stopping{false}
+{
+}
+//=============================================================================
+
+//=============================================================================
+SessionJournal::~SessionJournal()
+{
+	stop();
+}
+//=============================================================================
+
+//=============================================================================
+auto SessionJournal::recover(SceneState& scene) -> std::optional<std::size_t>
+{
+	auto snapshotBytes = readFile(m_Directory / snapshotFileName);
+	if (!snapshotBytes) {
+		return std::nullopt;
+	}
+
+	const auto snapshotFrames = parseFrames(*snapshotBytes);
+	if (snapshotFrames.empty()) {
+		return std::nullopt;
+	}
+
+	std::uint64_t nextSequence{0};
+
+	const bool loaded = decodeFrame(snapshotFrames[0], [&](auto& archive) {
+		std::uint8_t version{0};
+		archive(version);
+		if (version != formatVersion) {
+			return false;
+		}
+
+		SceneState::Volume volume{TransformType::Identity()};
+		SceneState::Plane plane{TransformType::Identity()};
+		std::uint64_t widgetCount{0};
+		archive(nextSequence, volume.transform, plane.transform, widgetCount);
+
+		std::vector<SceneState::Widget> widgets;
+		for (std::uint64_t i = 0; i < widgetCount; ++i) {
+			std::uint64_t id{0};
+			SceneState::Widget widget{0, {}, TransformType::Identity(),
+				TransformType::Identity()};
+			archive(id, widget.nodes, widget.transform, widget.volumeOffset);
+
+			widget.id = static_cast<IdType>(id);
+			widgets.push_back(std::move(widget));
+		}
+
+		scene.restore(std::move(widgets), volume, plane);
+		return true;
+	});
+
+	if (!loaded) {
+		return std::nullopt;
+	}
+
+	m_NextSequence = nextSequence;
+	std::size_t replayed{0};
+
+	auto journalBytes = readFile(m_Directory / journalFileName);
+	if (!journalBytes) {
+		return replayed;
+	}
+
+	for (const auto& frame : parseFrames(*journalBytes)) {
+		const bool decoded = decodeFrame(frame, [&](auto& archive) {
+			std::uint64_t sequence{0};
+			std::uint8_t recordType{0};
+			std::uint8_t objectType{0};
+			std::uint64_t id{0};
+			PropertyListType propList;
+			archive(sequence, recordType, objectType, id, propList);
+
+			// Left over from before the snapshot, if the server died
+			// between writing it and emptying the journal
+			if (sequence < m_NextSequence) {
+				return true;
+			}
+
+			const auto widgetId = static_cast<IdType>(id);
+
+			switch (static_cast<RecordType>(recordType)) {
+				case RecordType::PROPERTY_UPDATE:
+					replayUpdate(scene, static_cast<ObjectType>(objectType),
+						widgetId, propList);
+					break;
+				case RecordType::WIDGET_CREATED:
+					scene.addWidget(widgetId);
+					break;
+				case RecordType::WIDGET_DESTROYED:
+					scene.removeWidget(widgetId);
+					break;
+				default:
+					return false;
+			}
+
+			m_NextSequence = sequence + 1;
+			++replayed;
+			return true;
+		});
+
+		if (!decoded) {
+			break;
+		}
+	}
+
+	return replayed;
+}
+//=============================================================================
+
+//=============================================================================
+bool SessionJournal::start(const SceneState& scene)
+{
+	if (isStarted()) {
+		return true;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(m_Directory, error);
+
+	// The journal is emptied once the snapshot is in place, which also
+	// drops any incomplete record at its end
+	if (!writeSnapshot(encodeSnapshot(scene, m_NextSequence))) {
+		return false;
+	}
+
+	m_RecordCountSinceSnapshot = 0;
+	m_Stopping = false;
+	m_Thread = std::thread{[this] { run(); }};
+
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::stop()
+{
+	if (!isStarted()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{m_Mutex};
+		m_Stopping = true;
+	}
+
+	m_Condition.notify_one();
+	m_Thread.join();
+
+	m_JournalFile.close();
+}
+//=============================================================================
+
+//=============================================================================
+bool SessionJournal::isStarted() const
+{
+	return m_Thread.joinable();
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::recordUpdates(const SceneState::UpdateListType& updates)
+{
+	if (!isStarted()) {
+		return;
+	}
+
+	for (const auto& update : updates) {
+		if (update.type == ObjectType::LASER) {
+			continue;
+		}
+
+		enqueue({false,
+			encodeRecord(m_NextSequence++, RecordType::PROPERTY_UPDATE,
+				update.type, update.id, update.propList)});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::recordWidgetCreated(IdType id)
+{
+	if (isStarted()) {
+		enqueue({false, encodeRecord(m_NextSequence++,
+							RecordType::WIDGET_CREATED, ObjectType::WIDGET, id,
+							{})});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::recordWidgetDestroyed(IdType id)
+{
+	if (isStarted()) {
+		enqueue({false, encodeRecord(m_NextSequence++,
+							RecordType::WIDGET_DESTROYED, ObjectType::WIDGET,
+							id, {})});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::recordSnapshot(const SceneState& scene)
+{
+	if (isStarted()) {
+		enqueue({true, encodeSnapshot(scene, m_NextSequence)});
+		m_RecordCountSinceSnapshot = 0;
+	}
+}
+//=============================================================================
+
+//=============================================================================
+std::uint64_t SessionJournal::getRecordCountSinceSnapshot() const
+{
+	return m_RecordCountSinceSnapshot;
+}
+//=============================================================================
+
+//=============================================================================
+auto SessionJournal::getStatistics() const -> Statistics
+{
+	std::lock_guard<std::mutex> lock{m_Mutex};
+	return m_Statistics;
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::enqueue(Entry&& entry)
+{
+	if (!entry.snapshot) {
+		++m_RecordCountSinceSnapshot;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{m_Mutex};
+		m_Queue.push_back(std::move(entry));
+	}
+
+	m_Condition.notify_one();
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::run()
+{
+	std::unique_lock<std::mutex> lock{m_Mutex};
+
+	while (true) {
+		m_Condition.wait(
+			lock, [this] { return m_Stopping || !m_Queue.empty(); });
+
+		// Everything queued is committed before stopping
+		if (m_Queue.empty()) {
+			break;
+		}
+
+		auto entries = std::move(m_Queue);
+		m_Queue.clear();
+
+		lock.unlock();
+		commit(entries);
+		lock.lock();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void SessionJournal::commit(std::vector<Entry>& entries)
+{
+	Statistics statistics;
+
+	// A snapshot supersedes the records before it, which are dropped. Should
+	// it fail, they are kept in the journal instead
+	auto first = entries.begin();
+	auto snapshot = std::find_if(entries.rbegin(), entries.rend(),
+		[](const Entry& entry) { return entry.snapshot; });
+
+	if ((snapshot != entries.rend()) && writeSnapshot(snapshot->bytes)) {
+		++statistics.snapshots;
+		statistics.bytes += snapshot->bytes.size();
+
+		first = snapshot.base();
+	}
+
+	std::vector<std::uint8_t> bytes;
+	for (auto it = first; it != entries.end(); ++it) {
+		if (!it->snapshot) {
+			bytes.insert(bytes.end(), it->bytes.begin(), it->bytes.end());
+			++statistics.records;
+		}
+	}
+
+	if (!bytes.empty()) {
+		m_JournalFile.write(reinterpret_cast<const char*>(bytes.data()),
+			static_cast<std::streamsize>(bytes.size()));
+		m_JournalFile.flush();
+
+		if (!m_JournalFile) {
+			std::cerr << "Could not write the session journal in "
+					  << m_Directory.string() << std::endl;
+			m_JournalFile.clear();
+		}
+
+		++statistics.commits;
+		statistics.bytes += bytes.size();
+	}
+
+	std::lock_guard<std::mutex> lock{m_Mutex};
+	m_Statistics.records += statistics.records;
+	m_Statistics.commits += statistics.commits;
+	m_Statistics.snapshots += statistics.snapshots;
+	m_Statistics.bytes += statistics.bytes;
+}
+//=============================================================================
+
+//=============================================================================
+// Written beside the previous snapshot and renamed over it, so that there
+// always is a complete one. The journal is emptied afterwards; records left
+// in it by a crash in between are older than the snapshot and skipped
+bool SessionJournal::writeSnapshot(const std::vector<std::uint8_t>& bytes)
+{
+	const auto path = m_Directory / snapshotFileName;
+	auto temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+		file.write(reinterpret_cast<const char*>(bytes.data()),
+			static_cast<std::streamsize>(bytes.size()));
+		file.close();
+
+		if (!file) {
+			std::cerr << "Could not write the session snapshot in "
+					  << m_Directory.string() << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		std::cerr << "Could not replace the session snapshot in "
+				  << m_Directory.string() << ": " << error.message()
+				  << std::endl;
+		return false;
+	}
+
+	m_JournalFile.close();
+	m_JournalFile.open(m_Directory / journalFileName,
+		std::ios::binary | std::ios::trunc);
+
+	return m_JournalFile.is_open();
+}
+//=============================================================================
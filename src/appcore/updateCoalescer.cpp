@@ -0,0 +1,124 @@
+#include "appcore/updateCoalescer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+namespace
+{
+using PropertyType = common::PropertyListType::value_type;
+using PropertyId = common::PropertyId;
+
+// Node positions are addressed by index, so only a newer position of the
+// same node (or a whole new node list) makes an older one obsolete
+std::optional<std::uint16_t> getNodeIndex(const PropertyType& property)
+{
+	auto values =
+		std::get_if<std::vector<common::VariantType>>(&property.second);
+	if (!values || values->empty()) {
+		return std::nullopt;
+	}
+
+	if (auto index = std::get_if<std::uint16_t>(&values->front())) {
+		return *index;
+	}
+
+	return std::nullopt;
+}
+
+bool supersedes(const PropertyType& newer, const PropertyType& older)
+{
+	const auto newerId = newer.first.getId();
+	const auto olderId = older.first.getId();
+
+	if (olderId == PropertyId::NODE_POSITION) {
+		return (newerId == PropertyId::NODES) ||
+			((newerId == PropertyId::NODE_POSITION) &&
+				(getNodeIndex(newer) == getNodeIndex(older)));
+	}
+
+	return newerId == olderId;
+}
+}  // namespace
+
+//=============================================================================
+void UpdateCoalescer::add(ObjectType type, IdType id,
+	const PropertyListType& propList, SendCallbackType send)
+{
+	m_Statistics.receivedUpdates++;
+
+	auto it = std::find_if(m_PendingUpdates.begin(), m_PendingUpdates.end(),
+		[type, id](const auto& pending) {
+			return (pending.type == type) && (pending.id == id);
+		});
+
+	if (it == m_PendingUpdates.end()) {
+		m_PendingUpdates.push_back({type, id, propList, std::move(send)});
+		return;
+	}
+
+	m_Statistics.coalescedUpdates++;
+
+	// Superseded values are removed and the newer ones appended, so that
+	// applying the merged list in order gives the same result as applying
+	// every update
+	auto& pendingProps = it->propList;
+	for (const auto& property : propList) {
+		auto removed = std::remove_if(pendingProps.begin(), pendingProps.end(),
+			[&property](const auto& pendingProperty) {
+				return supersedes(property, pendingProperty);
+			});
+
+		m_Statistics.supersededProperties +=
+			std::distance(removed, pendingProps.end());
+
+		pendingProps.erase(removed, pendingProps.end());
+		pendingProps.push_back(property);
+	}
+
+	it->send = std::move(send);
+}
+//=============================================================================
+
+//=============================================================================
+void UpdateCoalescer::flush()
+{
+	// Sending may add or flush updates; those belong to the next flush
+	auto pendingUpdates = std::move(m_PendingUpdates);
+	m_PendingUpdates.clear();
+
+	for (const auto& pending : pendingUpdates) {
+		m_Statistics.sentUpdates++;
+
+		if (pending.send) {
+			pending.send(pending.propList);
+		}
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void UpdateCoalescer::discard(ObjectType type, IdType id)
+{
+	m_PendingUpdates.erase(
+		std::remove_if(m_PendingUpdates.begin(), m_PendingUpdates.end(),
+			[type, id](const auto& pending) {
+				return (pending.type == type) && (pending.id == id);
+			}),
+		m_PendingUpdates.end());
+}
+//=============================================================================
+
+//=============================================================================
+bool UpdateCoalescer::isEmpty() const
+{
+	return m_PendingUpdates.empty();
+}
+//=============================================================================
+
+//=============================================================================
+auto UpdateCoalescer::getStatistics() const -> const Statistics&
+{
+	return m_Statistics;
+}
+//=============================================================================
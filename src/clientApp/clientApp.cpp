@@ -3,6 +3,8 @@
 #include "clientApp/autostereoscopicOpenGLRenderWindow.h"
 #include "config/config.h"
 #include "networking/connection.h"
+#include "networking/datagramChannel.h"
+#include "networking/encodedMessage.h"
 #include "appcore/messages.h"
 #include "appcore/serializationHelper.h"
 #include "appcore/serializationTypes.h"
@@ -58,7 +60,9 @@
 #include <vector>
 
 //==============================================================================
-ClientApp::ClientApp()
+ClientApp::ClientApp() :
+	m_DatagramToken{0},
+	m_FrameFormat{NetworkMessage::FrameFormat::V1}
 {
 	m_Interactor = vtkSmartPointer<Interactor>::New();
 
@@ -178,7 +182,9 @@ ClientApp::ClientApp()
 		});
 
 	m_MessageEncoder.setOnCredentialsRequestedCallback(
-		[this] { onCredentialsRequested(); });
+		[this](const PeerCapabilities& serverCapabilities) {
+			onCredentialsRequested(serverCapabilities);
+		});
 
 	m_MessageEncoder.setOnAuthorizationSuccessCallback(
 		[this](const PeerInfo& info) { onAuthorizationSucceeded(info); });
@@ -186,6 +192,17 @@ ClientApp::ClientApp()
 	m_MessageEncoder.setOnAuthorizationFailedCallback(
 		[this] { onAuthorizationFailed(); });
 
+	m_MessageEncoder.setOnDatagramChannelOfferedCallback(
+		[this](const DatagramChannelOffer& offer) {
+			onDatagramChannelOffered(offer);
+		});
+
+	m_MessageEncoder.setOnStatisticsReceivedCallback(
+		[this](const std::string& report) {
+			emit serverStatisticsReceived(
+				QString::fromStdString(report), QPrivateSignal{});
+		});
+
 	m_MessageEncoder.setOnPeerAddedCallback(
 		[this](const PeerInfo& peerInfo) { onPeerAdded(peerInfo); });
 
@@ -197,6 +214,11 @@ ClientApp::ClientApp()
 			const std::vector<PeerInfo>& peers, ApplicationObjects&& dataObjects) {
 			onFullStateUpdated(peers, std::move(dataObjects));
 		});
+
+	m_MessageEncoder.setOnFullStateChunkReceivedCallback(
+		[this](FullStateChunk&& chunk) {
+			onFullStateChunkReceived(std::move(chunk));
+		});
 }
 //==============================================================================
 
@@ -355,6 +377,8 @@ void ClientApp::connectToHost(
 	const QHostAddress& hostAddress, quint16 portNumber)
 {
 	m_Connection = std::make_unique<Connection>();
+	m_Connection->setOptions(Config::getDefaultConfig().connectionOptions);
+	m_HostAddress = hostAddress;
 
 	QObject::connect(
 		m_Connection.get(), &Connection::messageReceived, m_Connection.get(),
@@ -569,8 +593,39 @@ void ClientApp::calibrateInteractionDevice()
 //==============================================================================
 
 //==============================================================================
-void ClientApp::onCredentialsRequested()
+void ClientApp::onCredentialsRequested(
+	const PeerCapabilities& serverCapabilities)
 {
+	// Servers which predate capability negotiation advertise nothing and
+	// must only ever receive JSON
+	if (serverCapabilities.flags != 0) {
+		sendMessage(m_MessageEncoder.createPeerCapabilitiesMsg(
+			PeerCapabilities{PeerCapabilities::supported}));
+	}
+
+	// Only use features both sides understand
+	PeerCapabilities capabilities{
+		serverCapabilities.flags & PeerCapabilities::supported};
+	m_MessageEncoder.setPeerCapabilities(capabilities);
+	m_Capabilities = capabilities;
+
+	// Neither end holds transform baselines for this connection yet
+	m_MessageEncoder.resetTransformBaselines();
+
+	if (m_Connection && capabilities.has(PeerCapabilities::MESSAGE_BATCH)) {
+		m_Connection->setBatchWindow(Connection::defaultBatchWindow);
+	}
+
+	// The capabilities went out in the frame format the server expects
+	// before it has read them; everything after them can resynchronize
+	if (capabilities.has(PeerCapabilities::FRAME_V2)) {
+		m_FrameFormat = NetworkMessage::FrameFormat::V2;
+
+		if (m_Connection) {
+			m_Connection->setFrameFormat(m_FrameFormat);
+		}
+	}
+
 	emit credentialsRequested(QPrivateSignal{});
 }
 //==============================================================================
@@ -598,6 +653,24 @@ void ClientApp::sendCredentials(
 }
 //==============================================================================
 
+//==============================================================================
+void ClientApp::requestServerStatistics()
+{
+	sendMessage(m_MessageEncoder.createStatisticsRequestMsg());
+}
+//==============================================================================
+
+//==============================================================================
+void ClientApp::setSubscription(const Subscription& subscription)
+{
+	m_Subscription = subscription;
+
+	if (m_ClientId && m_Capabilities.has(PeerCapabilities::SUBSCRIPTIONS)) {
+		sendMessage(m_MessageEncoder.createSubscriptionMsg(subscription));
+	}
+}
+//==============================================================================
+
 //==============================================================================
 void ClientApp::onAuthorizationSucceeded(const PeerInfo& peerInfo)
 {
@@ -609,6 +682,10 @@ void ClientApp::onAuthorizationSucceeded(const PeerInfo& peerInfo)
 			  << "(" << peerInfo.color[0] << ", " << peerInfo.color[1] << ", "
 			  << peerInfo.color[2] << ")" << std::endl;
 
+	if (m_Subscription) {
+		setSubscription(*m_Subscription);
+	}
+
 	emit connectionStarted(QPrivateSignal{});
 }
 //==============================================================================
@@ -621,11 +698,53 @@ void ClientApp::onAuthorizationFailed()
 }
 //==============================================================================
 
+//==============================================================================
+void ClientApp::onDatagramChannelOffered(const DatagramChannelOffer& offer)
+{
+	if (!m_Connection) {
+		return;
+	}
+
+	auto datagramChannel = std::make_unique<DatagramChannel>();
+	if (!datagramChannel->bind(QHostAddress::Any)) {
+		// Everything keeps going over the connection
+		std::cerr << "Could not open a datagram channel" << std::endl;
+		return;
+	}
+
+	QObject::connect(datagramChannel.get(), &DatagramChannel::messageReceived,
+		datagramChannel.get(), [this](auto, const NetworkMessage& msg) {
+			if (MessageEncoder::getLatestWinsKey(msg)) {
+				m_MessageEncoder.processMessage(msg);
+			}
+		});
+
+	QObject::connect(datagramChannel.get(), &DatagramChannel::settleRequired,
+		datagramChannel.get(), [this](auto, const EncodedMessage& msg) {
+			if (m_Connection) {
+				m_Connection->sendEncodedMessage(msg);
+			}
+		});
+
+	QObject::connect(datagramChannel.get(),
+		&DatagramChannel::endpointConfirmed, datagramChannel.get(),
+		[](auto) { std::cout << "Datagram channel is up" << std::endl; });
+
+	datagramChannel->connectEndpoint(offer.token, m_HostAddress, offer.port);
+
+	m_DatagramToken = offer.token;
+	m_DatagramChannel = std::move(datagramChannel);
+}
+//==============================================================================
+
 //==============================================================================
 void ClientApp::onDisconnected()
 {
+	m_DatagramChannel.reset();
 	m_Connection.reset();
+	m_FrameFormat = NetworkMessage::FrameFormat::V1;
 	m_ClientId = std::nullopt;
+	m_Capabilities = PeerCapabilities{};
 
 	if (m_ServerProcess &&
 		(m_ServerProcess->state() != QProcess::ProcessState::NotRunning)) {
@@ -740,7 +859,10 @@ void ClientApp::onWidgetUpdated(const WidgetUpdate& widgetUpdate)
 {
 	switch (widgetUpdate.msgType) {
 		case WidgetUpdate::MessageType::CREATE: {
+			// Node updates from peers may outpace the frame rate, and the
+			// geometry is only needed once per frame
 			auto widget = std::make_unique<SplineWidget>();
+			widget->setGeometryLazy(true);
 			widget->setInteractor(m_Interactor);
 			widget->setProcessEvents(true);
 
@@ -852,7 +974,82 @@ void ClientApp::onFullStateUpdated(
 
 	m_ApplicationObjects = std::move(dataObjects);
 
-	// peer information
+	setPeers(peers);
+
+	for (auto& [id, laser] : m_ApplicationObjects.lasers) {
+		setupLaser(id, *laser);
+	}
+
+	setupVolume(cachedVolume);
+	setupPlane();
+
+	for (auto& [widgetId, widget] : m_ApplicationObjects.widgets) {
+		setupWidget(widgetId, *widget);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ClientApp::onFullStateChunkReceived(FullStateChunk&& chunk)
+{
+	using Type = FullStateChunk::Type;
+
+	// Each object is set up as soon as it arrives, so the scene fills in
+	// while the rest of the state is still on its way
+	switch (chunk.type) {
+		case Type::PEERS: {
+			// Only opens a complete state; objects sent on their own replace
+			// just themselves
+			m_ApplicationObjects.lasers.clear();
+			m_ApplicationObjects.widgets.clear();
+
+			setPeers(chunk.peers);
+			break;
+		}
+		case Type::VOLUME: {
+			if (chunk.volume) {
+				vtkSmartPointer<vtkVolume> cachedVolume =
+					m_ApplicationObjects.volume->getVolume();
+
+				m_ApplicationObjects.volume = std::move(chunk.volume);
+				setupVolume(cachedVolume);
+			}
+			break;
+		}
+		case Type::PLANE: {
+			if (chunk.cutplane) {
+				m_ApplicationObjects.cutplane = std::move(chunk.cutplane);
+				setupPlane();
+			}
+			break;
+		}
+		case Type::LASER: {
+			if (chunk.laser) {
+				auto& laser = m_ApplicationObjects.lasers[chunk.id];
+				laser = std::move(chunk.laser);
+				setupLaser(chunk.id, *laser);
+			}
+			break;
+		}
+		case Type::WIDGET: {
+			if (chunk.widget) {
+				auto& widget = m_ApplicationObjects.widgets[chunk.id];
+				widget = std::move(chunk.widget);
+				setupWidget(chunk.id, *widget);
+			}
+			break;
+		}
+		case Type::END: {
+			std::cout << "Received the full state" << std::endl;
+			break;
+		}
+	}  // end switch
+}
+//==============================================================================
+
+//==============================================================================
+void ClientApp::setPeers(const std::vector<PeerInfo>& peers)
+{
 	m_ConnectedPeerModel.clear();
 
 	for (const auto& peer : peers) {
@@ -873,28 +1070,34 @@ void ClientApp::onFullStateUpdated(
 
 		m_ConnectedPeerModel.appendRow(newPeerItem);
 	}
+}
+//==============================================================================
 
-	// setup lasers -----------------------------------------------------------
-	for (auto& [id, laser] : m_ApplicationObjects.lasers) {
-		QObject::connect(
-			laser.get(), &LaserWidget::requestPropertyUpdate, laser.get(),
-			[this, id = id](const auto& propList) {
-				sendMessage(
-					m_MessageEncoder.createLaserUpdateMsg(LaserUpdate(propList)));
-			},
-			Qt::AutoConnection);
-
-		laser->setVisible(true);
-		laser->setInteractor(m_Interactor);
-		if (id == m_ClientId.value()) {
-			laser->setProcessEvents(true);
-		}
-		else {
-			laser->setProcessEvents(false);
-		}
+//==============================================================================
+void ClientApp::setupLaser(IdType id, LaserWidget& laser)
+{
+	QObject::connect(
+		&laser, &LaserWidget::requestPropertyUpdate, &laser,
+		[this, id = id](const auto& propList) {
+			sendMessage(
+				m_MessageEncoder.createLaserUpdateMsg(LaserUpdate(propList)));
+		},
+		Qt::AutoConnection);
+
+	laser.setVisible(true);
+	laser.setInteractor(m_Interactor);
+	if (id == m_ClientId.value()) {
+		laser.setProcessEvents(true);
 	}
+	else {
+		laser.setProcessEvents(false);
+	}
+}
+//==============================================================================
 
-	// setup volume -----------------------------------------------------------
+//==============================================================================
+void ClientApp::setupVolume(vtkSmartPointer<vtkVolume> cachedVolume)
+{
 	m_ApplicationObjects.volume->setVolume(cachedVolume);
 	m_ApplicationObjects.volume->setInteractor(m_Interactor);
 	m_ApplicationObjects.volume->setProcessEvents(true);
@@ -938,8 +1141,12 @@ void ClientApp::onFullStateUpdated(
 			}
 		},
 		Qt::AutoConnection);
+}
+//==============================================================================
 
-	// setup plane widget -----------------------------------------------------
+//==============================================================================
+void ClientApp::setupPlane()
+{
 	m_ApplicationObjects.cutplane->setInteractor(m_Interactor);
 	m_ApplicationObjects.cutplane->setProcessEvents(true);
 
@@ -989,59 +1196,62 @@ void ClientApp::onFullStateUpdated(
 			}
 		},
 		Qt::AutoConnection);
+}
+//==============================================================================
 
-	// setup widgets ---------------------------------------------------------
-	for (auto& [widgetId, widget] : m_ApplicationObjects.widgets) {
-		widget->setInteractor(m_Interactor);
-		widget->setProcessEvents(true);
+//==============================================================================
+void ClientApp::setupWidget(IdType widgetId, SplineWidget& widget)
+{
+	widget.setGeometryLazy(true);
+	widget.setInteractor(m_Interactor);
+	widget.setProcessEvents(true);
 
-		QObject::connect(
-			widget.get(), &SplineWidget::requestPropertyUpdate, widget.get(),
-			[this, id = widgetId](
-				const SplineWidget::PropertyListType& propList) {
+	QObject::connect(
+		&widget, &SplineWidget::requestPropertyUpdate, &widget,
+		[this, id = widgetId](
+			const SplineWidget::PropertyListType& propList) {
+			sendMessage(m_MessageEncoder.createWidgetUpdateMsg(WidgetUpdate{
+				WidgetUpdate::MessageType::PROPERTY_UPDATE, id, propList}));
+		},
+		Qt::AutoConnection);
+
+	QObject::connect(
+		&widget, &SplineWidget::interactionStateChanged, &widget,
+		[this, id = widgetId](SplineWidget::InteractionState newState,
+			SplineWidget::InteractionState oldState) {
+			if (newState != SplineWidget::InteractionState::ACTIVE) {
 				sendMessage(m_MessageEncoder.createWidgetUpdateMsg(WidgetUpdate{
-					WidgetUpdate::MessageType::PROPERTY_UPDATE, id, propList}));
-			},
-			Qt::AutoConnection);
-
-		QObject::connect(
-			widget.get(), &SplineWidget::interactionStateChanged, widget.get(),
-			[this, id = widgetId](SplineWidget::InteractionState newState,
-				SplineWidget::InteractionState oldState) {
-				if (newState != SplineWidget::InteractionState::ACTIVE) {
-					sendMessage(m_MessageEncoder.createWidgetUpdateMsg(WidgetUpdate{
-						WidgetUpdate::MessageType::INTERACTION_ENDED, id}));
-				}
-			},
-			Qt::AutoConnection);
-
-		QObject::connect(
-			widget.get(), &SplineWidget::interactionStateChanged, widget.get(),
-			[this](SplineWidget::InteractionState newState,
-				SplineWidget::InteractionState oldState) {
-				if ((newState == SplineWidget::InteractionState::ACTIVE) ||
-					(newState ==
-						SplineWidget::InteractionState::INTERSECTING)) {
-					auto& laserMap = m_ApplicationObjects.lasers;
-					if (auto it = laserMap.find(m_ClientId.value());
-						it != laserMap.end()) {
-						it->second->setHighlight(true);
-					}
+					WidgetUpdate::MessageType::INTERACTION_ENDED, id}));
+			}
+		},
+		Qt::AutoConnection);
+
+	QObject::connect(
+		&widget, &SplineWidget::interactionStateChanged, &widget,
+		[this](SplineWidget::InteractionState newState,
+			SplineWidget::InteractionState oldState) {
+			if ((newState == SplineWidget::InteractionState::ACTIVE) ||
+				(newState ==
+					SplineWidget::InteractionState::INTERSECTING)) {
+				auto& laserMap = m_ApplicationObjects.lasers;
+				if (auto it = laserMap.find(m_ClientId.value());
+					it != laserMap.end()) {
+					it->second->setHighlight(true);
 				}
-				else if (newState == SplineWidget::InteractionState::INACTIVE) {
-					auto& laserMap = m_ApplicationObjects.lasers;
-					if (auto it = laserMap.find(m_ClientId.value());
-						it != laserMap.end()) {
-						it->second->setHighlight(false);
-					}
+			}
+			else if (newState == SplineWidget::InteractionState::INACTIVE) {
+				auto& laserMap = m_ApplicationObjects.lasers;
+				if (auto it = laserMap.find(m_ClientId.value());
+					it != laserMap.end()) {
+					it->second->setHighlight(false);
 				}
+			}
 
-				if (oldState == SplineWidget::InteractionState::DEFINING) {
-					emit widgetPlacementEnded(QPrivateSignal{});
-				}
-			},
-			Qt::AutoConnection);
-	}
+			if (oldState == SplineWidget::InteractionState::DEFINING) {
+				emit widgetPlacementEnded(QPrivateSignal{});
+			}
+		},
+		Qt::AutoConnection);
 }
 //==============================================================================
 
@@ -1049,7 +1259,25 @@ void ClientApp::onFullStateUpdated(
 void ClientApp::sendMessage(const NetworkMessage& msg)
 {
 	if (m_Connection) {
-		m_Connection->sendMessage(msg);
+		// Encode here so the queued signal carries shared bytes instead of
+		// a deep copy of the payload
+		EncodedMessage encodedMsg{msg, m_FrameFormat};
+
+		if (m_DatagramChannel) {
+			if (auto latestWinsKey = MessageEncoder::getLatestWinsKey(msg)) {
+				if (m_DatagramChannel->sendMessage(
+						m_DatagramToken, latestWinsKey.value(), encodedMsg)) {
+					return;
+				}
+			}
+			else {
+				// Resends what went out as datagrams first, so that e.g. the
+				// last pose of a drag arrives before it ends
+				m_DatagramChannel->settle(m_DatagramToken);
+			}
+		}
+
+		m_Connection->sendEncodedMessage(encodedMsg);
 	}
 }
 //==============================================================================
\ No newline at end of file
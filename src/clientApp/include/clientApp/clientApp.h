@@ -4,6 +4,7 @@
 #include "networking/networkMessage.h"
 #include "common/coreTypes.h"
 #include "appcore/applicationObjects.h"
+#include "appcore/fullStateChunk.h"
 #include "appcore/messageEncoder.h"
 #include "clientApp/trackingManager.h"
 
@@ -18,13 +19,16 @@
 #include <memory>
 #include <string>
 #include <optional>
+#include <cstdint>
 
 class Connection;
+class DatagramChannel;
 class Interactor;
 class vtkRenderWindow;
 class vtkActor;
 class vtkOrientationMarkerWidget;
 class vtkImageData;
+class vtkVolume;
 
 class ClientApp : public QObject
 {
@@ -45,6 +49,15 @@ public:
 	void sendCredentials(const std::string& sessionCode,
 		const std::string& nickname);
 
+	// Asks the server for its message statistics, which arrive with
+	// serverStatisticsReceived
+	void requestServerStatistics();
+
+	// Declares which property updates the server should send on, and how
+	// often. Kept across connections and sent on each authorization, if the
+	// server understands subscriptions
+	void setSubscription(const Subscription&);
+
 	void launchServerApp(const QHostAddress& hostAddress =
 		QHostAddress::LocalHost, quint16 portNumber = 3760);
 
@@ -74,16 +87,21 @@ signals:
 	void serverFinished(QPrivateSignal);
 	void serverStatusChanged(QProcess::ProcessState, QPrivateSignal);
 	void widgetPlacementEnded(QPrivateSignal);
+	void serverStatisticsReceived(const QString& report, QPrivateSignal);
 
 protected:
 	using MessageType = NetworkMessage;
 	using ColorVectorType = common::ColorVectorType;
 
+	// Messages which MessageEncoder::getLatestWinsKey deems fit go over the
+	// datagram channel, when the server offered one, and everything else
+	// over the connection
 	void sendMessage(const NetworkMessage&);
 
-	void onCredentialsRequested();
+	void onCredentialsRequested(const PeerCapabilities&);
 	void onAuthorizationSucceeded(const PeerInfo&);
 	void onAuthorizationFailed();
+	void onDatagramChannelOffered(const DatagramChannelOffer&);
 	void onPeerAdded(const PeerInfo&);
 	void onPeerRemoved(const PeerInfo&);
 	void onDisconnected();
@@ -93,10 +111,19 @@ protected:
 	void onPlaneUpdated(const PlaneUpdate&);
 	void onFullStateUpdated(const std::vector<PeerInfo>&,
 		ApplicationObjects&&);
+	void onFullStateChunkReceived(FullStateChunk&&);
 
 private:
 	explicit ClientApp();
 
+	// Set up the objects of the full state once they are in
+	// m_ApplicationObjects
+	void setPeers(const std::vector<PeerInfo>&);
+	void setupLaser(IdType, LaserWidget&);
+	void setupVolume(vtkSmartPointer<vtkVolume> cachedVolume);
+	void setupPlane();
+	void setupWidget(IdType, SplineWidget&);
+
 	ApplicationObjects m_ApplicationObjects;
 	MessageEncoder m_MessageEncoder;
 	TrackingManager m_TrackingManager;
@@ -106,8 +133,14 @@ private:
 	vtkSmartPointer<vtkOrientationMarkerWidget> m_OrientationMarker;
 	vtkSmartPointer<Interactor> m_Interactor;
 	std::unique_ptr<Connection> m_Connection;
+	std::unique_ptr<DatagramChannel> m_DatagramChannel;
+	std::uint64_t m_DatagramToken;
+	NetworkMessage::FrameFormat m_FrameFormat;
+	QHostAddress m_HostAddress;
 	std::unique_ptr<QProcess> m_ServerProcess;
 	std::optional<unsigned long> m_ClientId;
+	PeerCapabilities m_Capabilities;
+	std::optional<Subscription> m_Subscription;
 };
 
 #endif
\ No newline at end of file
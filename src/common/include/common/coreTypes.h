@@ -1,6 +1,8 @@
 #ifndef coreTypes_h
 #define coreTypes_h
 
+#include "common/propertyKey.h"
+
 #include <Eigen/Geometry>
 
 #include <variant>
@@ -62,7 +64,8 @@ using PropertyVariantType =
 	decltype(detail::asVariant(detail::TypeCat<detail::PropTypes,
 		detail::TypeList<std::vector<detail::VariantType>>>::type{}));
 
-using PropertyListType = std::vector<std::pair<std::string, PropertyVariantType>>;
+using PropertyListType =
+	std::vector<std::pair<PropertyKey, PropertyVariantType>>;
 
 Q_DECLARE_METATYPE(PropertyVariantType);
 Q_DECLARE_METATYPE(PropertyListType);
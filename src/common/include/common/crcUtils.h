@@ -62,6 +62,24 @@ inline constexpr std::uint32_t lookupTable[256] = {0x00000000L, 0x04C11DB7L,
 std::uint32_t calculateCRC32(unsigned char* buffer, std::size_t length);
 
 void updateCRC32(unsigned char byte, std::uint32_t& crc);
+
+// Block-oriented update: feeds length bytes starting at buffer into crc and
+// returns the updated value. Produces exactly the same result as calling the
+// single-byte overload once per byte (MSB-first, polynomial 0x04C11DB7), but
+// dispatches at runtime to the fastest implementation the CPU supports
+std::uint32_t updateCRC32(
+	const void* buffer, std::size_t length, std::uint32_t crc);
+
+// Individual implementations behind the block-oriented update, exposed for
+// testing and benchmarking
+std::uint32_t updateCRC32SlicingBy8(
+	const void* buffer, std::size_t length, std::uint32_t crc);
+
+std::uint32_t updateCRC32CarrylessMultiply(
+	const void* buffer, std::size_t length, std::uint32_t crc);
+
+// Whether the CPU supports the carry-less multiply (PCLMULQDQ) implementation
+bool isCarrylessMultiplySupported();
 }  // namespace crc
 
 #endif
\ No newline at end of file
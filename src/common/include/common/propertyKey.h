@@ -0,0 +1,96 @@
+#ifndef propertyKey_h
+#define propertyKey_h
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace common
+{
+// Compile-time registry of the property names exchanged between widgets and
+// peers. New properties are appended to both the enum, ahead of COUNT, and
+// the name table so that existing ids stay stable on the wire
+enum class PropertyId : std::uint16_t {
+	UNKNOWN,
+	COLOR,
+	BASE,
+	TIP,
+	TRANSFORM,
+	NODE_POSITION,
+	NODES,
+	COUNT
+};
+
+inline constexpr std::array propertyNames = {std::string_view{"unknown"},
+	std::string_view{"color"}, std::string_view{"base"},
+	std::string_view{"tip"}, std::string_view{"transform"},
+	std::string_view{"nodePosition"}, std::string_view{"nodes"}};
+
+static_assert(
+	propertyNames.size() == static_cast<std::size_t>(PropertyId::COUNT),
+	"every PropertyId needs a name in propertyNames");
+
+// Property key. Comparisons and dispatch work on the id; the registered
+// name is used by text (JSON) archives and for debugging. Keys read by name
+// which are not registered, such as the properties of newer peers, are
+// UNKNOWN but keep their name, so they are written back as read. Such a key
+// owns its name, so names read off the wire go away with the keys holding
+// them
+class PropertyKey
+{
+public:
+	PropertyKey(PropertyId id = PropertyId::UNKNOWN) : m_Id{id} {}
+
+	PropertyId getId() const { return m_Id; }
+
+	std::string_view getName() const
+	{
+		return m_Name.empty() ? getRegisteredName(m_Id)
+							  : std::string_view{m_Name};
+	}
+
+	// Registered id of the name, or UNKNOWN
+	static constexpr PropertyId findId(std::string_view name)
+	{
+		for (std::size_t i = 0; i < propertyNames.size(); ++i) {
+			if (propertyNames[i] == name) {
+				return static_cast<PropertyId>(i);
+			}
+		}
+
+		return PropertyId::UNKNOWN;
+	}
+
+	static PropertyKey fromName(std::string_view name);
+
+	// Unregistered keys are told apart by name
+	bool operator==(const PropertyKey& other) const
+	{
+		return (m_Id == other.m_Id) &&
+			((m_Id != PropertyId::UNKNOWN) || (m_Name == other.m_Name));
+	}
+
+	bool operator!=(const PropertyKey& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	static constexpr std::string_view getRegisteredName(PropertyId id)
+	{
+		auto index = static_cast<std::size_t>(id);
+		return (index < propertyNames.size()) ? propertyNames[index]
+											  : propertyNames[0];
+	}
+
+	PropertyId m_Id;
+	std::string m_Name;	// unregistered names only
+};
+
+static_assert(PropertyKey::findId("nodes") == PropertyId::NODES,
+	"property name table is out of sync with PropertyId");
+}  // namespace common
+
+#endif
@@ -1,5 +1,171 @@
 #include "common/crcUtils.h"
 
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+	defined(_M_IX86)
+#	define CRC_HAS_X86_INTRINSICS 1
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define CRC_TARGET_CLMUL
+#	else
+#		include <cpuid.h>
+#		define CRC_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#	endif
+#endif
+
+namespace
+{
+using SlicingTablesType = std::array<std::array<std::uint32_t, 256>, 8>;
+
+// Table k holds the CRC of each byte value followed by k zero bytes, which
+// lets eight input bytes be folded into the CRC per iteration
+constexpr SlicingTablesType createSlicingTables()
+{
+	SlicingTablesType tables{};
+	for (std::size_t i = 0; i < 256; ++i) {
+		tables[0][i] = crc::lookupTable[i];
+	}
+
+	for (std::size_t k = 1; k < tables.size(); ++k) {
+		for (std::size_t i = 0; i < 256; ++i) {
+			const auto previous = tables[k - 1][i];
+			tables[k][i] = (previous << 8) ^ tables[0][previous >> 24];
+		}
+	}
+
+	return tables;
+}
+
+constexpr SlicingTablesType slicingTables = createSlicingTables();
+
+std::uint32_t updateCRC32Bytewise(
+	const unsigned char* buffer, std::size_t length, std::uint32_t crc)
+{
+	for (std::size_t i = 0; i < length; ++i) {
+		crc = crc::lookupTable[(crc >> 24) ^ buffer[i]] ^ (crc << 8);
+	}
+
+	return crc;
+}
+
+#ifdef CRC_HAS_X86_INTRINSICS
+// Remainder of x^n modulo the CRC polynomial, used as folding constants
+constexpr std::uint64_t xPowModP(unsigned int n)
+{
+	std::uint64_t remainder = 1;
+	for (unsigned int i = 0; i < n; ++i) {
+		remainder <<= 1;
+		if (remainder & 0x100000000ULL) {
+			remainder ^= 0x104C11DB7ULL;
+		}
+	}
+
+	return remainder;
+}
+
+// Folding constants for advancing the accumulator by one (128-bit) and four
+// (512-bit) blocks
+constexpr auto fold1Hi = static_cast<long long>(xPowModP(128 + 64));
+constexpr auto fold1Lo = static_cast<long long>(xPowModP(128));
+constexpr auto fold4Hi = static_cast<long long>(xPowModP(512 + 64));
+constexpr auto fold4Lo = static_cast<long long>(xPowModP(512));
+
+// Loads a 16-byte block as a big-endian 128-bit polynomial
+CRC_TARGET_CLMUL
+inline __m128i loadBlock(const unsigned char* bytes, __m128i byteReverse)
+{
+	return _mm_shuffle_epi8(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)), byteReverse);
+}
+
+// Folds a 128-bit accumulator forward by the distance encoded in the
+// constants (hi: x^(d+64) mod P, lo: x^d mod P) and adds the next block
+CRC_TARGET_CLMUL
+inline __m128i fold(__m128i accumulator, __m128i constants, __m128i block)
+{
+	const auto hi = _mm_clmulepi64_si128(accumulator, constants, 0x11);
+	const auto lo = _mm_clmulepi64_si128(accumulator, constants, 0x00);
+
+	return _mm_xor_si128(_mm_xor_si128(hi, lo), block);
+}
+
+CRC_TARGET_CLMUL
+std::uint32_t updateCRC32Clmul(
+	const unsigned char* buffer, std::size_t length, std::uint32_t crc)
+{
+	// The CRC is defined MSB-first, so each 16-byte block is byte-reversed
+	// into a big-endian 128-bit polynomial before folding
+	const auto byteReverse =
+		_mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+	const auto fold1 = _mm_set_epi64x(fold1Hi, fold1Lo);
+	const auto fold4 = _mm_set_epi64x(fold4Hi, fold4Lo);
+
+	// The incoming CRC is equivalent to xor-ing it into the leading 32 bits
+	// of the message
+	auto acc0 = _mm_xor_si128(loadBlock(buffer, byteReverse),
+		_mm_set_epi32(static_cast<int>(crc), 0, 0, 0));
+	auto acc1 = loadBlock(buffer + 16, byteReverse);
+	auto acc2 = loadBlock(buffer + 32, byteReverse);
+	auto acc3 = loadBlock(buffer + 48, byteReverse);
+	buffer += 64;
+	length -= 64;
+
+	while (length >= 64) {
+		acc0 = fold(acc0, fold4, loadBlock(buffer, byteReverse));
+		acc1 = fold(acc1, fold4, loadBlock(buffer + 16, byteReverse));
+		acc2 = fold(acc2, fold4, loadBlock(buffer + 32, byteReverse));
+		acc3 = fold(acc3, fold4, loadBlock(buffer + 48, byteReverse));
+		buffer += 64;
+		length -= 64;
+	}
+
+	auto accumulator = fold(acc0, fold1, acc1);
+	accumulator = fold(accumulator, fold1, acc2);
+	accumulator = fold(accumulator, fold1, acc3);
+
+	while (length >= 16) {
+		accumulator =
+			fold(accumulator, fold1, loadBlock(buffer, byteReverse));
+		buffer += 16;
+		length -= 16;
+	}
+
+	// The remaining 128-bit polynomial is congruent to everything folded so
+	// far; finish it (and any tail bytes) with the table-driven path
+	alignas(16) unsigned char remainder[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(remainder),
+		_mm_shuffle_epi8(accumulator, byteReverse));
+
+	crc = crc::updateCRC32SlicingBy8(remainder, sizeof(remainder), 0);
+	return crc::updateCRC32SlicingBy8(buffer, length, crc);
+}
+
+bool detectCarrylessMultiply()
+{
+	unsigned int registers[4] = {0, 0, 0, 0};
+#	ifdef _MSC_VER
+	__cpuid(reinterpret_cast<int*>(registers), 1);
+#	else
+	if (!__get_cpuid(
+			1, &registers[0], &registers[1], &registers[2], &registers[3])) {
+		return false;
+	}
+#	endif
+	const bool pclmulqdq = (registers[2] & (1u << 1)) != 0;
+	const bool ssse3 = (registers[2] & (1u << 9)) != 0;
+
+	return pclmulqdq && ssse3;
+}
+#endif
+
+// Below this size the setup cost of the carry-less multiply path outweighs
+// its benefit
+constexpr std::size_t carrylessMultiplyThreshold = 128;
+}  // namespace
+
 namespace crc
 {
 void updateCRC32(unsigned char byte, std::uint32_t& crc)
@@ -9,12 +175,63 @@ void updateCRC32(unsigned char byte, std::uint32_t& crc)
 
 std::uint32_t calculateCRC32(unsigned char* buffer, std::size_t length)
 {
-	std::uint32_t crc{0};
-	for (auto i = 0; i < length; ++i) {
-		updateCRC32(*buffer, crc);
-		buffer++;
+	return updateCRC32(buffer, length, 0);
+}
+
+std::uint32_t updateCRC32(
+	const void* buffer, std::size_t length, std::uint32_t crc)
+{
+	static const bool useCarrylessMultiply = isCarrylessMultiplySupported();
+
+	if (useCarrylessMultiply && (length >= carrylessMultiplyThreshold)) {
+		return updateCRC32CarrylessMultiply(buffer, length, crc);
 	}
 
-	return crc;
+	return updateCRC32SlicingBy8(buffer, length, crc);
+}
+
+std::uint32_t updateCRC32SlicingBy8(
+	const void* buffer, std::size_t length, std::uint32_t crc)
+{
+	auto bytes = static_cast<const unsigned char*>(buffer);
+	const auto& t = slicingTables;
+
+	while (length >= 8) {
+		crc ^= (static_cast<std::uint32_t>(bytes[0]) << 24) |
+			(static_cast<std::uint32_t>(bytes[1]) << 16) |
+			(static_cast<std::uint32_t>(bytes[2]) << 8) |
+			(static_cast<std::uint32_t>(bytes[3]) << 0);
+
+		crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xFF] ^
+			t[5][(crc >> 8) & 0xFF] ^ t[4][crc & 0xFF] ^ t[3][bytes[4]] ^
+			t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+
+		bytes += 8;
+		length -= 8;
+	}
+
+	return updateCRC32Bytewise(bytes, length, crc);
+}
+
+std::uint32_t updateCRC32CarrylessMultiply(
+	const void* buffer, std::size_t length, std::uint32_t crc)
+{
+#ifdef CRC_HAS_X86_INTRINSICS
+	if ((length >= 64) && isCarrylessMultiplySupported()) {
+		return updateCRC32Clmul(
+			static_cast<const unsigned char*>(buffer), length, crc);
+	}
+#endif
+	return updateCRC32SlicingBy8(buffer, length, crc);
+}
+
+bool isCarrylessMultiplySupported()
+{
+#ifdef CRC_HAS_X86_INTRINSICS
+	static const bool supported = detectCarrylessMultiply();
+	return supported;
+#else
+	return false;
+#endif
 }
-}  // namespace crc
\ No newline at end of file
+}  // namespace crc
@@ -0,0 +1,16 @@
+#include "common/propertyKey.h"
+
+namespace common
+{
+//=============================================================================
+PropertyKey PropertyKey::fromName(std::string_view name)
+{
+	PropertyKey key{findId(name)};
+	if ((key.m_Id == PropertyId::UNKNOWN) && (name != key.getName())) {
+		key.m_Name = name;
+	}
+
+	return key;
+}
+//=============================================================================
+}  // namespace common
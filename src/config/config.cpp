@@ -15,6 +15,37 @@ namespace
 {
 const std::filesystem::path defaultConfigPath{"../configuration/config.json"};
 
+// Reads the optional "connection" object, e.g.
+// "connection": {"low_delay": true, "send_buffer_size": 262144,
+//     "receive_buffer_size": 262144, "keep_alive_idle": 10,
+//     "keep_alive_interval": 2, "dscp": 46}
+void readConnectionOptions(
+	const QJsonObject& connectionObject, ConnectionOptions& options)
+{
+	if (auto it = connectionObject.constFind("low_delay");
+		it != connectionObject.end()) {
+		if (auto val = *it; val.isBool()) {
+			options.lowDelay = val.toBool();
+		}
+	}
+
+	const std::pair<const char*, int*> intOptions[] = {
+		{"send_buffer_size", &options.sendBufferSize},
+		{"receive_buffer_size", &options.receiveBufferSize},
+		{"keep_alive_idle", &options.keepAliveIdle},
+		{"keep_alive_interval", &options.keepAliveInterval},
+		{"dscp", &options.dscp}};
+
+	for (const auto& [name, value] : intOptions) {
+		if (auto it = connectionObject.constFind(name);
+			it != connectionObject.end()) {
+			if (auto val = *it; val.isDouble()) {
+				*value = val.toInt();
+			}
+		}
+	}
+}
+
 void createDefaultConfigFile(const std::filesystem::path& filename)
 {
 	QJsonDocument doc;
@@ -91,6 +122,14 @@ Config getDefaultConfigFromFile(const std::filesystem::path& filename)
 					defaultConfig.serverPath = val.toString().toStdString();
 				}
 			}
+
+			if (auto it = rootObject.constFind("connection");
+				it != rootObject.end()) {
+				if (auto val = *it; val.isObject()) {
+					readConnectionOptions(
+						val.toObject(), defaultConfig.connectionOptions);
+				}
+			}
 		}
 	}
 
@@ -1,6 +1,8 @@
 #ifndef config_h
 #define config_h
 
+#include "networking/connectionOptions.h"
+
 #include <string>
 
 class Config {
@@ -10,6 +12,7 @@ public:
 	std::string barcoCOMPort; // port used for Barco display communication
 	std::string defaultAlias; // alias (name) used when joining a network session
 	std::string serverPath; // path to the server application
+	ConnectionOptions connectionOptions; // socket tuning of peer connections
 
 	static const Config& getDefaultConfig();
 };
@@ -1,36 +1,82 @@
 #ifndef connection_h
 #define connection_h
 
+#include "connectionOptions.h"
+#include "encodedMessage.h"
 #include "networkMessage.h"
+#include "sendQueue.h"
 
 #include <QObject>
 
+#include <cstddef>
 #include <memory>
 
 class NetworkMessage;
 class QHostAddress;
+class ConnectionThreadPool;
+class ConnectionImpl;
 
 class Connection : public QObject
 {
 	Q_OBJECT;
 
 public:
-	explicit Connection();
+	// Without a thread pool the connection runs its own I/O thread;
+	// otherwise its socket is served by one of the pool's threads
+	explicit Connection(ConnectionThreadPool* threadPool = nullptr);
 	~Connection();
 
+	// Batch window used once both peers understand MESSAGE_BATCH frames
+	static constexpr int defaultBatchWindow = 0;
+
 signals:
 	void connectToClient(qintptr socketDescriptor);
 	void connectToServer(const QHostAddress& clientAddress, quint16 portNumber);
 	void sendMessage(const NetworkMessage&);
+	void sendEncodedMessage(const EncodedMessage&);
 	void close();
+
+	// Small messages sent within this many milliseconds of the first one
+	// still unsent are packed into a single MESSAGE_BATCH frame; zero packs
+	// those sent during one pass of the connection's event loop. A negative
+	// window (the default) writes every message on its own. Only enable once
+	// the peer is known to understand batches
+	void setBatchWindow(int milliseconds);
+
+	// Socket options, applied as soon as the socket is connected (and right
+	// away if it already is). Without this signal the defaults of
+	// ConnectionOptions apply
+	void setOptions(const ConnectionOptions&);
+
+	// Frame format of the messages sent from now on. Frames of the default
+	// format, V1, cannot be told apart from garbage after a corrupt one;
+	// only switch to V2 once the peer is known to understand it
+	void setFrameFormat(NetworkMessage::FrameFormat);
 	
 	void error(const QString&, QPrivateSignal);
 	void disconnected(QPrivateSignal);
+
+	// Receivers in the thread of this object get the message without
+	// another copy of its payload, which goes back to PayloadPool once all of
+	// them have returned
 	void messageReceived(const NetworkMessage&, QPrivateSignal);
 
+	// Emitted when the peer falls behind, every second while it is behind
+	// and once it has caught up. Whenever more than a few MiB wait in the
+	// socket, messages are held in a send queue instead, where a newer
+	// message drops an older one with the same supersede key
+	void sendQueueStatisticsUpdated(
+		const SendQueue::Statistics&, QPrivateSignal);
+
 private:
 	class ConnectionThread;
 	std::unique_ptr<ConnectionThread> m_ConnectionThread;
+
+	// Set instead of the thread when hosted by a pool; the implementation
+	// then lives until it is deleted on its pool thread
+	ConnectionThreadPool* m_ThreadPool;
+	ConnectionImpl* m_PooledImpl;
+	std::size_t m_PoolThreadIndex;
 };
 
 #endif
\ No newline at end of file
@@ -1,13 +1,21 @@
 #ifndef connectionImpl_h
 #define connectionImpl_h
 
+#include "connectionOptions.h"
+#include "networkMessage.h"
 #include "networkMessageParser.h"
+#include "payloadPool.h"
+#include "sendQueue.h"
 
 #include <QObject>
 #include <QTcpSocket>
+#include <QTimer>
+
+#include <cstdint>
 
 class QHostAddress;
 class NetworkMessage;
+class EncodedMessage;
 
 class ConnectionImpl : public QObject
 {
@@ -18,18 +26,45 @@ public:
 
 public slots:
 	void sendMessage(const NetworkMessage&);
+	void sendEncodedMessage(const EncodedMessage&);
 	void connectToClient(qintptr socketDescriptor);
 	void connectToServer(const QHostAddress& hostAddress, quint16 portNumber);
 	void close();
+	void setBatchWindow(int milliseconds);
+	void setOptions(const ConnectionOptions&);
+	void setFrameFormat(NetworkMessage::FrameFormat);
 
 signals:
-	void messageReceived(const NetworkMessage&, QPrivateSignal);
+	void messageReceived(const SharedNetworkMessage&, QPrivateSignal);
 	void disconnected(QPrivateSignal);
 	void error(const QString&, QPrivateSignal);
+	void sendQueueStatisticsUpdated(
+		const SendQueue::Statistics&, QPrivateSignal);
 
 private:
+	void applyOptions();
+	void writeMessage(const NetworkMessage&);
+	void writeEncodedMessage(const EncodedMessage&);
+	bool isBatching() const;
+	void scheduleBatchFlush();
+	void flushBatch();
+	void enqueue(const EncodedMessage&);
+	void pushToSendQueue(const EncodedMessage&);
+	void updateCongestion();
+	void drainSendQueue();
+	void reportSendQueue();
+
 	NetworkMessageParser m_MessageParser;
 	QTcpSocket m_Socket;
+	QTimer m_BatchTimer;
+	NetworkMessage m_Batch;
+	int m_BatchWindow;
+	NetworkMessage::FrameFormat m_FrameFormat;
+	ConnectionOptions m_Options;
+	SendQueue m_SendQueue;
+	QTimer m_SendQueueReportTimer;
+	bool m_Congested;
+	std::uint64_t m_CongestionCount;
 };
 
 #endif
\ No newline at end of file
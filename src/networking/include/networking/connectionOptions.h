@@ -0,0 +1,40 @@
+#ifndef connectionOptions_h
+#define connectionOptions_h
+
+#include <QMetaType>
+#include <QtGlobal>
+
+// Socket level tuning of a peer connection. Interaction updates are small
+// and latency-sensitive, hence low-delay mode by default; everything else
+// keeps the system defaults unless set
+struct ConnectionOptions
+{
+	// Disables Nagle's algorithm, so small updates are sent immediately
+	// rather than held back until earlier ones are acknowledged
+	bool lowDelay = true;
+
+	// Kernel socket buffer sizes in bytes; zero keeps the system default
+	int sendBufferSize = 0;
+	int receiveBufferSize = 0;
+
+	// Seconds a connection may be idle before keepalive probes start, and
+	// between probes; zero leaves keepalive off
+	int keepAliveIdle = 0;
+	int keepAliveInterval = 0;
+
+	// Differentiated services code point of outgoing packets (46 is
+	// expedited forwarding); negative leaves the field alone. Windows only
+	// honors it through its QoS policies
+	int dscp = -1;
+};
+
+Q_DECLARE_METATYPE(ConnectionOptions);
+
+namespace connectionOptions
+{
+// Applies the options to a connected socket. Returns false if any of them
+// was rejected; the others are still applied
+bool apply(qintptr socketDescriptor, const ConnectionOptions&);
+}  // namespace connectionOptions
+
+#endif
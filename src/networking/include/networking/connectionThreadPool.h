@@ -0,0 +1,45 @@
+#ifndef connectionThreadPool_h
+#define connectionThreadPool_h
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class QObject;
+class QThread;
+
+// A fixed set of I/O threads, each running one event loop which serves the
+// sockets of many connections, as an alternative to a thread per connection.
+// Connections are handed to the least loaded thread, taking turns among
+// equally loaded ones. The pool must outlive the connections created on it
+class ConnectionThreadPool
+{
+public:
+	// A thread count of zero (or less) uses one thread per core
+	explicit ConnectionThreadPool(int threadCount = 0);
+	~ConnectionThreadPool();
+
+	ConnectionThreadPool(const ConnectionThreadPool&) = delete;
+	ConnectionThreadPool& operator=(const ConnectionThreadPool&) = delete;
+
+	int getThreadCount() const;
+
+	// Number of connections currently hosted by each thread
+	std::vector<int> getLoad() const;
+
+private:
+	friend class Connection;
+
+	// Moves the object to a pool thread and returns the index of the thread,
+	// to be given back to release once the object has been disposed of
+	std::size_t attach(QObject* object);
+	void release(std::size_t threadIndex);
+
+	std::vector<std::unique_ptr<QThread>> m_Threads;
+	std::vector<int> m_Load;
+	std::size_t m_NextThread;
+	mutable std::mutex m_Mutex;
+};
+
+#endif
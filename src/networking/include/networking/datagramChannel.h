@@ -0,0 +1,137 @@
+#ifndef datagramChannel_h
+#define datagramChannel_h
+
+#include "encodedMessage.h"
+#include "networkMessage.h"
+
+#include <QHostAddress>
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+class QUdpSocket;
+
+// Unreliable, unordered companion of a Connection for high-rate state which
+// is superseded within milliseconds, such as poses. Each datagram carries one
+// message of a stream, identified by a stream key; a receiver drops any
+// datagram older than the last one it accepted for that stream. Layout
+// (big-endian), followed by the message frame exactly as on the connection:
+//
+//   offset  size  field
+//        0     8  token of the endpoint
+//        8     1  kind (message, probe or probe reply)
+//        9     4  sequence number
+//       13     8  stream key
+//
+// Endpoints are identified by a random token handed out over the reliable
+// connection. A side which knows the address of the other end probes it until
+// it answers; the other side learns the address from the probes. Nothing is
+// sent to an endpoint before that exchange has confirmed it.
+//
+// Messages are only sent as datagrams within a stream that is already open.
+// The first message of a stream is left to the reliable connection, as is
+// the last one sent as a datagram once the stream goes quiet or settle is
+// called. Sending every reliable message after settling the streams of the
+// endpoint keeps state changes from overtaking each other across the two
+// channels. The socket is served by the event loop of the owning thread
+class DatagramChannel : public QObject
+{
+	Q_OBJECT;
+
+public:
+	using TokenType = std::uint64_t;
+	using StreamKeyType = std::uint64_t;
+	using ClockType = std::chrono::steady_clock;
+
+	// Largest datagram sent; larger messages go over the connection
+	static constexpr std::size_t maxDatagramSize = 1200;
+
+	// A stream without messages for this long is settled
+	static constexpr std::chrono::milliseconds settleDelay{100};
+
+	static constexpr std::chrono::milliseconds probeInterval{250};
+	static constexpr int maxProbeAttempts = 20;
+
+	explicit DatagramChannel(QObject* parent = nullptr);
+	~DatagramChannel();
+
+	// A port of zero picks a free one
+	bool bind(const QHostAddress& address, quint16 port = 0);
+	bool isBound() const;
+	quint16 getPort() const;
+
+	static TokenType generateToken();
+
+	// Expects datagrams with the token from an address learned once they
+	// arrive
+	void addEndpoint(TokenType);
+
+	// Probes the other end at the given address until it answers
+	void connectEndpoint(TokenType, const QHostAddress&, quint16 port);
+
+	void removeEndpoint(TokenType);
+	bool isConfirmed(TokenType) const;
+
+	// Sends the message as a datagram, unless the endpoint is unconfirmed,
+	// the message does not fit in a datagram or it opens the stream. Returns
+	// whether it was sent; if not, send it over the connection instead
+	bool sendMessage(TokenType, StreamKeyType, const EncodedMessage&);
+
+	// Closes every open stream of the endpoint, emitting settleRequired for
+	// those whose last message went out as a datagram
+	void settle(TokenType);
+
+signals:
+	void endpointConfirmed(TokenType, QPrivateSignal);
+	void messageReceived(TokenType, const NetworkMessage&, QPrivateSignal);
+
+	// The message has to be sent over the connection, before anything else
+	// sent there from now on
+	void settleRequired(TokenType, const EncodedMessage&, QPrivateSignal);
+
+private:
+	enum class Kind : std::uint8_t {
+		MESSAGE,
+		PROBE,
+		PROBE_REPLY
+	};
+
+	struct Stream
+	{
+		ClockType::time_point lastSent;
+		std::optional<EncodedMessage> unsettled;
+	};
+
+	struct Endpoint
+	{
+		std::optional<QHostAddress> address;
+		quint16 port = 0;
+		bool confirmed = false;
+		int probeAttempts = 0;
+		std::uint32_t nextSequence = 0;
+		std::unordered_map<StreamKeyType, Stream> sentStreams;
+		std::unordered_map<StreamKeyType, std::uint32_t> receivedSequences;
+	};
+
+	void onReadyRead();
+	void receiveDatagram(
+		const QByteArray&, const QHostAddress&, quint16 port);
+	void write(TokenType, Endpoint&, Kind, StreamKeyType = 0,
+		const QByteArray& frame = QByteArray());
+	void confirm(TokenType, Endpoint&);
+	void sendProbes();
+	void settleQuietStreams();
+	void settle(TokenType, Endpoint&, bool quietOnly);
+
+	std::unique_ptr<QUdpSocket> m_Socket;
+	std::unordered_map<TokenType, Endpoint> m_Endpoints;
+	QTimer m_ProbeTimer;
+	QTimer m_SettleTimer;
+};
+
+#endif
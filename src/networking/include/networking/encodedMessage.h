@@ -0,0 +1,51 @@
+#ifndef encodedMessage_h
+#define encodedMessage_h
+
+#include "networking/networkMessage.h"
+
+#include <QByteArray>
+#include <QMetaType>
+
+#include <cstdint>
+#include <optional>
+
+// Immutable, fully-encoded wire frame. The bytes are held in an implicitly
+// shared (reference-counted) QByteArray, so copies handed to several
+// connection threads share a single buffer rather than duplicating it
+class EncodedMessage
+{
+public:
+	using DescriptorType = NetworkMessage::DescriptorType;
+	using FrameFormat = NetworkMessage::FrameFormat;
+
+	EncodedMessage() = default;
+	explicit EncodedMessage(
+		const NetworkMessage& msg, FrameFormat format = FrameFormat::V1);
+	~EncodedMessage() = default;
+
+	DescriptorType getType() const;
+	FrameFormat getFrameFormat() const;
+	const QByteArray& getBytes() const;
+	bool isEmpty() const;
+
+	// The same message in the given frame format. Unless it already is in
+	// that format, this copies the payload into a new frame, so encode for
+	// the format of the receiving connection in the first place
+	EncodedMessage withFrameFormat(FrameFormat format) const;
+
+	// Messages with equal keys hold new values for the same properties of
+	// the same object, so a congested connection may drop a queued one in
+	// favor of the latest. Only set it where that loses nothing
+	void setSupersedeKey(std::uint64_t key);
+	std::optional<std::uint64_t> getSupersedeKey() const;
+
+private:
+	DescriptorType m_Type = 0x0000;
+	FrameFormat m_FrameFormat = FrameFormat::V1;
+	QByteArray m_Bytes;
+	std::optional<std::uint64_t> m_SupersedeKey;
+};
+
+Q_DECLARE_METATYPE(EncodedMessage);
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef epollServer_h
+#define epollServer_h
+
+#include "connectionOptions.h"
+#include "networkMessageParser.h"
+#include "sendQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class NetworkMessage;
+class EncodedMessage;
+
+// Server side networking on Linux epoll, as an alternative to TcpServer and
+// a Connection per peer: every socket is non-blocking and edge-triggered,
+// and all of them are served from the thread calling poll, so no event loop
+// and no thread per connection is needed. Not thread-safe apart from stop.
+//
+// Callbacks are only ever invoked from poll, never from within send or
+// close, so they may send to or close any connection. Messages sent while
+// polling are written once the events at hand have been handled, letting
+// the writes of one pass share system calls; those sent at other times are
+// written right away.
+//
+// Connections apply the same backpressure as Connection: once more than
+// SendQueue::highWatermark bytes wait to be written, further messages are
+// held in a SendQueue, where newer ones supersede stale ones, until the
+// backlog drains below SendQueue::lowWatermark. A connection whose queue
+// passes its limit is closed
+class EpollServer
+{
+public:
+	using ConnectionIdType = std::uint64_t;
+	using ConnectionCallbackType = std::function<void(ConnectionIdType)>;
+	using MessageCallbackType =
+		std::function<void(ConnectionIdType, NetworkMessage&)>;
+	using ErrorCallbackType =
+		std::function<void(ConnectionIdType, const std::string&)>;
+	using SendQueueStatisticsCallbackType = std::function<void(
+		ConnectionIdType, const SendQueue::Statistics&)>;
+
+	EpollServer();
+	~EpollServer();
+
+	EpollServer(const EpollServer&) = delete;
+	EpollServer& operator=(const EpollServer&) = delete;
+
+	// Listens on an IPv4 address; a port of zero picks a free one
+	bool listen(const std::string& address, std::uint16_t port);
+	bool isListening() const;
+	std::uint16_t getPort() const;
+
+	// Stops accepting connections; those already accepted stay open
+	void closeListener();
+
+	void setConnectedCallback(ConnectionCallbackType);
+	void setDisconnectedCallback(ConnectionCallbackType);
+	void setMessageReceivedCallback(MessageCallbackType);
+	void setErrorCallback(ErrorCallbackType);
+
+	// Invoked when a connection falls behind, every
+	// SendQueue::reportInterval milliseconds while it stays behind, and
+	// once it has caught up
+	void setSendQueueStatisticsCallback(SendQueueStatisticsCallbackType);
+
+	// Socket options of connections accepted from now on
+	void setConnectionOptions(const ConnectionOptions&);
+
+	// Frame format of everything sent to the connection from now on; only
+	// switch once the peer is known to understand it
+	void setFrameFormat(ConnectionIdType, NetworkMessage::FrameFormat);
+
+	void sendMessage(ConnectionIdType, const NetworkMessage&);
+	void sendEncodedMessage(ConnectionIdType, const EncodedMessage&);
+
+	// Closes the connection once everything sent to it has been written.
+	// The disconnected callback follows, as for connections closed by the
+	// peer
+	void close(ConnectionIdType);
+
+	std::size_t getConnectionCount() const;
+
+	// The epoll descriptor, which is readable whenever poll has something to
+	// do; watching it lets another event loop drive the server
+	int getDescriptor() const;
+
+	// Waits up to the given time for events (-1 waits indefinitely) and
+	// handles them. Returns false if waiting failed
+	bool poll(int timeoutMilliseconds);
+
+	// Polls until stop is called
+	void run();
+
+	// Makes run return; may be called from any thread
+	void stop();
+
+private:
+	struct Client
+	{
+		int socket = -1;
+		NetworkMessageParser parser;
+		// Bytes handed over for writing, of which the first outputOffset
+		// have been written
+		std::vector<char> output;
+		std::size_t outputOffset = 0;
+		SendQueue sendQueue;
+		bool congested = false;
+		std::uint64_t congestionCount = 0;
+		bool reportPending = false;
+		std::chrono::steady_clock::time_point reportTime;
+		bool closing = false;
+		bool removing = false;
+		std::string error;
+		NetworkMessage::FrameFormat frameFormat =
+			NetworkMessage::FrameFormat::V1;
+	};
+
+	void acceptConnections();
+	void readFrom(ConnectionIdType, Client&);
+	void append(Client&, const char* data, std::size_t size);
+	void enqueue(ConnectionIdType, Client&, const EncodedMessage&);
+	void updateCongestion(ConnectionIdType, Client&);
+	bool drainSendQueue(ConnectionIdType, Client&);
+	void scheduleReport(ConnectionIdType, Client&);
+	void scheduleWrite(ConnectionIdType, Client&);
+	void writeTo(ConnectionIdType, Client&);
+	void fail(ConnectionIdType, Client&, const std::string& reason);
+	void scheduleRemoval(ConnectionIdType, Client&);
+	void finishPass();
+	void wake();
+
+	int m_EpollDescriptor;
+	int m_ListenDescriptor;
+	int m_WakeDescriptor;
+	std::uint16_t m_Port;
+	ConnectionIdType m_NextConnectionId;
+	bool m_Polling;
+	std::atomic<bool> m_Stopped;
+
+	std::unordered_map<ConnectionIdType, std::unique_ptr<Client>> m_Clients;
+	std::vector<ConnectionIdType> m_PendingWrites;
+	std::vector<ConnectionIdType> m_PendingRemovals;
+	std::vector<ConnectionIdType> m_PendingReports;
+	std::vector<char> m_ReadBuffer;
+	ConnectionOptions m_ConnectionOptions;
+
+	ConnectionCallbackType m_ConnectedCallback;
+	ConnectionCallbackType m_DisconnectedCallback;
+	MessageCallbackType m_MessageReceivedCallback;
+	ErrorCallbackType m_ErrorCallback;
+	SendQueueStatisticsCallbackType m_SendQueueStatisticsCallback;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef messageBatch_h
+#define messageBatch_h
+
+#include "networking/networkMessage.h"
+
+#include <cstdint>
+#include <functional>
+
+class EncodedMessage;
+
+// Packing of several messages into the payload of one MESSAGE_BATCH frame,
+// so that they share a single header, checksum and socket write. Each packed
+// message is its type and size fields, encoded as in the frame prefix,
+// followed by its payload
+namespace messageBatch
+{
+using PayloadDataType = NetworkMessage::PayloadDataType;
+using MessageCallbackType = std::function<void(NetworkMessage&)>;
+
+// Number of bytes preceding each packed payload
+inline constexpr std::size_t entryPrefixSize =
+	sizeof(NetworkMessage::DescriptorType) + sizeof(NetworkMessage::SizeType);
+
+void append(PayloadDataType& batch, NetworkMessage::DescriptorType type,
+	const std::uint8_t* payload, std::size_t payloadSize);
+
+void append(PayloadDataType& batch, const NetworkMessage& msg);
+
+// Reuses the type, size and payload already encoded in the frame
+void append(PayloadDataType& batch, const EncodedMessage& msg);
+
+// Invokes the callback for each packed message in order. Returns false if
+// the batch is malformed, after the messages preceding the fault have been
+// delivered. Batches are never nested, so packed batches are skipped
+bool unpack(const PayloadDataType& batch, const MessageCallbackType& callback);
+}  // namespace messageBatch
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef messageStatistics_h
+#define messageStatistics_h
+
+#include "networking/networkMessage.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Counts messages, bytes and latencies of every message type through the
+// stages a message passes on its way in and out. Recording is lock-free:
+// threads add to one of a few stripes of relaxed atomic counters, picked
+// once per thread, so they rarely share a cache line. Snapshots sum the
+// stripes and may be taken from any thread while recording goes on
+class MessageStatistics
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using DescriptorType = NetworkMessage::DescriptorType;
+
+	enum class Stage : std::uint8_t {
+		PARSE,	// first byte of the frame read until the message is complete
+		QUEUE,	// from the I/O thread to the thread of its Connection
+		DECODE,	// payload into the message structure
+		HANDLE,	// callback of the message type
+		WRITE	// frame handed to the socket
+	};
+
+	static constexpr std::size_t stageCount = 5;
+
+	// Types from this one on, which a peer with a newer protocol may send,
+	// share the last slot
+	static constexpr std::size_t typeCount = 24;
+
+	// Latency histogram with HDR-style log-linear buckets: each power of two
+	// from 1 us to 4 s is split into subBucketCount buckets, so a latency is
+	// known to within 25% at any magnitude. Anything shorter falls into the
+	// first bucket, anything longer into the last
+	struct Histogram
+	{
+		static constexpr std::size_t subBucketCount = 4;
+		static constexpr unsigned minExponent = 10;
+		static constexpr unsigned maxExponent = 32;
+		static constexpr std::size_t bucketCount =
+			(maxExponent - minExponent) * subBucketCount + 2;
+
+		static std::size_t getBucket(std::chrono::nanoseconds);
+
+		// Largest latency counted in the bucket
+		static std::chrono::nanoseconds getBucketLimit(std::size_t bucket);
+
+		std::uint64_t getCount() const;
+
+		// Upper limit of the bucket holding the given fraction of latencies,
+		// e.g. 0.99 for the 99th percentile; zero if nothing was recorded
+		std::chrono::nanoseconds getPercentile(double fraction) const;
+
+		std::array<std::uint64_t, bucketCount> buckets{};
+	};
+
+	struct Entry
+	{
+		std::uint64_t messages = 0;
+		std::uint64_t bytes = 0;
+		Histogram latency;
+	};
+
+	// Totals per message type and stage
+	struct Snapshot
+	{
+		const Entry& get(DescriptorType, Stage) const;
+
+		// What was recorded since the earlier snapshot
+		Snapshot operator-(const Snapshot& earlier) const;
+
+		std::array<std::array<Entry, stageCount>, typeCount> entries;
+	};
+
+	MessageStatistics();
+	~MessageStatistics();
+
+	MessageStatistics(const MessageStatistics&) = delete;
+	MessageStatistics& operator=(const MessageStatistics&) = delete;
+
+	// The statistics recorded by the networking and appcore modules, which
+	// live until the process exits
+	static MessageStatistics& getDefault();
+
+	void record(Stage, DescriptorType, std::size_t bytes, Clock::duration);
+
+	Snapshot getSnapshot() const;
+
+	// One line per message type with any traffic, giving the count and the
+	// median, 99th percentile and maximum latency of each stage it passed
+	static std::string format(const Snapshot&);
+
+	static const char* getStageName(Stage);
+	static const char* getTypeName(DescriptorType);
+
+	// Records the time taken by consecutive stages of one message; the stage
+	// running when the timer is destroyed ends there
+	class StageTimer
+	{
+	public:
+		StageTimer(MessageStatistics&, DescriptorType, std::size_t bytes,
+			Stage first);
+		~StageTimer();
+
+		StageTimer(const StageTimer&) = delete;
+		StageTimer& operator=(const StageTimer&) = delete;
+
+		// Ends the running stage and starts the given one
+		void next(Stage);
+
+	private:
+		MessageStatistics& m_Statistics;
+		DescriptorType m_Type;
+		std::size_t m_Bytes;
+		Stage m_Stage;
+		Clock::time_point m_Start;
+	};
+
+private:
+	struct Stripe;
+
+	static constexpr std::size_t stripeCount = 4;
+
+	std::array<std::unique_ptr<Stripe>, stripeCount> m_Stripes;
+};
+
+#endif
@@ -4,6 +4,9 @@
 #include <QByteArray>
 #include <QMetaType>
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 
 class NetworkMessage
@@ -20,7 +23,16 @@ public:
 		LASER_UPDATED,
 		VOLUME_UPDATED,
 		WIDGET_EVENT,
-		PLANE_EVENT
+		PLANE_EVENT,
+		PEER_CAPABILITIES,
+		LASER_POSE,
+		TRANSFORM_UPDATE,
+		MESSAGE_BATCH,	// several messages under one frame, see messageBatch.h
+		DATAGRAM_CHANNEL,	// offer of a datagramChannel.h endpoint
+		FULL_STATE_CHUNK,	// one part of a FULL_STATE, see fullStateChunk.h
+		STATISTICS_REQUEST,	// query of the server's messageStatistics.h
+		STATISTICS,	// answer to STATISTICS_REQUEST
+		SUBSCRIPTION	// updates a peer wants, see Subscription in messages.h
 	};
 
 	using HeaderType = std::uint8_t;
@@ -29,18 +41,100 @@ public:
 	using PayloadDataType = std::vector<std::uint8_t>;
 	using ChecksumType = std::uint32_t;
 
+	// Version 1 frames start with a single zero header byte, so after any
+	// corruption every zero in the stream looks like the start of a frame.
+	// Version 2 frames start with a sync word instead, and protect the
+	// prefix with a checksum of its own which is verified before the payload
+	// is accepted. Type, size and trailer are encoded the same in both:
+	//
+	//   version 1: header | type | size | payload | checksum
+	//   version 2: sync word | type | size | prefix checksum | payload |
+	//              checksum
+	//
+	// The trailing checksum covers everything preceding it
+	enum class FrameFormat : std::uint8_t {
+		V1,
+		V2
+	};
+
+	static constexpr std::array<std::uint8_t, 4> syncWord{
+		0xE9, 0x1C, 0x5B, 0xA3};
+
+	// Number of bytes preceding the payload (header, type and size fields)
+	static constexpr std::size_t prefixSize =
+		sizeof(HeaderType) + sizeof(DescriptorType) + sizeof(SizeType);
+
+	// Number of bytes preceding the payload of a version 2 frame
+	static constexpr std::size_t prefixSizeV2 = syncWord.size() +
+		sizeof(DescriptorType) + sizeof(SizeType) + sizeof(ChecksumType);
+
+	// Number of bytes following the payload (checksum field)
+	static constexpr std::size_t trailerSize = sizeof(ChecksumType);
+
+	// Largest payload of any message; see getMaxPayloadSize for the limit
+	// of each type
+	static constexpr SizeType maxPayloadSize = 524288000;
+
+	// Set in the type field of messages whose payload uses the binary
+	// archive of MessageEncoder, so that receivers can decode without
+	// per-connection state; mask it off before comparing against MessageType
+	static constexpr DescriptorType binaryArchiveFlag = 0x8000;
+
+	// Encoded prefix of either frame format
+	struct Prefix
+	{
+		const std::uint8_t* data() const { return bytes.data(); }
+		std::size_t size() const { return length; }
+
+		std::array<std::uint8_t, prefixSizeV2> bytes;
+		std::size_t length;
+	};
+
+	// Wire representation split into the encoded prefix, a view of the
+	// payload (pointing into data, so only valid while the message is alive
+	// and unmodified) and the encoded checksum trailer
+	struct Segments
+	{
+		Prefix prefix;
+		const std::uint8_t* payload;
+		std::size_t payloadSize;
+		std::array<std::uint8_t, trailerSize> trailer;
+	};
+
 	NetworkMessage() = default;
 	~NetworkMessage() = default;
 
-	QByteArray serialize() const;
+	NetworkMessage(const NetworkMessage&) = default;
+	NetworkMessage& operator=(const NetworkMessage&) = default;
+
+	// Moves hand over the payload buffer without copying it
+	NetworkMessage(NetworkMessage&&) = default;
+	NetworkMessage& operator=(NetworkMessage&&) = default;
+
+	// Encodes the complete frame into a single, exactly-sized buffer
+	QByteArray serialize(FrameFormat = FrameFormat::V1) const;
+
+	// Encodes the frame without copying the payload, for scatter/gather writes
+	Segments serializeSegments(FrameFormat = FrameFormat::V1) const;
+
+	static std::size_t getPrefixSize(FrameFormat);
+
+	// Largest payload accepted for a message of the given type; a frame
+	// claiming more is treated as corrupt before anything is allocated
+	static SizeType getMaxPayloadSize(DescriptorType);
 
 	HeaderType header = 0x00;
 	DescriptorType type = 0x0000;
 	SizeType size = 0x00000000;	 // size of payload data
 	PayloadDataType data;
 	ChecksumType checksum = 0x00000000;
+
+	// When the parser completed the message, to time the stages following
+	// it; not part of the frame
+	std::chrono::steady_clock::time_point receivedAt;
 };
 
 Q_DECLARE_METATYPE(NetworkMessage);
+Q_DECLARE_METATYPE(NetworkMessage::FrameFormat);
 
 #endif
\ No newline at end of file
@@ -5,12 +5,23 @@
 
 #include <QByteArray>
 
+#include <array>
+#include <chrono>
 #include <functional>
 #include <cstdint>
 
+// Reassembles messages from a stream of either frame format (see
+// NetworkMessage::FrameFormat). Frames whose size exceeds the limit of their
+// type are dropped as corrupt before their payload is reserved. Once a
+// version 2 frame has arrived, the peer is known to send nothing else and
+// version 1 frames are no longer accepted, so that only the sync word can
+// start a frame. Messages are stamped with the time they were completed, and
+// the time since the parser got to their first byte is recorded in
+// MessageStatistics as their PARSE stage
 class NetworkMessageParser
 {
 public:
+	using Clock = std::chrono::steady_clock;
 	using MessageReadyCallbackType = std::function<void(NetworkMessage&)>;
 
 	void parse(const QByteArray&);
@@ -20,6 +31,7 @@ public:
 private:
 	enum class MessageSection {
 		HEADER,
+		FRAME_PREFIX,
 		TYPE_BYTE1,
 		TYPE_BYTE2,
 		SIZE_BYTE1,
@@ -33,11 +45,26 @@ private:
 		CHECKSUM_BYTE4
 	};
 
+	void beginPayload();
+	void finishMessage();
+	void rejectFrame();
+
+	// Version 2 prefix handling
+	bool hasSyncWord() const;
+	void acceptPrefix();
+	void resynchronize();
+
 	MessageReadyCallbackType m_MessageReadyCallback;
 	NetworkMessage m_Message;
 	NetworkMessage::SizeType m_CurrentMessageSize = 0;
 	MessageSection m_ParseStep = MessageSection::HEADER;
 	std::uint32_t m_ChecksumValue = 0x00000000;
+	std::array<std::uint8_t, NetworkMessage::prefixSizeV2> m_Prefix;
+	std::size_t m_PrefixSize = 0;
+	bool m_LegacyFramesAccepted = true;
+	Clock::time_point m_FrameStart;
+	Clock::time_point m_ChunkTime;
+	bool m_ChunkTimed = false;
 };
 
-#endif
\ No newline at end of file
+#endif
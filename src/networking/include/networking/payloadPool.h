@@ -0,0 +1,71 @@
+#ifndef payloadPool_h
+#define payloadPool_h
+
+#include "networking/networkMessage.h"
+
+#include <QMetaType>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Received message whose payload is shared, immutable, between the threads
+// it passes through instead of being copied at every queued signal
+using SharedNetworkMessage = std::shared_ptr<const NetworkMessage>;
+
+// Recycles payload buffers of received messages. A connection parses into a
+// buffer from the pool and hands the message on as a SharedNetworkMessage;
+// once the last reference is gone, i.e. after every receiver has processed
+// it, the buffer returns to the pool with its capacity. A steady stream of
+// messages thus stops allocating payloads. Thread-safe
+class PayloadPool
+{
+public:
+	using PayloadDataType = NetworkMessage::PayloadDataType;
+
+	struct Statistics
+	{
+		// Buffers handed out, and how many of them came from the pool
+		std::uint64_t acquired = 0;
+		std::uint64_t reused = 0;
+
+		// Buffers given back, and how many of them were freed as the pool
+		// was full or they were too large to keep
+		std::uint64_t released = 0;
+		std::uint64_t discarded = 0;
+	};
+
+	// Limits on what the pool holds on to between bursts
+	static constexpr std::size_t maxBuffers = 256;
+	static constexpr std::size_t maxBufferCapacity = 1024 * 1024;
+
+	PayloadPool() = default;
+
+	PayloadPool(const PayloadPool&) = delete;
+	PayloadPool& operator=(const PayloadPool&) = delete;
+
+	// The pool used by connections, which lives until the process exits
+	static PayloadPool& getDefault();
+
+	// An empty buffer, with the capacity of a recycled one if available
+	PayloadDataType acquire();
+	void release(PayloadDataType&&);
+
+	// Moves the message into a shared one which releases its payload back
+	// to the pool, and leaves the message with a recycled, empty payload
+	// ready to be parsed into again
+	SharedNetworkMessage share(NetworkMessage&);
+
+	Statistics getStatistics() const;
+
+private:
+	mutable std::mutex m_Mutex;
+	std::vector<PayloadDataType> m_Buffers;
+	Statistics m_Statistics;
+};
+
+Q_DECLARE_METATYPE(SharedNetworkMessage);
+
+#endif
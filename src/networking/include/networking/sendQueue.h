@@ -0,0 +1,73 @@
+#ifndef sendQueue_h
+#define sendQueue_h
+
+#include "networking/encodedMessage.h"
+
+#include <QMetaType>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Outbound messages held back while a peer's socket is congested. A message
+// carrying a supersede key replaces any queued one with the same key, which
+// is then never sent; messages without a key are always kept
+class SendQueue
+{
+public:
+	struct Statistics
+	{
+		// Whether messages are currently being held back
+		bool congested = false;
+
+		// Messages and bytes currently waiting
+		std::size_t queuedMessages = 0;
+		std::size_t queuedBytes = 0;
+
+		// Largest backlog seen, in bytes
+		std::size_t peakQueuedBytes = 0;
+
+		// Bytes handed to the socket but not yet written to the network
+		std::int64_t socketBytes = 0;
+
+		// Queued messages dropped in favor of a newer one
+		std::uint64_t supersededMessages = 0;
+
+		// Number of times the peer fell behind and queueing began
+		std::uint64_t congestionCount = 0;
+	};
+
+	static constexpr std::size_t defaultMaxBytes = 64 * 1024 * 1024;
+
+	// Once the socket holds more than highWatermark unwritten bytes,
+	// messages wait in the send queue until it has drained below
+	// lowWatermark
+	static constexpr std::int64_t highWatermark = 4 * 1024 * 1024;
+	static constexpr std::int64_t lowWatermark = 1024 * 1024;
+
+	// Statistics are reported this often while a peer is congested
+	static constexpr int reportInterval = 1000;
+
+	explicit SendQueue(std::size_t maxBytes = defaultMaxBytes);
+
+	// Returns false if the queue exceeds its limit even after dropping
+	// superseded messages; the message is queued regardless, and a message
+	// is never refused by an empty queue
+	bool push(const EncodedMessage&);
+
+	const EncodedMessage& front() const;
+	void pop();
+	bool isEmpty() const;
+
+	// The congestion and socket figures are left for the connection to fill
+	const Statistics& getStatistics() const;
+
+private:
+	std::deque<EncodedMessage> m_Messages;
+	std::size_t m_MaxBytes;
+	Statistics m_Statistics;
+};
+
+Q_DECLARE_METATYPE(SendQueue::Statistics);
+
+#endif
@@ -1,13 +1,26 @@
 #include "networking/connection.h"
 #include "networking/connectionImpl.h"
+#include "networking/connectionThreadPool.h"
+#include "networking/encodedMessage.h"
+#include "networking/messageBatch.h"
+#include "networking/messageStatistics.h"
 #include "networking/networkMessage.h"
+#include "networking/payloadPool.h"
 
 #include <QHostAddress>
 #include <QThread>
 
 #include <iostream>
 
-static constexpr std::uint32_t maxMessageSize = 524288000;
+// Messages with larger payloads are written on their own, and a batch is
+// written as soon as it grows past maxBatchSize
+static constexpr std::size_t maxBatchedPayloadSize = 16384;
+static constexpr std::size_t maxBatchSize = 65536;
+
+// See SendQueue for the watermarks
+static constexpr qint64 highWatermark = SendQueue::highWatermark;
+static constexpr qint64 lowWatermark = SendQueue::lowWatermark;
+static constexpr int sendQueueReportInterval = SendQueue::reportInterval;
 
 class Connection::ConnectionThread : public QThread
 {
@@ -27,18 +40,46 @@ private:
 //==============================================================================
 // ConnectionImpl
 //==============================================================================
-ConnectionImpl::ConnectionImpl() : m_Socket{this}
+ConnectionImpl::ConnectionImpl() :
+	m_Socket{this},
+	m_BatchTimer{this},
+	m_BatchWindow{-1},
+	m_FrameFormat{NetworkMessage::FrameFormat::V1},
+	m_SendQueueReportTimer{this},
+	m_Congested{false},
+	m_CongestionCount{0}
 {
 	std::cout << "ConnectionImpl::constructor" << std::endl;
 
-	m_MessageParser.setMessageReadyCallback([this](const auto& msg) {
-		emit messageReceived(msg, QPrivateSignal{});
+	m_Batch.header = 0x00;
+	m_Batch.type = NetworkMessage::MESSAGE_BATCH;
+
+	m_BatchTimer.setSingleShot(true);
+	QObject::connect(
+		&m_BatchTimer, &QTimer::timeout, this, [this] { flushBatch(); });
+
+	m_SendQueueReportTimer.setInterval(sendQueueReportInterval);
+	QObject::connect(&m_SendQueueReportTimer, &QTimer::timeout, this,
+		[this] { reportSendQueue(); });
+
+	QObject::connect(&m_Socket, &QTcpSocket::bytesWritten, this,
+		[this] { drainSendQueue(); });
+
+	QObject::connect(
+		&m_Socket, &QTcpSocket::connected, this, [this] { applyOptions(); });
+
+	// The parsed message is handed on without copying its payload, and the
+	// parser continues with a recycled buffer
+	m_MessageParser.setMessageReadyCallback([this](auto& msg) {
+		emit messageReceived(
+			PayloadPool::getDefault().share(msg), QPrivateSignal{});
 	});
 
 	QObject::connect(&m_Socket, &QTcpSocket::readyRead, this, [this] {
 		while (m_Socket.bytesAvailable()) {
 			m_MessageParser.parse(m_Socket.readAll());
-			if (m_MessageParser.getCurrentMessageSize() > maxMessageSize) {
+			if (m_MessageParser.getCurrentMessageSize() >
+				NetworkMessage::maxPayloadSize) {
 				m_Socket.close();
 
 				emit error("Max message length exceeded", QPrivateSignal{});
@@ -61,8 +102,14 @@ ConnectionImpl::ConnectionImpl() : m_Socket{this}
 		Qt::AutoConnection);
 
 	qRegisterMetaType<NetworkMessage>("NetworkMessage");
+	qRegisterMetaType<SharedNetworkMessage>("SharedNetworkMessage");
+	qRegisterMetaType<EncodedMessage>("EncodedMessage");
 	qRegisterMetaType<QHostAddress>("QHostAddress");
 	qRegisterMetaType<qintptr>("qintptr");
+	qRegisterMetaType<SendQueue::Statistics>("SendQueue::Statistics");
+	qRegisterMetaType<ConnectionOptions>("ConnectionOptions");
+	qRegisterMetaType<NetworkMessage::FrameFormat>(
+		"NetworkMessage::FrameFormat");
 }
 //==============================================================================
 
@@ -78,7 +125,9 @@ ConnectionImpl::~ConnectionImpl()
 void ConnectionImpl::connectToClient(qintptr socketDescriptor)
 {
 	std::cout << "ConnectionImpl::connectToClient" << std::endl;
-	m_Socket.setSocketDescriptor(socketDescriptor);
+	if (m_Socket.setSocketDescriptor(socketDescriptor)) {
+		applyOptions();
+	}
 }
 //==============================================================================
 
@@ -94,16 +143,262 @@ void ConnectionImpl::connectToServer(
 //==============================================================================
 void ConnectionImpl::sendMessage(const NetworkMessage& msg)
 {
-	m_Socket.write(msg.serialize());
+	if (m_Congested) {
+		enqueue(EncodedMessage{msg, m_FrameFormat});
+		return;
+	}
+
+	if (isBatching() && (msg.data.size() <= maxBatchedPayloadSize)) {
+		messageBatch::append(m_Batch.data, msg);
+		scheduleBatchFlush();
+		return;
+	}
+
+	// Keep messages in the order they were sent
+	flushBatch();
+	writeMessage(msg);
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::sendEncodedMessage(const EncodedMessage& encodedMsg)
+{
+	const auto msg = encodedMsg.withFrameFormat(m_FrameFormat);
+
+	const auto frameOverhead = NetworkMessage::getPrefixSize(m_FrameFormat) +
+		NetworkMessage::trailerSize;
+	const auto frameSize = static_cast<std::size_t>(msg.getBytes().size());
+
+	if (m_Congested) {
+		enqueue(msg);
+		return;
+	}
+
+	if (isBatching() && !msg.isEmpty() &&
+		(frameSize <= frameOverhead + maxBatchedPayloadSize)) {
+		messageBatch::append(m_Batch.data, msg);
+		scheduleBatchFlush();
+		return;
+	}
+
+	flushBatch();
+	writeEncodedMessage(msg);
 }
 //==============================================================================
 
 //==============================================================================
 void ConnectionImpl::close()
 {
+	flushBatch();
+
+	// The socket writes everything it holds before disconnecting
+	while (!m_SendQueue.isEmpty()) {
+		m_Socket.write(m_SendQueue.front().getBytes());
+		m_SendQueue.pop();
+	}
+
 	m_Socket.disconnectFromHost();
 }
 //==============================================================================
+
+//==============================================================================
+void ConnectionImpl::setBatchWindow(int milliseconds)
+{
+	m_BatchWindow = milliseconds;
+
+	if (!isBatching()) {
+		flushBatch();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::setFrameFormat(NetworkMessage::FrameFormat format)
+{
+	// Batched messages go out in the frame format they were sent with
+	flushBatch();
+	m_FrameFormat = format;
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::setOptions(const ConnectionOptions& options)
+{
+	m_Options = options;
+
+	if (m_Socket.state() == QAbstractSocket::ConnectedState) {
+		applyOptions();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::applyOptions()
+{
+	if (!connectionOptions::apply(m_Socket.socketDescriptor(), m_Options)) {
+		std::cerr << "Some connection options could not be applied"
+				  << std::endl;
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::writeMessage(const NetworkMessage& msg)
+{
+	const auto frameSize = NetworkMessage::getPrefixSize(m_FrameFormat) +
+		msg.data.size() + NetworkMessage::trailerSize;
+
+	MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+		msg.type, frameSize, MessageStatistics::Stage::WRITE};
+
+	// Hand the socket the encoded prefix, the payload and the trailer
+	// directly rather than assembling an intermediate copy of the frame
+	const auto segments = msg.serializeSegments(m_FrameFormat);
+
+	m_Socket.write(reinterpret_cast<const char*>(segments.prefix.data()),
+		segments.prefix.size());
+
+	if (segments.payloadSize > 0) {
+		m_Socket.write(reinterpret_cast<const char*>(segments.payload),
+			segments.payloadSize);
+	}
+
+	m_Socket.write(reinterpret_cast<const char*>(segments.trailer.data()),
+		segments.trailer.size());
+
+	updateCongestion();
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::writeEncodedMessage(const EncodedMessage& msg)
+{
+	MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+		msg.getType(), static_cast<std::size_t>(msg.getBytes().size()),
+		MessageStatistics::Stage::WRITE};
+
+	m_Socket.write(msg.getBytes());
+	updateCongestion();
+}
+//==============================================================================
+
+//==============================================================================
+bool ConnectionImpl::isBatching() const
+{
+	return m_BatchWindow >= 0;
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::scheduleBatchFlush()
+{
+	if (m_Batch.data.size() >= maxBatchSize) {
+		flushBatch();
+	}
+	else if (!m_BatchTimer.isActive()) {
+		m_BatchTimer.start(m_BatchWindow);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::flushBatch()
+{
+	m_BatchTimer.stop();
+
+	if (m_Batch.data.empty()) {
+		return;
+	}
+
+	m_Batch.size = m_Batch.data.size();
+	if (m_Congested) {
+		pushToSendQueue(EncodedMessage{m_Batch, m_FrameFormat});
+	}
+	else {
+		writeMessage(m_Batch);
+	}
+	m_Batch.data.clear();
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::enqueue(const EncodedMessage& msg)
+{
+	// Anything still batched was sent before this message
+	flushBatch();
+	pushToSendQueue(msg);
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::pushToSendQueue(const EncodedMessage& msg)
+{
+	if (!m_SendQueue.push(msg)) {
+		// The peer cannot keep up, and dropping anything more would leave
+		// it out of sync
+		m_Socket.close();
+
+		emit error("Send queue limit exceeded", QPrivateSignal{});
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::updateCongestion()
+{
+	if (m_Congested || (m_Socket.bytesToWrite() <= highWatermark)) {
+		return;
+	}
+
+	m_Congested = true;
+	m_CongestionCount++;
+
+	m_SendQueueReportTimer.start();
+	reportSendQueue();
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::drainSendQueue()
+{
+	if (!m_Congested || (m_Socket.bytesToWrite() > lowWatermark)) {
+		return;
+	}
+
+	while (!m_SendQueue.isEmpty() &&
+		(m_Socket.bytesToWrite() <= highWatermark)) {
+		const auto& msg = m_SendQueue.front();
+
+		{
+			MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+				msg.getType(), static_cast<std::size_t>(msg.getBytes().size()),
+				MessageStatistics::Stage::WRITE};
+
+			m_Socket.write(msg.getBytes());
+		}
+		m_SendQueue.pop();
+	}
+
+	if (m_SendQueue.isEmpty() && (m_Socket.bytesToWrite() <= highWatermark)) {
+		m_Congested = false;
+
+		m_SendQueueReportTimer.stop();
+		reportSendQueue();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionImpl::reportSendQueue()
+{
+	auto statistics = m_SendQueue.getStatistics();
+	statistics.congested = m_Congested;
+	statistics.socketBytes = m_Socket.bytesToWrite();
+	statistics.congestionCount = m_CongestionCount;
+
+	emit sendQueueStatisticsUpdated(statistics, QPrivateSignal{});
+}
+//==============================================================================
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 //==============================================================================
 // ConnectionThread
@@ -137,7 +432,10 @@ void Connection::ConnectionThread::run()
 //==============================================================================
 // Connection
 //==============================================================================
-Connection::Connection()
+Connection::Connection(ConnectionThreadPool* threadPool) :
+	m_ThreadPool{threadPool},
+	m_PooledImpl{nullptr},
+	m_PoolThreadIndex{0}
 {
 	std::cout << "Connection::constructor" << std::endl;
 	auto connectionImpl = std::make_unique<ConnectionImpl>();
@@ -151,14 +449,29 @@ Connection::Connection()
 	QObject::connect(this, &Connection::sendMessage, connectionImpl.get(),
 		&ConnectionImpl::sendMessage, Qt::AutoConnection);
 
+	QObject::connect(this, &Connection::sendEncodedMessage,
+		connectionImpl.get(), &ConnectionImpl::sendEncodedMessage,
+		Qt::AutoConnection);
+
 	QObject::connect(this, &Connection::close, connectionImpl.get(),
 		&ConnectionImpl::close, Qt::AutoConnection);
 
+	QObject::connect(this, &Connection::setBatchWindow, connectionImpl.get(),
+		&ConnectionImpl::setBatchWindow, Qt::AutoConnection);
+
+	QObject::connect(this, &Connection::setOptions, connectionImpl.get(),
+		&ConnectionImpl::setOptions, Qt::AutoConnection);
+
+	QObject::connect(this, &Connection::setFrameFormat, connectionImpl.get(),
+		&ConnectionImpl::setFrameFormat, Qt::AutoConnection);
+
 	QObject::connect(
 		connectionImpl.get(), &ConnectionImpl::disconnected, this,
 		[this] {
-			m_ConnectionThread->quit();
-			m_ConnectionThread->wait();
+			if (m_ConnectionThread) {
+				m_ConnectionThread->quit();
+				m_ConnectionThread->wait();
+			}
 
 			emit disconnected(QPrivateSignal{});
 		},
@@ -173,11 +486,31 @@ Connection::Connection()
 
 	QObject::connect(
 		connectionImpl.get(), &ConnectionImpl::messageReceived, this,
-		[this](const NetworkMessage& msg) {
-			emit messageReceived(msg, QPrivateSignal{});
+		[this](const SharedNetworkMessage& msg) {
+			MessageStatistics::getDefault().record(
+				MessageStatistics::Stage::QUEUE, msg->type, msg->data.size(),
+				MessageStatistics::Clock::now() - msg->receivedAt);
+
+			// Receivers connected directly are done with the message once
+			// this returns, and the payload goes back to the pool
+			emit messageReceived(*msg, QPrivateSignal{});
+		},
+		Qt::AutoConnection);
+
+	QObject::connect(
+		connectionImpl.get(), &ConnectionImpl::sendQueueStatisticsUpdated,
+		this,
+		[this](const SendQueue::Statistics& statistics) {
+			emit sendQueueStatisticsUpdated(statistics, QPrivateSignal{});
 		},
 		Qt::AutoConnection);
 
+	if (m_ThreadPool) {
+		m_PoolThreadIndex = m_ThreadPool->attach(connectionImpl.get());
+		m_PooledImpl = connectionImpl.release();
+		return;
+	}
+
 	m_ConnectionThread =
 		std::make_unique<ConnectionThread>(std::move(connectionImpl));
 
@@ -189,6 +522,15 @@ Connection::Connection()
 Connection::~Connection()
 {
 	std::cout << "Connection::destructor" << std::endl;
+
+	if (m_PooledImpl) {
+		// Calls already queued to the implementation are processed before
+		// its deferred deletion
+		m_PooledImpl->deleteLater();
+		m_ThreadPool->release(m_PoolThreadIndex);
+		return;
+	}
+
 	m_ConnectionThread->quit();
 	m_ConnectionThread->wait();
 }
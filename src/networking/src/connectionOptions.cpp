@@ -0,0 +1,93 @@
+#include "networking/connectionOptions.h"
+
+#ifdef _WIN32
+#	include <WinSock2.h>
+#	include <WS2tcpip.h>
+#else
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#	include <sys/socket.h>
+#endif
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace
+{
+bool setOption(qintptr socketDescriptor, int level, int name, int value)
+{
+#ifdef _WIN32
+	return setsockopt(static_cast<SOCKET>(socketDescriptor), level, name,
+			   reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+#else
+	return setsockopt(static_cast<int>(socketDescriptor), level, name, &value,
+			   sizeof(value)) == 0;
+#endif
+}
+
+bool setKeepAlive(qintptr socketDescriptor, int idle, int interval)
+{
+	bool applied = setOption(socketDescriptor, SOL_SOCKET, SO_KEEPALIVE, 1);
+
+#if defined(TCP_KEEPIDLE)
+	applied &= setOption(socketDescriptor, IPPROTO_TCP, TCP_KEEPIDLE, idle);
+#elif defined(TCP_KEEPALIVE)
+	applied &= setOption(socketDescriptor, IPPROTO_TCP, TCP_KEEPALIVE, idle);
+#endif
+
+#if defined(TCP_KEEPINTVL)
+	if (interval > 0) {
+		applied &= setOption(
+			socketDescriptor, IPPROTO_TCP, TCP_KEEPINTVL, interval);
+	}
+#endif
+
+	return applied;
+}
+
+bool setDscp(qintptr socketDescriptor, int dscp)
+{
+	// The code point is the upper six bits of the former type of service
+	// byte; whichever of the two protocols the socket uses accepts it
+	const int trafficClass = (dscp & 0x3F) << 2;
+
+	bool applied =
+		setOption(socketDescriptor, IPPROTO_IP, IP_TOS, trafficClass);
+
+#ifdef IPV6_TCLASS
+	applied |= setOption(
+		socketDescriptor, IPPROTO_IPV6, IPV6_TCLASS, trafficClass);
+#endif
+
+	return applied;
+}
+}  // namespace
+
+//=============================================================================
+bool connectionOptions::apply(
+	qintptr socketDescriptor, const ConnectionOptions& options)
+{
+	bool applied = setOption(socketDescriptor, IPPROTO_TCP, TCP_NODELAY,
+		options.lowDelay ? 1 : 0);
+
+	if (options.sendBufferSize > 0) {
+		applied &= setOption(
+			socketDescriptor, SOL_SOCKET, SO_SNDBUF, options.sendBufferSize);
+	}
+
+	if (options.receiveBufferSize > 0) {
+		applied &= setOption(
+			socketDescriptor, SOL_SOCKET, SO_RCVBUF, options.receiveBufferSize);
+	}
+
+	if (options.keepAliveIdle > 0) {
+		applied &= setKeepAlive(socketDescriptor, options.keepAliveIdle,
+			options.keepAliveInterval);
+	}
+
+	if (options.dscp >= 0) {
+		applied &= setDscp(socketDescriptor, options.dscp);
+	}
+
+	return applied;
+}
+//=============================================================================
@@ -0,0 +1,96 @@
+#include "networking/connectionThreadPool.h"
+
+#include <QObject>
+#include <QThread>
+
+#include <algorithm>
+#include <iostream>
+
+//==============================================================================
+ConnectionThreadPool::ConnectionThreadPool(int threadCount) : m_NextThread{0}
+{
+	if (threadCount <= 0) {
+		threadCount = std::max(QThread::idealThreadCount(), 1);
+	}
+
+	std::cout << "ConnectionThreadPool::constructor, " << threadCount
+			  << " threads" << std::endl;
+
+	for (int i = 0; i < threadCount; ++i) {
+		auto thread = std::make_unique<QThread>();
+		thread->setObjectName(QString("ConnectionThreadPool %1").arg(i));
+		thread->start();
+
+		m_Threads.push_back(std::move(thread));
+	}
+
+	m_Load.resize(m_Threads.size(), 0);
+}
+//==============================================================================
+
+//==============================================================================
+ConnectionThreadPool::~ConnectionThreadPool()
+{
+	std::cout << "ConnectionThreadPool::destructor" << std::endl;
+
+	// Connections released just before still have their deferred deletion
+	// pending, which a finishing thread processes
+	for (auto& thread : m_Threads) {
+		thread->quit();
+	}
+
+	for (auto& thread : m_Threads) {
+		thread->wait();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+int ConnectionThreadPool::getThreadCount() const
+{
+	return static_cast<int>(m_Threads.size());
+}
+//==============================================================================
+
+//==============================================================================
+std::vector<int> ConnectionThreadPool::getLoad() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Load;
+}
+//==============================================================================
+
+//==============================================================================
+std::size_t ConnectionThreadPool::attach(QObject* object)
+{
+	std::size_t threadIndex{0};
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Starting the search after the last thread picked spreads
+		// connections round-robin whenever the load is even
+		threadIndex = m_NextThread % m_Load.size();
+		for (std::size_t i = 1; i < m_Load.size(); ++i) {
+			auto candidate = (m_NextThread + i) % m_Load.size();
+			if (m_Load[candidate] < m_Load[threadIndex]) {
+				threadIndex = candidate;
+			}
+		}
+
+		m_Load[threadIndex]++;
+		m_NextThread = threadIndex + 1;
+	}
+
+	object->moveToThread(m_Threads[threadIndex].get());
+	return threadIndex;
+}
+//==============================================================================
+
+//==============================================================================
+void ConnectionThreadPool::release(std::size_t threadIndex)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Load[threadIndex]--;
+}
+//==============================================================================
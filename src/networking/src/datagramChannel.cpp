@@ -0,0 +1,355 @@
+#include "networking/datagramChannel.h"
+#include "networking/networkMessageParser.h"
+
+#include <QNetworkDatagram>
+#include <QUdpSocket>
+#include <QtEndian>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t tokenOffset = 0;
+constexpr std::size_t kindOffset = 8;
+constexpr std::size_t sequenceOffset = 9;
+constexpr std::size_t streamKeyOffset = 13;
+constexpr std::size_t headerSize = 21;
+
+// True if the sequence number comes after the other one, allowing for
+// wrap-around
+bool isNewer(std::uint32_t sequence, std::uint32_t other)
+{
+	return static_cast<std::int32_t>(sequence - other) > 0;
+}
+}  // namespace
+
+//=============================================================================
+DatagramChannel::DatagramChannel(QObject* parent) :
+	QObject(parent),
+	m_Socket{std::make_unique<QUdpSocket>()}
+{
+	qRegisterMetaType<EncodedMessage>();
+	qRegisterMetaType<NetworkMessage>();
+
+	QObject::connect(m_Socket.get(), &QUdpSocket::readyRead, this,
+		&DatagramChannel::onReadyRead);
+
+	m_ProbeTimer.setInterval(probeInterval);
+	QObject::connect(
+		&m_ProbeTimer, &QTimer::timeout, this, &DatagramChannel::sendProbes);
+
+	m_SettleTimer.setInterval(settleDelay / 2);
+	QObject::connect(&m_SettleTimer, &QTimer::timeout, this,
+		&DatagramChannel::settleQuietStreams);
+}
+//=============================================================================
+
+//=============================================================================
+DatagramChannel::~DatagramChannel() = default;
+//=============================================================================
+
+//=============================================================================
+bool DatagramChannel::bind(const QHostAddress& address, quint16 port)
+{
+	return m_Socket->bind(address, port);
+}
+//=============================================================================
+
+//=============================================================================
+bool DatagramChannel::isBound() const
+{
+	return m_Socket->state() == QAbstractSocket::BoundState;
+}
+//=============================================================================
+
+//=============================================================================
+quint16 DatagramChannel::getPort() const
+{
+	return m_Socket->localPort();
+}
+//=============================================================================
+
+//=============================================================================
+auto DatagramChannel::generateToken() -> TokenType
+{
+	std::random_device device;
+	std::uniform_int_distribution<TokenType> distribution;
+
+	return distribution(device);
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::addEndpoint(TokenType token)
+{
+	m_Endpoints[token] = Endpoint{};
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::connectEndpoint(
+	TokenType token, const QHostAddress& address, quint16 port)
+{
+	auto& endpoint = m_Endpoints[token];
+	endpoint = Endpoint{};
+	endpoint.address = address;
+	endpoint.port = port;
+
+	write(token, endpoint, Kind::PROBE);
+	endpoint.probeAttempts++;
+
+	m_ProbeTimer.start();
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::removeEndpoint(TokenType token)
+{
+	m_Endpoints.erase(token);
+}
+//=============================================================================
+
+//=============================================================================
+bool DatagramChannel::isConfirmed(TokenType token) const
+{
+	auto it = m_Endpoints.find(token);
+	return (it != m_Endpoints.end()) && it->second.confirmed;
+}
+//=============================================================================
+
+//=============================================================================
+bool DatagramChannel::sendMessage(
+	TokenType token, StreamKeyType streamKey, const EncodedMessage& msg)
+{
+	auto it = m_Endpoints.find(token);
+	if ((it == m_Endpoints.end()) || !it->second.confirmed) {
+		return false;
+	}
+
+	const auto& bytes = msg.getBytes();
+	if ((headerSize + static_cast<std::size_t>(bytes.size())) >
+		maxDatagramSize) {
+		return false;
+	}
+
+	auto& endpoint = it->second;
+	auto [streamIt, opened] = endpoint.sentStreams.try_emplace(streamKey);
+
+	auto& stream = streamIt->second;
+	stream.lastSent = ClockType::now();
+
+	if (!m_SettleTimer.isActive()) {
+		m_SettleTimer.start();
+	}
+
+	if (opened) {
+		return false;
+	}
+
+	write(token, endpoint, Kind::MESSAGE, streamKey, bytes);
+	stream.unsettled = msg;
+
+	return true;
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::settle(TokenType token)
+{
+	if (auto it = m_Endpoints.find(token); it != m_Endpoints.end()) {
+		settle(token, it->second, false);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::settle(TokenType token, Endpoint& endpoint,
+	bool quietOnly)
+{
+	const auto quietSince = ClockType::now() - settleDelay;
+
+	// Collect first, as the receivers of the signal may send again
+	std::vector<EncodedMessage> unsettled;
+
+	auto& streams = endpoint.sentStreams;
+	for (auto it = streams.begin(); it != streams.end();) {
+		if (quietOnly && (it->second.lastSent > quietSince)) {
+			++it;
+			continue;
+		}
+
+		if (it->second.unsettled) {
+			unsettled.push_back(std::move(*it->second.unsettled));
+		}
+		it = streams.erase(it);
+	}
+
+	for (const auto& msg : unsettled) {
+		emit settleRequired(token, msg, QPrivateSignal{});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::settleQuietStreams()
+{
+	std::vector<TokenType> tokens;
+	bool streamsOpen{false};
+
+	for (auto& [token, endpoint] : m_Endpoints) {
+		if (!endpoint.sentStreams.empty()) {
+			tokens.push_back(token);
+		}
+	}
+
+	for (auto token : tokens) {
+		if (auto it = m_Endpoints.find(token); it != m_Endpoints.end()) {
+			settle(token, it->second, true);
+			streamsOpen = streamsOpen || !it->second.sentStreams.empty();
+		}
+	}
+
+	if (!streamsOpen) {
+		m_SettleTimer.stop();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::sendProbes()
+{
+	bool probing{false};
+
+	for (auto& [token, endpoint] : m_Endpoints) {
+		if (endpoint.confirmed || !endpoint.address ||
+			(endpoint.probeAttempts >= maxProbeAttempts)) {
+			continue;
+		}
+
+		write(token, endpoint, Kind::PROBE);
+		endpoint.probeAttempts++;
+		probing = true;
+	}
+
+	// Past the last attempt the other end is considered unreachable, and
+	// everything keeps going over the connection
+	if (!probing) {
+		m_ProbeTimer.stop();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::write(TokenType token, Endpoint& endpoint, Kind kind,
+	StreamKeyType streamKey, const QByteArray& frame)
+{
+	if (!endpoint.address) {
+		return;
+	}
+
+	QByteArray datagram(static_cast<int>(headerSize + frame.size()), 0);
+	auto data = reinterpret_cast<uchar*>(datagram.data());
+
+	qToBigEndian<quint64>(token, data + tokenOffset);
+	data[kindOffset] = static_cast<uchar>(kind);
+	qToBigEndian<quint32>(endpoint.nextSequence++, data + sequenceOffset);
+	qToBigEndian<quint64>(streamKey, data + streamKeyOffset);
+	std::copy(frame.cbegin(), frame.cend(), datagram.begin() + headerSize);
+
+	m_Socket->writeDatagram(datagram, endpoint.address.value(), endpoint.port);
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::confirm(TokenType token, Endpoint& endpoint)
+{
+	if (!endpoint.confirmed) {
+		endpoint.confirmed = true;
+		emit endpointConfirmed(token, QPrivateSignal{});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::onReadyRead()
+{
+	while (m_Socket->hasPendingDatagrams()) {
+		auto datagram = m_Socket->receiveDatagram();
+		receiveDatagram(datagram.data(), datagram.senderAddress(),
+			static_cast<quint16>(datagram.senderPort()));
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void DatagramChannel::receiveDatagram(
+	const QByteArray& datagram, const QHostAddress& sender, quint16 port)
+{
+	if (static_cast<std::size_t>(datagram.size()) < headerSize) {
+		return;
+	}
+
+	auto data = reinterpret_cast<const uchar*>(datagram.constData());
+	const auto token = qFromBigEndian<quint64>(data + tokenOffset);
+
+	// Unknown tokens are dropped before anything else is looked at
+	auto it = m_Endpoints.find(token);
+	if (it == m_Endpoints.end()) {
+		return;
+	}
+
+	auto& endpoint = it->second;
+	const auto kind = static_cast<Kind>(data[kindOffset]);
+	const auto sequence = qFromBigEndian<quint32>(data + sequenceOffset);
+	const auto streamKey = qFromBigEndian<quint64>(data + streamKeyOffset);
+
+	switch (kind) {
+		case Kind::PROBE: {
+			// The address may change, e.g. when a NAT rebinds the port
+			endpoint.address = sender;
+			endpoint.port = port;
+
+			write(token, endpoint, Kind::PROBE_REPLY);
+			confirm(token, endpoint);
+			break;
+		}
+		case Kind::PROBE_REPLY: {
+			confirm(token, endpoint);
+			break;
+		}
+		case Kind::MESSAGE: {
+			if (!endpoint.confirmed) {
+				break;
+			}
+
+			if (auto sequenceIt = endpoint.receivedSequences.find(streamKey);
+				(sequenceIt != endpoint.receivedSequences.end()) &&
+				!isNewer(sequence, sequenceIt->second)) {
+				break;
+			}
+
+			// A datagram holds exactly one complete frame; anything else is
+			// dropped
+			std::optional<NetworkMessage> msg;
+			bool valid{true};
+
+			NetworkMessageParser parser;
+			parser.setMessageReadyCallback([&](NetworkMessage& parsed) {
+				valid = valid && !msg;
+				msg = std::move(parsed);
+			});
+			parser.parse(datagram.mid(static_cast<int>(headerSize)));
+
+			if (!msg || !valid || (parser.getCurrentMessageSize() != 0)) {
+				break;
+			}
+
+			endpoint.receivedSequences[streamKey] = sequence;
+			emit messageReceived(token, msg.value(), QPrivateSignal{});
+			break;
+		}
+	}
+}
+//=============================================================================
@@ -0,0 +1,79 @@
+#include "networking/encodedMessage.h"
+
+//=============================================================================
+EncodedMessage::EncodedMessage(const NetworkMessage& msg, FrameFormat format) :
+	m_Type{msg.type},
+	m_FrameFormat{format},
+	m_Bytes{msg.serialize(format)}
+{
+}
+//=============================================================================
+
+//=============================================================================
+EncodedMessage::DescriptorType EncodedMessage::getType() const
+{
+	return m_Type;
+}
+//=============================================================================
+
+//=============================================================================
+EncodedMessage::FrameFormat EncodedMessage::getFrameFormat() const
+{
+	return m_FrameFormat;
+}
+//=============================================================================
+
+//=============================================================================
+const QByteArray& EncodedMessage::getBytes() const
+{
+	return m_Bytes;
+}
+//=============================================================================
+
+//=============================================================================
+bool EncodedMessage::isEmpty() const
+{
+	return m_Bytes.isEmpty();
+}
+//=============================================================================
+
+//=============================================================================
+EncodedMessage EncodedMessage::withFrameFormat(FrameFormat format) const
+{
+	const auto prefixSize = NetworkMessage::getPrefixSize(m_FrameFormat);
+	const auto frameSize = static_cast<std::size_t>(m_Bytes.size());
+
+	if ((format == m_FrameFormat) ||
+		(frameSize < prefixSize + NetworkMessage::trailerSize)) {
+		return *this;
+	}
+
+	auto payload = reinterpret_cast<const std::uint8_t*>(m_Bytes.constData());
+
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = m_Type;
+	msg.data.assign(payload + prefixSize,
+		payload + frameSize - NetworkMessage::trailerSize);
+	msg.size = msg.data.size();
+
+	EncodedMessage encodedMsg{msg, format};
+	encodedMsg.m_SupersedeKey = m_SupersedeKey;
+
+	return encodedMsg;
+}
+//=============================================================================
+
+//=============================================================================
+void EncodedMessage::setSupersedeKey(std::uint64_t key)
+{
+	m_SupersedeKey = key;
+}
+//=============================================================================
+
+//=============================================================================
+std::optional<std::uint64_t> EncodedMessage::getSupersedeKey() const
+{
+	return m_SupersedeKey;
+}
+//=============================================================================
@@ -0,0 +1,769 @@
+#include "networking/epollServer.h"
+#include "networking/encodedMessage.h"
+#include "networking/messageStatistics.h"
+#include "networking/networkMessage.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+// Tags of the non-client descriptors in the epoll set; connection ids count
+// up from one and never reach these
+constexpr EpollServer::ConnectionIdType listenerTag =
+	std::numeric_limits<EpollServer::ConnectionIdType>::max();
+constexpr EpollServer::ConnectionIdType wakeTag = listenerTag - 1;
+
+constexpr std::size_t readBufferSize = 65536;
+constexpr int maxEventsPerPass = 256;
+
+bool addToEpoll(int epollDescriptor, int descriptor, std::uint32_t events,
+	EpollServer::ConnectionIdType tag)
+{
+	epoll_event event{};
+	event.events = events;
+	event.data.u64 = tag;
+
+	return epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, descriptor, &event) == 0;
+}
+
+void printError(const char* what)
+{
+	std::cerr << "EpollServer: " << what << ": " << std::strerror(errno)
+			  << std::endl;
+}
+}  // namespace
+
+//==============================================================================
+EpollServer::EpollServer() :
+	m_EpollDescriptor{epoll_create1(EPOLL_CLOEXEC)},
+	m_ListenDescriptor{-1},
+	m_WakeDescriptor{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+	m_Port{0},
+	m_NextConnectionId{1},
+	m_Polling{false},
+	m_Stopped{false}
+{
+	m_ReadBuffer.resize(readBufferSize);
+
+	if ((m_EpollDescriptor < 0) || (m_WakeDescriptor < 0)) {
+		printError("Could not create the epoll instance");
+		return;
+	}
+
+	if (!addToEpoll(m_EpollDescriptor, m_WakeDescriptor, EPOLLIN, wakeTag)) {
+		printError("Could not watch the wake-up descriptor");
+	}
+}
+//==============================================================================
+
+//==============================================================================
+EpollServer::~EpollServer()
+{
+	for (const auto& [id, client] : m_Clients) {
+		::close(client->socket);
+	}
+
+	closeListener();
+
+	if (m_WakeDescriptor >= 0) {
+		::close(m_WakeDescriptor);
+	}
+
+	if (m_EpollDescriptor >= 0) {
+		::close(m_EpollDescriptor);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+bool EpollServer::listen(const std::string& address, std::uint16_t port)
+{
+	if ((m_EpollDescriptor < 0) || isListening()) {
+		return false;
+	}
+
+	sockaddr_in socketAddress{};
+	socketAddress.sin_family = AF_INET;
+	socketAddress.sin_port = htons(port);
+	if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+		std::cerr << "EpollServer: Invalid IPv4 address " << address
+				  << std::endl;
+		return false;
+	}
+
+	m_ListenDescriptor =
+		socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_ListenDescriptor < 0) {
+		printError("Could not create the listening socket");
+		return false;
+	}
+
+	int reuseAddress{1};
+	setsockopt(m_ListenDescriptor, SOL_SOCKET, SO_REUSEADDR, &reuseAddress,
+		sizeof(reuseAddress));
+
+	socklen_t addressSize = sizeof(socketAddress);
+	if ((bind(m_ListenDescriptor,
+			 reinterpret_cast<const sockaddr*>(&socketAddress),
+			 addressSize) != 0) ||
+		(::listen(m_ListenDescriptor, SOMAXCONN) != 0) ||
+		(getsockname(m_ListenDescriptor,
+			 reinterpret_cast<sockaddr*>(&socketAddress),
+			 &addressSize) != 0) ||
+		!addToEpoll(m_EpollDescriptor, m_ListenDescriptor, EPOLLIN | EPOLLET,
+			listenerTag)) {
+		printError("Could not listen");
+		closeListener();
+		return false;
+	}
+
+	m_Port = ntohs(socketAddress.sin_port);
+
+	// Connections may have been queued before the descriptor was watched
+	acceptConnections();
+	return true;
+}
+//==============================================================================
+
+//==============================================================================
+bool EpollServer::isListening() const
+{
+	return m_ListenDescriptor >= 0;
+}
+//==============================================================================
+
+//==============================================================================
+std::uint16_t EpollServer::getPort() const
+{
+	return m_Port;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::closeListener()
+{
+	if (m_ListenDescriptor < 0) {
+		return;
+	}
+
+	// Closing the descriptor also removes it from the epoll set
+	::close(m_ListenDescriptor);
+	m_ListenDescriptor = -1;
+	m_Port = 0;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setConnectedCallback(ConnectionCallbackType callback)
+{
+	m_ConnectedCallback = std::move(callback);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setDisconnectedCallback(ConnectionCallbackType callback)
+{
+	m_DisconnectedCallback = std::move(callback);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setMessageReceivedCallback(MessageCallbackType callback)
+{
+	m_MessageReceivedCallback = std::move(callback);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setErrorCallback(ErrorCallbackType callback)
+{
+	m_ErrorCallback = std::move(callback);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setSendQueueStatisticsCallback(
+	SendQueueStatisticsCallbackType callback)
+{
+	m_SendQueueStatisticsCallback = std::move(callback);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setConnectionOptions(const ConnectionOptions& options)
+{
+	m_ConnectionOptions = options;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::setFrameFormat(
+	ConnectionIdType id, NetworkMessage::FrameFormat format)
+{
+	if (auto it = m_Clients.find(id); it != m_Clients.end()) {
+		it->second->frameFormat = format;
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::sendMessage(ConnectionIdType id, const NetworkMessage& msg)
+{
+	auto it = m_Clients.find(id);
+	if (it == m_Clients.end()) {
+		return;
+	}
+
+	auto& client = *it->second;
+	if (client.congested) {
+		enqueue(id, client, EncodedMessage{msg, client.frameFormat});
+		return;
+	}
+
+	const auto frameSize = NetworkMessage::getPrefixSize(client.frameFormat) +
+		msg.data.size() + NetworkMessage::trailerSize;
+
+	MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+		msg.type, frameSize, MessageStatistics::Stage::WRITE};
+
+	const auto segments = msg.serializeSegments(client.frameFormat);
+	const bool idle = (client.outputOffset == client.output.size());
+
+	append(client, reinterpret_cast<const char*>(segments.prefix.data()),
+		segments.prefix.size());
+	append(client, reinterpret_cast<const char*>(segments.payload),
+		segments.payloadSize);
+	append(client, reinterpret_cast<const char*>(segments.trailer.data()),
+		segments.trailer.size());
+
+	updateCongestion(id, client);
+
+	if (idle) {
+		scheduleWrite(id, client);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::sendEncodedMessage(
+	ConnectionIdType id, const EncodedMessage& msg)
+{
+	auto it = m_Clients.find(id);
+	if (it == m_Clients.end()) {
+		return;
+	}
+
+	auto& client = *it->second;
+	enqueue(id, client, msg.withFrameFormat(client.frameFormat));
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::close(ConnectionIdType id)
+{
+	auto it = m_Clients.find(id);
+	if (it == m_Clients.end()) {
+		return;
+	}
+
+	auto& client = *it->second;
+
+	// Everything sent so far is written before disconnecting
+	while (!client.sendQueue.isEmpty()) {
+		const auto& bytes = client.sendQueue.front().getBytes();
+		append(client, bytes.constData(), bytes.size());
+		client.sendQueue.pop();
+	}
+
+	client.closing = true;
+
+	if (client.outputOffset == client.output.size()) {
+		scheduleRemoval(id, client);
+	}
+	else {
+		scheduleWrite(id, client);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+std::size_t EpollServer::getConnectionCount() const
+{
+	return m_Clients.size();
+}
+//==============================================================================
+
+//==============================================================================
+int EpollServer::getDescriptor() const
+{
+	return m_EpollDescriptor;
+}
+//==============================================================================
+
+//==============================================================================
+bool EpollServer::poll(int timeoutMilliseconds)
+{
+	if (m_EpollDescriptor < 0) {
+		return false;
+	}
+
+	std::array<epoll_event, maxEventsPerPass> events;
+
+	m_Polling = true;
+	auto eventCount = epoll_wait(m_EpollDescriptor, events.data(),
+		maxEventsPerPass, timeoutMilliseconds);
+
+	if ((eventCount < 0) && (errno != EINTR)) {
+		m_Polling = false;
+		printError("Waiting for events failed");
+		return false;
+	}
+
+	for (int i = 0; i < eventCount; ++i) {
+		const auto tag = events[i].data.u64;
+		const auto flags = events[i].events;
+
+		if (tag == listenerTag) {
+			acceptConnections();
+			continue;
+		}
+
+		if (tag == wakeTag) {
+			std::uint64_t wakeCount{0};
+			while (::read(m_WakeDescriptor, &wakeCount, sizeof(wakeCount)) > 0)
+				;
+			continue;
+		}
+
+		auto it = m_Clients.find(tag);
+		if (it == m_Clients.end()) {
+			continue;
+		}
+
+		auto& client = *it->second;
+		if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+			readFrom(tag, client);
+		}
+
+		if ((flags & EPOLLOUT) && !client.removing) {
+			writeTo(tag, client);
+		}
+	}
+
+	finishPass();
+	m_Polling = false;
+
+	return true;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::run()
+{
+	while (!m_Stopped) {
+		if (!poll(-1)) {
+			break;
+		}
+	}
+
+	m_Stopped = false;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::stop()
+{
+	m_Stopped = true;
+	wake();
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::acceptConnections()
+{
+	while (isListening()) {
+		auto socket = accept4(m_ListenDescriptor, nullptr, nullptr,
+			SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (socket < 0) {
+			if ((errno == EINTR) || (errno == ECONNABORTED)) {
+				continue;
+			}
+
+			// Running out of descriptors is reported but not fatal; the next
+			// incoming connection retries the pending ones
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+				printError("Could not accept a connection");
+			}
+			break;
+		}
+
+		if (!connectionOptions::apply(socket, m_ConnectionOptions)) {
+			std::cerr << "EpollServer: Some connection options could not be "
+						 "applied"
+					  << std::endl;
+		}
+
+		const auto id = m_NextConnectionId++;
+		if (!addToEpoll(m_EpollDescriptor, socket,
+				EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, id)) {
+			printError("Could not watch a connection");
+			::close(socket);
+			continue;
+		}
+
+		auto client = std::make_unique<Client>();
+		client->socket = socket;
+		client->parser.setMessageReadyCallback([this, id](auto& msg) {
+			if (m_MessageReceivedCallback) {
+				m_MessageReceivedCallback(id, msg);
+			}
+		});
+
+		m_Clients.insert({id, std::move(client)});
+
+		if (m_ConnectedCallback) {
+			m_ConnectedCallback(id);
+		}
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::readFrom(ConnectionIdType id, Client& client)
+{
+	// Edge-triggered, so everything available has to be read now
+	while (!client.closing && !client.removing) {
+		auto count =
+			::recv(client.socket, m_ReadBuffer.data(), m_ReadBuffer.size(), 0);
+
+		if (count > 0) {
+			client.parser.parse(QByteArray::fromRawData(
+				m_ReadBuffer.data(), static_cast<int>(count)));
+
+			if (client.parser.getCurrentMessageSize() >
+				NetworkMessage::maxPayloadSize) {
+				fail(id, client, "Max message length exceeded");
+			}
+			continue;
+		}
+
+		if (count == 0) {
+			scheduleRemoval(id, client);
+		}
+		else if (errno == EINTR) {
+			continue;
+		}
+		else if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			fail(id, client, "Socket error");
+		}
+		break;
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::append(Client& client, const char* data, std::size_t size)
+{
+	if (!client.closing && !client.removing && (size > 0)) {
+		client.output.insert(client.output.end(), data, data + size);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::enqueue(
+	ConnectionIdType id, Client& client, const EncodedMessage& msg)
+{
+	if (client.closing || client.removing) {
+		return;
+	}
+
+	if (client.congested) {
+		if (!client.sendQueue.push(msg)) {
+			// The peer cannot keep up, and dropping anything more would
+			// leave it out of sync
+			fail(id, client, "Send queue limit exceeded");
+		}
+		return;
+	}
+
+	const auto& bytes = msg.getBytes();
+	const bool idle = (client.outputOffset == client.output.size());
+
+	{
+		MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+			msg.getType(), static_cast<std::size_t>(bytes.size()),
+			MessageStatistics::Stage::WRITE};
+
+		append(client, bytes.constData(), bytes.size());
+	}
+
+	updateCongestion(id, client);
+
+	if (idle) {
+		scheduleWrite(id, client);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::updateCongestion(ConnectionIdType id, Client& client)
+{
+	const auto pendingBytes = client.output.size() - client.outputOffset;
+	if (client.congested ||
+		(pendingBytes <= static_cast<std::size_t>(SendQueue::highWatermark))) {
+		return;
+	}
+
+	client.congested = true;
+	client.congestionCount++;
+	scheduleReport(id, client);
+}
+//==============================================================================
+
+//==============================================================================
+bool EpollServer::drainSendQueue(ConnectionIdType id, Client& client)
+{
+	constexpr auto highWatermark =
+		static_cast<std::size_t>(SendQueue::highWatermark);
+	constexpr auto lowWatermark =
+		static_cast<std::size_t>(SendQueue::lowWatermark);
+
+	auto pendingBytes = client.output.size() - client.outputOffset;
+	if (!client.congested || (pendingBytes > lowWatermark)) {
+		return false;
+	}
+
+	bool drained{false};
+	while (!client.sendQueue.isEmpty() && (pendingBytes <= highWatermark)) {
+		const auto& msg = client.sendQueue.front();
+		const auto& bytes = msg.getBytes();
+
+		{
+			MessageStatistics::StageTimer timer{MessageStatistics::getDefault(),
+				msg.getType(), static_cast<std::size_t>(bytes.size()),
+				MessageStatistics::Stage::WRITE};
+
+			append(client, bytes.constData(), bytes.size());
+		}
+		client.sendQueue.pop();
+
+		pendingBytes += bytes.size();
+		drained = true;
+	}
+
+	if (client.sendQueue.isEmpty() && (pendingBytes <= highWatermark)) {
+		client.congested = false;
+		scheduleReport(id, client);
+	}
+
+	return drained;
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::scheduleReport(ConnectionIdType id, Client& client)
+{
+	if (client.reportPending) {
+		return;
+	}
+
+	client.reportPending = true;
+	m_PendingReports.push_back(id);
+
+	// Callbacks are only invoked while polling
+	if (!m_Polling) {
+		wake();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::scheduleWrite(ConnectionIdType id, Client& client)
+{
+	if (m_Polling) {
+		m_PendingWrites.push_back(id);
+	}
+	else {
+		writeTo(id, client);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::writeTo(ConnectionIdType id, Client& client)
+{
+	auto& output = client.output;
+	bool blocked{false};
+
+	do {
+		while (client.outputOffset < output.size()) {
+			auto count = ::send(client.socket,
+				output.data() + client.outputOffset,
+				output.size() - client.outputOffset, MSG_NOSIGNAL);
+
+			if (count >= 0) {
+				client.outputOffset += count;
+			}
+			else if (errno == EINTR) {
+				continue;
+			}
+			else {
+				// Once the socket has room again, EPOLLOUT brings us back
+				if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+					fail(id, client, "Socket error");
+					return;
+				}
+
+				blocked = true;
+				break;
+			}
+		}
+
+		// Written bytes are dropped all at once, or once they make up half
+		// the buffer, so a lagging peer does not shift its backlog on every
+		// partial write
+		if (client.outputOffset == output.size()) {
+			output.clear();
+			client.outputOffset = 0;
+		}
+		else if (client.outputOffset >= output.size() / 2) {
+			output.erase(output.begin(), output.begin() + client.outputOffset);
+			client.outputOffset = 0;
+		}
+	} while (drainSendQueue(id, client) && !blocked);
+
+	if (client.congested &&
+		(std::chrono::steady_clock::now() - client.reportTime >=
+			std::chrono::milliseconds(SendQueue::reportInterval))) {
+		scheduleReport(id, client);
+	}
+
+	if (client.closing && output.empty()) {
+		scheduleRemoval(id, client);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::fail(
+	ConnectionIdType id, Client& client, const std::string& reason)
+{
+	if (client.error.empty()) {
+		client.error = reason;
+	}
+
+	client.output.clear();
+	client.outputOffset = 0;
+	scheduleRemoval(id, client);
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::scheduleRemoval(ConnectionIdType id, Client& client)
+{
+	if (client.removing) {
+		return;
+	}
+
+	client.removing = true;
+	m_PendingRemovals.push_back(id);
+
+	// Callbacks are only invoked while polling
+	if (!m_Polling) {
+		wake();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::finishPass()
+{
+	// Callbacks may send or close further connections, so keep going until
+	// there is nothing left to do
+	while (!m_PendingWrites.empty() || !m_PendingRemovals.empty() ||
+		!m_PendingReports.empty()) {
+		auto pendingWrites = std::move(m_PendingWrites);
+		m_PendingWrites.clear();
+
+		for (auto id : pendingWrites) {
+			auto it = m_Clients.find(id);
+			if ((it != m_Clients.end()) && !it->second->removing) {
+				writeTo(id, *it->second);
+			}
+		}
+
+		auto pendingReports = std::move(m_PendingReports);
+		m_PendingReports.clear();
+
+		for (auto id : pendingReports) {
+			auto it = m_Clients.find(id);
+			if (it == m_Clients.end()) {
+				continue;
+			}
+
+			auto& client = *it->second;
+			client.reportPending = false;
+			client.reportTime = std::chrono::steady_clock::now();
+
+			auto statistics = client.sendQueue.getStatistics();
+			statistics.congested = client.congested;
+			statistics.socketBytes = static_cast<std::int64_t>(
+				client.output.size() - client.outputOffset);
+			statistics.congestionCount = client.congestionCount;
+
+			if (m_SendQueueStatisticsCallback) {
+				m_SendQueueStatisticsCallback(id, statistics);
+			}
+		}
+
+		auto pendingRemovals = std::move(m_PendingRemovals);
+		m_PendingRemovals.clear();
+
+		for (auto id : pendingRemovals) {
+			auto it = m_Clients.find(id);
+			if (it == m_Clients.end()) {
+				continue;
+			}
+
+			auto client = std::move(it->second);
+			m_Clients.erase(it);
+			::close(client->socket);
+
+			if (!client->error.empty() && m_ErrorCallback) {
+				m_ErrorCallback(id, client->error);
+			}
+
+			if (m_DisconnectedCallback) {
+				m_DisconnectedCallback(id);
+			}
+		}
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void EpollServer::wake()
+{
+	if (m_WakeDescriptor < 0) {
+		return;
+	}
+
+	// Failing means the counter is saturated, so a wake-up is pending anyway
+	const std::uint64_t one{1};
+	[[maybe_unused]] auto result =
+		::write(m_WakeDescriptor, &one, sizeof(one));
+}
+//==============================================================================
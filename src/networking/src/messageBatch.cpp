@@ -0,0 +1,107 @@
+#include "networking/messageBatch.h"
+#include "networking/encodedMessage.h"
+
+#ifdef _WIN32
+#	include <WinSock2.h>
+#else
+#	include <arpa/inet.h>
+#endif
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace messageBatch
+{
+//=============================================================================
+void append(PayloadDataType& batch, NetworkMessage::DescriptorType type,
+	const std::uint8_t* payload, std::size_t payloadSize)
+{
+	const auto size = static_cast<NetworkMessage::SizeType>(payloadSize);
+
+	batch.push_back(static_cast<std::uint8_t>(htons(type) >> 8));
+	batch.push_back(static_cast<std::uint8_t>(htons(type) >> 0));
+	batch.push_back(static_cast<std::uint8_t>(htonl(size) >> 24));
+	batch.push_back(static_cast<std::uint8_t>(htonl(size) >> 16));
+	batch.push_back(static_cast<std::uint8_t>(htonl(size) >> 8));
+	batch.push_back(static_cast<std::uint8_t>(htonl(size) >> 0));
+
+	batch.insert(batch.end(), payload, payload + payloadSize);
+}
+//=============================================================================
+
+//=============================================================================
+void append(PayloadDataType& batch, const NetworkMessage& msg)
+{
+	append(batch, msg.type, msg.data.data(), msg.data.size());
+}
+//=============================================================================
+
+//=============================================================================
+void append(PayloadDataType& batch, const EncodedMessage& msg)
+{
+	using FrameFormat = NetworkMessage::FrameFormat;
+
+	const auto format = msg.getFrameFormat();
+	const auto prefixSize = NetworkMessage::getPrefixSize(format);
+
+	const auto& bytes = msg.getBytes();
+	if (static_cast<std::size_t>(bytes.size()) <
+		(prefixSize + NetworkMessage::trailerSize)) {
+		return;
+	}
+
+	// Take the type and size fields, which follow the header byte or sync
+	// word, and the payload, which follows any prefix checksum, leaving out
+	// the checksum trailer of the frame
+	auto frame = reinterpret_cast<const std::uint8_t*>(bytes.constData());
+	auto fields = frame +
+		((format == FrameFormat::V2) ? NetworkMessage::syncWord.size()
+									 : sizeof(NetworkMessage::HeaderType));
+
+	batch.insert(batch.end(), fields, fields + entryPrefixSize);
+	batch.insert(batch.end(), frame + prefixSize,
+		frame + bytes.size() - NetworkMessage::trailerSize);
+}
+//=============================================================================
+
+//=============================================================================
+bool unpack(const PayloadDataType& batch, const MessageCallbackType& callback)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+
+	auto current = batch.data();
+	const auto end = current + batch.size();
+
+	while (current != end) {
+		if (static_cast<std::size_t>(end - current) < entryPrefixSize) {
+			return false;
+		}
+
+		// Fields are assembled most-significant byte first, as the parser
+		// does for the frame prefix
+		msg.type = ntohs(static_cast<std::uint16_t>(
+			(static_cast<std::uint16_t>(current[0]) << 8) |
+			(static_cast<std::uint16_t>(current[1]) << 0)));
+		msg.size = ntohl((static_cast<std::uint32_t>(current[2]) << 24) |
+			(static_cast<std::uint32_t>(current[3]) << 16) |
+			(static_cast<std::uint32_t>(current[4]) << 8) |
+			(static_cast<std::uint32_t>(current[5]) << 0));
+		current += entryPrefixSize;
+
+		if (static_cast<std::size_t>(end - current) < msg.size) {
+			return false;
+		}
+
+		msg.data.assign(current, current + msg.size);
+		current += msg.size;
+
+		const auto type = msg.type & ~NetworkMessage::binaryArchiveFlag;
+		if ((type != NetworkMessage::MESSAGE_BATCH) && callback) {
+			callback(msg);
+		}
+	}
+
+	return true;
+}
+//=============================================================================
+}  // namespace messageBatch
@@ -0,0 +1,351 @@
+#include "networking/messageStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+using Histogram = MessageStatistics::Histogram;
+
+std::size_t getTypeSlot(NetworkMessage::DescriptorType type)
+{
+	return std::min<std::size_t>(
+		type & ~NetworkMessage::binaryArchiveFlag,
+		MessageStatistics::typeCount - 1);
+}
+
+// Threads are spread over the stripes in the order they first record
+std::size_t getThreadStripe(std::size_t stripeCount)
+{
+	static std::atomic<std::size_t> nextStripe{0};
+	thread_local const std::size_t stripe =
+		nextStripe.fetch_add(1, std::memory_order_relaxed);
+
+	return stripe % stripeCount;
+}
+
+std::string formatLatency(std::chrono::nanoseconds latency)
+{
+	if (latency == std::chrono::nanoseconds::max()) {
+		return ">4s";
+	}
+
+	std::ostringstream stream;
+	stream << std::fixed << std::setprecision(0);
+
+	const auto count = static_cast<double>(latency.count());
+	if (count < 1e6) {
+		stream << count / 1e3 << "us";
+	}
+	else if (count < 1e9) {
+		stream << count / 1e6 << "ms";
+	}
+	else {
+		stream << std::setprecision(1) << count / 1e9 << "s";
+	}
+
+	return stream.str();
+}
+}  // namespace
+
+//=============================================================================
+struct MessageStatistics::Stripe
+{
+	// The message count is the total of the buckets, which saves recording
+	// it separately
+	struct Entry
+	{
+		std::atomic<std::uint64_t> bytes{0};
+		std::array<std::atomic<std::uint64_t>, Histogram::bucketCount>
+			buckets{};
+	};
+
+	std::array<std::array<Entry, stageCount>, typeCount> entries;
+};
+//=============================================================================
+
+//=============================================================================
+std::size_t MessageStatistics::Histogram::getBucket(
+	std::chrono::nanoseconds latency)
+{
+	const auto value = static_cast<std::uint64_t>(
+		std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+
+	if (value < (std::uint64_t{1} << minExponent)) {
+		return 0;
+	}
+
+	if (value >= (std::uint64_t{1} << maxExponent)) {
+		return bucketCount - 1;
+	}
+
+	auto exponent = minExponent;
+	while ((value >> (exponent + 1)) != 0) {
+		++exponent;
+	}
+
+	// The two bits below the leading one pick the sub-bucket
+	const auto subBucket = (value >> (exponent - 2)) & (subBucketCount - 1);
+
+	return 1 + (exponent - minExponent) * subBucketCount + subBucket;
+}
+//=============================================================================
+
+//=============================================================================
+std::chrono::nanoseconds MessageStatistics::Histogram::getBucketLimit(
+	std::size_t bucket)
+{
+	if (bucket == 0) {
+		return std::chrono::nanoseconds{(1 << minExponent) - 1};
+	}
+
+	if (bucket >= bucketCount - 1) {
+		return std::chrono::nanoseconds::max();
+	}
+
+	const auto exponent = minExponent + (bucket - 1) / subBucketCount;
+	const auto subBucket = (bucket - 1) % subBucketCount;
+
+	const auto limit = ((subBucketCount + subBucket + 1) << (exponent - 2)) - 1;
+	return std::chrono::nanoseconds{static_cast<std::int64_t>(limit)};
+}
+//=============================================================================
+
+//=============================================================================
+std::uint64_t MessageStatistics::Histogram::getCount() const
+{
+	std::uint64_t count{0};
+	for (const auto bucketCount : buckets) {
+		count += bucketCount;
+	}
+
+	return count;
+}
+//=============================================================================
+
+//=============================================================================
+std::chrono::nanoseconds MessageStatistics::Histogram::getPercentile(
+	double fraction) const
+{
+	const auto count = getCount();
+	if (count == 0) {
+		return std::chrono::nanoseconds{0};
+	}
+
+	const auto rank = std::max<std::uint64_t>(1,
+		static_cast<std::uint64_t>(std::ceil(fraction * count)));
+
+	std::uint64_t counted{0};
+	for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+		counted += buckets[bucket];
+		if (counted >= rank) {
+			return getBucketLimit(bucket);
+		}
+	}
+
+	return getBucketLimit(bucketCount - 1);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageStatistics::Snapshot::get(DescriptorType type, Stage stage) const
+	-> const Entry&
+{
+	return entries[getTypeSlot(type)][static_cast<std::size_t>(stage)];
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageStatistics::Snapshot::operator-(const Snapshot& earlier) const
+	-> Snapshot
+{
+	auto difference = *this;
+
+	for (std::size_t type = 0; type < typeCount; ++type) {
+		for (std::size_t stage = 0; stage < stageCount; ++stage) {
+			auto& entry = difference.entries[type][stage];
+			const auto& earlierEntry = earlier.entries[type][stage];
+
+			entry.messages -= earlierEntry.messages;
+			entry.bytes -= earlierEntry.bytes;
+			for (std::size_t i = 0; i < Histogram::bucketCount; ++i) {
+				entry.latency.buckets[i] -= earlierEntry.latency.buckets[i];
+			}
+		}
+	}
+
+	return difference;
+}
+//=============================================================================
+
+//=============================================================================
+MessageStatistics::MessageStatistics()
+{
+	for (auto& stripe : m_Stripes) {
+		stripe = std::make_unique<Stripe>();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+MessageStatistics::~MessageStatistics() = default;
+//=============================================================================
+
+//=============================================================================
+MessageStatistics& MessageStatistics::getDefault()
+{
+	// Never destroyed, as I/O threads may still record while static objects
+	// are torn down
+	static auto statistics = new MessageStatistics;
+	return *statistics;
+}
+//=============================================================================
+
+//=============================================================================
+void MessageStatistics::record(Stage stage, DescriptorType type,
+	std::size_t bytes, Clock::duration latency)
+{
+	auto& stripe = *m_Stripes[getThreadStripe(stripeCount)];
+	auto& entry =
+		stripe.entries[getTypeSlot(type)][static_cast<std::size_t>(stage)];
+
+	const auto bucket = Histogram::getBucket(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(latency));
+
+	entry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	entry.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+//=============================================================================
+
+//=============================================================================
+auto MessageStatistics::getSnapshot() const -> Snapshot
+{
+	Snapshot snapshot;
+
+	for (const auto& stripe : m_Stripes) {
+		for (std::size_t type = 0; type < typeCount; ++type) {
+			for (std::size_t stage = 0; stage < stageCount; ++stage) {
+				const auto& source = stripe->entries[type][stage];
+				auto& entry = snapshot.entries[type][stage];
+
+				entry.bytes += source.bytes.load(std::memory_order_relaxed);
+				for (std::size_t i = 0; i < Histogram::bucketCount; ++i) {
+					const auto count =
+						source.buckets[i].load(std::memory_order_relaxed);
+
+					entry.messages += count;
+					entry.latency.buckets[i] += count;
+				}
+			}
+		}
+	}
+
+	return snapshot;
+}
+//=============================================================================
+
+//=============================================================================
+std::string MessageStatistics::format(const Snapshot& snapshot)
+{
+	std::ostringstream stream;
+
+	for (std::size_t type = 0; type < typeCount; ++type) {
+		const auto& entries = snapshot.entries[type];
+
+		const bool active = std::any_of(entries.begin(), entries.end(),
+			[](const Entry& entry) { return entry.messages != 0; });
+		if (!active) {
+			continue;
+		}
+
+		stream << getTypeName(static_cast<DescriptorType>(type));
+
+		for (std::size_t stage = 0; stage < stageCount; ++stage) {
+			const auto& entry = entries[stage];
+			if (entry.messages == 0) {
+				continue;
+			}
+
+			const auto& latency = entry.latency;
+
+			stream << ' ' << getStageName(static_cast<Stage>(stage))
+				   << " n=" << entry.messages
+				   << " p50=" << formatLatency(latency.getPercentile(0.5))
+				   << " p99=" << formatLatency(latency.getPercentile(0.99))
+				   << " max=" << formatLatency(latency.getPercentile(1.0));
+		}
+
+		stream << '\n';
+	}
+
+	return stream.str();
+}
+//=============================================================================
+
+//=============================================================================
+const char* MessageStatistics::getStageName(Stage stage)
+{
+	switch (stage) {
+		case Stage::PARSE:
+			return "parse";
+		case Stage::QUEUE:
+			return "queue";
+		case Stage::DECODE:
+			return "decode";
+		case Stage::HANDLE:
+			return "handle";
+		case Stage::WRITE:
+			return "write";
+	}
+
+	return "unknown";
+}
+//=============================================================================
+
+//=============================================================================
+const char* MessageStatistics::getTypeName(DescriptorType type)
+{
+	static constexpr std::array<const char*, typeCount> names{
+		"REQUEST_CREDENTIALS", "PEER_CREDENTIALS", "FULL_STATE",
+		"AUTHORIZATION_SUCCEEDED", "AUTHORIZATION_FAILED", "PEER_ADDED",
+		"PEER_REMOVED", "LASER_UPDATED", "VOLUME_UPDATED", "WIDGET_EVENT",
+		"PLANE_EVENT", "PEER_CAPABILITIES", "LASER_POSE", "TRANSFORM_UPDATE",
+		"MESSAGE_BATCH", "DATAGRAM_CHANNEL", "FULL_STATE_CHUNK",
+		"STATISTICS_REQUEST", "STATISTICS", "SUBSCRIPTION"};
+
+	const auto name = names[getTypeSlot(type)];
+	return name ? name : "OTHER";
+}
+//=============================================================================
+
+//=============================================================================
+MessageStatistics::StageTimer::StageTimer(MessageStatistics& statistics,
+	DescriptorType type, std::size_t bytes, Stage first) :
+	m_Statistics{statistics},
+	m_Type{type},
+	m_Bytes{bytes},
+	m_Stage{first},
+	m_Start{Clock::now()}
+{
+}
+//=============================================================================
+
+//=============================================================================
+MessageStatistics::StageTimer::~StageTimer()
+{
+	m_Statistics.record(m_Stage, m_Type, m_Bytes, Clock::now() - m_Start);
+}
+//=============================================================================
+
+//=============================================================================
+void MessageStatistics::StageTimer::next(Stage stage)
+{
+	const auto now = Clock::now();
+	m_Statistics.record(m_Stage, m_Type, m_Bytes, now - m_Start);
+
+	m_Stage = stage;
+	m_Start = now;
+}
+//=============================================================================
@@ -7,45 +7,134 @@
 #include <arpa/inet.h>
 #endif
 
+#include <algorithm>
+#include <cstring>
+
 #pragma comment(lib, "Ws2_32.lib")
 
-//=============================================================================
-QByteArray NetworkMessage::serialize() const
+namespace
 {
-	QByteArray message;
-	std::uint32_t crc{ 0 };
+// Message types are limited to their largest legitimate payload, so a
+// corrupt size field cannot make a receiver reserve much memory
+constexpr NetworkMessage::SizeType maxSmallPayloadSize = 64 * 1024;
+constexpr NetworkMessage::SizeType maxBatchPayloadSize = 1024 * 1024;
+constexpr NetworkMessage::SizeType maxObjectPayloadSize = 16 * 1024 * 1024;
 
-	message.push_back(this->header);
-	crc::updateCRC32(message.back(), crc);
+void writeChecksum(std::uint32_t crc, std::uint8_t* bytes)
+{
+	bytes[0] = static_cast<std::uint8_t>(htonl(crc) >> 24);
+	bytes[1] = static_cast<std::uint8_t>(htonl(crc) >> 16);
+	bytes[2] = static_cast<std::uint8_t>(htonl(crc) >> 8);
+	bytes[3] = static_cast<std::uint8_t>(htonl(crc) >> 0);
+}
+}  // namespace
 
-	message.push_back(htons(this->type) >> 8);
-	crc::updateCRC32(message.back(), crc);
+//=============================================================================
+QByteArray NetworkMessage::serialize(FrameFormat format) const
+{
+	const auto segments = this->serializeSegments(format);
+	const auto prefixLength = segments.prefix.size();
 
-	message.push_back(htons(this->type) >> 0);
-	crc::updateCRC32(message.back(), crc);
+	const auto frameSize = prefixLength + segments.payloadSize + trailerSize;
+	QByteArray message(static_cast<int>(frameSize), Qt::Uninitialized);
 
-	message.push_back(htonl(this->size) >> 24);
-	crc::updateCRC32(message.back(), crc);
-	
-	message.push_back(htonl(this->size) >> 16);
-	crc::updateCRC32(message.back(), crc);
+	auto bytes = reinterpret_cast<std::uint8_t*>(message.data());
 
-	message.push_back(htonl(this->size) >> 8);
-	crc::updateCRC32(message.back(), crc);
+	std::memcpy(bytes, segments.prefix.data(), prefixLength);
+	bytes += prefixLength;
 
-	message.push_back(htonl(this->size) >> 0);
-	crc::updateCRC32(message.back(), crc);
-	
-	for (const auto& byte : this->data) {
-		message.push_back(byte);
-		crc::updateCRC32(message.back(), crc);
+	if (segments.payloadSize > 0) {
+		std::memcpy(bytes, segments.payload, segments.payloadSize);
+		bytes += segments.payloadSize;
 	}
 
-	message.push_back(htonl(crc) >> 24);
-	message.push_back(htonl(crc) >> 16);
-	message.push_back(htonl(crc) >> 8);
-	message.push_back(htonl(crc) >> 0);
+	std::memcpy(bytes, segments.trailer.data(), trailerSize);
 
 	return message;
 }
-//=============================================================================
\ No newline at end of file
+//=============================================================================
+
+//=============================================================================
+NetworkMessage::Segments NetworkMessage::serializeSegments(
+	FrameFormat format) const
+{
+	Segments segments;
+
+	auto& prefix = segments.prefix.bytes;
+	auto fields = prefix.data();
+
+	if (format == FrameFormat::V2) {
+		std::copy(syncWord.begin(), syncWord.end(), prefix.begin());
+		fields += syncWord.size();
+	}
+	else {
+		*fields++ = this->header;
+	}
+
+	fields[0] = static_cast<std::uint8_t>(htons(this->type) >> 8);
+	fields[1] = static_cast<std::uint8_t>(htons(this->type) >> 0);
+	fields[2] = static_cast<std::uint8_t>(htonl(this->size) >> 24);
+	fields[3] = static_cast<std::uint8_t>(htonl(this->size) >> 16);
+	fields[4] = static_cast<std::uint8_t>(htonl(this->size) >> 8);
+	fields[5] = static_cast<std::uint8_t>(htonl(this->size) >> 0);
+	fields += sizeof(DescriptorType) + sizeof(SizeType);
+
+	if (format == FrameFormat::V2) {
+		writeChecksum(
+			crc::updateCRC32(prefix.data(), fields - prefix.data(), 0),
+			fields);
+		fields += sizeof(ChecksumType);
+	}
+
+	segments.prefix.length = static_cast<std::size_t>(fields - prefix.data());
+
+	segments.payload = this->data.data();
+	segments.payloadSize = this->data.size();
+
+	auto crc = crc::updateCRC32(prefix.data(), segments.prefix.length, 0);
+	crc = crc::updateCRC32(segments.payload, segments.payloadSize, crc);
+	writeChecksum(crc, segments.trailer.data());
+
+	return segments;
+}
+//=============================================================================
+
+//=============================================================================
+std::size_t NetworkMessage::getPrefixSize(FrameFormat format)
+{
+	return (format == FrameFormat::V2) ? prefixSizeV2 : prefixSize;
+}
+//=============================================================================
+
+//=============================================================================
+auto NetworkMessage::getMaxPayloadSize(DescriptorType type) -> SizeType
+{
+	switch (type & ~binaryArchiveFlag) {
+		case REQUEST_CREDENTIALS:
+		case PEER_CREDENTIALS:
+		case AUTHORIZATION_SUCCEEDED:
+		case AUTHORIZATION_FAILED:
+		case PEER_ADDED:
+		case PEER_REMOVED:
+		case PEER_CAPABILITIES:
+		case LASER_POSE:
+		case TRANSFORM_UPDATE:
+		case DATAGRAM_CHANNEL:
+		case STATISTICS_REQUEST:
+			return maxSmallPayloadSize;
+		case MESSAGE_BATCH:
+			return maxBatchPayloadSize;
+		case LASER_UPDATED:
+		case VOLUME_UPDATED:
+		case WIDGET_EVENT:
+		case PLANE_EVENT:
+		case FULL_STATE_CHUNK:
+		case STATISTICS:
+		case SUBSCRIPTION:
+			return maxObjectPayloadSize;
+		default:
+			// The full state, and types added by newer peers
+			return maxPayloadSize;
+	}
+}
+//=============================================================================
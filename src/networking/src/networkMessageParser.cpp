@@ -1,4 +1,6 @@
 #include "networking/networkMessageParser.h"
+#include "networking/messageBatch.h"
+#include "networking/messageStatistics.h"
 #include "common/crcUtils.h"
 
 #ifdef _WIN32
@@ -7,16 +9,96 @@
 #	include <arpa/inet.h>
 #endif
 
+#include <algorithm>
+
 #pragma comment(lib, "Ws2_32.lib")
 
+namespace
+{
+// Fields are assembled most-significant byte first, mirroring the
+// byte-at-a-time path below
+std::uint16_t readUInt16(const std::uint8_t* bytes)
+{
+	return static_cast<std::uint16_t>(
+		(static_cast<std::uint16_t>(bytes[0]) << 8) |
+		(static_cast<std::uint16_t>(bytes[1]) << 0));
+}
+
+std::uint32_t readUInt32(const std::uint8_t* bytes)
+{
+	return (static_cast<std::uint32_t>(bytes[0]) << 24) |
+		(static_cast<std::uint32_t>(bytes[1]) << 16) |
+		(static_cast<std::uint32_t>(bytes[2]) << 8) |
+		(static_cast<std::uint32_t>(bytes[3]) << 0);
+}
+
+void updateChecksum(
+	const std::uint8_t* bytes, std::size_t length, std::uint32_t& crc)
+{
+	crc = crc::updateCRC32(bytes, length, crc);
+}
+
+// True if the bytes are the sync word, or as much of it as they cover
+template <class Iterator>
+bool startsWithSyncWord(Iterator first, Iterator last)
+{
+	const auto count = std::min<std::size_t>(
+		static_cast<std::size_t>(last - first),
+		NetworkMessage::syncWord.size());
+
+	return std::equal(first, first + count, NetworkMessage::syncWord.begin());
+}
+}  // namespace
+
 //=============================================================================
 void NetworkMessageParser::parse(const QByteArray& data)
 {
-	for (const auto& arrayElem : data) {
-		const auto& byte = static_cast<const std::uint8_t&>(arrayElem);
+	auto current = reinterpret_cast<const std::uint8_t*>(data.constData());
+	const auto end = current + data.size();
+
+	// Read the clock only once a frame starts in this chunk
+	m_ChunkTimed = false;
+
+	while (current != end) {
+		const auto available = static_cast<std::size_t>(end - current);
 
 		switch (m_ParseStep) {
 			case MessageSection::HEADER: {
+				if (!m_ChunkTimed) {
+					m_ChunkTime = Clock::now();
+					m_ChunkTimed = true;
+				}
+				m_FrameStart = m_ChunkTime;
+
+				if (*current == NetworkMessage::syncWord[0]) {
+					m_ParseStep = MessageSection::FRAME_PREFIX;
+					break;
+				}
+
+				if (!m_LegacyFramesAccepted) {
+					// Nothing but a sync word can start a frame
+					current = std::find(
+						current, end, NetworkMessage::syncWord[0]);
+					break;
+				}
+
+				// Fast path: header, type and size are all contained in this
+				// chunk, so decode them together
+				if ((*current == 0x00) &&
+					(available >= NetworkMessage::prefixSize)) {
+					m_Message.header = current[0];
+					m_Message.type = ntohs(readUInt16(current + 1));
+					m_Message.size = ntohl(readUInt32(current + 3));
+
+					updateChecksum(
+						current, NetworkMessage::prefixSize, m_ChecksumValue);
+					current += NetworkMessage::prefixSize;
+
+					beginPayload();
+					break;
+				}
+
+				const auto byte = *current++;
 				if (byte != 0x00) {
 					m_ParseStep = MessageSection::HEADER;
 					m_ChecksumValue = 0x00000000;
@@ -29,13 +111,32 @@ void NetworkMessageParser::parse(const QByteArray& data)
 				m_ParseStep = MessageSection::TYPE_BYTE1;
 				break;
 			}
+			case MessageSection::FRAME_PREFIX: {
+				const auto count =
+					std::min(available, m_Prefix.size() - m_PrefixSize);
+
+				std::copy(current, current + count,
+					m_Prefix.begin() + m_PrefixSize);
+				m_PrefixSize += count;
+				current += count;
+
+				if (!hasSyncWord()) {
+					resynchronize();
+				}
+				else if (m_PrefixSize == m_Prefix.size()) {
+					acceptPrefix();
+				}
+				break;
+			}
 			case MessageSection::TYPE_BYTE1: {
+				const auto byte = *current++;
 				m_Message.type = static_cast<std::uint16_t>(byte) << 8;
 				crc::updateCRC32(byte, m_ChecksumValue);
 				m_ParseStep = MessageSection::TYPE_BYTE2;
 				break;
 			}
 			case MessageSection::TYPE_BYTE2: {
+				const auto byte = *current++;
 				m_Message.type |= static_cast<std::uint16_t>(byte) << 0;
 				m_Message.type = ntohs(m_Message.type);
 				crc::updateCRC32(byte, m_ChecksumValue);
@@ -43,42 +144,45 @@ void NetworkMessageParser::parse(const QByteArray& data)
 				break;
 			}
 			case MessageSection::SIZE_BYTE1: {
+				const auto byte = *current++;
 				m_Message.size = static_cast<std::uint32_t>(byte) << 24;
 				crc::updateCRC32(byte, m_ChecksumValue);
 				m_ParseStep = MessageSection::SIZE_BYTE2;
 				break;
 			}
 			case MessageSection::SIZE_BYTE2: {
+				const auto byte = *current++;
 				m_Message.size |= static_cast<std::uint32_t>(byte) << 16;
 				crc::updateCRC32(byte, m_ChecksumValue);
 				m_ParseStep = MessageSection::SIZE_BYTE3;
 				break;
 			}
 			case MessageSection::SIZE_BYTE3: {
+				const auto byte = *current++;
 				m_Message.size |= static_cast<std::uint32_t>(byte) << 8;
 				crc::updateCRC32(byte, m_ChecksumValue);
 				m_ParseStep = MessageSection::SIZE_BYTE4;
 				break;
 			}
 			case MessageSection::SIZE_BYTE4: {
+				const auto byte = *current++;
 				m_Message.size |= static_cast<std::uint32_t>(byte) << 0;
 				m_Message.size = ntohl(m_Message.size);
 				crc::updateCRC32(byte, m_ChecksumValue);
-				m_CurrentMessageSize = m_Message.size;
-				m_ParseStep = MessageSection::DATA;
 
-				m_Message.data.clear();
-				if (m_Message.size > 0) {
-					m_Message.data.reserve(m_Message.size);
-				}
-				else {
-					m_ParseStep = MessageSection::CHECKSUM_BYTE1;
-				}
+				beginPayload();
 				break;
 			}
 			case MessageSection::DATA: {
-				m_Message.data.push_back(byte);
-				crc::updateCRC32(byte, m_ChecksumValue);
+				// Copy (and checksum) as much of the payload as this chunk
+				// holds in a single operation
+				const auto count = std::min<std::size_t>(
+					available, m_Message.size - m_Message.data.size());
+
+				m_Message.data.insert(
+					m_Message.data.end(), current, current + count);
+				updateChecksum(current, count, m_ChecksumValue);
+				current += count;
 
 				if (m_Message.data.size() == m_Message.size) {
 					m_ParseStep = MessageSection::CHECKSUM_BYTE1;
@@ -86,34 +190,37 @@ void NetworkMessageParser::parse(const QByteArray& data)
 				break;
 			}
 			case MessageSection::CHECKSUM_BYTE1: {
+				// Fast path: the complete checksum is contained in this chunk
+				if (available >= NetworkMessage::trailerSize) {
+					m_Message.checksum = readUInt32(current);
+					current += NetworkMessage::trailerSize;
+
+					finishMessage();
+					break;
+				}
+
+				const auto byte = *current++;
 				m_Message.checksum = static_cast<std::uint32_t>(byte) << 24;
 				m_ParseStep = MessageSection::CHECKSUM_BYTE2;
 				break;
 			}
 			case MessageSection::CHECKSUM_BYTE2: {
+				const auto byte = *current++;
 				m_Message.checksum |= static_cast<std::uint32_t>(byte) << 16;
 				m_ParseStep = MessageSection::CHECKSUM_BYTE3;
 				break;
 			}
 			case MessageSection::CHECKSUM_BYTE3: {
+				const auto byte = *current++;
 				m_Message.checksum |= static_cast<std::uint32_t>(byte) << 8;
 				m_ParseStep = MessageSection::CHECKSUM_BYTE4;
 				break;
 			}
 			case MessageSection::CHECKSUM_BYTE4: {
+				const auto byte = *current++;
 				m_Message.checksum |= static_cast<std::uint32_t>(byte) << 0;
-				m_Message.checksum = ntohl(m_Message.checksum);
-
-				// Does checksum match the internally-calculated checksum?
-				 if ((m_Message.checksum == m_ChecksumValue) &&
-					 m_MessageReadyCallback) {
-					 std::invoke(m_MessageReadyCallback, m_Message);
-				}
-
-				m_ParseStep = MessageSection::HEADER;
-				m_ChecksumValue = 0x00000000;
-				m_CurrentMessageSize = 0;
 
+				finishMessage();
 				break;
 			}
 		}  // end switch
@@ -121,6 +228,133 @@ void NetworkMessageParser::parse(const QByteArray& data)
 }
 //=============================================================================
 
+//=============================================================================
+void NetworkMessageParser::beginPayload()
+{
+	if (m_Message.size > NetworkMessage::getMaxPayloadSize(m_Message.type)) {
+		rejectFrame();
+		return;
+	}
+
+	m_CurrentMessageSize = m_Message.size;
+	m_ParseStep = MessageSection::DATA;
+
+	m_Message.data.clear();
+	if (m_Message.size > 0) {
+		m_Message.data.reserve(m_Message.size);
+	}
+	else {
+		m_ParseStep = MessageSection::CHECKSUM_BYTE1;
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void NetworkMessageParser::finishMessage()
+{
+	m_Message.checksum = ntohl(m_Message.checksum);
+
+	// Does checksum match the internally-calculated checksum?
+	if ((m_Message.checksum == m_ChecksumValue) && m_MessageReadyCallback) {
+		const auto now = Clock::now();
+		MessageStatistics::getDefault().record(MessageStatistics::Stage::PARSE,
+			m_Message.type, m_Message.data.size(), now - m_FrameStart);
+
+		m_Message.receivedAt = now;
+
+		// A frame following in the same chunk starts now
+		m_ChunkTime = now;
+		m_ChunkTimed = true;
+
+		if (m_Message.type == NetworkMessage::MESSAGE_BATCH) {
+			messageBatch::unpack(
+				m_Message.data, [this, now](NetworkMessage& msg) {
+					msg.receivedAt = now;
+					std::invoke(m_MessageReadyCallback, msg);
+				});
+		}
+		else {
+			std::invoke(m_MessageReadyCallback, m_Message);
+		}
+	}
+
+	m_ParseStep = MessageSection::HEADER;
+	m_ChecksumValue = 0x00000000;
+	m_CurrentMessageSize = 0;
+}
+//=============================================================================
+
+//=============================================================================
+void NetworkMessageParser::rejectFrame()
+{
+	// The rest of the frame is skipped like any other unframed bytes
+	m_ParseStep = MessageSection::HEADER;
+	m_ChecksumValue = 0x00000000;
+	m_CurrentMessageSize = 0;
+}
+//=============================================================================
+
+//=============================================================================
+bool NetworkMessageParser::hasSyncWord() const
+{
+	return startsWithSyncWord(
+		m_Prefix.begin(), m_Prefix.begin() + m_PrefixSize);
+}
+//=============================================================================
+
+//=============================================================================
+void NetworkMessageParser::acceptPrefix()
+{
+	constexpr auto checksumOffset = NetworkMessage::syncWord.size() +
+		sizeof(NetworkMessage::DescriptorType) +
+		sizeof(NetworkMessage::SizeType);
+
+	const auto fields = m_Prefix.data() + NetworkMessage::syncWord.size();
+	const auto checksum = ntohl(readUInt32(m_Prefix.data() + checksumOffset));
+
+	if (checksum != crc::updateCRC32(m_Prefix.data(), checksumOffset, 0)) {
+		resynchronize();
+		return;
+	}
+
+	m_Message.header = 0x00;
+	m_Message.type = ntohs(readUInt16(fields));
+	m_Message.size = ntohl(readUInt32(fields + 2));
+
+	if (m_Message.size > NetworkMessage::getMaxPayloadSize(m_Message.type)) {
+		resynchronize();
+		return;
+	}
+
+	m_ChecksumValue = crc::updateCRC32(m_Prefix.data(), m_Prefix.size(), 0);
+	m_PrefixSize = 0;
+	m_LegacyFramesAccepted = false;
+
+	beginPayload();
+}
+//=============================================================================
+
+//=============================================================================
+void NetworkMessageParser::resynchronize()
+{
+	// Drop the bytes up to the next one which may start a sync word; the
+	// ones after it are looked at again
+	const auto begin = m_Prefix.begin();
+	const auto end = begin + m_PrefixSize;
+
+	auto next = begin;
+	do {
+		next = std::find(next + 1, end, NetworkMessage::syncWord[0]);
+	} while ((next != end) && !startsWithSyncWord(next, end));
+
+	m_PrefixSize =
+		static_cast<std::size_t>(std::copy(next, end, begin) - begin);
+	if (m_PrefixSize == 0) {
+		m_ParseStep = MessageSection::HEADER;
+	}
+}
+//=============================================================================
+
 //=============================================================================
 NetworkMessage::SizeType NetworkMessageParser::getCurrentMessageSize() const
 {
@@ -0,0 +1,77 @@
+#include "networking/payloadPool.h"
+
+#include <utility>
+
+//=============================================================================
+PayloadPool& PayloadPool::getDefault()
+{
+	// Never destroyed, as messages may still be released while static
+	// objects are torn down
+	static auto pool = new PayloadPool;
+	return *pool;
+}
+//=============================================================================
+
+//=============================================================================
+auto PayloadPool::acquire() -> PayloadDataType
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_Statistics.acquired++;
+	if (m_Buffers.empty()) {
+		return PayloadDataType();
+	}
+
+	m_Statistics.reused++;
+	auto buffer = std::move(m_Buffers.back());
+	m_Buffers.pop_back();
+
+	return buffer;
+}
+//=============================================================================
+
+//=============================================================================
+void PayloadPool::release(PayloadDataType&& buffer)
+{
+	// Buffers without capacity are not worth keeping, and free nothing
+	if (buffer.capacity() == 0) {
+		return;
+	}
+
+	buffer.clear();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_Statistics.released++;
+	if ((m_Buffers.size() >= maxBuffers) ||
+		(buffer.capacity() > maxBufferCapacity)) {
+		m_Statistics.discarded++;
+		return;
+	}
+
+	m_Buffers.push_back(std::move(buffer));
+}
+//=============================================================================
+
+//=============================================================================
+SharedNetworkMessage PayloadPool::share(NetworkMessage& msg)
+{
+	auto shared = new NetworkMessage(std::move(msg));
+	msg.data = acquire();
+
+	return SharedNetworkMessage(shared, [this](const NetworkMessage* msg) {
+		auto released = const_cast<NetworkMessage*>(msg);
+		release(std::move(released->data));
+
+		delete released;
+	});
+}
+//=============================================================================
+
+//=============================================================================
+auto PayloadPool::getStatistics() const -> Statistics
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Statistics;
+}
+//=============================================================================
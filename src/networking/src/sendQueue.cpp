@@ -0,0 +1,77 @@
+#include "networking/sendQueue.h"
+
+#include <algorithm>
+
+namespace
+{
+std::size_t getByteCount(const EncodedMessage& msg)
+{
+	return static_cast<std::size_t>(msg.getBytes().size());
+}
+}  // namespace
+
+//=============================================================================
+SendQueue::SendQueue(std::size_t maxBytes) : m_MaxBytes{maxBytes}
+{
+}
+//=============================================================================
+
+//=============================================================================
+bool SendQueue::push(const EncodedMessage& msg)
+{
+	if (auto key = msg.getSupersedeKey()) {
+		auto removed = std::remove_if(m_Messages.begin(), m_Messages.end(),
+			[&key, this](const EncodedMessage& queuedMsg) {
+				if (queuedMsg.getSupersedeKey() != key) {
+					return false;
+				}
+
+				m_Statistics.queuedBytes -= getByteCount(queuedMsg);
+				m_Statistics.supersededMessages++;
+				return true;
+			});
+
+		m_Messages.erase(removed, m_Messages.end());
+	}
+
+	const bool wasEmpty = m_Messages.empty();
+
+	m_Messages.push_back(msg);
+	m_Statistics.queuedBytes += getByteCount(msg);
+	m_Statistics.queuedMessages = m_Messages.size();
+	m_Statistics.peakQueuedBytes =
+		std::max(m_Statistics.peakQueuedBytes, m_Statistics.queuedBytes);
+
+	return wasEmpty || (m_Statistics.queuedBytes <= m_MaxBytes);
+}
+//=============================================================================
+
+//=============================================================================
+const EncodedMessage& SendQueue::front() const
+{
+	return m_Messages.front();
+}
+//=============================================================================
+
+//=============================================================================
+void SendQueue::pop()
+{
+	m_Statistics.queuedBytes -= getByteCount(m_Messages.front());
+	m_Messages.pop_front();
+	m_Statistics.queuedMessages = m_Messages.size();
+}
+//=============================================================================
+
+//=============================================================================
+bool SendQueue::isEmpty() const
+{
+	return m_Messages.empty();
+}
+//=============================================================================
+
+//=============================================================================
+auto SendQueue::getStatistics() const -> const Statistics&
+{
+	return m_Statistics;
+}
+//=============================================================================
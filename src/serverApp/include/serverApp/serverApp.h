@@ -2,21 +2,35 @@
 #define serverApp_h
 
 #include "common/coreTypes.h"
+#include "networking/connectionOptions.h"
+#include "networking/messageStatistics.h"
 #include "networking/networkMessage.h"
-#include "appcore/applicationObjects.h"
+#include "networking/sendQueue.h"
 #include "appcore/messageEncoder.h"
+#include "appcore/messages.h"
+#include "appcore/sceneState.h"
+#include "appcore/session.h"
+#include "appcore/updateCoalescer.h"
 
 #include <QHostAddress>
+#include <QTimer>
 
 #include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <array>
+#include <cstdint>
 #include <optional>
+#include <functional>
 
 class TcpServer;
 class Connection;
+class ConnectionThreadPool;
+class EncodedMessage;
+class EpollServer;
+class DatagramChannel;
+class QSocketNotifier;
 
 class ServerApp
 {
@@ -29,18 +43,133 @@ public:
 	bool isListening() const;
 	void close();
 
+	static constexpr double defaultBroadcastRate = 90.0;
+
+	// Property updates are coalesced per object and rebroadcast at this rate,
+	// in Hz. A rate of zero rebroadcasts every update as it arrives
+	void setBroadcastRate(double rate);
+	double getBroadcastRate() const;
+
+	// Totals of all sessions
+	UpdateCoalescer::Statistics getBroadcastStatistics() const;
+
+	// Batch window of connections to peers which accept MESSAGE_BATCH
+	// frames; see Connection::setBatchWindow
+	void setBatchWindow(int milliseconds);
+	int getBatchWindow() const;
+
+	// Serves the connections of peers joining from now on from a shared pool
+	// of I/O threads instead of a thread each; zero threads uses one per core
+	void useConnectionThreadPool(int threadCount = 0);
+
+	// Accepts and serves peers with the epoll backend, on the thread of the
+	// event loop, rather than with TcpServer and a Connection per peer. Has
+	// to be called before listen. Returns false where epoll is unavailable
+	bool useEpollBackend();
+
+	// Socket options of peer connections accepted from now on
+	void setConnectionOptions(const ConnectionOptions&);
+	const ConnectionOptions& getConnectionOptions() const;
+
+	// Offers peers which understand it a datagram channel for pose updates,
+	// on the UDP port with the number listened on. Has to be called before
+	// listen
+	void setDatagramChannelEnabled(bool enabled);
+	bool isDatagramChannelEnabled() const;
+
+	// Latest send queue figures of a peer which has fallen behind at some
+	// point; see Connection::sendQueueStatisticsUpdated and
+	// EpollServer::setSendQueueStatisticsCallback
+	std::optional<SendQueue::Statistics> getSendQueueStatistics(
+		common::IdType connectionId) const;
+
+	static constexpr int defaultStatisticsInterval = 60;
+
+	// Logs the message statistics of the interval every this many seconds;
+	// zero stops logging them. Peers may query the totals since the start
+	// with a STATISTICS_REQUEST either way
+	void setStatisticsInterval(int seconds);
+	int getStatisticsInterval() const;
+
+	// Opens a review session under a new code, which peers give in their
+	// credentials to join it. Sessions are isolated from one another, each
+	// with its own scene, object ownership and broadcasts, while sharing the
+	// listener and the I/O threads. Listening opens one if there is none
+	std::string createSession();
+	std::vector<std::string> getSessionCodes() const;
+
+	static constexpr int snapshotInterval = 30;
+
+	// Keeps the widgets, the volume and the cut plane of each session in a
+	// session journal in a subdirectory named after its code, and compacts
+	// the journals every snapshotInterval seconds. The sessions a previous
+	// server left there are recovered under their codes. Has to be called
+	// before creating sessions. Returns false if the directory cannot be
+	// written
+	bool setSessionDirectory(const std::string& directory);
+
 protected:
 	using MessageType = NetworkMessage;
 	using ColorVectorType = common::ColorVectorType;
 	using IdType = common::IdType;
+	using PropertyListType = common::PropertyListType;
+	using ObjectType = UpdateCoalescer::ObjectType;
+	using RateClass = Subscription::RateClass;
+	using OutputEncoderMap = Session::OutputEncoderMap;
 
-	void messageAllClients(const NetworkMessage&);
-	void messageOneClient(const NetworkMessage&, IdType);
+	// Builds a message with the given encoder. Broadcasts invoke it once per
+	// negotiated capability set in use rather than once per peer
+	using MessageBuilderType = std::function<NetworkMessage(MessageEncoder&)>;
+
+	// Messages the validated peers of the session. Connections falling
+	// behind may drop a queued message in favor of a newer one with the same
+	// supersede key
+	void messageAllClients(Session&, const MessageBuilderType&,
+		std::optional<std::uint64_t> supersedeKey = std::nullopt);
+
+	// Messages a property update of the object to the peers of the session
+	// which subscribed to it at the rate class, with the encoders of that
+	// rate class
+	void messageSubscribers(Session&, RateClass, ObjectType, IdType,
+		const MessageBuilderType&,
+		std::optional<std::uint64_t> supersedeKey = std::nullopt);
+
+	void messageOneClient(const MessageBuilderType&, IdType);
+
+	// Encoders keep per-object transform baselines for their broadcasts, so
+	// each session has its own; peers yet to join one use those of the server
+	MessageEncoder& getOutputEncoder(
+		const PeerCapabilities&, Session* = nullptr);
+
+	// Capabilities offered to joining peers
+	PeerCapabilities getSupportedCapabilities() const;
+
+	// Queues a property update for the next broadcast tick of the rate
+	// class. The callback sends the coalesced properties of the object
+	void scheduleBroadcast(Session&, RateClass, ObjectType, IdType,
+		const PropertyListType&, UpdateCoalescer::SendCallbackType);
+
+	// Schedules the rebroadcast of updates applied to the scene state of the
+	// session, and journals them
+	void broadcastUpdates(Session&, const SceneState::UpdateListType&);
 	void authenticatePeer(IdType connectionId,
 		const std::string& sessionCode, const std::string& nickname);
-	bool removePeer(IdType peerId);
+
+	// Releases whatever the peer held and tells the rest of its session
+	void removePeer(IdType peerId);
+
+	// Session the peer has joined; null until it has been validated
+	Session* getSession(IdType connectionId);
 
 	void onNewConnection(qintptr socketDescriptor);
+	void onEpollConnected(std::uint64_t epollConnectionId);
+	void onEpollDisconnected(std::uint64_t epollConnectionId);
+	void onSendQueueStatisticsUpdated(
+		IdType connectionId, const SendQueue::Statistics&);
+	void onPeerCapabilitiesReceived(const PeerCapabilities&, IdType);
+	void onDatagramReceived(std::uint64_t token, const NetworkMessage&);
+	void onStatisticsRequested(IdType connectionId);
+	void onSubscriptionReceived(const Subscription&, IdType connectionId);
 
 	void onLaserUpdated(const LaserUpdate&, IdType connectionId);
 	void onVolumeUpdated(const VolumeUpdate&, IdType connectionId);
@@ -49,33 +178,79 @@ protected:
 
 private:
 	void shutdown();
+	void logStatistics();
+	void flushBroadcasts();
+	void flushPreviews();
 
 	// Custom struct to hold all the relevant connection information
 	struct ConnectionInfo
 	{
+		// With the epoll backend the connection is null and the socket is
+		// identified by the epoll connection id instead
 		std::unique_ptr<Connection> connection;
+		std::uint64_t epollConnectionId = 0;
 		std::string alias;
 		ColorVectorType color;
 		bool validated;
+		PeerCapabilities capabilities;
+		std::optional<SendQueue::Statistics> sendQueueStatistics;
+		std::optional<std::uint64_t> datagramToken;
+		Session* session = nullptr;
 	};
 
 	using ConnectionMap = std::unordered_map<IdType, ConnectionInfo>;
-	using WidgetOwnershipMap = std::unordered_map<IdType,
-		std::optional<IdType>>;
+	using PeerFilterType = std::function<bool(const Session::Peer&)>;
+
+	// Messages the validated peers of the session the filter lets through,
+	// encoding once per capability set with the encoders of the rate class
+	void messagePeers(Session&, RateClass, const PeerFilterType&,
+		const MessageBuilderType&, std::optional<std::uint64_t> supersedeKey);
+
+	// The scene of the session as a peer loads it on joining
+	void sendFullState(IdType connectionId, const ConnectionInfo&, Session&);
+
+	void addConnection(IdType connectionId, ConnectionInfo);
+	void offerDatagramChannel(IdType connectionId, ConnectionInfo&);
+
+	// Sends the message over the datagram channel of the peer if it has a
+	// latest-wins key and the channel takes it, and over the connection
+	// otherwise
+	void sendToPeer(const ConnectionInfo&, const EncodedMessage&,
+		std::optional<std::uint64_t> latestWinsKey = std::nullopt);
+	void sendToConnection(const ConnectionInfo&, const EncodedMessage&);
+	void closeConnection(const ConnectionInfo&);
+
+	// Journals the session from its current scene on, if sessions are kept
+	// in a directory
+	bool startJournal(Session&);
 
 	QHostAddress m_HostIP;
 	std::optional<quint16> m_HostPort;
 	std::unique_ptr<TcpServer> m_TcpServer;
+	std::unique_ptr<ConnectionThreadPool> m_ConnectionThreadPool;
+	std::unique_ptr<EpollServer> m_EpollServer;
+	std::unique_ptr<QSocketNotifier> m_EpollNotifier;
+	std::unordered_map<std::uint64_t, IdType> m_EpollConnections;
+	std::unique_ptr<DatagramChannel> m_DatagramChannel;
+	std::unordered_map<std::uint64_t, IdType> m_DatagramEndpoints;
+	bool m_DatagramChannelEnabled;
 	bool m_Listening;
-	std::string m_SessionCode;
+	SessionRegistry m_Sessions;
+	std::string m_SessionDirectory;
 	ConnectionMap m_Connections;
-	WidgetOwnershipMap m_WidgetOwnershipMap;
-	std::optional<IdType> m_VolumeOwner;
-	std::optional<IdType> m_PlaneOwner;
-	ApplicationObjects m_ApplicationObjects;
 	MessageEncoder m_MessageEncoder;
+	MessageEncoder m_DatagramEncoder;
+	OutputEncoderMap m_OutputEncoders;
 	IdType m_NextAvailableConnectionId;
-	IdType m_NextAvailableWidgetId;
+	QTimer m_BroadcastTimer;
+	QTimer m_PreviewTimer;
+	double m_BroadcastRate;
+	int m_BatchWindow;
+	ConnectionOptions m_ConnectionOptions;
+	QTimer m_StatisticsTimer;
+	int m_StatisticsInterval;
+	MessageStatistics::Snapshot m_LoggedStatistics;
+	QTimer m_SnapshotTimer;
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "serverApp/serverApp.h"
+#include "networking/connection.h"
+#include "config/config.h"
 
 #include <QApplication>
 #include <QCommandLineParser>
@@ -29,20 +31,68 @@ auto main(int argc, char* argv[]) -> int
 	QCommandLineOption launcherIPOption({{"l", "launcherIP"},
 		"IP address of the launching entity", "launcherIP", "127.0.0.1"});
 
+	QCommandLineOption broadcastRateOption({{"r", "broadcastRate"},
+		"Rate at which property updates are broadcast, in Hz (0 broadcasts "
+		"every update immediately)",
+		"rate", QString::number(ServerApp::defaultBroadcastRate)});
+
+	QCommandLineOption batchWindowOption({{"b", "batchWindow"},
+		"Window in which small messages to a peer are packed into one frame, "
+		"in ms (negative disables batching)",
+		"window", QString::number(Connection::defaultBatchWindow)});
+
+	QCommandLineOption ioThreadsOption({{"t", "ioThreads"},
+		"Serve peer connections from a pool of I/O threads instead of a "
+		"thread each (0 uses one per core)",
+		"count"});
+
+	QCommandLineOption epollOption({{"e", "epoll"},
+		"Serve peer connections with the epoll backend on the main thread "
+		"(Linux only)"});
+
+	QCommandLineOption udpOption({{"u", "udp"},
+		"Offer peers a datagram channel on the UDP port matching the port "
+		"number, for pose updates"});
+
+	QCommandLineOption statisticsIntervalOption({{"s", "statisticsInterval"},
+		"Interval at which message counts and latencies are logged, in s "
+		"(0 disables logging)",
+		"interval", QString::number(ServerApp::defaultStatisticsInterval)});
+
+	QCommandLineOption sessionsOption({{"n", "sessions"},
+		"Number of review sessions served, each under its own session code",
+		"count", "1"});
+
+	QCommandLineOption sessionDirectoryOption({{"j", "sessionDirectory"},
+		"Directory in which the sessions are journaled, and from which they "
+		"are recovered after a restart",
+		"directory"});
+
 	parser.addOption(ipOption);
 	parser.addOption(portOption);
 	parser.addOption(launcherIPOption);
+	parser.addOption(broadcastRateOption);
+	parser.addOption(batchWindowOption);
+	parser.addOption(ioThreadsOption);
+	parser.addOption(epollOption);
+	parser.addOption(udpOption);
+	parser.addOption(statisticsIntervalOption);
+	parser.addOption(sessionsOption);
+	parser.addOption(sessionDirectoryOption);
 	parser.process(app);
 
 	auto hostAddress = QHostAddress(parser.value(ipOption));
 	auto portNumber = parser.value(portOption).toULong();
 	auto launcherIPAddress = QHostAddress(parser.value(launcherIPOption));
+	auto broadcastRate = parser.value(broadcastRateOption).toDouble();
+	auto batchWindow = parser.value(batchWindowOption).toInt();
 
 	std::cout << "IP address: " << hostAddress.toString().toStdString() << "\n";
 	std::cout << "Port number: " << portNumber << "\n";
 	std::cout << "Session host IP address: "
-		<< launcherIPAddress.toString().toStdString()
-		<< std::endl;
+		<< launcherIPAddress.toString().toStdString() << "\n";
+	std::cout << "Broadcast rate: " << broadcastRate << " Hz\n";
+	std::cout << "Batch window: " << batchWindow << " ms" << std::endl;
 
 	if (hostAddress.isNull()) {
 		std::cerr << "IP address is not valid" << std::endl;
@@ -55,6 +105,36 @@ auto main(int argc, char* argv[]) -> int
 	}
 
 	ServerApp serverApp(launcherIPAddress);
+	serverApp.setBroadcastRate(broadcastRate);
+	serverApp.setBatchWindow(batchWindow);
+	serverApp.setConnectionOptions(
+		Config::getDefaultConfig().connectionOptions);
+	if (parser.isSet(ioThreadsOption)) {
+		serverApp.useConnectionThreadPool(
+			parser.value(ioThreadsOption).toInt());
+	}
+
+	if (parser.isSet(epollOption) && !serverApp.useEpollBackend()) {
+		return EXIT_FAILURE;
+	}
+
+	serverApp.setDatagramChannelEnabled(parser.isSet(udpOption));
+	serverApp.setStatisticsInterval(
+		parser.value(statisticsIntervalOption).toInt());
+
+	if (parser.isSet(sessionDirectoryOption) &&
+		!serverApp.setSessionDirectory(
+			parser.value(sessionDirectoryOption).toStdString())) {
+		return EXIT_FAILURE;
+	}
+
+	// Sessions recovered from the session directory count towards these
+	const auto sessionCount = parser.value(sessionsOption).toInt();
+	while (static_cast<int>(serverApp.getSessionCodes().size()) <
+		sessionCount) {
+		serverApp.createSession();
+	}
+
 	if (!serverApp.listen(hostAddress, portNumber)) {
 		std::cerr << "Could not launch server" << std::endl;
 		return EXIT_FAILURE;
@@ -1,13 +1,14 @@
 #include "serverApp/serverApp.h"
 #include "networking/tcpServer.h"
 #include "networking/connection.h"
+#include "networking/connectionThreadPool.h"
+#include "networking/datagramChannel.h"
+#include "networking/encodedMessage.h"
+#include "networking/epollServer.h"
 #include "appcore/messages.h"
 #include "appcore/serializationHelper.h"
 #include "appcore/serializationTypes.h"
-#include "widgets/laserWidget.h"
-#include "widgets/volumeWidget.h"
-#include "widgets/splineWidget.h"
-#include "widgets/planeWidget.h"
+#include "appcore/sessionJournal.h"
 
 #include <cereal/types/string.hpp>
 #include <cereal/types/array.hpp>
@@ -16,11 +17,16 @@
 #include <cereal/types/vector.hpp>
 
 #include <QTcpSocket>
+#include <QSocketNotifier>
 #include <QColor>
 
+#include <filesystem>
 #include <iostream>
 #include <random>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
 #include <sstream>
 #include <vector>
 
@@ -39,23 +45,75 @@ QColor generateRandomColor()
 	return randomColor;
 }
 
-std::string generateSessionCode()
+// Property updates of an object may replace its earlier ones in the send
+// queue of a peer which has fallen behind, provided they carry exactly the
+// same properties. Node positions are addressed by index, and unknown
+// properties by name, so updates holding either never qualify
+std::optional<std::uint64_t> getSupersedeKey(UpdateCoalescer::ObjectType type,
+	common::IdType id, const common::PropertyListType& propList)
 {
-	const std::string chars =
-		"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	using PropertyId = common::PropertyId;
+
+	std::uint64_t propertyMask{0};
+	for (const auto& [key, value] : propList) {
+		const auto propertyId = key.getId();
+		if ((propertyId == PropertyId::NODE_POSITION) ||
+			(propertyId == PropertyId::UNKNOWN)) {
+			return std::nullopt;
+		}
+
+		propertyMask |= std::uint64_t{1} << static_cast<unsigned>(propertyId);
+	}
+
+	// Object type in the top 4 bits, the properties in the next 16 and the
+	// object id in the remaining 44
+	constexpr std::uint64_t idMask = (std::uint64_t{1} << 44) - 1;
 
-	std::random_device device;
-	std::mt19937 generator(device());
-	std::uniform_int_distribution<> distribution(0, chars.size() - 1);
+	return (static_cast<std::uint64_t>(type) << 60) | (propertyMask << 44) |
+		(static_cast<std::uint64_t>(id) & idMask);
+}
 
-	std::string randomString;
-	const int strLength{2};
+NetworkMessage::FrameFormat getFrameFormat(const PeerCapabilities& capabilities)
+{
+	return capabilities.has(PeerCapabilities::FRAME_V2)
+		? NetworkMessage::FrameFormat::V2
+		: NetworkMessage::FrameFormat::V1;
+}
 
-	for (int i = 0; i < strLength; i++) {
-		randomString += chars[distribution(generator)];
+// Peers yet to join a session are messaged with encoders of the server, one
+// per capability set
+MessageEncoder& getEncoder(
+	std::unordered_map<PeerCapabilities::FlagsType, MessageEncoder>& encoders,
+	const PeerCapabilities& capabilities)
+{
+	auto [it, inserted] = encoders.try_emplace(capabilities.flags);
+	if (inserted) {
+		it->second.setPeerCapabilities(capabilities);
 	}
 
-	return randomString;
+	return it->second;
+}
+
+NetworkMessage createPropertyUpdateMsg(MessageEncoder& encoder,
+	UpdateCoalescer::ObjectType type, common::IdType id,
+	const common::PropertyListType& propList)
+{
+	using ObjectType = UpdateCoalescer::ObjectType;
+
+	switch (type) {
+		case ObjectType::LASER:
+			return encoder.createLaserUpdateMsg(LaserUpdate(propList, id));
+		case ObjectType::VOLUME:
+			return encoder.createVolumeUpdateMsg(VolumeUpdate(
+				VolumeUpdate::MessageType::PROPERTY_UPDATE, propList));
+		case ObjectType::PLANE:
+			return encoder.createPlaneUpdateMsg(PlaneUpdate(
+				PlaneUpdate::MessageType::PROPERTY_UPDATE, propList));
+		case ObjectType::WIDGET:
+		default:
+			return encoder.createWidgetUpdateMsg(WidgetUpdate(
+				WidgetUpdate::MessageType::PROPERTY_UPDATE, id, propList));
+	}
 }
 }  // namespace
 
@@ -65,25 +123,39 @@ ServerApp::ServerApp(
 	m_HostIP{hostIP},
 	m_HostPort{hostPort},
 	m_TcpServer{std::make_unique<TcpServer>()},
+	m_DatagramChannelEnabled{false},
+	m_Listening{false},
 	m_NextAvailableConnectionId{0},
-	m_NextAvailableWidgetId{0},
-	m_Listening{false}
+	m_BroadcastRate{0.0},
+	m_BatchWindow{Connection::defaultBatchWindow},
+	m_StatisticsInterval{0},
+	m_LoggedStatistics{MessageStatistics::getDefault().getSnapshot()}
 {
 	QObject::connect(m_TcpServer.get(), &TcpServer::newConnection,
 		[this](
 			quintptr socketDescriptor) { onNewConnection(socketDescriptor); });
 
-	QObject::connect(m_ApplicationObjects.volume.get(),
-		&VolumeWidget::propertyUpdated, [this](const auto& propList) {
-			messageAllClients(m_MessageEncoder.createVolumeUpdateMsg(VolumeUpdate(
-				VolumeUpdate::MessageType::PROPERTY_UPDATE, propList)));
-		});
+	m_BroadcastTimer.setTimerType(Qt::PreciseTimer);
+	QObject::connect(&m_BroadcastTimer, &QTimer::timeout,
+		[this] { flushBroadcasts(); });
+	setBroadcastRate(defaultBroadcastRate);
 
-	QObject::connect(m_ApplicationObjects.cutplane.get(),
-		&PlaneWidget::propertyUpdated, [this](const auto& propList) {
-			messageAllClients(m_MessageEncoder.createPlaneUpdateMsg(PlaneUpdate(
-				PlaneUpdate::MessageType::PROPERTY_UPDATE, propList)));
-		});
+	m_PreviewTimer.setTimerType(Qt::PreciseTimer);
+	QObject::connect(
+		&m_PreviewTimer, &QTimer::timeout, [this] { flushPreviews(); });
+
+	QObject::connect(
+		&m_StatisticsTimer, &QTimer::timeout, [this] { logStatistics(); });
+	setStatisticsInterval(defaultStatisticsInterval);
+
+	QObject::connect(&m_SnapshotTimer, &QTimer::timeout, [this] {
+		for (auto& [code, session] : m_Sessions.getSessions()) {
+			auto& journal = session->journal;
+			if (journal && (journal->getRecordCountSinceSnapshot() > 0)) {
+				journal->recordSnapshot(session->sceneState);
+			}
+		}
+	});
 
 	m_MessageEncoder.setOnPeerCredentialsReceivedCallback(
 		[this](const PeerCredentials& credentials, IdType connectionId) {
@@ -91,6 +163,11 @@ ServerApp::ServerApp(
 				connectionId, credentials.sessionCode, credentials.alias);
 		});
 
+	m_MessageEncoder.setOnPeerCapabilitiesReceivedCallback(
+		[this](const PeerCapabilities& capabilities, IdType connectionId) {
+			onPeerCapabilitiesReceived(capabilities, connectionId);
+		});
+
 	m_MessageEncoder.setOnLaserUpdatedCallback(
 		[this](const LaserUpdate& laserUpdate, IdType connectionId) {
 			onLaserUpdated(laserUpdate, connectionId);
@@ -110,6 +187,53 @@ ServerApp::ServerApp(
 		[this](const PlaneUpdate& planeUpdate, IdType connectionId) {
 			onPlaneUpdated(planeUpdate, connectionId);
 		});
+
+	m_MessageEncoder.setOnStatisticsRequestedCallback(
+		[this](IdType connectionId) { onStatisticsRequested(connectionId); });
+
+	m_MessageEncoder.setOnSubscriptionReceivedCallback(
+		[this](const Subscription& subscription, IdType connectionId) {
+			onSubscriptionReceived(subscription, connectionId);
+		});
+
+	// Datagrams may arrive late and out of order with respect to the
+	// connection, so they only ever update objects their sender owns.
+	// Taking and releasing ownership is left to the connection
+	m_DatagramEncoder.setOnLaserUpdatedCallback(
+		[this](const LaserUpdate& laserUpdate, IdType connectionId) {
+			onLaserUpdated(laserUpdate, connectionId);
+		});
+
+	m_DatagramEncoder.setOnVolumeUpdatedCallback(
+		[this](const VolumeUpdate& volumeUpdate, IdType connectionId) {
+			if (auto session = getSession(connectionId);
+				session && (session->volumeOwner == connectionId)) {
+				onVolumeUpdated(volumeUpdate, connectionId);
+			}
+		});
+
+	m_DatagramEncoder.setOnWidgetUpdatedCallback(
+		[this](const WidgetUpdate& widgetUpdate, IdType connectionId) {
+			auto session = getSession(connectionId);
+			if (!session) {
+				return;
+			}
+
+			const auto& widgetOwnershipMap = session->widgetOwnershipMap;
+			if (auto it = widgetOwnershipMap.find(widgetUpdate.widgetId);
+				(it != widgetOwnershipMap.end()) &&
+				(it->second == connectionId)) {
+				onWidgetUpdated(widgetUpdate, connectionId);
+			}
+		});
+
+	m_DatagramEncoder.setOnPlaneUpdatedCallback(
+		[this](const PlaneUpdate& planeUpdate, IdType connectionId) {
+			if (auto session = getSession(connectionId);
+				session && (session->planeOwner == connectionId)) {
+				onPlaneUpdated(planeUpdate, connectionId);
+			}
+		});
 }
 //==============================================================================
 
@@ -127,15 +251,72 @@ bool ServerApp::listen(const QHostAddress& address, quint16 portNumber)
 			  << address.toString().toStdString() << ", port " << portNumber
 			  << std::endl;
 
-	if (m_TcpServer->listen(address, portNumber)) {
-		m_SessionCode = generateSessionCode();
+	bool listening{false};
+	if (m_EpollServer) {
+#ifdef NETWORKING_EPOLL
+		listening = m_EpollServer->listen(
+			address.toString().toStdString(), portNumber);
+#endif
+	}
+	else {
+		listening = m_TcpServer->listen(address, portNumber);
+	}
+
+	if (listening && m_DatagramChannelEnabled) {
+		m_DatagramChannel = std::make_unique<DatagramChannel>();
+
+		if (m_DatagramChannel->bind(address, portNumber)) {
+			QObject::connect(m_DatagramChannel.get(),
+				&DatagramChannel::messageReceived,
+				[this](auto token, const NetworkMessage& msg) {
+					onDatagramReceived(token, msg);
+				});
+
+			QObject::connect(m_DatagramChannel.get(),
+				&DatagramChannel::settleRequired,
+				[this](auto token, const EncodedMessage& msg) {
+					if (auto it = m_DatagramEndpoints.find(token);
+						it != m_DatagramEndpoints.end()) {
+						if (auto connectionIt = m_Connections.find(it->second);
+							connectionIt != m_Connections.end()) {
+							sendToConnection(connectionIt->second, msg);
+						}
+					}
+				});
+
+			QObject::connect(m_DatagramChannel.get(),
+				&DatagramChannel::endpointConfirmed, [this](auto token) {
+					if (auto it = m_DatagramEndpoints.find(token);
+						it != m_DatagramEndpoints.end()) {
+						std::cout << "Datagram channel to peer " << it->second
+								  << " is up" << std::endl;
+					}
+				});
+
+			std::cout << "Datagram channel on UDP port "
+					  << m_DatagramChannel->getPort() << std::endl;
+		}
+		else {
+			// Peers simply keep everything on their connection
+			std::cerr << "Could not bind the datagram channel to UDP port "
+					  << portNumber << std::endl;
+			m_DatagramChannel.reset();
+		}
+	}
+
+	if (listening) {
+		if (m_Sessions.getSessions().empty()) {
+			createSession();
+		}
 
 		std::cout << "Server is listening at "
 				  << address.toString().toStdString() << ", port " << portNumber
 				  << std::endl;
 
 		std::cout << "************************************************\n";
-		std::cout << "   Session code is: " << m_SessionCode << "\n";
+		for (const auto& code : getSessionCodes()) {
+			std::cout << "   Session code is: " << code << "\n";
+		}
 		std::cout << "************************************************"
 				  << std::endl;
 	}
@@ -147,6 +328,12 @@ bool ServerApp::listen(const QHostAddress& address, quint16 portNumber)
 //==============================================================================
 bool ServerApp::isListening() const
 {
+#ifdef NETWORKING_EPOLL
+	if (m_EpollServer) {
+		return m_EpollServer->isListening();
+	}
+#endif
+
 	return m_TcpServer->isListening();
 }
 //==============================================================================
@@ -163,7 +350,41 @@ void ServerApp::close()
 void ServerApp::shutdown()
 {
 	std::cout << "Shutting down the server..." << std::endl;
+	m_BroadcastTimer.stop();
+	m_PreviewTimer.stop();
+	m_StatisticsTimer.stop();
+	m_SnapshotTimer.stop();
 	m_TcpServer->close();
+
+#ifdef NETWORKING_EPOLL
+	if (m_EpollServer) {
+		m_EpollServer->closeListener();
+	}
+#endif
+
+	const auto statistics = getBroadcastStatistics();
+	std::cout << "Property updates received: " << statistics.receivedUpdates
+			  << ", broadcast: " << statistics.sentUpdates
+			  << ", coalesced away: " << statistics.coalescedUpdates
+			  << std::endl;
+
+	// The next server starts from the snapshots rather than the journals
+	for (auto& [code, session] : m_Sessions.getSessions()) {
+		auto& journal = session->journal;
+		if (!journal || !journal->isStarted()) {
+			continue;
+		}
+
+		journal->recordSnapshot(session->sceneState);
+		journal->stop();
+
+		const auto journalStatistics = journal->getStatistics();
+		std::cout << "Session " << code
+				  << " records journaled: " << journalStatistics.records
+				  << ", commits: " << journalStatistics.commits
+				  << ", snapshots: " << journalStatistics.snapshots
+				  << std::endl;
+	}
 }
 //==============================================================================
 
@@ -174,7 +395,8 @@ void ServerApp::onNewConnection(qintptr socketDescriptor)
 		return;
 	}
 
-	auto newConnection = std::make_unique<Connection>();
+	auto newConnection =
+		std::make_unique<Connection>(m_ConnectionThreadPool.get());
 	auto connectionId = m_NextAvailableConnectionId++;
 
 	std::cout << "Creating new connection with id = " << connectionId
@@ -188,12 +410,7 @@ void ServerApp::onNewConnection(qintptr socketDescriptor)
 
 	QObject::connect(
 		newConnection.get(), &Connection::disconnected, newConnection.get(),
-		[this, connectionId] {
-			if (removePeer(connectionId)) {
-				messageAllClients(
-					m_MessageEncoder.createPeerRemovedMsg(PeerInfo{connectionId}));
-			}
-		},
+		[this, connectionId] { removePeer(connectionId); },
 		Qt::AutoConnection);
 
 	QObject::connect(
@@ -204,44 +421,807 @@ void ServerApp::onNewConnection(qintptr socketDescriptor)
 
 			// TODO: What if the error message isn't related to the socket
 			// closing?
-			if (removePeer(connectionId)) {
-				messageAllClients(
-					m_MessageEncoder.createPeerRemovedMsg(PeerInfo{connectionId}));
-			}
+			removePeer(connectionId);
+		},
+		Qt::AutoConnection);
+
+	QObject::connect(
+		newConnection.get(), &Connection::sendQueueStatisticsUpdated,
+		newConnection.get(),
+		[this, connectionId](const SendQueue::Statistics& statistics) {
+			onSendQueueStatisticsUpdated(connectionId, statistics);
 		},
 		Qt::AutoConnection);
 
+	newConnection->setOptions(m_ConnectionOptions);
 	newConnection->connectToClient(socketDescriptor);
 
 	ConnectionInfo newConnectionInfo;
 	newConnectionInfo.connection = std::move(newConnection);
+	addConnection(connectionId, std::move(newConnectionInfo));
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onEpollConnected(std::uint64_t epollConnectionId)
+{
+	if (!isListening()) {
+		return;
+	}
+
+	auto connectionId = m_NextAvailableConnectionId++;
+
+	std::cout << "Creating new connection with id = " << connectionId
+			  << std::endl;
+
+	m_EpollConnections.insert({epollConnectionId, connectionId});
+
+	ConnectionInfo newConnectionInfo;
+	newConnectionInfo.epollConnectionId = epollConnectionId;
+	addConnection(connectionId, std::move(newConnectionInfo));
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onEpollDisconnected(std::uint64_t epollConnectionId)
+{
+	auto it = m_EpollConnections.find(epollConnectionId);
+	if (it == m_EpollConnections.end()) {
+		return;
+	}
+
+	removePeer(it->second);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onSendQueueStatisticsUpdated(
+	IdType connectionId, const SendQueue::Statistics& statistics)
+{
+	auto it = m_Connections.find(connectionId);
+	if (it == m_Connections.end()) {
+		return;
+	}
+
+	auto& connectionInfo = it->second;
+	connectionInfo.sendQueueStatistics = statistics;
+
+	std::cout << "Peer " << connectionId << " (" << connectionInfo.alias
+			  << ") ";
+
+	if (statistics.congested) {
+		std::cout << "is lagging: " << statistics.queuedMessages
+				  << " messages (" << statistics.queuedBytes / 1024
+				  << " KiB) queued, " << statistics.socketBytes / 1024
+				  << " KiB in the socket, " << statistics.supersededMessages
+				  << " superseded so far" << std::endl;
+	}
+	else {
+		std::cout << "has caught up; peak backlog "
+				  << statistics.peakQueuedBytes / 1024 << " KiB"
+				  << std::endl;
+	}
+}
+//==============================================================================
+
+//==============================================================================
+auto ServerApp::getSendQueueStatistics(IdType connectionId) const
+	-> std::optional<SendQueue::Statistics>
+{
+	if (auto it = m_Connections.find(connectionId); it != m_Connections.end()) {
+		return it->second.sendQueueStatistics;
+	}
+
+	return std::nullopt;
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::addConnection(
+	IdType connectionId, ConnectionInfo newConnectionInfo)
+{
 	newConnectionInfo.validated = false;
 	newConnectionInfo.color = ColorVectorType{0.0, 0.0, 0.0};
 	newConnectionInfo.alias = "";
+	newConnectionInfo.capabilities = PeerCapabilities{};
 
 	m_Connections.insert({connectionId, std::move(newConnectionInfo)});
 
-	messageOneClient(m_MessageEncoder.createRequestCredentialsMsg(), connectionId);
+	messageOneClient(
+		[this](MessageEncoder& encoder) {
+			return encoder.createRequestCredentialsMsg(
+				getSupportedCapabilities());
+		},
+		connectionId);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::messageAllClients(Session& session,
+	const MessageBuilderType& buildMessage,
+	std::optional<std::uint64_t> supersedeKey)
+{
+	// Pending property updates happened before this message, so they go
+	// first to keep interaction and create/destroy events strictly ordered
+	session.updateCoalescer.flush();
+	session.previewCoalescer.flush();
+
+	messagePeers(session, RateClass::FULL_RATE, nullptr, buildMessage,
+		supersedeKey);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::messageSubscribers(Session& session, RateClass rateClass,
+	ObjectType type, IdType id, const MessageBuilderType& buildMessage,
+	std::optional<std::uint64_t> supersedeKey)
+{
+	messagePeers(session, rateClass,
+		[rateClass, type, id](const Session::Peer& peer) {
+			return peer.wants(rateClass, type, id);
+		},
+		buildMessage, supersedeKey);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::messagePeers(Session& session, RateClass rateClass,
+	const PeerFilterType& isRecipient,
+	const MessageBuilderType& buildMessage,
+	std::optional<std::uint64_t> supersedeKey)
+{
+	// Serialize once per negotiated capability set in use; every connection
+	// thread with that set shares the same encoded bytes
+	struct EncodedBroadcast
+	{
+		PeerCapabilities::FlagsType flags;
+		EncodedMessage msg;
+		std::optional<std::uint64_t> latestWinsKey;
+	};
+	std::vector<EncodedBroadcast> encodedMsgs;
+
+	for (const auto& peer : session.peers) {
+		if (isRecipient && !isRecipient(peer)) {
+			continue;
+		}
+
+		if (auto connectionIt = m_Connections.find(peer.id);
+			connectionIt != m_Connections.end()) {
+			const auto& connectionInfo = connectionIt->second;
+			const auto& capabilities = connectionInfo.capabilities;
+
+			auto it = std::find_if(encodedMsgs.begin(), encodedMsgs.end(),
+				[&capabilities](const auto& encodedMsg) {
+					return encodedMsg.flags == capabilities.flags;
+				});
+
+			if (it == encodedMsgs.end()) {
+				auto msg = buildMessage(
+					session.getEncoder(rateClass, capabilities));
+				auto latestWinsKey = MessageEncoder::getLatestWinsKey(msg);
+				EncodedMessage encodedMsg{msg, getFrameFormat(capabilities)};
+
+				// Delta-coded transforms rely on every earlier one arriving
+				const bool isDeltaCoded = (encodedMsg.getType() ==
+					NetworkMessage::TRANSFORM_UPDATE);
+
+				if (supersedeKey && !isDeltaCoded) {
+					encodedMsg.setSupersedeKey(*supersedeKey);
+				}
+
+				encodedMsgs.push_back(
+					{capabilities.flags, std::move(encodedMsg), latestWinsKey});
+
+				it = std::prev(encodedMsgs.end());
+			}
+
+			sendToPeer(connectionInfo, it->msg, it->latestWinsKey);
+		}
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::messageOneClient(
+	const MessageBuilderType& buildMessage, IdType connectionId)
+{
+	if (auto it = m_Connections.find(connectionId); it != m_Connections.end()) {
+		auto& connectionInfo = it->second;
+
+		const auto& capabilities = connectionInfo.capabilities;
+
+		sendToPeer(connectionInfo,
+			EncodedMessage{buildMessage(getOutputEncoder(
+							   capabilities, connectionInfo.session)),
+				getFrameFormat(capabilities)});
+	}
+}
+//==============================================================================
+
+//==============================================================================
+MessageEncoder& ServerApp::getOutputEncoder(
+	const PeerCapabilities& capabilities, Session* session)
+{
+	return session ? session->getEncoder(RateClass::FULL_RATE, capabilities)
+				   : getEncoder(m_OutputEncoders, capabilities);
+}
+//==============================================================================
+
+//==============================================================================
+PeerCapabilities ServerApp::getSupportedCapabilities() const
+{
+	auto flags = PeerCapabilities::supported;
+	if (!m_DatagramChannel) {
+		flags &= ~PeerCapabilities::DATAGRAM_CHANNEL;
+	}
+
+	return PeerCapabilities{flags};
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::scheduleBroadcast(Session& session, RateClass rateClass,
+	ObjectType type, IdType id, const PropertyListType& propList,
+	UpdateCoalescer::SendCallbackType send)
+{
+	if (rateClass == RateClass::PREVIEW) {
+		session.previewCoalescer.add(type, id, propList, std::move(send));
+
+		if (!m_PreviewTimer.isActive()) {
+			m_PreviewTimer.start(std::chrono::milliseconds(
+				std::lround(1000.0 / Subscription::previewRate)));
+		}
+
+		return;
+	}
+
+	session.updateCoalescer.add(type, id, propList, std::move(send));
+
+	if (!m_BroadcastTimer.isActive()) {
+		session.updateCoalescer.flush();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::broadcastUpdates(
+	Session& session, const SceneState::UpdateListType& updates)
+{
+	if (session.journal) {
+		session.journal->recordUpdates(updates);
+	}
+
+	for (const auto& update : updates) {
+		const auto type = update.type;
+		const auto id = update.id;
+
+		// Nothing is queued for objects no peer subscribed to
+		for (const auto rateClass :
+			{RateClass::FULL_RATE, RateClass::PREVIEW}) {
+			if (!session.hasSubscribers(rateClass, type, id)) {
+				continue;
+			}
+
+			scheduleBroadcast(session, rateClass, type, id, update.propList,
+				[this, &session, rateClass, type, id](
+					const PropertyListType& propList) {
+					// Widget updates are never superseded
+					const auto supersedeKey = (type == ObjectType::WIDGET)
+						? std::nullopt
+						: getSupersedeKey(type, id, propList);
+
+					messageSubscribers(session, rateClass, type, id,
+						[&](MessageEncoder& encoder) {
+							return createPropertyUpdateMsg(
+								encoder, type, id, propList);
+						},
+						supersedeKey);
+				});
+		}
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::setBroadcastRate(double rate)
+{
+	m_BroadcastRate = std::max(rate, 0.0);
+
+	if (m_BroadcastRate > 0.0) {
+		m_BroadcastTimer.start(std::chrono::milliseconds(
+			std::max(1L, std::lround(1000.0 / m_BroadcastRate))));
+	}
+	else {
+		m_BroadcastTimer.stop();
+		flushBroadcasts();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::flushBroadcasts()
+{
+	for (auto& [code, session] : m_Sessions.getSessions()) {
+		session->updateCoalescer.flush();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::flushPreviews()
+{
+	for (auto& [code, session] : m_Sessions.getSessions()) {
+		session->previewCoalescer.flush();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::setStatisticsInterval(int seconds)
+{
+	m_StatisticsInterval = std::max(seconds, 0);
+
+	if (m_StatisticsInterval > 0) {
+		m_StatisticsTimer.start(std::chrono::seconds(m_StatisticsInterval));
+	}
+	else {
+		m_StatisticsTimer.stop();
+	}
+}
+//==============================================================================
+
+//==============================================================================
+int ServerApp::getStatisticsInterval() const
+{
+	return m_StatisticsInterval;
+}
+//==============================================================================
+
+//==============================================================================
+std::string ServerApp::createSession()
+{
+	auto& session = m_Sessions.create();
+	startJournal(session);
+
+	return session.code;
+}
+//==============================================================================
+
+//==============================================================================
+std::vector<std::string> ServerApp::getSessionCodes() const
+{
+	return m_Sessions.getCodes();
+}
+//==============================================================================
+
+//==============================================================================
+auto ServerApp::getSession(IdType connectionId) -> Session*
+{
+	if (auto it = m_Connections.find(connectionId); it != m_Connections.end()) {
+		return it->second.session;
+	}
+
+	return nullptr;
+}
+//==============================================================================
+
+//==============================================================================
+bool ServerApp::setSessionDirectory(const std::string& directory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::cerr << "Could not create the session directory " << directory
+				  << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	m_SessionDirectory = directory;
+
+	for (const auto& entry :
+		std::filesystem::directory_iterator{directory, error}) {
+		const auto code = entry.path().filename().string();
+		if (!entry.is_directory() || m_Sessions.isTaken(code)) {
+			continue;
+		}
+
+		auto journal = std::make_unique<SessionJournal>(entry.path());
+		SceneState sceneState;
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto replayed = journal->recover(sceneState);
+		if (!replayed) {
+			continue;
+		}
+
+		const std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - start;
+
+		auto& session = *m_Sessions.add(code);
+		session.sceneState = std::move(sceneState);
+		session.journal = std::move(journal);
+
+		// Recovered widgets are up for grabs
+		for (const auto& widget : session.sceneState.getWidgets()) {
+			session.widgetOwnershipMap.insert({widget.id, std::nullopt});
+			session.nextAvailableWidgetId =
+				std::max(session.nextAvailableWidgetId, widget.id + 1);
+		}
+
+		std::cout << "Recovered session " << code << " with "
+				  << session.sceneState.getWidgets().size()
+				  << " widgets and " << replayed.value()
+				  << " journal records in " << elapsed.count() << " ms"
+				  << std::endl;
+
+		if (!startJournal(session)) {
+			return false;
+		}
+	}
+
+	m_SnapshotTimer.start(std::chrono::seconds(snapshotInterval));
+
+	return true;
+}
+//==============================================================================
+
+//==============================================================================
+bool ServerApp::startJournal(Session& session)
+{
+	if (m_SessionDirectory.empty()) {
+		return true;
+	}
+
+	if (!session.journal) {
+		session.journal = std::make_unique<SessionJournal>(
+			std::filesystem::path{m_SessionDirectory} / session.code);
+	}
+
+	if (!session.journal->start(session.sceneState)) {
+		std::cerr << "Could not start the journal of session " << session.code
+				  << " in " << m_SessionDirectory << std::endl;
+		session.journal.reset();
+		return false;
+	}
+
+	return true;
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::logStatistics()
+{
+	const auto snapshot = MessageStatistics::getDefault().getSnapshot();
+	const auto report =
+		MessageStatistics::format(snapshot - m_LoggedStatistics);
+	m_LoggedStatistics = snapshot;
+
+	if (report.empty()) {
+		return;
+	}
+
+	std::cout << "Message statistics of the last " << m_StatisticsInterval
+			  << " s:\n"
+			  << report << std::flush;
+}
+//==============================================================================
+
+//==============================================================================
+double ServerApp::getBroadcastRate() const
+{
+	return m_BroadcastRate;
+}
+//==============================================================================
+
+//==============================================================================
+auto ServerApp::getBroadcastStatistics() const -> UpdateCoalescer::Statistics
+{
+	UpdateCoalescer::Statistics total;
+	for (const auto& [code, session] : m_Sessions.getSessions()) {
+		const auto& statistics = session->updateCoalescer.getStatistics();
+
+		total.receivedUpdates += statistics.receivedUpdates;
+		total.sentUpdates += statistics.sentUpdates;
+		total.coalescedUpdates += statistics.coalescedUpdates;
+		total.supersededProperties += statistics.supersededProperties;
+	}
+
+	return total;
 }
 //==============================================================================
 
 //==============================================================================
-void ServerApp::messageAllClients(const NetworkMessage& msg)
+void ServerApp::setBatchWindow(int milliseconds)
 {
+	m_BatchWindow = milliseconds;
+
 	for (const auto& [id, connectionInfo] : m_Connections) {
-		if (connectionInfo.validated) {
-			connectionInfo.connection->sendMessage(msg);
+		if (connectionInfo.connection &&
+			connectionInfo.capabilities.has(PeerCapabilities::MESSAGE_BATCH)) {
+			connectionInfo.connection->setBatchWindow(m_BatchWindow);
+		}
+
+		// The peer switched to resynchronizing frames right after sending
+		// its capabilities, and is ready to receive them as well
+		if (connectionInfo.capabilities.has(PeerCapabilities::FRAME_V2)) {
+			const auto format = NetworkMessage::FrameFormat::V2;
+
+			if (connectionInfo.connection) {
+				connectionInfo.connection->setFrameFormat(format);
+			}
+#ifdef NETWORKING_EPOLL
+			else if (m_EpollServer) {
+				m_EpollServer->setFrameFormat(
+					connectionInfo.epollConnectionId, format);
+			}
+#endif
 		}
 	}
 }
 //==============================================================================
 
 //==============================================================================
-void ServerApp::messageOneClient(const NetworkMessage& msg, IdType connectionId)
+int ServerApp::getBatchWindow() const
+{
+	return m_BatchWindow;
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::useConnectionThreadPool(int threadCount)
+{
+	// Existing connections keep the pool they were created on, so the old
+	// one has to stay alive as long as any of them does
+	if (m_ConnectionThreadPool && !m_Connections.empty()) {
+		std::cerr << "Cannot change the connection thread pool while peers "
+					 "are connected"
+				  << std::endl;
+		return;
+	}
+
+	m_ConnectionThreadPool =
+		std::make_unique<ConnectionThreadPool>(threadCount);
+}
+//==============================================================================
+
+//==============================================================================
+bool ServerApp::useEpollBackend()
+{
+#ifdef NETWORKING_EPOLL
+	if (isListening()) {
+		std::cerr << "The networking backend cannot change while listening"
+				  << std::endl;
+		return false;
+	}
+
+	m_EpollServer = std::make_unique<EpollServer>();
+	m_EpollServer->setConnectionOptions(m_ConnectionOptions);
+	m_EpollServer->setConnectedCallback([this](auto epollConnectionId) {
+		onEpollConnected(epollConnectionId);
+	});
+	m_EpollServer->setDisconnectedCallback([this](auto epollConnectionId) {
+		onEpollDisconnected(epollConnectionId);
+	});
+	m_EpollServer->setErrorCallback(
+		[this](auto epollConnectionId, const std::string& errorMsg) {
+			if (auto it = m_EpollConnections.find(epollConnectionId);
+				it != m_EpollConnections.end()) {
+				std::cerr << "Error received from peer " << it->second << ": "
+						  << errorMsg << std::endl;
+			}
+		});
+	m_EpollServer->setMessageReceivedCallback(
+		[this](auto epollConnectionId, const NetworkMessage& msg) {
+			if (auto it = m_EpollConnections.find(epollConnectionId);
+				it != m_EpollConnections.end()) {
+				m_MessageEncoder.processMessage(msg, it->second);
+			}
+		});
+	m_EpollServer->setSendQueueStatisticsCallback(
+		[this](auto epollConnectionId,
+			const SendQueue::Statistics& statistics) {
+			if (auto it = m_EpollConnections.find(epollConnectionId);
+				it != m_EpollConnections.end()) {
+				onSendQueueStatisticsUpdated(it->second, statistics);
+			}
+		});
+
+	// Let the event loop poll the server whenever it has work to do
+	m_EpollNotifier = std::make_unique<QSocketNotifier>(
+		m_EpollServer->getDescriptor(), QSocketNotifier::Read);
+	QObject::connect(m_EpollNotifier.get(), &QSocketNotifier::activated,
+		[this] { m_EpollServer->poll(0); });
+
+	return true;
+#else
+	std::cerr << "The epoll backend is not available on this platform"
+			  << std::endl;
+	return false;
+#endif
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::setConnectionOptions(const ConnectionOptions& options)
+{
+	m_ConnectionOptions = options;
+
+#ifdef NETWORKING_EPOLL
+	if (m_EpollServer) {
+		m_EpollServer->setConnectionOptions(m_ConnectionOptions);
+	}
+#endif
+}
+//==============================================================================
+
+//==============================================================================
+const ConnectionOptions& ServerApp::getConnectionOptions() const
+{
+	return m_ConnectionOptions;
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::setDatagramChannelEnabled(bool enabled)
+{
+	if (isListening()) {
+		std::cerr << "The datagram channel cannot change while listening"
+				  << std::endl;
+		return;
+	}
+
+	m_DatagramChannelEnabled = enabled;
+}
+//==============================================================================
+
+//==============================================================================
+bool ServerApp::isDatagramChannelEnabled() const
+{
+	return m_DatagramChannelEnabled;
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::offerDatagramChannel(
+	IdType connectionId, ConnectionInfo& connectionInfo)
+{
+	if (!m_DatagramChannel ||
+		!connectionInfo.capabilities.has(PeerCapabilities::DATAGRAM_CHANNEL)) {
+		return;
+	}
+
+	auto token = DatagramChannel::generateToken();
+	m_DatagramChannel->addEndpoint(token);
+	m_DatagramEndpoints.insert({token, connectionId});
+	connectionInfo.datagramToken = token;
+
+	DatagramChannelOffer offer{m_DatagramChannel->getPort(), token};
+	messageOneClient(
+		[&](MessageEncoder& encoder) {
+			return encoder.createDatagramChannelMsg(offer);
+		},
+		connectionId);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onDatagramReceived(
+	std::uint64_t token, const NetworkMessage& msg)
+{
+	auto it = m_DatagramEndpoints.find(token);
+	if (it == m_DatagramEndpoints.end()) {
+		return;
+	}
+
+	// Anything which has to arrive reliably is only accepted over the
+	// connection
+	if (MessageEncoder::getLatestWinsKey(msg)) {
+		m_DatagramEncoder.processMessage(msg, it->second);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onStatisticsRequested(IdType connectionId)
+{
+	auto it = m_Connections.find(connectionId);
+	if ((it == m_Connections.end()) || !it->second.validated) {
+		return;
+	}
+
+	const auto report = MessageStatistics::format(
+		MessageStatistics::getDefault().getSnapshot());
+
+	messageOneClient(
+		[&report](MessageEncoder& encoder) {
+			return encoder.createStatisticsMsg(report);
+		},
+		connectionId);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::sendToPeer(const ConnectionInfo& connectionInfo,
+	const EncodedMessage& msg, std::optional<std::uint64_t> latestWinsKey)
+{
+	if (m_DatagramChannel && connectionInfo.datagramToken) {
+		const auto token = connectionInfo.datagramToken.value();
+
+		if (latestWinsKey) {
+			if (m_DatagramChannel->sendMessage(
+					token, latestWinsKey.value(), msg)) {
+				return;
+			}
+		}
+		else {
+			// What went out as datagrams is resent before this message, so
+			// it cannot be overtaken by a stale datagram
+			m_DatagramChannel->settle(token);
+		}
+	}
+
+	sendToConnection(connectionInfo, msg);
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::sendToConnection(
+	const ConnectionInfo& connectionInfo, const EncodedMessage& msg)
+{
+	if (connectionInfo.connection) {
+		connectionInfo.connection->sendEncodedMessage(msg);
+		return;
+	}
+
+#ifdef NETWORKING_EPOLL
+	if (m_EpollServer) {
+		m_EpollServer->sendEncodedMessage(
+			connectionInfo.epollConnectionId, msg);
+	}
+#endif
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::closeConnection(const ConnectionInfo& connectionInfo)
+{
+	if (connectionInfo.connection) {
+		connectionInfo.connection->close();
+		return;
+	}
+
+#ifdef NETWORKING_EPOLL
+	if (m_EpollServer) {
+		m_EpollServer->close(connectionInfo.epollConnectionId);
+	}
+#endif
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onPeerCapabilitiesReceived(
+	const PeerCapabilities& capabilities, IdType connectionId)
 {
 	if (auto it = m_Connections.find(connectionId); it != m_Connections.end()) {
 		auto& connectionInfo = it->second;
-		connectionInfo.connection->sendMessage(msg);
+
+		// Only use features both sides understand
+		connectionInfo.capabilities = PeerCapabilities{
+			capabilities.flags & getSupportedCapabilities().flags};
+
+		std::cout << "Connection " << connectionId
+				  << " negotiated capabilities 0x" << std::hex
+				  << connectionInfo.capabilities.flags << std::dec << std::endl;
+
+		const auto binaryArchive =
+			connectionInfo.capabilities.has(PeerCapabilities::BINARY_ARCHIVE);
+		m_MessageEncoder.setBinaryArchiveAccepted(connectionId, binaryArchive);
+		m_DatagramEncoder.setBinaryArchiveAccepted(connectionId, binaryArchive);
+
+		if (connectionInfo.connection &&
+			connectionInfo.capabilities.has(PeerCapabilities::MESSAGE_BATCH)) {
+			connectionInfo.connection->setBatchWindow(m_BatchWindow);
+		}
 	}
 }
 //==============================================================================
@@ -256,18 +1236,26 @@ void ServerApp::authenticatePeer(IdType connectionId,
 	if (auto it = m_Connections.find(connectionId); it != m_Connections.end()) {
 		auto& connectionInfo = it->second;
 
-		if (sessionCode != m_SessionCode) {
+		// A peer joins a single session, once
+		if (connectionInfo.validated) {
+			return;
+		}
+
+		auto requestedSession = m_Sessions.find(sessionCode);
+		if (!requestedSession) {
 			// peer provided bad credentials. Kick them off
 			messageOneClient(
-				m_MessageEncoder.createAuthenticationFailedMsg(), connectionId);
+				[](MessageEncoder& encoder) {
+					return encoder.createAuthenticationFailedMsg();
+				},
+				connectionId);
 
-			connectionInfo.connection->close();
+			closeConnection(connectionInfo);
 		}
 		else {
 			// setup the new peer
+			auto& session = *requestedSession;
 
-			// Add a new laser
-			auto newLaser = std::make_unique<LaserWidget>();
 			auto newColor = generateRandomColor();
 			ColorVectorType color{
 				newColor.redF(), newColor.greenF(), newColor.blueF()};
@@ -278,62 +1266,153 @@ void ServerApp::authenticatePeer(IdType connectionId,
 			connectionInfo.alias = alias;
 			connectionInfo.color = color;
 			connectionInfo.validated = true;
+			connectionInfo.session = &session;
 
-			newLaser->setColor(color[0], color[1], color[2]);
+			// Joins with a new laser
+			session.addPeer(connectionId, color);
 
-			QObject::connect(newLaser.get(), &LaserWidget::propertyUpdated,
-				[this, id = connectionId](const auto& propList) {
-					messageAllClients(m_MessageEncoder.createLaserUpdateMsg(
-						LaserUpdate(propList, id)));
-				});
+			// The new peer holds no transform baselines, so restart its
+			// streams from keyframes
+			session.resetTransformBaselines(connectionInfo.capabilities);
 
 			PeerInfo info{connectionId, alias, color};
 
-			m_ApplicationObjects.lasers.insert(
-				{connectionId, std::move(newLaser)});
-
-			messageOneClient(m_MessageEncoder.createAuthenticationSucceededMsg(info),
+			messageOneClient(
+				[&](MessageEncoder& encoder) {
+					return encoder.createAuthenticationSucceededMsg(info);
+				},
 				connectionId);
 
-			std::vector<PeerInfo> peers;
-			for (const auto& [id, connectionInfo] : m_Connections) {
-				peers.push_back(
-					PeerInfo{ id, connectionInfo.alias, connectionInfo.color });
-			}
-			messageOneClient(m_MessageEncoder.createFullStateMsg(peers,
-				m_ApplicationObjects), connectionId);
+			sendFullState(connectionId, connectionInfo, session);
+
+			offerDatagramChannel(connectionId, connectionInfo);
 
 			// Notify the other peers
-			messageAllClients(m_MessageEncoder.createPeerAddedMsg(info));
+			messageAllClients(session, [&](MessageEncoder& encoder) {
+				return encoder.createPeerAddedMsg(info);
+			});
 		}
 	}
 }
 //==============================================================================
 
 //==============================================================================
-bool ServerApp::removePeer(IdType connectionId)
+void ServerApp::sendFullState(
+	IdType connectionId, const ConnectionInfo& connectionInfo, Session& session)
+{
+	std::vector<PeerInfo> peers;
+	for (const auto& peer : session.peers) {
+		const auto& peerInfo = m_Connections.at(peer.id);
+		peers.push_back(PeerInfo{peer.id, peerInfo.alias, peerInfo.color});
+	}
+
+	if (connectionInfo.capabilities.has(
+			PeerCapabilities::CHUNKED_FULL_STATE)) {
+		// One object at a time, instead of a single message which grows
+		// with the scene and holds up everything behind it
+		const auto format = getFrameFormat(connectionInfo.capabilities);
+
+		getOutputEncoder(connectionInfo.capabilities, &session)
+			.createFullStateChunks(peers, session.sceneState,
+				[&](NetworkMessage&& chunk) {
+					sendToPeer(connectionInfo, EncodedMessage{chunk, format});
+				});
+	}
+	else {
+		messageOneClient(
+			[&](MessageEncoder& encoder) {
+				return encoder.createFullStateMsg(peers, session.sceneState);
+			},
+			connectionId);
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::onSubscriptionReceived(
+	const Subscription& subscription, IdType connectionId)
+{
+	auto it = m_Connections.find(connectionId);
+	if ((it == m_Connections.end()) || !it->second.session) {
+		return;
+	}
+
+	auto& connectionInfo = it->second;
+	auto& session = *connectionInfo.session;
+	const auto& capabilities = connectionInfo.capabilities;
+
+	// Objects the peer skipped so far are brought up to date with chunks
+	if (!capabilities.has(PeerCapabilities::SUBSCRIPTIONS) ||
+		!capabilities.has(PeerCapabilities::CHUNKED_FULL_STATE)) {
+		return;
+	}
+
+	// Whatever is pending was meant for the previous subscription
+	session.updateCoalescer.flush();
+	session.previewCoalescer.flush();
+
+	const auto addedObjects =
+		session.setSubscription(connectionId, subscription);
+
+	// The peer now takes its transforms from other streams, or of objects
+	// it skipped so far, which its baselines do not account for
+	session.resetTransformBaselines(capabilities);
+
+	// One chunk per object, which the peer applies on its own, leaving the
+	// rest of its scene and whatever it is interacting with as it is
+	auto& encoder = session.getEncoder(RateClass::FULL_RATE, capabilities);
+	const auto format = getFrameFormat(capabilities);
+
+	for (const auto& object : addedObjects) {
+		encoder.createFullStateChunk(session.sceneState, object.type,
+			object.id, [&](NetworkMessage&& chunk) {
+				sendToPeer(connectionInfo, EncodedMessage{chunk, format});
+			});
+	}
+}
+//==============================================================================
+
+//==============================================================================
+void ServerApp::removePeer(IdType connectionId)
 {
 	std::cout << "Removing peer connection with id = " << connectionId
 			  << std::endl;
 
-	m_ApplicationObjects.lasers.erase(connectionId);
+	m_MessageEncoder.removeSender(connectionId);
+	m_DatagramEncoder.removeSender(connectionId);
+
+	auto it = m_Connections.find(connectionId);
+	if (it == m_Connections.end()) {
+		return;
+	}
+
+	auto& connectionInfo = it->second;
 
-	// Make sure to release any lingering object ownership
-	if (m_VolumeOwner.has_value() && (m_VolumeOwner.value() == connectionId)) {
-		m_VolumeOwner = std::nullopt;
+	if (connectionInfo.datagramToken) {
+		const auto token = connectionInfo.datagramToken.value();
+		m_DatagramChannel->removeEndpoint(token);
+		m_DatagramEndpoints.erase(token);
 	}
 
-	if (m_PlaneOwner.has_value() && (m_PlaneOwner.value() == connectionId)) {
-		m_PlaneOwner = std::nullopt;
+	if (!connectionInfo.connection) {
+		// Closing is a no-op if the peer already disconnected
+		closeConnection(connectionInfo);
+		m_EpollConnections.erase(connectionInfo.epollConnectionId);
 	}
 
-	for (auto& [widgetId, widgetOwner] : m_WidgetOwnershipMap) {
-		if (widgetOwner.has_value() && (widgetOwner.value() == connectionId)) {
-			widgetOwner = std::nullopt;
-		}
+	auto session = connectionInfo.session;
+	m_Connections.erase(it);
+
+	if (!session) {
+		return;
 	}
 
-	return (m_Connections.erase(connectionId) > 0);
+	// Drops its laser and releases any lingering object ownership
+	session->removePeer(connectionId);
+
+	messageAllClients(*session, [&](MessageEncoder& encoder) {
+		return encoder.createPeerRemovedMsg(PeerInfo{connectionId});
+	});
 }
 //==============================================================================
 
@@ -341,9 +1420,10 @@ bool ServerApp::removePeer(IdType connectionId)
 void ServerApp::onLaserUpdated(
 	const LaserUpdate& laserUpdate, IdType connectionId)
 {
-	if (auto it = m_ApplicationObjects.lasers.find(connectionId);
-		it != m_ApplicationObjects.lasers.end()) {
-		it->second->updateProperties(laserUpdate.propList);
+	if (auto session = getSession(connectionId)) {
+		broadcastUpdates(*session,
+			session->sceneState.updateLaser(
+				connectionId, laserUpdate.propList));
 	}
 }
 //==============================================================================
@@ -352,34 +1432,44 @@ void ServerApp::onLaserUpdated(
 void ServerApp::onVolumeUpdated(
 	const VolumeUpdate& volumeUpdate, IdType connectionId)
 {
+	auto session = getSession(connectionId);
+	if (!session) {
+		return;
+	}
+
 	switch (volumeUpdate.msgType) {
 		case VolumeUpdate::MessageType::INTERACTION_ENDED: {
-			if (m_VolumeOwner.has_value() &&
-				(m_VolumeOwner.value() == connectionId)) {
-				m_VolumeOwner = std::nullopt;
-
-				messageAllClients(m_MessageEncoder.createVolumeUpdateMsg(
-					VolumeUpdate(VolumeUpdate::MessageType::INTERACTION_ENDED,
-						{}, connectionId)));
+			if (session->volumeOwner.has_value() &&
+				(session->volumeOwner.value() == connectionId)) {
+				session->volumeOwner = std::nullopt;
+
+				messageAllClients(*session, [&](MessageEncoder& encoder) {
+					return encoder.createVolumeUpdateMsg(VolumeUpdate(
+						VolumeUpdate::MessageType::INTERACTION_ENDED, {},
+						connectionId));
+				});
 			}
 			break;
 		}
 		case VolumeUpdate::MessageType::PROPERTY_UPDATE: {
-			if (m_VolumeOwner.has_value()) {
-				if (m_VolumeOwner.value() == connectionId) {
-					m_ApplicationObjects.volume->updateProperties(
-						volumeUpdate.propList);
+			if (session->volumeOwner.has_value()) {
+				if (session->volumeOwner.value() == connectionId) {
+					broadcastUpdates(*session,
+						session->sceneState.updateVolume(
+							volumeUpdate.propList));
 				}
 			}
 			else {	// volume has a new owner
-				m_VolumeOwner = connectionId;
+				session->volumeOwner = connectionId;
 
-				messageAllClients(m_MessageEncoder.createVolumeUpdateMsg(
-					VolumeUpdate(VolumeUpdate::MessageType::INTERACTION_STARTED,
-						{}, connectionId)));
+				messageAllClients(*session, [&](MessageEncoder& encoder) {
+					return encoder.createVolumeUpdateMsg(VolumeUpdate(
+						VolumeUpdate::MessageType::INTERACTION_STARTED, {},
+						connectionId));
+				});
 
-				m_ApplicationObjects.volume->updateProperties(
-					volumeUpdate.propList);
+				broadcastUpdates(*session,
+					session->sceneState.updateVolume(volumeUpdate.propList));
 			}
 			break;
 		}
@@ -391,68 +1481,76 @@ void ServerApp::onVolumeUpdated(
 void ServerApp::onWidgetUpdated(
 	const WidgetUpdate& widgetUpdate, IdType connectionId)
 {
-	switch (widgetUpdate.msgType) {
-		case WidgetUpdate::MessageType::CREATE: {
-			auto widgetId = m_NextAvailableWidgetId++;
-
-			auto newWidget = std::make_unique<SplineWidget>();
-			newWidget->attach(m_ApplicationObjects.volume.get());
+	auto session = getSession(connectionId);
+	if (!session) {
+		return;
+	}
 
-			QObject::connect(newWidget.get(), &SplineWidget::propertyUpdated,
-				[this, id = widgetId](const auto& propList) {
-					messageAllClients(m_MessageEncoder.createWidgetUpdateMsg(
-						WidgetUpdate(WidgetUpdate::MessageType::PROPERTY_UPDATE,
-							id, propList)));
-				});
+	auto& widgetOwnershipMap = session->widgetOwnershipMap;
 
-			// Immediately grant property request changes
-			QObject::connect(newWidget.get(),
-				&SplineWidget::requestPropertyUpdate, newWidget.get(),
-				&SplineWidget::updateProperties);
+	switch (widgetUpdate.msgType) {
+		case WidgetUpdate::MessageType::CREATE: {
+			auto widgetId = session->nextAvailableWidgetId++;
 
-			m_ApplicationObjects.widgets.insert(
-				{widgetId, std::move(newWidget)});
+			// Attached to the volume, which it follows from here on
+			session->sceneState.addWidget(widgetId);
+			if (session->journal) {
+				session->journal->recordWidgetCreated(widgetId);
+			}
 
-			m_WidgetOwnershipMap.insert({widgetId, connectionId});
+			widgetOwnershipMap.insert({widgetId, connectionId});
 
-			messageAllClients(m_MessageEncoder.createWidgetUpdateMsg(WidgetUpdate(
-				widgetUpdate.msgType, widgetId, {}, connectionId)));
+			messageAllClients(*session, [&](MessageEncoder& encoder) {
+				return encoder.createWidgetUpdateMsg(WidgetUpdate(
+					widgetUpdate.msgType, widgetId, {}, connectionId));
+			});
 
 			break;
 		}
 		case WidgetUpdate::MessageType::DESTROY: {
-			m_WidgetOwnershipMap.erase(widgetUpdate.widgetId);
-			if (m_ApplicationObjects.widgets.erase(
-					widgetUpdate.widgetId) > 0) {
-				messageAllClients(
-					m_MessageEncoder.createWidgetUpdateMsg(widgetUpdate));
+			widgetOwnershipMap.erase(widgetUpdate.widgetId);
+			session->updateCoalescer.discard(
+				ObjectType::WIDGET, widgetUpdate.widgetId);
+			session->previewCoalescer.discard(
+				ObjectType::WIDGET, widgetUpdate.widgetId);
+			if (session->sceneState.removeWidget(widgetUpdate.widgetId)) {
+				if (session->journal) {
+					session->journal->recordWidgetDestroyed(
+						widgetUpdate.widgetId);
+				}
+
+				messageAllClients(*session, [&](MessageEncoder& encoder) {
+					return encoder.createWidgetUpdateMsg(widgetUpdate);
+				});
 			}
 
 			break;
 		}
 		case WidgetUpdate::MessageType::PROPERTY_UPDATE: {
-			auto& widgets = m_ApplicationObjects.widgets;
-			if (auto it = widgets.find(widgetUpdate.widgetId);
-				it != widgets.end()) {
-				if (m_WidgetOwnershipMap.at(widgetUpdate.widgetId)
+			if (session->sceneState.findWidget(widgetUpdate.widgetId)) {
+				if (widgetOwnershipMap.at(widgetUpdate.widgetId)
 						.has_value()) {
-					if (m_WidgetOwnershipMap.at(widgetUpdate.widgetId)
+					if (widgetOwnershipMap.at(widgetUpdate.widgetId)
 							.value() == connectionId) {
-						it->second->updateProperties(widgetUpdate.propList);
+						broadcastUpdates(*session,
+							session->sceneState.updateWidget(
+								widgetUpdate.widgetId, widgetUpdate.propList));
 					}
 				}
 				else {	// widget has a new owner
-					m_WidgetOwnershipMap.at(widgetUpdate.widgetId) =
+					widgetOwnershipMap.at(widgetUpdate.widgetId) =
 						connectionId;
-					it->second->updateProperties(widgetUpdate.propList);
+					broadcastUpdates(*session,
+						session->sceneState.updateWidget(
+							widgetUpdate.widgetId, widgetUpdate.propList));
 				}
 			}
 
 			break;
 		}
 		case WidgetUpdate::MessageType::INTERACTION_ENDED: {
-			if (auto it = m_WidgetOwnershipMap.find(widgetUpdate.widgetId);
-				it != m_WidgetOwnershipMap.end()) {
+			if (auto it = widgetOwnershipMap.find(widgetUpdate.widgetId);
+				it != widgetOwnershipMap.end()) {
 				if (it->second.has_value() &&
 					(it->second.value() == connectionId)) {
 					it->second = std::nullopt;
@@ -469,26 +1567,31 @@ void ServerApp::onWidgetUpdated(
 void ServerApp::onPlaneUpdated(
 	const PlaneUpdate& planeUpdate, IdType connectionId)
 {
+	auto session = getSession(connectionId);
+	if (!session) {
+		return;
+	}
+
 	switch (planeUpdate.msgType) {
 		case PlaneUpdate::MessageType::INTERACTION_ENDED: {
-			if (m_PlaneOwner.has_value() &&
-				(m_PlaneOwner.value() == connectionId)) {
-				m_PlaneOwner = std::nullopt;
+			if (session->planeOwner.has_value() &&
+				(session->planeOwner.value() == connectionId)) {
+				session->planeOwner = std::nullopt;
 			}
 			break;
 		}
 		case PlaneUpdate::MessageType::PROPERTY_UPDATE: {
-			if (m_PlaneOwner.has_value()) {
-				if (m_PlaneOwner.value() == connectionId) {
-					m_ApplicationObjects.cutplane->updateProperties(
-						planeUpdate.propList);
+			if (session->planeOwner.has_value()) {
+				if (session->planeOwner.value() == connectionId) {
+					broadcastUpdates(*session,
+						session->sceneState.updatePlane(planeUpdate.propList));
 				}
 			}
 			else {	// plane widget has a new owner
-				m_PlaneOwner = connectionId;
+				session->planeOwner = connectionId;
 
-				m_ApplicationObjects.cutplane->updateProperties(
-					planeUpdate.propList);
+				broadcastUpdates(*session,
+					session->sceneState.updatePlane(planeUpdate.propList));
 			}
 			break;
 		}
@@ -80,6 +80,16 @@ public:
 
 	NodeListType getNodes() const;
 
+	// In geometry-lazy mode a node change only updates the node list. The
+	// spline points, node actors and curve catch up once the widget is about
+	// to be rendered or the curve is queried, so a burst of node updates
+	// between two frames rebuilds the geometry once. Off by default
+	void setGeometryLazy(bool);
+	bool isGeometryLazy() const;
+
+	// Polyline through the nodes, or null while there are none
+	vtkPolyData* getCurve();
+
 public slots:
 	virtual void updateProperties(const PropertyListType&) override;
 
@@ -98,6 +108,8 @@ protected:
 	void onKeyPressEvent();
 	void changeInteractionState(InteractionState newState);
 	void setTransformInternal(const TransformType&);
+	void onNodesModified();
+	void updateGeometry();
 
 	vtkSmartPointer<Interactor> m_Interactor;
 	vtkSmartPointer<vtkGeneralizedCallbackCommand> m_CallbackCommand;
@@ -115,6 +127,9 @@ protected:
 	TransformType m_AssemblyTransform; // convenience so we don't always have
 	// to query the actual vtk object and perform conversions
 	QMetaObject::Connection m_AttachmentConnection;
+	NodeListType m_Nodes; // relative to m_AssemblyTransform
+	bool m_GeometryLazy;
+	bool m_GeometryModified; // m_Nodes not yet applied to the VTK objects
 
 private:
 	friend class cereal::access;
@@ -16,6 +16,7 @@ public:
 	using VariantType = common::VariantType;
 	using PropertyVariantType = common::PropertyVariantType;
 	using PropertyListType = common::PropertyListType;
+	using PropertyId = common::PropertyId;
 	using TransformType = common::TransformType;
 
 	virtual void setInteractor(Interactor*) = 0;
@@ -67,22 +67,29 @@ void LaserWidget::updateProperties(const PropertyListType& propList)
 	PropertyListType updatedProps;
 
 	for (const auto& elem : propList) {
-		auto& [propName, propValue] = elem;
-		
-		if (propName == "color") {
-			const auto& colorVec = std::get<ColorVectorType>(propValue);
-			setColor(colorVec);
-			updatedProps.push_back({ propName, getColor() });
-		}
-		else if (propName == "base") {
-			const auto& base = std::get<PointType>(propValue);
-			updateBaseInternal(base);
-			updatedProps.push_back({ propName, getBase() });
-		}
-		else if (propName == "tip") {
-			const auto& tip = std::get<PointType>(propValue);
-			updateTipInternal(tip);
-			updatedProps.push_back({ propName, getTip() });
+		auto& [propKey, propValue] = elem;
+
+		switch (propKey.getId()) {
+			case PropertyId::COLOR: {
+				const auto& colorVec = std::get<ColorVectorType>(propValue);
+				setColor(colorVec);
+				updatedProps.push_back({ propKey, getColor() });
+				break;
+			}
+			case PropertyId::BASE: {
+				const auto& base = std::get<PointType>(propValue);
+				updateBaseInternal(base);
+				updatedProps.push_back({ propKey, getBase() });
+				break;
+			}
+			case PropertyId::TIP: {
+				const auto& tip = std::get<PointType>(propValue);
+				updateTipInternal(tip);
+				updatedProps.push_back({ propKey, getTip() });
+				break;
+			}
+			default:
+				break;
 		}
 	}
 
@@ -235,7 +242,7 @@ void LaserWidget::setBase(double x, double y, double z)
 //=============================================================================
 void LaserWidget::setBase(const PointType& point)
 {
-	emit requestPropertyUpdate({ {"base", point} });
+	emit requestPropertyUpdate({ {PropertyId::BASE, point} });
 }
 //=============================================================================
 
@@ -257,7 +264,7 @@ void LaserWidget::setTip(double x, double y, double z)
 //=============================================================================
 void LaserWidget::setTip(const PointType& point)
 {
-	emit requestPropertyUpdate({ {"tip", point} });
+	emit requestPropertyUpdate({ {PropertyId::TIP, point} });
 }
 //=============================================================================
 
@@ -359,8 +366,9 @@ void LaserWidget::processEvents(unsigned long eventId)
 			m_Interactor->GetInteractionRayLength() *
 			currentDevicePose.linear().col(2);
 
-		emit requestPropertyUpdate({ {"base", currentDevicePose.translation()},
-			{"tip", rayTip } });
+		emit requestPropertyUpdate(
+			{ {PropertyId::BASE, currentDevicePose.translation()},
+				{PropertyId::TIP, rayTip } });
 
 			break;
 		}
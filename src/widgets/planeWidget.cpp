@@ -123,12 +123,12 @@ void PlaneWidget::updateProperties(const PropertyListType& propList)
 	PropertyListType updatedProps;
 
 	for (const auto& elem : propList) {
-		auto& [propName, propValue] = elem;
-		if (propName == "transform") {
+		auto& [propKey, propValue] = elem;
+		if (propKey.getId() == PropertyId::TRANSFORM) {
 			const auto& transform = std::get<TransformType>(propValue);
 
 			setTransformInternal(transform);
-			updatedProps.push_back({propName, propValue});
+			updatedProps.push_back({propKey, propValue});
 		}
 	}
 
@@ -175,7 +175,7 @@ auto PlaneWidget::getInteractor() const -> Interactor*
 //=============================================================================
 void PlaneWidget::setTransform(const TransformType& transform)
 {
-	emit requestPropertyUpdate({{"transform", transform}});
+	emit requestPropertyUpdate({{PropertyId::TRANSFORM, transform}});
 }
 //=============================================================================
 
@@ -339,7 +339,7 @@ void PlaneWidget::onMoveEvent()
 		}
 		case InteractionState::ACTIVE: {
 			common::TransformType xForm = currentDevicePose * m_TempTransform;
-			emit requestPropertyUpdate({{"transform", xForm}});
+			emit requestPropertyUpdate({{PropertyId::TRANSFORM, xForm}});
 
 			break;
 		}
@@ -74,7 +74,9 @@ SplineWidget::SplineWidget() :
 	m_ParametricFunction{vtkSmartPointer<vtkParametricFunctionSource>::New()},
 	m_ActiveNode{0},
 	m_CachedTransform{TransformType::Identity()},
-	m_AssemblyTransform{TransformType::Identity()}
+	m_AssemblyTransform{TransformType::Identity()},
+	m_GeometryLazy{false},
+	m_GeometryModified{false}
 {
 	m_CallbackCommand->setCallback(
 		[this](vtkObject* caller, unsigned long eventId,
@@ -120,40 +122,50 @@ void SplineWidget::updateProperties(const PropertyListType& propertyList)
 	PropertyListType updatedProps;
 
 	for (const auto& elem : propertyList) {
-		auto& [propName, propValue] = elem;
-		if (propName == "nodePosition") {
-			const auto& indexValPair =
-				std::get<std::vector<VariantType>>(propValue);
-			auto index = std::get<std::uint16_t>(indexValPair[0]);
-			const auto& position =
-				std::get<common::Point3dType>(indexValPair[1]);
-			updateNodePositionInternal(index, position);
-
-			if (auto nodePosition = getNodePosition(index)) {
-				updatedProps.push_back({"nodePosition",
-					std::vector<VariantType>{
-						static_cast<uint16_t>(index), nodePosition.value()}});
+		auto& [propKey, propValue] = elem;
+
+		switch (propKey.getId()) {
+			case PropertyId::NODE_POSITION: {
+				const auto& indexValPair =
+					std::get<std::vector<VariantType>>(propValue);
+				auto index = std::get<std::uint16_t>(indexValPair[0]);
+				const auto& position =
+					std::get<common::Point3dType>(indexValPair[1]);
+				updateNodePositionInternal(index, position);
+
+				if (auto nodePosition = getNodePosition(index)) {
+					updatedProps.push_back({PropertyId::NODE_POSITION,
+						std::vector<VariantType>{static_cast<uint16_t>(index),
+							nodePosition.value()}});
+				}
+				break;
 			}
-		}
-		else if (propName == "nodes") {
-			const auto& nodeVector =
-				std::get<std::vector<VariantType>>(propValue);
-			NodeListType newNodeList;
-			std::transform(nodeVector.begin(), nodeVector.end(),
-				std::back_inserter(newNodeList),
-				[](auto&& elem) { return std::get<NodePositionType>(elem); });
-			initializeFromNodes(newNodeList);
-
-			const auto& nodes = getNodes();
-			std::vector<VariantType> variantNodes;
-			std::copy(
-				nodes.begin(), nodes.end(), std::back_inserter(variantNodes));
-			updatedProps.push_back({propName, variantNodes});
-		}
-		else if (propName == "transform") {
-			const auto& transform = std::get<TransformType>(propValue);
-			setTransformInternal(transform);
-			updatedProps.push_back({propName, transform});
+			case PropertyId::NODES: {
+				const auto& nodeVector =
+					std::get<std::vector<VariantType>>(propValue);
+				NodeListType newNodeList;
+				std::transform(nodeVector.begin(), nodeVector.end(),
+					std::back_inserter(newNodeList),
+					[](auto&& elem) {
+						return std::get<NodePositionType>(elem);
+					});
+				initializeFromNodes(newNodeList);
+
+				const auto& nodes = getNodes();
+				std::vector<VariantType> variantNodes;
+				std::copy(nodes.begin(), nodes.end(),
+					std::back_inserter(variantNodes));
+				updatedProps.push_back({propKey, variantNodes});
+				break;
+			}
+			case PropertyId::TRANSFORM: {
+				const auto& transform = std::get<TransformType>(propValue);
+				setTransformInternal(transform);
+				updatedProps.push_back({propKey, transform});
+				break;
+			}
+			default:
+				break;
 		}
 	}
 
@@ -175,6 +187,7 @@ void SplineWidget::setInteractor(Interactor* iren)
 								->GetRenderers()
 								->GetFirstRenderer()) {
 			renderer->RemoveViewProp(m_PropAssembly);
+			renderer->RemoveObserver(m_CallbackCommand);
 		}
 	}
 
@@ -186,6 +199,9 @@ void SplineWidget::setInteractor(Interactor* iren)
 								->GetRenderers()
 								->GetFirstRenderer()) {
 			renderer->AddViewProp(m_PropAssembly);
+
+			// Lazy geometry is brought up to date before every render
+			renderer->AddObserver(vtkCommand::StartEvent, m_CallbackCommand);
 		}
 	}
 }
@@ -201,7 +217,7 @@ Interactor* SplineWidget::getInteractor() const
 //=============================================================================
 void SplineWidget::setTransform(const TransformType& transform)
 {
-	emit requestPropertyUpdate({{"transform", transform}});
+	emit requestPropertyUpdate({{PropertyId::TRANSFORM, transform}});
 }
 //=============================================================================
 
@@ -366,7 +382,7 @@ void SplineWidget::setNodePosition(NodeIdType id, double x, double y, double z)
 void SplineWidget::setNodePosition(
 	NodeIdType nodeId, const NodePositionType& nodePosition)
 {
-	emit requestPropertyUpdate({{"nodePosition",
+	emit requestPropertyUpdate({{PropertyId::NODE_POSITION,
 		std::vector<VariantType>{
 			static_cast<uint16_t>(nodeId), nodePosition}}});
 }
@@ -376,19 +392,14 @@ void SplineWidget::setNodePosition(
 void SplineWidget::updateNodePositionInternal(
 	NodeIdType nodeId, const NodePositionType& nodePosition)
 {
-	if ((nodeId < 0) || (nodeId >= m_NodeActors.size())) {
+	if ((nodeId < 0) || (nodeId >= m_Nodes.size())) {
 		std::cerr << "Node index: " << nodeId << " is out of range"
 				  << std::endl;
 		return;
 	}
 
-	auto transformedPosition = m_AssemblyTransform.inverse() * nodePosition;
-
-	m_Spline->GetPoints()->SetPoint(nodeId, transformedPosition[0],
-		transformedPosition[1], transformedPosition[2]);
-	m_Spline->Modified();
-	m_NodeActors[nodeId]->SetPosition(
-		transformedPosition[0], transformedPosition[1], transformedPosition[2]);
+	m_Nodes[nodeId] = m_AssemblyTransform.inverse() * nodePosition;
+	onNodesModified();
 }
 //=============================================================================
 
@@ -403,7 +414,7 @@ void SplineWidget::addNode(const NodePositionType& node)
 
 	variantNodes.push_back(node);
 
-	emit requestPropertyUpdate({{"nodes", variantNodes}});
+	emit requestPropertyUpdate({{PropertyId::NODES, variantNodes}});
 }
 //=============================================================================
 
@@ -417,7 +428,7 @@ void SplineWidget::addNode(double x, double y, double z)
 //=============================================================================
 void SplineWidget::removeNode(NodeIdType nodeId)
 {
-	if ((nodeId < 0) || (nodeId >= m_NodeActors.size())) {
+	if ((nodeId < 0) || (nodeId >= m_Nodes.size())) {
 		std::cerr << "Node index: " << nodeId << " is out of range"
 				  << std::endl;
 		return;
@@ -430,7 +441,7 @@ void SplineWidget::removeNode(NodeIdType nodeId)
 	std::copy(
 		nodeList.begin(), nodeList.end(), std::back_inserter(variantNodes));
 
-	emit requestPropertyUpdate({{"nodes", variantNodes}});
+	emit requestPropertyUpdate({{PropertyId::NODES, variantNodes}});
 }
 //=============================================================================
 
@@ -438,13 +449,8 @@ void SplineWidget::removeNode(NodeIdType nodeId)
 auto SplineWidget::getNodePosition(NodeIdType nodeId) const
 	-> std::optional<NodePositionType>
 {
-	if (nodeId >= 0 && nodeId < m_NodeActors.size()) {
-		double p[3];
-		m_NodeActors[nodeId]->GetPosition(p);
-
-		Eigen::Map<NodePositionType> m(p);
-
-		return NodePositionType{m_AssemblyTransform * m};
+	if (nodeId >= 0 && nodeId < m_Nodes.size()) {
+		return NodePositionType{m_AssemblyTransform * m_Nodes[nodeId]};
 	}
 	else {
 		return std::nullopt;
@@ -460,53 +466,117 @@ void SplineWidget::initializeFromNodes(const NodeListType& nodes)
 		return;
 	}
 
-	NodeListType transformedNodes;
-	std::transform(nodes.begin(), nodes.end(),
-		std::back_inserter(transformedNodes), [this](const auto& node) {
+	m_Nodes.clear();
+	std::transform(nodes.begin(), nodes.end(), std::back_inserter(m_Nodes),
+		[this](const auto& node) {
 			return m_AssemblyTransform.inverse() * node;
 		});
 
-	vtkNew<vtkPoints> newNodes;
-	for (const auto& node : transformedNodes) {
-		newNodes->InsertNextPoint(node[0], node[1], node[2]);
+	onNodesModified();
+}
+//=============================================================================
+
+//=============================================================================
+void SplineWidget::onNodesModified()
+{
+	m_GeometryModified = true;
+
+	if (!m_GeometryLazy) {
+		updateGeometry();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+void SplineWidget::updateGeometry()
+{
+	if (!m_GeometryModified) {
+		return;
+	}
+
+	m_GeometryModified = false;
+
+	const auto nodeCount = static_cast<vtkIdType>(m_Nodes.size());
+
+	auto points = m_Spline->GetPoints();
+	if (points->GetNumberOfPoints() != nodeCount) {
+		vtkNew<vtkPoints> newPoints;
+		newPoints->SetNumberOfPoints(nodeCount);
+		m_Spline->SetPoints(newPoints);
+		points = newPoints;
 	}
 
-	m_Spline->SetPoints(newNodes);
+	for (vtkIdType i = 0; i < nodeCount; i++) {
+		points->SetPoint(i, m_Nodes[i].data());
+	}
+
+	points->Modified();
 	m_Spline->Modified();
 
 	// If there are zero input connections it means this is the first time
 	// we're initializing the nodes, and we need to set the mapper input
 	// from the spline function output (doing so before there are any spline
 	// nodes triggers a VTK error)
-	if (m_LineActor->GetMapper()->GetNumberOfInputConnections(0) == 0) {
+	if ((nodeCount > 0) &&
+		(m_LineActor->GetMapper()->GetNumberOfInputConnections(0) == 0)) {
 		m_LineActor->GetMapper()->SetInputConnection(
 			m_ParametricFunction->GetOutputPort());
 	}
 
-	if (m_NodeActors.size() < transformedNodes.size()) {
-		for (auto it = transformedNodes.begin() + m_NodeActors.size();
-			 it != transformedNodes.end(); it++) {
-			m_NodeActors.push_back(createNodeActor());
-			m_PropAssembly->AddPart(m_NodeActors.back());
-		}
+	while (m_NodeActors.size() < m_Nodes.size()) {
+		m_NodeActors.push_back(createNodeActor());
+		m_PropAssembly->AddPart(m_NodeActors.back());
 	}
-	else if (m_NodeActors.size() > transformedNodes.size()) {
-		for (auto it = m_NodeActors.begin() + transformedNodes.size();
+
+	if (m_NodeActors.size() > m_Nodes.size()) {
+		for (auto it = m_NodeActors.begin() + m_Nodes.size();
 			it != m_NodeActors.end(); it++) {
 			m_PropAssembly->RemovePart(*it);
 		}
 
-		m_NodeActors.erase(m_NodeActors.begin() + transformedNodes.size(),
-			m_NodeActors.end());
+		m_NodeActors.erase(
+			m_NodeActors.begin() + m_Nodes.size(), m_NodeActors.end());
 	}
 
-	for (unsigned int i = 0; i < transformedNodes.size(); i++) {
-		m_NodeActors[i]->SetPosition(transformedNodes[i][0],
-			transformedNodes[i][1], transformedNodes[i][2]);
+	for (unsigned int i = 0; i < m_Nodes.size(); i++) {
+		m_NodeActors[i]->SetPosition(
+			m_Nodes[i][0], m_Nodes[i][1], m_Nodes[i][2]);
 	}
 }
 //=============================================================================
 
+//=============================================================================
+void SplineWidget::setGeometryLazy(bool lazy)
+{
+	m_GeometryLazy = lazy;
+
+	if (!m_GeometryLazy) {
+		updateGeometry();
+	}
+}
+//=============================================================================
+
+//=============================================================================
+bool SplineWidget::isGeometryLazy() const
+{
+	return m_GeometryLazy;
+}
+//=============================================================================
+
+//=============================================================================
+vtkPolyData* SplineWidget::getCurve()
+{
+	if (m_Nodes.empty()) {
+		return nullptr;
+	}
+
+	updateGeometry();
+	m_ParametricFunction->Update();
+
+	return m_ParametricFunction->GetOutput();
+}
+//=============================================================================
+
 //=============================================================================
 auto SplineWidget::getNodeIndex(vtkProp* prop) -> std::optional<NodeIdType>
 {
@@ -525,14 +595,11 @@ auto SplineWidget::getNodeIndex(vtkProp* prop) -> std::optional<NodeIdType>
 //=============================================================================
 auto SplineWidget::getNodes() const -> NodeListType
 {
-	auto pts = m_Spline->GetPoints();
 	NodeListType nodes;
-	for (vtkIdType i = 0; i < pts->GetNumberOfPoints(); i++) {
-		double pt[3];
-		pts->GetPoint(i, pt);
-		Eigen::Map<NodePositionType> m(pt);
-		nodes.push_back(NodePositionType{m_AssemblyTransform * m});
-	}
+	std::transform(m_Nodes.begin(), m_Nodes.end(), std::back_inserter(nodes),
+		[this](const auto& node) {
+			return NodePositionType{m_AssemblyTransform * node};
+		});
 
 	return nodes;
 }
@@ -558,6 +625,10 @@ void SplineWidget::processEvents(unsigned long eventId)
 			onKeyPressEvent();
 			break;
 		}
+		case vtkCommand::StartEvent: {	// the renderer is about to render
+			updateGeometry();
+			break;
+		}
 	}  // end switch
 }
 //=============================================================================
@@ -575,13 +646,13 @@ void SplineWidget::onMoveEvent()
 
 	switch (m_InteractionState) {
 		case InteractionState::DEFINING: {
-			if (m_NodeActors.empty()) {
+			if (m_Nodes.empty()) {
 				return;
 			}
 
-			auto activeNode = m_NodeActors.size() - 1;
+			auto activeNode = m_Nodes.size() - 1;
 
-			emit requestPropertyUpdate({{"nodePosition",
+			emit requestPropertyUpdate({{PropertyId::NODE_POSITION,
 				std::vector<VariantType>{static_cast<uint16_t>(activeNode),
 					NodePositionType{rayTip[0], rayTip[1], rayTip[2]}}}});
 
@@ -592,6 +663,9 @@ void SplineWidget::onMoveEvent()
 		case InteractionState::INTERSECTING: {
 			bool nodePicked{false};
 
+			// Picking needs the node actors where the nodes are
+			updateGeometry();
+
 			if (m_NodePicker->Pick3DPoint(rayBase.data(), rayTip.data(),
 					m_Interactor->GetRenderWindow()
 						->GetRenderers()
@@ -640,7 +714,7 @@ void SplineWidget::onMoveEvent()
 
 			auto newNodePosition = currentDevicePose * m_ActiveNodeDeviceCoords;
 
-			emit requestPropertyUpdate({{"nodePosition",
+			emit requestPropertyUpdate({{PropertyId::NODE_POSITION,
 				std::vector<VariantType>{
 					static_cast<uint16_t>(m_ActiveNode), newNodePosition}}});
 
@@ -704,7 +778,7 @@ void SplineWidget::onKeyPressEvent()
 				std::copy(nodeList.begin(), nodeList.end() - 1,
 					std::back_inserter(variantNodes));
 
-				emit requestPropertyUpdate({{"nodes", variantNodes}});
+				emit requestPropertyUpdate({{PropertyId::NODES, variantNodes}});
 				changeInteractionState(InteractionState::INACTIVE);
 			}
 			break;
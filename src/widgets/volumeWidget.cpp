@@ -98,12 +98,12 @@ void VolumeWidget::updateProperties(const PropertyListType& propList)
 	PropertyListType updatedProps;
 
 	for (const auto& elem : propList) {
-		auto& [propName, propValue] = elem;
-		if (propName == "transform"){
+		auto& [propKey, propValue] = elem;
+		if (propKey.getId() == PropertyId::TRANSFORM){
 			const auto& transform = std::get<common::TransformType>(propValue);
 
 			setTransformInternal(transform);
-			updatedProps.push_back({ propName, propValue });
+			updatedProps.push_back({ propKey, propValue });
 		}
 	}
 
@@ -150,7 +150,7 @@ Interactor* VolumeWidget::getInteractor() const
 //=============================================================================
 void VolumeWidget::setTransform(const TransformType& transform)
 {
-	emit requestPropertyUpdate({{"transform", transform}});
+	emit requestPropertyUpdate({{PropertyId::TRANSFORM, transform}});
 }
 //=============================================================================
 
@@ -374,7 +374,7 @@ void VolumeWidget::onMoveEvent()
 		}
 		case InteractionState::ACTIVE: {
 			common::TransformType xForm = currentDevicePose * m_TempTransform;
-			emit requestPropertyUpdate({ {"transform", xForm} });
+			emit requestPropertyUpdate({ {PropertyId::TRANSFORM, xForm} });
 
 			break;
 		}
@@ -0,0 +1,162 @@
+#include "networking/connection.h"
+#include "networking/connectionOptions.h"
+#include "networking/networkMessage.h"
+#include "networking/tcpServer.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int messageCount = 500;
+constexpr int sendIntervalMilliseconds = 2;
+constexpr int timeoutMilliseconds = 60000;
+
+using ClockType = std::chrono::steady_clock;
+
+//=============================================================================
+// Sends small timestamped updates from a client to a local server at a
+// steady rate, as a tracked device would, and returns the one-way latency
+// of every message in microseconds, sorted
+std::vector<double> measureLatency(const ConnectionOptions& options)
+{
+	TcpServer server;
+	if (!server.listen(QHostAddress::LocalHost)) {
+		ADD_FAILURE() << "Could not listen on the loopback interface";
+		return {};
+	}
+
+	QEventLoop eventLoop;
+	QTimer::singleShot(timeoutMilliseconds, &eventLoop, &QEventLoop::quit);
+
+	std::unique_ptr<Connection> serverConnection;
+	std::vector<double> latencies;
+	latencies.reserve(messageCount);
+
+	QObject::connect(&server, &TcpServer::newConnection, &eventLoop,
+		[&](qintptr socketDescriptor) {
+			serverConnection = std::make_unique<Connection>();
+			serverConnection->setOptions(options);
+
+			QObject::connect(serverConnection.get(),
+				&Connection::messageReceived, &eventLoop,
+				[&](const NetworkMessage& msg) {
+					auto now = ClockType::now().time_since_epoch().count();
+					ClockType::rep sent{};
+					std::memcpy(&sent, msg.data.data(), sizeof(sent));
+
+					std::chrono::duration<double, std::micro> latency =
+						ClockType::duration{now - sent};
+					latencies.push_back(latency.count());
+
+					if (static_cast<int>(latencies.size()) == messageCount) {
+						eventLoop.quit();
+					}
+				});
+
+			serverConnection->connectToClient(socketDescriptor);
+			eventLoop.quit();
+		});
+
+	Connection client;
+	client.setOptions(options);
+	client.connectToServer(QHostAddress::LocalHost, server.serverPort());
+
+	// Only measure the traffic, not the connection setup
+	eventLoop.exec();
+	EXPECT_TRUE(serverConnection);
+
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	msg.data.resize(64);
+	msg.size = msg.data.size();
+
+	int messagesSent{0};
+	QTimer sendTimer;
+	sendTimer.setTimerType(Qt::PreciseTimer);
+	QObject::connect(&sendTimer, &QTimer::timeout, &eventLoop, [&]() {
+		auto now = ClockType::now().time_since_epoch().count();
+		std::memcpy(msg.data.data(), &now, sizeof(now));
+		client.sendMessage(msg);
+
+		if (++messagesSent == messageCount) {
+			sendTimer.stop();
+		}
+	});
+	sendTimer.start(sendIntervalMilliseconds);
+
+	eventLoop.exec();
+	EXPECT_EQ(static_cast<int>(latencies.size()), messageCount);
+
+	std::sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+//=============================================================================
+
+//=============================================================================
+double getPercentile(const std::vector<double>& sortedValues, double percent)
+{
+	if (sortedValues.empty()) {
+		return 0.0;
+	}
+
+	auto index = static_cast<std::size_t>(
+		percent / 100.0 * static_cast<double>(sortedValues.size() - 1));
+	return sortedValues[index];
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+class ConnectionLatencyBenchmark : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance()) {
+			static int argc{1};
+			static char name[] = "benchmarkConnectionLatency";
+			static char* argv[] = {name, nullptr};
+			static QCoreApplication app(argc, argv);
+		}
+	}
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(ConnectionLatencyBenchmark, LowDelay)
+{
+	for (bool lowDelay : {false, true}) {
+		ConnectionOptions options;
+		options.lowDelay = lowDelay;
+
+		auto latencies = measureLatency(options);
+		std::string name = lowDelay ? "nodelay" : "nagle";
+
+		std::cout << name << ":";
+		for (double percent : {50.0, 90.0, 99.0, 100.0}) {
+			auto value = getPercentile(latencies, percent);
+			auto label = percent < 100.0
+							 ? "p" + std::to_string(static_cast<int>(percent))
+							 : std::string{"max"};
+
+			std::cout << " " << label << " " << value << " us";
+			RecordProperty(
+				"latency_us_" + name + "_" + label, std::to_string(value));
+		}
+		std::cout << std::endl;
+	}
+}
+//=============================================================================
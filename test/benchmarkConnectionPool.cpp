@@ -0,0 +1,214 @@
+#include "networking/connection.h"
+#include "networking/connectionThreadPool.h"
+#include "networking/networkMessage.h"
+#include "networking/payloadPool.h"
+#include "networking/tcpServer.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr int messagesPerPeer = 200;
+constexpr int timeoutMilliseconds = 60000;
+
+// Heap allocations made through operator new by any thread
+std::atomic<std::size_t> allocationCount{0};
+
+struct Delivery
+{
+	double seconds;
+	std::size_t allocations;
+};
+
+//=============================================================================
+// Connects the given number of local peers to a server, has every peer send
+// a burst of small updates and returns the time until the server received
+// all of them, in seconds, along with the heap allocations made meanwhile.
+// Both ends of every link use the given pool, or a thread per connection
+// without one
+Delivery measureDelivery(int peerCount, ConnectionThreadPool* threadPool)
+{
+	TcpServer server;
+	if (!server.listen(QHostAddress::LocalHost)) {
+		ADD_FAILURE() << "Could not listen on the loopback interface";
+		return {0.0, 0};
+	}
+
+	QEventLoop eventLoop;
+	QTimer::singleShot(timeoutMilliseconds, &eventLoop, &QEventLoop::quit);
+
+	std::vector<std::unique_ptr<Connection>> serverConnections;
+	int messagesReceived{0};
+
+	QObject::connect(&server, &TcpServer::newConnection, &eventLoop,
+		[&](qintptr socketDescriptor) {
+			auto connection = std::make_unique<Connection>(threadPool);
+
+			QObject::connect(connection.get(), &Connection::messageReceived,
+				&eventLoop, [&](const NetworkMessage&) {
+					if (++messagesReceived == peerCount * messagesPerPeer) {
+						eventLoop.quit();
+					}
+				});
+
+			connection->connectToClient(socketDescriptor);
+			serverConnections.push_back(std::move(connection));
+
+			if (static_cast<int>(serverConnections.size()) == peerCount) {
+				eventLoop.quit();
+			}
+		});
+
+	std::vector<std::unique_ptr<Connection>> peers;
+	for (int i = 0; i < peerCount; ++i) {
+		peers.push_back(std::make_unique<Connection>(threadPool));
+		peers.back()->connectToServer(
+			QHostAddress::LocalHost, server.serverPort());
+	}
+
+	// Only time the traffic, not the connection setup
+	eventLoop.exec();
+	EXPECT_EQ(static_cast<int>(serverConnections.size()), peerCount);
+
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	msg.data.resize(64);
+	msg.size = msg.data.size();
+
+	const auto allocationsBefore = allocationCount.load();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < messagesPerPeer; ++i) {
+		for (auto& peer : peers) {
+			peer->sendMessage(msg);
+		}
+	}
+
+	eventLoop.exec();
+	auto stop = std::chrono::steady_clock::now();
+	const auto allocations = allocationCount.load() - allocationsBefore;
+
+	EXPECT_EQ(messagesReceived, peerCount * messagesPerPeer);
+
+	std::chrono::duration<double> elapsed = stop - start;
+	return {elapsed.count(), allocations};
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* ptr = std::malloc((size != 0) ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+//=============================================================================
+
+//=============================================================================
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+//=============================================================================
+
+//=============================================================================
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+//=============================================================================
+
+//=============================================================================
+class ConnectionPoolBenchmark : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance()) {
+			static int argc{1};
+			static char name[] = "benchmarkConnectionPool";
+			static char* argv[] = {name, nullptr};
+			static QCoreApplication app(argc, argv);
+		}
+	}
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(ConnectionPoolBenchmark, DeliveryScaling)
+{
+	// A thread per connection runs two threads per simulated peer in this
+	// process, one for each end of the link
+	for (int peerCount : {1, 4, 16, 64, 256}) {
+		auto threadPerConnection =
+			measureDelivery(peerCount, nullptr).seconds;
+
+		ConnectionThreadPool threadPool;
+		auto pooled = measureDelivery(peerCount, &threadPool).seconds;
+
+		auto messageCount = static_cast<double>(peerCount * messagesPerPeer);
+		std::cout << peerCount << " peers: thread per connection "
+				  << messageCount / threadPerConnection << " msg/s, pool of "
+				  << threadPool.getThreadCount() << " threads "
+				  << messageCount / pooled << " msg/s" << std::endl;
+
+		RecordProperty("msgps_threads_" + std::to_string(peerCount),
+			std::to_string(messageCount / threadPerConnection));
+		RecordProperty("msgps_pool_" + std::to_string(peerCount),
+			std::to_string(messageCount / pooled));
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(ConnectionPoolBenchmark, PayloadAllocations)
+{
+	// Allocations on both ends of the links while the server is under load,
+	// and how many received payloads came out of the pool
+	constexpr int peerCount = 16;
+
+	ConnectionThreadPool threadPool;
+
+	// The first run fills the pool
+	measureDelivery(peerCount, &threadPool);
+
+	const auto before = PayloadPool::getDefault().getStatistics();
+	const auto delivery = measureDelivery(peerCount, &threadPool);
+	const auto after = PayloadPool::getDefault().getStatistics();
+
+	const auto messageCount = static_cast<double>(peerCount * messagesPerPeer);
+	const auto acquired = after.acquired - before.acquired;
+	const auto reused = after.reused - before.reused;
+
+	std::cout << peerCount << " peers: "
+			  << delivery.allocations / delivery.seconds
+			  << " allocations/s, "
+			  << delivery.allocations / messageCount << " allocations/msg, "
+			  << reused << " of " << acquired << " payloads reused"
+			  << std::endl;
+
+	RecordProperty("allocations_per_second",
+		std::to_string(delivery.allocations / delivery.seconds));
+	RecordProperty("allocations_per_message",
+		std::to_string(delivery.allocations / messageCount));
+	RecordProperty("payloads_reused", std::to_string(reused));
+	RecordProperty("payloads_acquired", std::to_string(acquired));
+}
+//=============================================================================
@@ -0,0 +1,79 @@
+#include "common/crcUtils.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t bufferSize = 16 * 1024 * 1024;
+
+//=============================================================================
+// Checksums the buffer with the given implementation and returns the
+// throughput in MB/s, along with the checksum
+template <class Function>
+double measureThroughput(const std::vector<unsigned char>& buffer,
+	Function&& function, std::uint32_t& crc)
+{
+	auto start = std::chrono::steady_clock::now();
+	crc = function(buffer.data(), buffer.size(), 0);
+	auto stop = std::chrono::steady_clock::now();
+
+	std::chrono::duration<double> elapsed = stop - start;
+	return (buffer.size() / (1024.0 * 1024.0)) / elapsed.count();
+}
+//=============================================================================
+
+//=============================================================================
+std::uint32_t updateCRC32Bytewise(
+	const unsigned char* data, std::size_t length, std::uint32_t crc)
+{
+	for (std::size_t i = 0; i < length; ++i) {
+		crc::updateCRC32(data[i], crc);
+	}
+
+	return crc;
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+class CrcUtilsBenchmark : public ::testing::Test
+{
+protected:
+	void SetUp() override { m_Buffer.assign(bufferSize, 0xA5); }
+
+	void report(const std::string& name, double throughput)
+	{
+		std::cout << name << ": " << throughput << " MB/s" << std::endl;
+		RecordProperty("MBps_" + name, std::to_string(throughput));
+	}
+
+	std::vector<unsigned char> m_Buffer;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(CrcUtilsBenchmark, Throughput)
+{
+	std::uint32_t bytewise{0};
+	report("bytewise",
+		measureThroughput(m_Buffer, updateCRC32Bytewise, bytewise));
+
+	std::uint32_t slicingBy8{0};
+	report("slicing_by_8",
+		measureThroughput(m_Buffer, crc::updateCRC32SlicingBy8, slicingBy8));
+
+	std::uint32_t carrylessMultiply{0};
+	report("carryless_multiply",
+		measureThroughput(m_Buffer, crc::updateCRC32CarrylessMultiply,
+			carrylessMultiply));
+
+	// Each implementation has to arrive at the same checksum
+	EXPECT_EQ(slicingBy8, bytewise);
+	EXPECT_EQ(carrylessMultiply, bytewise);
+}
+//=============================================================================
@@ -0,0 +1,182 @@
+#include "networking/networkMessageParser.h"
+#include "networking/networkMessage.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+constexpr std::size_t payloadSize = 16 * 1024 * 1024;  // 16 MB FULL_STATE
+
+//=============================================================================
+// Feeds the serialized message to the parser in chunks of the given size and
+// returns the parse throughput in MB/s. The chunks are views of the message,
+// rather than copies made up front, which at one byte each would take
+// millions of allocations and about a gigabyte of memory
+double measureThroughput(const QByteArray& byteArray, int chunkSize,
+	std::size_t& messagesReceived)
+{
+	NetworkMessageParser parser;
+	parser.setMessageReadyCallback(
+		[&messagesReceived](const NetworkMessage&) { messagesReceived++; });
+
+	auto start = std::chrono::steady_clock::now();
+	for (int offset = 0; offset < byteArray.size(); offset += chunkSize) {
+		parser.parse(QByteArray::fromRawData(byteArray.constData() + offset,
+			std::min(chunkSize, byteArray.size() - offset)));
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	std::chrono::duration<double> elapsed = stop - start;
+	return (byteArray.size() / (1024.0 * 1024.0)) / elapsed.count();
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+class NetworkMessageParserBenchmark : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		NetworkMessage msg;
+		msg.header = 0x00;
+		msg.type = NetworkMessage::MessageType::FULL_STATE;
+		msg.data.resize(payloadSize);
+		std::iota(msg.data.begin(), msg.data.end(), 0);
+		msg.size = msg.data.size();
+
+		m_ByteArray = msg.serialize();
+	}
+
+	QByteArray m_ByteArray;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserBenchmark, ParseThroughput)
+{
+	// A chunk size of one byte forces every field through the byte-at-a-time
+	// path (the behavior before the bulk fast path was introduced); larger
+	// chunks resemble typical readyRead() deliveries
+	for (int chunkSize : {1, 1460, 65536, m_ByteArray.size()}) {
+		std::size_t messagesReceived{0};
+		auto throughput =
+			measureThroughput(m_ByteArray, chunkSize, messagesReceived);
+
+		std::cout << "chunk size " << chunkSize << " bytes: " << throughput
+				  << " MB/s" << std::endl;
+
+		RecordProperty("MBps_chunk_" + std::to_string(chunkSize),
+			std::to_string(throughput));
+
+		ASSERT_EQ(messagesReceived, 1);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserBenchmark, SerializeThroughput)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::FULL_STATE;
+	msg.data.resize(payloadSize);
+	std::iota(msg.data.begin(), msg.data.end(), 0);
+	msg.size = msg.data.size();
+
+	auto start = std::chrono::steady_clock::now();
+	auto byteArray = msg.serialize();
+	auto stop = std::chrono::steady_clock::now();
+
+	std::chrono::duration<double> elapsed = stop - start;
+	auto throughput = (byteArray.size() / (1024.0 * 1024.0)) / elapsed.count();
+
+	std::cout << "serialize: " << throughput << " MB/s" << std::endl;
+	RecordProperty("MBps_serialize", std::to_string(throughput));
+
+	ASSERT_TRUE(byteArray == m_ByteArray);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserBenchmark, ParseThroughputV2)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::FULL_STATE;
+	msg.data.resize(payloadSize);
+	std::iota(msg.data.begin(), msg.data.end(), 0);
+	msg.size = msg.data.size();
+
+	const auto byteArray = msg.serialize(NetworkMessage::FrameFormat::V2);
+
+	// The prefix checksum is the only extra work, so this should match the
+	// version 1 throughput
+	for (int chunkSize : {1, 1460, 65536, byteArray.size()}) {
+		std::size_t messagesReceived{0};
+		auto throughput =
+			measureThroughput(byteArray, chunkSize, messagesReceived);
+
+		std::cout << "version 2, chunk size " << chunkSize
+				  << " bytes: " << throughput << " MB/s" << std::endl;
+
+		RecordProperty("MBps_v2_chunk_" + std::to_string(chunkSize),
+			std::to_string(throughput));
+
+		ASSERT_EQ(messagesReceived, 1);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserBenchmark, ResyncThroughput)
+{
+	// A stream of small frames in which every tenth has a corrupt byte, after
+	// a first intact one which tells the parser to expect nothing but
+	// version 2 frames. Each corrupt frame costs at most the frame after it,
+	// and the scan for the next sync word must not fall back to a byte at a
+	// time crawl
+	constexpr int frameCount = 100000;
+
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_POSE;
+	msg.data.resize(64);
+	std::iota(msg.data.begin(), msg.data.end(), 0);
+	msg.size = msg.data.size();
+
+	const auto frame = msg.serialize(NetworkMessage::FrameFormat::V2);
+
+	QByteArray byteArray;
+	byteArray.reserve(frame.size() * frameCount);
+	for (int i = 0; i < frameCount; ++i) {
+		byteArray.append(frame);
+		if (i % 10 == 5) {
+			// Alternately in the prefix and in the payload
+			const auto offset = (i % 20 == 5) ? 6 : frame.size() / 2;
+			byteArray.data()[byteArray.size() - frame.size() + offset] ^= 0x5A;
+		}
+	}
+
+	std::size_t messagesReceived{0};
+	auto throughput = measureThroughput(byteArray, 1460, messagesReceived);
+
+	std::cout << "resync: " << throughput << " MB/s, " << messagesReceived
+			  << " of " << frameCount << " frames" << std::endl;
+
+	RecordProperty("MBps_resync", std::to_string(throughput));
+
+	ASSERT_GE(messagesReceived, frameCount * 8 / 10);
+}
+//=============================================================================
+
+//=============================================================================
+int main(int argc, char* argv[])
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
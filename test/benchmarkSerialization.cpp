@@ -0,0 +1,451 @@
+#include "appcore/messageEncoder.h"
+#include "appcore/messages.h"
+#include "appcore/applicationObjects.h"
+#include "appcore/fullStateChunk.h"
+#include "appcore/sceneState.h"
+#include "widgets/laserWidget.h"
+#include "widgets/splineWidget.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+using ArchiveFormat = serialization::ArchiveFormat;
+using PropertyId = common::PropertyId;
+
+constexpr int iterations = 2000;
+constexpr int fullStateIterations = 20;
+
+// Heap allocations made through operator new by any thread
+std::atomic<std::size_t> allocationCount{0};
+
+struct Measurement
+{
+	std::size_t bytesPerMessage;
+	double encodeMicroseconds;
+	double decodeMicroseconds;
+};
+
+//=============================================================================
+// Encodes and decodes a message repeatedly and returns its size along with
+// the average time per message for each direction
+Measurement measure(const std::function<NetworkMessage()>& encode,
+	MessageEncoder& decoder, int count)
+{
+	using Microseconds = std::chrono::duration<double, std::micro>;
+
+	NetworkMessage msg;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; ++i) {
+		msg = encode();
+	}
+	auto stop = std::chrono::steady_clock::now();
+	Microseconds encodeTime = stop - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; ++i) {
+		decoder.processMessage(msg);
+	}
+	stop = std::chrono::steady_clock::now();
+	Microseconds decodeTime = stop - start;
+
+	return {msg.data.size(), encodeTime.count() / count,
+		decodeTime.count() / count};
+}
+//=============================================================================
+
+//=============================================================================
+// A scene of eight peers, each with a laser and a spline widget
+void createScene(std::vector<PeerInfo>& peers, ApplicationObjects& objects)
+{
+	for (unsigned long id = 0; id < 8; ++id) {
+		peers.push_back(PeerInfo{id, "peer" + std::to_string(id),
+			{0.1 * id, 0.2, 0.3}});
+
+		auto laser = std::make_unique<LaserWidget>();
+		laser->setBase({0.1 * id, 0.0, 0.0});
+		laser->setTip({0.1 * id, 1.0, 0.0});
+		objects.lasers.insert({id, std::move(laser)});
+
+		auto spline = std::make_unique<SplineWidget>();
+		for (int i = 0; i < 16; ++i) {
+			spline->addNode(0.01 * i, 0.02 * id, 0.03);
+		}
+		objects.widgets.insert({id, std::move(spline)});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+// The same scene as the server holds it
+void createScene(std::vector<PeerInfo>& peers, SceneState& scene)
+{
+	for (unsigned long id = 0; id < 8; ++id) {
+		peers.push_back(PeerInfo{id, "peer" + std::to_string(id),
+			{0.1 * id, 0.2, 0.3}});
+
+		scene.addLaser(id, {0.1 * id, 0.2, 0.3});
+		scene.updateLaser(id,
+			{{PropertyId::BASE, common::Point3dType{0.1 * id, 0.0, 0.0}},
+				{PropertyId::TIP, common::Point3dType{0.1 * id, 1.0, 0.0}}});
+
+		std::vector<common::VariantType> nodes;
+		for (int i = 0; i < 16; ++i) {
+			nodes.push_back(common::Point3dType{0.01 * i, 0.02 * id, 0.03});
+		}
+
+		scene.addWidget(id);
+		scene.updateWidget(id, {{PropertyId::NODES, nodes}});
+	}
+}
+//=============================================================================
+
+//=============================================================================
+std::string formatName(ArchiveFormat format)
+{
+	return (format == ArchiveFormat::BINARY) ? "binary" : "json";
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* ptr = std::malloc((size != 0) ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+//=============================================================================
+
+//=============================================================================
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+//=============================================================================
+
+//=============================================================================
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+//=============================================================================
+
+//=============================================================================
+class SerializationBenchmark : public ::testing::TestWithParam<ArchiveFormat>
+{
+protected:
+	void SetUp() override
+	{
+		m_Encoder.setArchiveFormat(GetParam());
+
+		m_Decoder.setOnLaserUpdatedCallback(
+			[this](const LaserUpdate&, IdType) { m_Decoded++; });
+		m_Decoder.setOnVolumeUpdatedCallback(
+			[this](const VolumeUpdate&, IdType) { m_Decoded++; });
+		m_Decoder.setOnWidgetUpdatedCallback(
+			[this](const WidgetUpdate&, IdType) { m_Decoded++; });
+		m_Decoder.setOnFullStateUpdatedCallback(
+			[this](const std::vector<PeerInfo>&, ApplicationObjects&&) {
+				m_Decoded++;
+			});
+		m_Decoder.setOnFullStateChunkReceivedCallback(
+			[this](FullStateChunk&& chunk) {
+				if (chunk.type == FullStateChunk::Type::END) {
+					m_Decoded++;
+				}
+			});
+	}
+
+	void report(const std::string& name, const Measurement& measurement)
+	{
+		auto prefix = name + "_" + formatName(GetParam());
+
+		std::cout << prefix << ": " << measurement.bytesPerMessage
+				  << " bytes/msg, encode " << measurement.encodeMicroseconds
+				  << " us/msg, decode " << measurement.decodeMicroseconds
+				  << " us/msg" << std::endl;
+
+		RecordProperty(
+			prefix + "_bytes", std::to_string(measurement.bytesPerMessage));
+		RecordProperty(prefix + "_encode_us",
+			std::to_string(measurement.encodeMicroseconds));
+		RecordProperty(prefix + "_decode_us",
+			std::to_string(measurement.decodeMicroseconds));
+	}
+
+	using IdType = common::IdType;
+
+	MessageEncoder m_Encoder;
+	MessageEncoder m_Decoder;
+	int m_Decoded{0};
+};
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, LaserUpdate)
+{
+	LaserUpdate laserUpdate(
+		{{PropertyId::BASE, common::Point3dType{0.12, -0.34, 0.56}},
+			{PropertyId::TIP, common::Point3dType{0.78, 0.91, -0.23}}},
+		3);
+
+	auto result = measure(
+		[&] { return m_Encoder.createLaserUpdateMsg(laserUpdate); },
+		m_Decoder, iterations);
+
+	report("LaserUpdate", result);
+	ASSERT_EQ(m_Decoded, iterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, LaserPose)
+{
+	// Same update as above, sent through the fixed-layout LASER_POSE path
+	m_Encoder.setLaserPoseEnabled(true);
+
+	LaserUpdate laserUpdate(
+		{{PropertyId::BASE, common::Point3dType{0.12, -0.34, 0.56}},
+			{PropertyId::TIP, common::Point3dType{0.78, 0.91, -0.23}}},
+		3);
+
+	auto result = measure(
+		[&] { return m_Encoder.createLaserUpdateMsg(laserUpdate); },
+		m_Decoder, iterations);
+
+	report("LaserPose", result);
+	ASSERT_EQ(m_Decoded, iterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, VolumeUpdate)
+{
+	common::TransformType transform{common::TransformType::Identity()};
+	transform.rotate(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitY()));
+	transform.translate(Eigen::Vector3d{0.1, 0.2, 0.3});
+
+	VolumeUpdate volumeUpdate(VolumeUpdate::MessageType::PROPERTY_UPDATE,
+		{{PropertyId::TRANSFORM, transform}}, 1);
+
+	auto result = measure(
+		[&] { return m_Encoder.createVolumeUpdateMsg(volumeUpdate); },
+		m_Decoder, iterations);
+
+	report("VolumeUpdate", result);
+	ASSERT_EQ(m_Decoded, iterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, CompactTransform)
+{
+	// Same update as above, sent as a delta-coded TRANSFORM_UPDATE while the
+	// volume is dragged
+	m_Encoder.setCompactTransformEnabled(true);
+
+	int step = 0;
+	auto nextUpdate = [&step] {
+		common::TransformType transform{common::TransformType::Identity()};
+		transform.rotate(
+			Eigen::AngleAxisd(0.3 + 0.001 * step, Eigen::Vector3d::UnitY()));
+		transform.translate(Eigen::Vector3d{0.1 + 0.0001 * step, 0.2, 0.3});
+		step++;
+
+		return VolumeUpdate(VolumeUpdate::MessageType::PROPERTY_UPDATE,
+			{{PropertyId::TRANSFORM, transform}}, 1);
+	};
+
+	// The decoder has to see every delta in order, so measure the two
+	// directions together
+	using Microseconds = std::chrono::duration<double, std::micro>;
+
+	std::size_t totalBytes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		auto msg = m_Encoder.createVolumeUpdateMsg(nextUpdate());
+		totalBytes += msg.data.size();
+		m_Decoder.processMessage(msg);
+	}
+	auto stop = std::chrono::steady_clock::now();
+	Microseconds elapsed = stop - start;
+
+	report("CompactTransform",
+		{totalBytes / iterations, elapsed.count() / iterations, 0.0});
+	ASSERT_EQ(m_Decoded, iterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, WidgetUpdate)
+{
+	std::vector<common::VariantType> nodes;
+	for (int i = 0; i < 16; ++i) {
+		nodes.push_back(common::Point3dType{0.01 * i, 0.02 * i, -0.03 * i});
+	}
+
+	WidgetUpdate widgetUpdate(WidgetUpdate::MessageType::PROPERTY_UPDATE, 7,
+		{{PropertyId::NODES, nodes}}, 2);
+
+	auto result = measure(
+		[&] { return m_Encoder.createWidgetUpdateMsg(widgetUpdate); },
+		m_Decoder, iterations);
+
+	report("WidgetUpdate", result);
+	ASSERT_EQ(m_Decoded, iterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, DecodeAllocations)
+{
+	// Heap allocations per decoded message, including those of the decoded
+	// values themselves
+	std::vector<common::VariantType> nodes;
+	for (int i = 0; i < 16; ++i) {
+		nodes.push_back(common::Point3dType{0.01 * i, 0.02 * i, -0.03 * i});
+	}
+
+	const std::vector<std::pair<std::string, NetworkMessage>> messages{
+		{"LaserUpdate",
+			m_Encoder.createLaserUpdateMsg(LaserUpdate(
+				{{PropertyId::BASE, common::Point3dType{0.12, -0.34, 0.56}},
+					{PropertyId::TIP,
+						common::Point3dType{0.78, 0.91, -0.23}}},
+				3))},
+		{"WidgetUpdate",
+			m_Encoder.createWidgetUpdateMsg(
+				WidgetUpdate(WidgetUpdate::MessageType::PROPERTY_UPDATE, 7,
+					{{PropertyId::NODES, nodes}}, 2))}};
+
+	for (const auto& [name, msg] : messages) {
+		const auto before = allocationCount.load();
+		for (int i = 0; i < iterations; ++i) {
+			m_Decoder.processMessage(msg);
+		}
+		const auto allocations =
+			static_cast<double>(allocationCount.load() - before) / iterations;
+
+		auto prefix = name + "_" + formatName(GetParam());
+		std::cout << prefix << ": " << allocations << " allocations/decode"
+				  << std::endl;
+		RecordProperty(
+			prefix + "_decode_allocations", std::to_string(allocations));
+	}
+
+	ASSERT_EQ(m_Decoded, iterations * static_cast<int>(messages.size()));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, FullState)
+{
+	std::vector<PeerInfo> peers;
+	ApplicationObjects objects;
+	createScene(peers, objects);
+
+	auto result = measure(
+		[&] { return m_Encoder.createFullStateMsg(peers, objects); },
+		m_Decoder, fullStateIterations);
+
+	report("FullState", result);
+	ASSERT_EQ(m_Decoded, fullStateIterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, ChunkedFullState)
+{
+	// Same scene as above, split into FULL_STATE_CHUNK messages. The size
+	// reported is that of the largest chunk, which bounds how long the
+	// stream is held up by the full state
+	using Microseconds = std::chrono::duration<double, std::micro>;
+
+	std::vector<PeerInfo> peers;
+	ApplicationObjects objects;
+	createScene(peers, objects);
+
+	std::vector<NetworkMessage> chunks;
+	auto collect = [&chunks](NetworkMessage&& chunk) {
+		chunks.push_back(std::move(chunk));
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < fullStateIterations; ++i) {
+		chunks.clear();
+		m_Encoder.createFullStateChunks(peers, objects, collect);
+	}
+	auto stop = std::chrono::steady_clock::now();
+	Microseconds encodeTime = stop - start;
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < fullStateIterations; ++i) {
+		for (const auto& chunk : chunks) {
+			m_Decoder.processMessage(chunk);
+		}
+	}
+	stop = std::chrono::steady_clock::now();
+	Microseconds decodeTime = stop - start;
+
+	std::size_t largestChunk = 0;
+	for (const auto& chunk : chunks) {
+		largestChunk = std::max(largestChunk, chunk.data.size());
+	}
+
+	std::cout << "ChunkedFullState_" << formatName(GetParam()) << ": "
+			  << chunks.size() << " chunks" << std::endl;
+
+	report("ChunkedFullState",
+		{largestChunk, encodeTime.count() / fullStateIterations,
+			decodeTime.count() / fullStateIterations});
+	ASSERT_EQ(chunks.size(),
+		objects.lasers.size() + objects.widgets.size() + 4);
+	ASSERT_EQ(m_Decoded, fullStateIterations);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SerializationBenchmark, SceneStateFullState)
+{
+	// The full state as the server encodes it from its scene state. Peers
+	// have to load it into widgets just as before
+	std::vector<PeerInfo> peers;
+	SceneState scene;
+	createScene(peers, scene);
+
+	std::size_t decodedLasers = 0;
+	std::size_t decodedNodes = 0;
+	m_Decoder.setOnFullStateUpdatedCallback(
+		[&](const std::vector<PeerInfo>&, ApplicationObjects&& objects) {
+			decodedLasers = objects.lasers.size();
+			decodedNodes = objects.widgets.at(3)->getNodes().size();
+			m_Decoded++;
+		});
+
+	auto result = measure(
+		[&] { return m_Encoder.createFullStateMsg(peers, scene); },
+		m_Decoder, fullStateIterations);
+
+	report("SceneStateFullState", result);
+	ASSERT_EQ(m_Decoded, fullStateIterations);
+	ASSERT_EQ(decodedLasers, scene.getLasers().size());
+	ASSERT_EQ(decodedNodes, scene.findWidget(3)->nodes.size());
+}
+//=============================================================================
+
+INSTANTIATE_TEST_SUITE_P(ArchiveFormats, SerializationBenchmark,
+	::testing::Values(ArchiveFormat::JSON, ArchiveFormat::BINARY),
+	[](const auto& info) { return formatName(info.param); });
@@ -0,0 +1,107 @@
+#include "widgets/splineWidget.h"
+#include "gtest/gtest.h"
+
+#include <vtkPolyData.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using PointType = common::Point3dType;
+using VariantType = common::VariantType;
+
+constexpr int nodeCount = 16;
+constexpr int moveCount = 20000;
+
+// Node moves arriving between two frames while rendering
+constexpr int movesPerFrame = 4;
+
+//=============================================================================
+// Drags the nodes of a spline in turn, as NODE_POSITION updates from peers
+// would, and returns the updates applied per second. With a frame interval
+// the curve is regenerated every that many moves, as a render would
+double measureNodeDrag(bool lazy, int frameInterval)
+{
+	SplineWidget widget;
+	widget.setGeometryLazy(lazy);
+
+	std::vector<VariantType> nodes;
+	for (int i = 0; i < nodeCount; ++i) {
+		nodes.push_back(PointType{10.0 * i, 0.0, 0.0});
+	}
+	widget.updateProperties({{PropertyId::NODES, nodes}});
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < moveCount; ++i) {
+		const auto node = static_cast<std::uint16_t>(i % nodeCount);
+
+		widget.updateProperties({{PropertyId::NODE_POSITION,
+			std::vector<VariantType>{
+				node, PointType{10.0 * node, 0.01 * i, 0.0}}}});
+
+		if ((frameInterval > 0) && ((i + 1) % frameInterval == 0)) {
+			widget.getCurve();
+		}
+	}
+	const auto stop = std::chrono::steady_clock::now();
+
+	auto curve = widget.getCurve();
+	EXPECT_NE(curve, nullptr);
+	EXPECT_GT(curve->GetNumberOfPoints(), 0);
+	EXPECT_TRUE(widget.getNodePosition(nodeCount - 1)
+					->isApprox(PointType{10.0 * (nodeCount - 1),
+						0.01 * (moveCount - 1), 0.0}));
+
+	return moveCount / std::chrono::duration<double>(stop - start).count();
+}
+//=============================================================================
+
+//=============================================================================
+std::string formatName(bool lazy)
+{
+	return lazy ? "lazy" : "eager";
+}
+//=============================================================================
+}  // namespace
+
+//=============================================================================
+class SplineWidgetBenchmark : public ::testing::TestWithParam<bool>
+{
+protected:
+	void report(const std::string& name, double updatesPerSecond)
+	{
+		auto prefix = name + "_" + formatName(GetParam());
+
+		std::cout << prefix << ": " << updatesPerSecond << " updates/s"
+				  << std::endl;
+
+		RecordProperty(prefix + "_updates_per_second",
+			std::to_string(updatesPerSecond));
+	}
+};
+//=============================================================================
+
+//=============================================================================
+TEST_P(SplineWidgetBenchmark, NodeDrag)
+{
+	// Nothing renders the widget, as on a peer without a display
+	report("NodeDrag", measureNodeDrag(GetParam(), 0));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_P(SplineWidgetBenchmark, NodeDragWhileRendering)
+{
+	report("NodeDragWhileRendering",
+		measureNodeDrag(GetParam(), movesPerFrame));
+}
+//=============================================================================
+
+INSTANTIATE_TEST_SUITE_P(GeometryModes, SplineWidgetBenchmark,
+	::testing::Values(false, true),
+	[](const auto& info) { return formatName(info.param); });
@@ -0,0 +1,119 @@
+#include "appcore/byteStreambuf.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//=============================================================================
+TEST(ByteStreambufTest, TestReadInPlace)
+{
+	const std::vector<std::uint8_t> bytes{'4', '2', ' ', 'a', 'b', 'c'};
+
+	serialization::SpanStreambuf buffer(bytes.data(), bytes.size());
+	std::istream stream(&buffer);
+
+	int number = 0;
+	std::string word;
+	stream >> number >> word;
+
+	EXPECT_EQ(number, 42);
+	EXPECT_EQ(word, "abc");
+	EXPECT_TRUE(stream.eof());
+}
+//=============================================================================
+
+//=============================================================================
+TEST(ByteStreambufTest, TestReadBlock)
+{
+	std::vector<std::uint8_t> bytes(64);
+	for (std::size_t i = 0; i < bytes.size(); ++i) {
+		bytes[i] = static_cast<std::uint8_t>(i);
+	}
+
+	serialization::SpanStreambuf buffer(bytes.data(), bytes.size());
+	std::istream stream(&buffer);
+
+	std::vector<char> block(48);
+	ASSERT_TRUE(stream.read(block.data(), block.size()));
+	EXPECT_EQ(static_cast<std::uint8_t>(block.back()), 47);
+
+	// Reading past the end fails and reports what was available
+	EXPECT_FALSE(stream.read(block.data(), block.size()));
+	EXPECT_EQ(stream.gcount(), 16);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(ByteStreambufTest, TestSeek)
+{
+	const std::vector<std::uint8_t> bytes{'a', 'b', 'c', 'd'};
+
+	serialization::SpanStreambuf buffer(bytes.data(), bytes.size());
+	std::istream stream(&buffer);
+
+	EXPECT_EQ(stream.get(), 'a');
+	EXPECT_EQ(stream.tellg(), 1);
+
+	stream.seekg(-1, std::ios_base::end);
+	EXPECT_EQ(stream.get(), 'd');
+
+	stream.seekg(1);
+	EXPECT_EQ(stream.get(), 'b');
+
+	// Seeking outside the bytes fails
+	stream.seekg(5);
+	EXPECT_TRUE(stream.fail());
+}
+//=============================================================================
+
+//=============================================================================
+TEST(ByteStreambufTest, TestWriteAppends)
+{
+	std::vector<std::uint8_t> bytes{'>'};
+
+	{
+		serialization::VectorStreambuf buffer(bytes);
+		std::ostream stream(&buffer);
+
+		stream << 42 << ' ';
+		stream.put('x');
+		stream.write("yz", 2);
+	}
+
+	const std::string written(bytes.begin(), bytes.end());
+	EXPECT_EQ(written, ">42 xyz");
+}
+//=============================================================================
+
+//=============================================================================
+TEST(ByteStreambufTest, TestRoundTrip)
+{
+	std::vector<std::uint8_t> bytes;
+
+	{
+		serialization::VectorStreambuf buffer(bytes);
+		std::ostream stream(&buffer);
+
+		for (int i = 0; i < 256; ++i) {
+			stream.put(static_cast<char>(i));
+		}
+	}
+
+	ASSERT_EQ(bytes.size(), 256u);
+
+	serialization::SpanStreambuf buffer(bytes.data(), bytes.size());
+	std::istream stream(&buffer);
+
+	std::vector<char> read{std::istreambuf_iterator<char>(stream),
+		std::istreambuf_iterator<char>()};
+
+	ASSERT_EQ(read.size(), bytes.size());
+	for (std::size_t i = 0; i < read.size(); ++i) {
+		EXPECT_EQ(static_cast<std::uint8_t>(read[i]), bytes[i]);
+	}
+}
+//=============================================================================
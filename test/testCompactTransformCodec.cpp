@@ -0,0 +1,207 @@
+#include "appcore/compactTransformCodec.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using TransformType = common::TransformType;
+using Target = compactTransform::Target;
+
+TransformType makeTransform(double angle, const Eigen::Vector3d& translation)
+{
+	TransformType transform{TransformType::Identity()};
+	transform.translate(translation);
+	transform.rotate(Eigen::AngleAxisd(
+		angle, Eigen::Vector3d{0.2, -0.7, 0.4}.normalized()));
+
+	return transform;
+}
+
+void expectNear(const TransformType& actual, const TransformType& expected)
+{
+	// half a quantization step in translation, and well under a
+	// thousandth of a radian in rotation
+	EXPECT_LE((actual.translation() - expected.translation())
+				  .cwiseAbs()
+				  .maxCoeff(),
+		0.5 * compactTransform::translationStep + 1e-12);
+
+	Eigen::AngleAxisd error(actual.linear().transpose() * expected.linear());
+	EXPECT_LT(std::abs(error.angle()), 1.0e-3);
+}
+}  // namespace
+
+//=============================================================================
+class CompactTransformCodecTest : public ::testing::Test
+{
+protected:
+	compactTransform::TransformUpdate makeUpdate(
+		double angle, const Eigen::Vector3d& translation) const
+	{
+		compactTransform::TransformUpdate update;
+		update.target = Target::WIDGET;
+		update.objectId = 12;
+		update.peerId = 3;
+		update.transform = makeTransform(angle, translation);
+
+		return update;
+	}
+
+	bool roundTrip(const compactTransform::TransformUpdate& update,
+		compactTransform::TransformUpdate& decoded)
+	{
+		compactTransform::encode(update, m_SentBaselines, m_Buffer);
+
+		return compactTransform::decode(
+			m_Buffer.data(), m_Buffer.size(), m_ReceivedBaselines, decoded);
+	}
+
+	compactTransform::BaselineMapType m_SentBaselines;
+	compactTransform::BaselineMapType m_ReceivedBaselines;
+	std::vector<std::uint8_t> m_Buffer;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestKeyframeRoundTrip)
+{
+	auto update = makeUpdate(1.1, {12.5, -3.25, 0.001});
+
+	compactTransform::TransformUpdate decoded;
+	ASSERT_TRUE(roundTrip(update, decoded));
+
+	ASSERT_EQ(decoded.target, Target::WIDGET);
+	ASSERT_EQ(decoded.objectId, 12);
+	ASSERT_EQ(decoded.peerId, 3);
+	expectNear(decoded.transform, update.transform);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestDeltaRoundTrip)
+{
+	compactTransform::TransformUpdate decoded;
+	ASSERT_TRUE(roundTrip(makeUpdate(0.5, {1.0, 2.0, 3.0}), decoded));
+	const auto keyframeSize = m_Buffer.size();
+
+	// A small interactive drag, one update at a time
+	for (int i = 1; i < 200; ++i) {
+		auto update = makeUpdate(
+			0.5 + 0.002 * i, {1.0 + 0.0005 * i, 2.0, 3.0 - 0.001 * i});
+
+		ASSERT_TRUE(roundTrip(update, decoded));
+		expectNear(decoded.transform, update.transform);
+
+		if ((i % compactTransform::keyframeInterval) != 0) {
+			ASSERT_LT(m_Buffer.size(), keyframeSize);
+		}
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestDeltaWithoutBaselineRejected)
+{
+	compactTransform::encode(
+		makeUpdate(0.5, {1.0, 2.0, 3.0}), m_SentBaselines, m_Buffer);
+	compactTransform::encode(
+		makeUpdate(0.6, {1.1, 2.0, 3.0}), m_SentBaselines, m_Buffer);
+
+	// The receiver never saw the keyframe
+	compactTransform::TransformUpdate decoded;
+	ASSERT_FALSE(compactTransform::decode(
+		m_Buffer.data(), m_Buffer.size(), m_ReceivedBaselines, decoded));
+	ASSERT_TRUE(m_ReceivedBaselines.empty());
+
+	// Once the baselines are reset on both ends, the next update is a
+	// keyframe again
+	m_SentBaselines.clear();
+	ASSERT_TRUE(roundTrip(makeUpdate(0.7, {1.2, 2.0, 3.0}), decoded));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestObjectsHaveIndependentBaselines)
+{
+	auto volumeUpdate = makeUpdate(0.1, {0.0, 0.0, 1.0});
+	volumeUpdate.target = Target::VOLUME;
+	volumeUpdate.objectId = 0;
+
+	compactTransform::TransformUpdate decoded;
+	ASSERT_TRUE(roundTrip(volumeUpdate, decoded));
+	ASSERT_TRUE(roundTrip(makeUpdate(0.2, {5.0, 0.0, 0.0}), decoded));
+
+	volumeUpdate.transform = makeTransform(0.15, {0.0, 0.1, 1.0});
+	ASSERT_TRUE(roundTrip(volumeUpdate, decoded));
+	ASSERT_EQ(decoded.target, Target::VOLUME);
+	expectNear(decoded.transform, volumeUpdate.transform);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestTruncatedDataRejected)
+{
+	compactTransform::encode(
+		makeUpdate(0.5, {1.0, 2.0, 3.0}), m_SentBaselines, m_Buffer);
+
+	compactTransform::TransformUpdate decoded;
+	for (std::size_t size = 0; size < m_Buffer.size(); ++size) {
+		ASSERT_FALSE(compactTransform::decode(
+			m_Buffer.data(), size, m_ReceivedBaselines, decoded));
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestUnsupportedPropertiesFallBack)
+{
+	auto transform = makeTransform(0.3, {1.0, 2.0, 3.0});
+	ASSERT_TRUE(compactTransform::fromPropertyList(
+		{{PropertyId::TRANSFORM, transform}})
+					.has_value());
+
+	TransformType scaled = transform;
+	scaled.scale(2.0);
+	ASSERT_FALSE(compactTransform::fromPropertyList(
+		{{PropertyId::TRANSFORM, scaled}})
+					 .has_value());
+
+	TransformType distant = transform;
+	distant.translation()(0) = 1.0e6;
+	ASSERT_FALSE(compactTransform::fromPropertyList(
+		{{PropertyId::TRANSFORM, distant}})
+					 .has_value());
+
+	ASSERT_FALSE(compactTransform::fromPropertyList(
+		{{PropertyId::TRANSFORM, transform}, {PropertyId::COLOR, true}})
+					 .has_value());
+	ASSERT_FALSE(compactTransform::fromPropertyList({}).has_value());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CompactTransformCodecTest, TestReadHeader)
+{
+	compactTransform::encode(
+		makeUpdate(0.5, {1.0, 2.0, 3.0}), m_SentBaselines, m_Buffer);
+
+	auto header =
+		compactTransform::readHeader(m_Buffer.data(), m_Buffer.size());
+	ASSERT_TRUE(header.has_value());
+	ASSERT_EQ(header->target, Target::WIDGET);
+	ASSERT_EQ(header->objectId, 12);
+	ASSERT_TRUE(header->keyframe);
+
+	compactTransform::encode(
+		makeUpdate(0.6, {1.0, 2.0, 3.5}), m_SentBaselines, m_Buffer);
+
+	header = compactTransform::readHeader(m_Buffer.data(), m_Buffer.size());
+	ASSERT_TRUE(header.has_value());
+	ASSERT_FALSE(header->keyframe);
+
+	ASSERT_FALSE(compactTransform::readHeader(m_Buffer.data(), 5).has_value());
+}
+//=============================================================================
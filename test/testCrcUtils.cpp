@@ -0,0 +1,100 @@
+#include "common/crcUtils.h"
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+std::uint32_t referenceCRC32(
+	const std::vector<unsigned char>& buffer, std::size_t offset,
+	std::size_t length, std::uint32_t crc = 0)
+{
+	for (std::size_t i = offset; i < offset + length; ++i) {
+		crc::updateCRC32(buffer[i], crc);
+	}
+
+	return crc;
+}
+}  // namespace
+
+//=============================================================================
+class CrcUtilsTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		std::mt19937 generator{42};
+		std::uniform_int_distribution<int> distribution(0, 255);
+
+		m_Buffer.resize(4096 + 64);
+		for (auto& byte : m_Buffer) {
+			byte = static_cast<unsigned char>(distribution(generator));
+		}
+	}
+
+	std::vector<unsigned char> m_Buffer;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(CrcUtilsTest, TestKnownValue)
+{
+	// CRC-32/MPEG-2 without initial value or final xor
+	const std::string check{"123456789"};
+	auto value = crc::updateCRC32(check.data(), check.size(), 0);
+
+	ASSERT_EQ(value, 0x89A1897F);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CrcUtilsTest, TestSlicingMatchesBytewise)
+{
+	for (std::size_t offset = 0; offset < 8; ++offset) {
+		for (std::size_t length = 0; length < 300; ++length) {
+			ASSERT_EQ(crc::updateCRC32SlicingBy8(
+						  m_Buffer.data() + offset, length, 0x12345678),
+				referenceCRC32(m_Buffer, offset, length, 0x12345678));
+		}
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CrcUtilsTest, TestCarrylessMultiplyMatchesBytewise)
+{
+	if (!crc::isCarrylessMultiplySupported()) {
+		std::cout << "PCLMULQDQ not supported; testing fallback only"
+				  << std::endl;
+	}
+
+	for (std::size_t offset = 0; offset < 16; ++offset) {
+		for (std::size_t length = 0; length < 600; ++length) {
+			ASSERT_EQ(crc::updateCRC32CarrylessMultiply(
+						  m_Buffer.data() + offset, length, 0xCAFEBABE),
+				referenceCRC32(m_Buffer, offset, length, 0xCAFEBABE));
+		}
+	}
+
+	ASSERT_EQ(crc::updateCRC32CarrylessMultiply(
+				  m_Buffer.data(), m_Buffer.size(), 0),
+		referenceCRC32(m_Buffer, 0, m_Buffer.size()));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(CrcUtilsTest, TestIncrementalUpdate)
+{
+	const auto expected = referenceCRC32(m_Buffer, 0, m_Buffer.size());
+
+	for (std::size_t split : {1, 7, 64, 129, 1000, 4000}) {
+		auto value = crc::updateCRC32(m_Buffer.data(), split, 0);
+		value = crc::updateCRC32(
+			m_Buffer.data() + split, m_Buffer.size() - split, value);
+
+		ASSERT_EQ(value, expected);
+	}
+}
+//=============================================================================
@@ -0,0 +1,145 @@
+#include "networking/datagramChannel.h"
+#include "networking/encodedMessage.h"
+#include "networking/networkMessage.h"
+#include "gtest/gtest.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr DatagramChannel::TokenType token = 0x0123456789abcdef;
+constexpr int timeoutMilliseconds = 5000;
+
+NetworkMessage makeMessage(const std::string& text)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_POSE;
+	msg.data = {text.begin(), text.end()};
+	msg.size = msg.data.size();
+
+	return msg;
+}
+
+// Runs the event loop until the condition holds, giving up after a while
+template <typename Condition>
+bool processEventsUntil(Condition condition)
+{
+	QEventLoop eventLoop;
+	QTimer timeout;
+	timeout.setSingleShot(true);
+	timeout.start(timeoutMilliseconds);
+
+	while (!condition() && timeout.isActive()) {
+		eventLoop.processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	return condition();
+}
+}  // namespace
+
+//=============================================================================
+class DatagramChannelTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance()) {
+			static int argc{1};
+			static char name[] = "testNetworkUtilities";
+			static char* argv[] = {name, nullptr};
+			static QCoreApplication app(argc, argv);
+		}
+
+		ASSERT_TRUE(m_Server.bind(QHostAddress::LocalHost));
+		ASSERT_TRUE(m_Client.bind(QHostAddress::LocalHost));
+
+		QObject::connect(&m_Server, &DatagramChannel::messageReceived,
+			[this](auto, const NetworkMessage& msg) {
+				m_Received.push_back(msg);
+			});
+		QObject::connect(&m_Client, &DatagramChannel::settleRequired,
+			[this](auto, const EncodedMessage& msg) {
+				m_Settled.push_back(msg);
+			});
+
+		// As when the server offers the channel over the connection
+		m_Server.addEndpoint(token);
+		m_Client.connectEndpoint(
+			token, QHostAddress::LocalHost, m_Server.getPort());
+
+		ASSERT_TRUE(processEventsUntil([this] {
+			return m_Server.isConfirmed(token) && m_Client.isConfirmed(token);
+		}));
+	}
+
+	DatagramChannel m_Server;
+	DatagramChannel m_Client;
+	std::vector<NetworkMessage> m_Received;
+	std::vector<EncodedMessage> m_Settled;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(DatagramChannelTest, TestStreamOpensReliably)
+{
+	EncodedMessage first{makeMessage("first")};
+	EncodedMessage second{makeMessage("second")};
+
+	// The first message of a stream is left to the connection
+	ASSERT_FALSE(m_Client.sendMessage(token, 1, first));
+	ASSERT_TRUE(m_Client.sendMessage(token, 1, second));
+
+	ASSERT_TRUE(processEventsUntil([this] { return !m_Received.empty(); }));
+	ASSERT_EQ(m_Received.size(), 1);
+
+	auto text = std::string{"second"};
+	ASSERT_TRUE(m_Received.front().data ==
+		NetworkMessage::PayloadDataType(text.begin(), text.end()));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(DatagramChannelTest, TestSettle)
+{
+	EncodedMessage msg{makeMessage("pose")};
+
+	ASSERT_FALSE(m_Client.sendMessage(token, 1, msg));
+	ASSERT_TRUE(m_Client.sendMessage(token, 1, msg));
+	ASSERT_FALSE(m_Client.sendMessage(token, 2, msg));
+
+	// Only the stream whose last message went out as a datagram needs to be
+	// resent, and both streams open reliably again afterwards
+	m_Client.settle(token);
+	ASSERT_EQ(m_Settled.size(), 1);
+	ASSERT_EQ(m_Settled.front().getBytes(), msg.getBytes());
+
+	ASSERT_FALSE(m_Client.sendMessage(token, 1, msg));
+	ASSERT_FALSE(m_Client.sendMessage(token, 2, msg));
+
+	// Quiet streams settle on their own
+	ASSERT_TRUE(m_Client.sendMessage(token, 2, msg));
+	ASSERT_TRUE(processEventsUntil([this] { return m_Settled.size() == 2; }));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(DatagramChannelTest, TestUnknownEndpoint)
+{
+	EncodedMessage msg{makeMessage("pose")};
+
+	ASSERT_FALSE(m_Client.sendMessage(token + 1, 1, msg));
+	ASSERT_FALSE(m_Server.isConfirmed(token + 1));
+
+	// Messages too large for a datagram go over the connection
+	std::string text(DatagramChannel::maxDatagramSize, 'x');
+	EncodedMessage largeMsg{makeMessage(text)};
+	ASSERT_FALSE(m_Client.sendMessage(token, 1, largeMsg));
+	ASSERT_FALSE(m_Client.sendMessage(token, 1, largeMsg));
+}
+//=============================================================================
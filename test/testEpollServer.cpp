@@ -0,0 +1,353 @@
+#include "networking/epollServer.h"
+#include "networking/encodedMessage.h"
+#include "networking/networkMessage.h"
+#include "networking/networkMessageParser.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Blocking loopback client, so the tests only need to drive the server
+class TestClient
+{
+public:
+	explicit TestClient(std::uint16_t port) :
+		m_Socket{socket(AF_INET, SOCK_STREAM, 0)}
+	{
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		m_Connected = connect(m_Socket, reinterpret_cast<sockaddr*>(&address),
+						  sizeof(address)) == 0;
+
+		m_Parser.setMessageReadyCallback([this](const NetworkMessage& msg) {
+			m_Received.push_back(msg);
+		});
+	}
+
+	~TestClient()
+	{
+		::close(m_Socket);
+	}
+
+	bool isConnected() const
+	{
+		return m_Connected;
+	}
+
+	void send(const NetworkMessage& msg)
+	{
+		auto bytes = msg.serialize();
+		ASSERT_EQ(::send(m_Socket, bytes.constData(), bytes.size(), 0),
+			bytes.size());
+	}
+
+	// Reads until a message arrived or the server closed the connection
+	std::vector<NetworkMessage> receive()
+	{
+		std::vector<char> buffer(4096);
+		while (m_Received.empty()) {
+			auto count = ::recv(m_Socket, buffer.data(), buffer.size(), 0);
+			if (count <= 0) {
+				break;
+			}
+
+			m_Parser.parse(QByteArray::fromRawData(buffer.data(), count));
+		}
+
+		return std::move(m_Received);
+	}
+
+	// Reads whatever has arrived, without waiting
+	std::vector<NetworkMessage> receiveAvailable()
+	{
+		std::vector<char> buffer(65536);
+		for (;;) {
+			auto count =
+				::recv(m_Socket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+			if (count <= 0) {
+				break;
+			}
+
+			m_Parser.parse(QByteArray::fromRawData(buffer.data(), count));
+		}
+
+		return std::move(m_Received);
+	}
+
+private:
+	int m_Socket;
+	bool m_Connected;
+	NetworkMessageParser m_Parser;
+	std::vector<NetworkMessage> m_Received;
+};
+
+NetworkMessage makeMessage(const std::string& text)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	msg.data = {text.begin(), text.end()};
+	msg.size = msg.data.size();
+
+	return msg;
+}
+
+// Polls until the condition holds, giving up after a few seconds
+template <typename Condition>
+bool pollUntil(EpollServer& server, Condition condition)
+{
+	const auto deadline =
+		std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		server.poll(10);
+	}
+
+	return true;
+}
+}  // namespace
+
+//=============================================================================
+class EpollServerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		ASSERT_TRUE(m_Server.listen("127.0.0.1", 0));
+		ASSERT_NE(m_Server.getPort(), 0);
+
+		m_Server.setConnectedCallback(
+			[this](auto id) { m_Connected.push_back(id); });
+		m_Server.setDisconnectedCallback(
+			[this](auto id) { m_Disconnected.push_back(id); });
+	}
+
+	EpollServer m_Server;
+	std::vector<EpollServer::ConnectionIdType> m_Connected;
+	std::vector<EpollServer::ConnectionIdType> m_Disconnected;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestEcho)
+{
+	std::size_t messagesReceived{0};
+	m_Server.setMessageReceivedCallback(
+		[this, &messagesReceived](auto id, NetworkMessage& msg) {
+			messagesReceived++;
+			m_Server.sendMessage(id, msg);
+		});
+
+	TestClient client{m_Server.getPort()};
+	ASSERT_TRUE(client.isConnected());
+	ASSERT_TRUE(pollUntil(m_Server, [this] { return !m_Connected.empty(); }));
+
+	auto msg = makeMessage("Hello world");
+	client.send(msg);
+	client.send(msg);
+	ASSERT_TRUE(pollUntil(m_Server, [&] { return messagesReceived == 2; }));
+
+	std::vector<NetworkMessage> replies;
+	while (replies.size() < 2) {
+		auto received = client.receive();
+		ASSERT_FALSE(received.empty());
+		replies.insert(replies.end(), received.begin(), received.end());
+	}
+
+	ASSERT_EQ(replies.size(), 2);
+	for (const auto& reply : replies) {
+		ASSERT_EQ(reply.type, msg.type);
+		ASSERT_TRUE(reply.data == msg.data);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestCloseAfterReply)
+{
+	// As when rejecting credentials: answer, then hang up
+	m_Server.setMessageReceivedCallback([this](auto id, NetworkMessage&) {
+		m_Server.sendMessage(id, makeMessage("Go away"));
+		m_Server.close(id);
+	});
+
+	TestClient client{m_Server.getPort()};
+	client.send(makeMessage("Let me in"));
+
+	ASSERT_TRUE(
+		pollUntil(m_Server, [this] { return !m_Disconnected.empty(); }));
+	ASSERT_EQ(m_Connected, m_Disconnected);
+	ASSERT_EQ(m_Server.getConnectionCount(), 0);
+
+	auto received = client.receive();
+	ASSERT_EQ(received.size(), 1);
+	ASSERT_TRUE(client.receive().empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestPeerDisconnect)
+{
+	{
+		TestClient client{m_Server.getPort()};
+		ASSERT_TRUE(
+			pollUntil(m_Server, [this] { return !m_Connected.empty(); }));
+		ASSERT_EQ(m_Server.getConnectionCount(), 1);
+	}
+
+	ASSERT_TRUE(
+		pollUntil(m_Server, [this] { return !m_Disconnected.empty(); }));
+	ASSERT_EQ(m_Server.getConnectionCount(), 0);
+
+	// Sending to a connection which is gone is ignored
+	m_Server.sendMessage(m_Disconnected.front(), makeMessage("Anyone?"));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestSlowPeerIsQueued)
+{
+	std::vector<SendQueue::Statistics> reports;
+	m_Server.setSendQueueStatisticsCallback(
+		[&reports](auto, const SendQueue::Statistics& statistics) {
+			reports.push_back(statistics);
+		});
+
+	TestClient client{m_Server.getPort()};
+	ASSERT_TRUE(pollUntil(m_Server, [this] { return !m_Connected.empty(); }));
+	const auto id = m_Connected.front();
+
+	// Updates of one object, which the peer does not read for now; far more
+	// than the socket and the high watermark hold
+	constexpr int messageCount = 400;
+	const std::string payload(64 * 1024, 'x');
+
+	for (int i = 0; i < messageCount; ++i) {
+		EncodedMessage msg{makeMessage(std::to_string(i) + payload)};
+		msg.setSupersedeKey(1);
+		m_Server.sendEncodedMessage(id, msg);
+	}
+
+	ASSERT_TRUE(pollUntil(m_Server, [&] { return !reports.empty(); }));
+	EXPECT_TRUE(reports.front().congested);
+	EXPECT_EQ(reports.front().congestionCount, 1);
+
+	// All but the latest of the queued updates are dropped
+	std::vector<NetworkMessage> received;
+	ASSERT_TRUE(pollUntil(m_Server, [&] {
+		auto messages = client.receiveAvailable();
+		received.insert(received.end(), messages.begin(), messages.end());
+		return !reports.back().congested;
+	}));
+	ASSERT_TRUE(pollUntil(m_Server, [&] {
+		auto messages = client.receiveAvailable();
+		received.insert(received.end(), messages.begin(), messages.end());
+		const auto last = std::to_string(messageCount - 1);
+		return !received.empty() &&
+			std::equal(last.begin(), last.end(),
+				received.back().data.begin());
+	}));
+
+	EXPECT_LT(received.size(), messageCount);
+	EXPECT_EQ(received.size() + reports.back().supersededMessages,
+		messageCount);
+	EXPECT_EQ(m_Disconnected.size(), 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestSlowPeerOverLimitIsClosed)
+{
+	std::vector<std::string> errors;
+	m_Server.setErrorCallback([&errors](auto, const std::string& error) {
+		errors.push_back(error);
+	});
+
+	TestClient client{m_Server.getPort()};
+	ASSERT_TRUE(pollUntil(m_Server, [this] { return !m_Connected.empty(); }));
+	const auto id = m_Connected.front();
+
+	// Without supersede keys nothing can be dropped, so the backlog grows
+	// past the limit of the send queue
+	const auto msg = makeMessage(std::string(64 * 1024, 'x'));
+	const auto messageCount = SendQueue::defaultMaxBytes / msg.data.size() +
+		SendQueue::highWatermark / msg.data.size() + 64;
+
+	for (std::size_t i = 0; i < messageCount; ++i) {
+		m_Server.sendMessage(id, msg);
+	}
+
+	ASSERT_TRUE(
+		pollUntil(m_Server, [this] { return !m_Disconnected.empty(); }));
+	ASSERT_EQ(errors.size(), 1);
+	EXPECT_EQ(errors.front(), "Send queue limit exceeded");
+	EXPECT_EQ(m_Server.getConnectionCount(), 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(EpollServerTest, TestManyConnections)
+{
+	// Both ends of every connection live in this process
+	rlimit limit{};
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	const auto clientCount = static_cast<std::size_t>(
+		std::min<rlim_t>(2000, (limit.rlim_cur - 64) / 2));
+
+	std::size_t messagesReceived{0};
+	m_Server.setMessageReceivedCallback(
+		[this, &messagesReceived](auto id, NetworkMessage& msg) {
+			messagesReceived++;
+			m_Server.sendMessage(id, msg);
+		});
+
+	std::vector<std::unique_ptr<TestClient>> clients;
+	for (std::size_t i = 0; i < clientCount; ++i) {
+		clients.push_back(std::make_unique<TestClient>(m_Server.getPort()));
+		ASSERT_TRUE(clients.back()->isConnected());
+
+		// Keep the listen backlog from overflowing
+		m_Server.poll(0);
+	}
+
+	ASSERT_TRUE(pollUntil(
+		m_Server, [&] { return m_Connected.size() == clientCount; }));
+
+	for (std::size_t i = 0; i < clientCount; ++i) {
+		clients[i]->send(makeMessage(std::to_string(i)));
+	}
+
+	ASSERT_TRUE(pollUntil(
+		m_Server, [&] { return messagesReceived == clientCount; }));
+
+	for (std::size_t i = 0; i < clientCount; ++i) {
+		auto received = clients[i]->receive();
+		ASSERT_EQ(received.size(), 1);
+
+		auto text = std::to_string(i);
+		ASSERT_TRUE(received.front().data ==
+			NetworkMessage::PayloadDataType(text.begin(), text.end()));
+	}
+}
+//=============================================================================
@@ -0,0 +1,100 @@
+#include "appcore/laserPoseCodec.h"
+#include "appcore/messages.h"
+#include "gtest/gtest.h"
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using PointType = common::Point3dType;
+}  // namespace
+
+//=============================================================================
+class LaserPoseCodecTest : public ::testing::Test
+{
+protected:
+	LaserUpdate makeLaserUpdate() const
+	{
+		LaserUpdate::PropertyListType propList{
+			{PropertyId::BASE, PointType{0.1, -2.5, 3.75}},
+			{PropertyId::TIP, PointType{-0.5, 1e-9, 42.0}},
+			{PropertyId::COLOR, common::ColorVectorType{0.0, 0.5, 1.0}}};
+
+		return LaserUpdate(propList, 17);
+	}
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(LaserPoseCodecTest, TestRoundTrip)
+{
+	auto pose = laserPose::fromLaserUpdate(makeLaserUpdate());
+	ASSERT_TRUE(pose.has_value());
+	pose->sequence = 123456;
+
+	laserPose::BufferType buffer;
+	laserPose::encode(pose.value(), buffer);
+
+	laserPose::LaserPose decoded;
+	ASSERT_TRUE(laserPose::decode(buffer.data(), buffer.size(), decoded));
+
+	ASSERT_EQ(decoded.id, 17);
+	ASSERT_EQ(decoded.sequence, 123456);
+	ASSERT_EQ(decoded.fields,
+		laserPose::BASE | laserPose::TIP | laserPose::COLOR);
+
+	// positions are transmitted at full precision
+	ASSERT_TRUE(decoded.base == pose->base);
+	ASSERT_TRUE(decoded.tip == pose->tip);
+
+	// colors are quantized to 8 bits per channel
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_NEAR(decoded.color[i], pose->color[i], 0.5 / 255.0);
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(LaserPoseCodecTest, TestPartialUpdate)
+{
+	LaserUpdate laserUpdate({{PropertyId::TIP, PointType{1.0, 2.0, 3.0}}}, 4);
+
+	auto pose = laserPose::fromLaserUpdate(laserUpdate);
+	ASSERT_TRUE(pose.has_value());
+
+	laserPose::BufferType buffer;
+	laserPose::encode(pose.value(), buffer);
+
+	laserPose::LaserPose decoded;
+	ASSERT_TRUE(laserPose::decode(buffer.data(), buffer.size(), decoded));
+
+	auto decodedUpdate = laserPose::toLaserUpdate(decoded);
+	ASSERT_EQ(decodedUpdate.id, 4);
+	ASSERT_EQ(decodedUpdate.propList.size(), 1);
+	ASSERT_TRUE(decodedUpdate.propList[0].first == PropertyId::TIP);
+	ASSERT_TRUE(std::get<PointType>(
+					decodedUpdate.propList[0].second) ==
+		PointType(1.0, 2.0, 3.0));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(LaserPoseCodecTest, TestUnsupportedPropertyFallsBack)
+{
+	auto laserUpdate = makeLaserUpdate();
+	laserUpdate.propList.push_back({PropertyId::TRANSFORM, true});
+
+	ASSERT_FALSE(laserPose::fromLaserUpdate(laserUpdate).has_value());
+	ASSERT_FALSE(laserPose::fromLaserUpdate(LaserUpdate{}).has_value());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(LaserPoseCodecTest, TestWrongSizeRejected)
+{
+	laserPose::BufferType buffer{};
+	laserPose::LaserPose decoded;
+
+	ASSERT_FALSE(
+		laserPose::decode(buffer.data(), buffer.size() - 1, decoded));
+}
+//=============================================================================
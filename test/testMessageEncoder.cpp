@@ -0,0 +1,206 @@
+#include "appcore/messageEncoder.h"
+#include "appcore/messages.h"
+#include "appcore/byteStreambuf.h"
+#include "appcore/serializationTypes.h"
+#include "gtest/gtest.h"
+
+#include <cereal/types/vector.hpp>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using ArchiveFormat = MessageEncoder::ArchiveFormat;
+using PropertyId = common::PropertyId;
+using PointType = common::Point3dType;
+using TransformType = common::TransformType;
+
+// Payload of a message in the binary archive holding nothing but a length,
+// as that of a string or a container
+NetworkMessage createLengthMsg(
+	NetworkMessage::DescriptorType type, cereal::size_type length)
+{
+	NetworkMessage msg;
+
+	{
+		serialization::VectorStreambuf buffer(msg.data);
+		std::ostream stream(&buffer);
+
+		serialization::BinaryOutputArchiveType archive(stream);
+		archive(cereal::make_size_tag(length));
+	}
+
+	msg.header = 0x00;
+	msg.type = type;
+	msg.type |= NetworkMessage::binaryArchiveFlag;
+	msg.size = msg.data.size();
+
+	return msg;
+}
+
+// One message in the binary archive of each payload a peer may send
+std::vector<NetworkMessage> createBinaryMsgs()
+{
+	MessageEncoder encoder{ArchiveFormat::BINARY};
+
+	TransformType transform{TransformType::Identity()};
+	transform.translation() = PointType{1.0, 2.0, 3.0};
+
+	const common::PropertyListType nodes{{PropertyId::NODES,
+		std::vector<common::VariantType>{
+			PointType{0.0, 0.0, 0.0}, PointType{1.0, 1.0, 1.0}}}};
+
+	Subscription subscription;
+	subscription.widgets.rateClass = Subscription::RateClass::PREVIEW;
+	subscription.widgets.ids = {1, 2, 3};
+
+	std::vector<NetworkMessage> msgs{
+		encoder.createPeerAddedMsg(PeerInfo{2, "alias", {1.0, 0.0, 0.0}}),
+		encoder.createLaserUpdateMsg(
+			LaserUpdate({{PropertyId::BASE, PointType{0.0, 0.0, 0.0}},
+							{PropertyId::TIP, PointType{0.0, 0.0, 1.0}}},
+				2)),
+		encoder.createVolumeUpdateMsg(
+			VolumeUpdate(VolumeUpdate::MessageType::PROPERTY_UPDATE,
+				{{PropertyId::TRANSFORM, transform}})),
+		encoder.createWidgetUpdateMsg(WidgetUpdate(
+			WidgetUpdate::MessageType::PROPERTY_UPDATE, 1, nodes, 2)),
+		encoder.createPlaneUpdateMsg(
+			PlaneUpdate(PlaneUpdate::MessageType::PROPERTY_UPDATE,
+				{{PropertyId::TRANSFORM, transform}})),
+		encoder.createStatisticsMsg("report"),
+		encoder.createSubscriptionMsg(subscription)};
+
+	for (const auto& msg : msgs) {
+		EXPECT_TRUE(msg.type & NetworkMessage::binaryArchiveFlag);
+	}
+
+	return msgs;
+}
+}  // namespace
+
+//=============================================================================
+TEST(MessageEncoderTest, TestBinaryArchiveIsNegotiated)
+{
+	const auto binaryMsg =
+		MessageEncoder{ArchiveFormat::BINARY}.createStatisticsMsg("report");
+	const auto jsonMsg = MessageEncoder{}.createStatisticsMsg("report");
+
+	MessageEncoder encoder;
+
+	int received = 0;
+	encoder.setOnStatisticsReceivedCallback(
+		[&received](const std::string& report) {
+			EXPECT_EQ(report, "report");
+			++received;
+		});
+
+	// Dropped unread until the sender negotiated the binary archive
+	encoder.processMessage(binaryMsg, 1);
+	EXPECT_EQ(received, 0);
+
+	encoder.setBinaryArchiveAccepted(1, true);
+	EXPECT_TRUE(encoder.acceptsBinaryArchive(1));
+	EXPECT_FALSE(encoder.acceptsBinaryArchive(2));
+
+	encoder.processMessage(binaryMsg, 1);
+	encoder.processMessage(binaryMsg, 2);
+	EXPECT_EQ(received, 1);
+
+	encoder.removeSender(1);
+	encoder.processMessage(binaryMsg, 1);
+	EXPECT_EQ(received, 1);
+
+	// JSON is read from every sender
+	encoder.processMessage(jsonMsg, 2);
+	EXPECT_EQ(received, 2);
+
+	// as is the binary archive by an encoder set to it
+	encoder.setArchiveFormat(ArchiveFormat::BINARY);
+	encoder.processMessage(binaryMsg, 2);
+	EXPECT_EQ(received, 3);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(MessageEncoderTest, TestLengthBeyondPayloadIsRefused)
+{
+	// A few bytes declaring a length no payload could hold
+	const auto msg =
+		createLengthMsg(NetworkMessage::STATISTICS, cereal::size_type{1} << 62);
+
+	// Refused as it is read, before anything is sized to it
+	{
+		serialization::SpanStreambuf buffer(msg.data.data(), msg.data.size());
+		std::istream stream(&buffer);
+		serialization::BinaryInputArchiveType archive(buffer, stream);
+
+		std::vector<std::uint8_t> bytes;
+		EXPECT_THROW(archive(bytes), cereal::Exception);
+		EXPECT_TRUE(bytes.empty());
+	}
+
+	MessageEncoder encoder;
+	encoder.setBinaryArchiveAccepted(1, true);
+
+	bool received = false;
+	encoder.setOnStatisticsReceivedCallback(
+		[&received](const std::string&) { received = true; });
+
+	// and the message is dropped
+	EXPECT_NO_THROW(encoder.processMessage(msg, 1));
+	EXPECT_FALSE(received);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(MessageEncoderTest, TestFuzzedBinaryPayloads)
+{
+	// Random corruption of binary payloads must never crash the receiver,
+	// whatever lengths, indices and values it ends up reading
+	std::mt19937 generator{1234};
+	std::uniform_int_distribution<int> byteDistribution(0, 255);
+
+	MessageEncoder encoder;
+	encoder.setBinaryArchiveAccepted(1, true);
+
+	for (const auto& original : createBinaryMsgs()) {
+		ASSERT_FALSE(original.data.empty());
+
+		for (int round = 0; round < 200; ++round) {
+			auto msg = original;
+
+			// flip or overwrite bytes, or cut the payload short
+			for (int i = 0; i < 1 + round % 8; ++i) {
+				std::uniform_int_distribution<std::size_t> positionDistribution(
+					0, msg.data.size() - 1);
+				const auto position = positionDistribution(generator);
+				const auto byte =
+					static_cast<std::uint8_t>(byteDistribution(generator));
+
+				switch (i % 3) {
+					case 0: msg.data[position] ^= 0x10; break;
+					case 1: msg.data[position] = byte; break;
+					default:
+						if (round % 4 == 0) {
+							msg.data.resize(position);
+						}
+						break;
+				}
+
+				if (msg.data.empty()) {
+					break;
+				}
+			}
+			msg.size = msg.data.size();
+
+			ASSERT_NO_THROW(encoder.processMessage(msg, 1));
+		}
+	}
+}
+//=============================================================================
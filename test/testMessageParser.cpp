@@ -1,7 +1,14 @@
 #include "networking/networkMessageParser.h"
 #include "networking/networkMessage.h"
+#include "networking/encodedMessage.h"
+#include "networking/messageBatch.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
 #ifdef _WIN32
 #include <WinSock2.h>
 #else
@@ -209,9 +216,522 @@ TEST_F(NetworkMessageParserTest, TestMessageSizeTooSmall)
 }
 //=============================================================================
 
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestMessageSplitAcrossChunks)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::PEER_ADDED;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	auto byteArray = msg.serialize();
+
+	NetworkMessage decodedMsg;
+	int msgCount{0};
+
+	m_MessageParser.setMessageReadyCallback(
+		[&decodedMsg, &msgCount](const NetworkMessage& msg) {
+			decodedMsg = msg;
+			msgCount++;
+		});
+
+	// feed the message one byte at a time so that every field is split
+	// across separate chunks
+	for (const auto& byte : byteArray) {
+		m_MessageParser.parse(QByteArray(&byte, 1));
+	}
+	std::string payload = {decodedMsg.data.begin(), decodedMsg.data.end()};
+
+	ASSERT_EQ(msgCount, 1);
+	ASSERT_TRUE(decodedMsg.type == NetworkMessage::MessageType::PEER_ADDED);
+	ASSERT_TRUE(message == payload);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestMultipleMessagesInOneChunk)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::PEER_ADDED;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	NetworkMessage emptyMsg;
+	emptyMsg.header = 0x00;
+	emptyMsg.type = NetworkMessage::MessageType::REQUEST_CREDENTIALS;
+	emptyMsg.size = 0;
+
+	QByteArray byteArray;
+	byteArray.append(msg.serialize());
+	byteArray.append(emptyMsg.serialize());
+	byteArray.append(msg.serialize());
+
+	std::vector<NetworkMessage> decodedMsgs;
+
+	m_MessageParser.setMessageReadyCallback(
+		[&decodedMsgs](const NetworkMessage& msg) {
+			decodedMsgs.push_back(msg);
+		});
+
+	// split the stream at an arbitrary point inside the second header
+	const int splitPoint = msg.serialize().size() + 3;
+	m_MessageParser.parse(byteArray.mid(0, splitPoint));
+	m_MessageParser.parse(byteArray.mid(splitPoint));
+
+	ASSERT_EQ(decodedMsgs.size(), 3);
+	ASSERT_TRUE(decodedMsgs[0].data == msg.data);
+	ASSERT_TRUE(decodedMsgs[1].type ==
+		NetworkMessage::MessageType::REQUEST_CREDENTIALS);
+	ASSERT_TRUE(decodedMsgs[1].data.empty());
+	ASSERT_TRUE(decodedMsgs[2].data == msg.data);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestSerializeSegments)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::WIDGET_EVENT;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	auto byteArray = msg.serialize();
+	auto segments = msg.serializeSegments();
+
+	ASSERT_EQ(static_cast<std::size_t>(byteArray.size()),
+		NetworkMessage::prefixSize + msg.data.size() +
+			NetworkMessage::trailerSize);
+
+	// the scatter/gather segments must describe exactly the same frame
+	QByteArray gathered;
+	gathered.append(reinterpret_cast<const char*>(segments.prefix.data()),
+		segments.prefix.size());
+	gathered.append(reinterpret_cast<const char*>(segments.payload),
+		segments.payloadSize);
+	gathered.append(reinterpret_cast<const char*>(segments.trailer.data()),
+		segments.trailer.size());
+
+	ASSERT_TRUE(gathered == byteArray);
+	ASSERT_EQ(segments.payload, msg.data.data());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestEncodedMessage)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	EncodedMessage encodedMsg{msg};
+	EncodedMessage copiedMsg = encodedMsg;
+
+	ASSERT_TRUE(encodedMsg.getBytes() == msg.serialize());
+	ASSERT_EQ(copiedMsg.getType(), NetworkMessage::MessageType::LASER_UPDATED);
+
+	// copies share the encoded bytes rather than duplicating them
+	ASSERT_EQ(copiedMsg.getBytes().constData(),
+		encodedMsg.getBytes().constData());
+
+	NetworkMessage decodedMsg;
+	m_MessageParser.setMessageReadyCallback(
+		[&decodedMsg](const NetworkMessage& msg) { decodedMsg = msg; });
+	m_MessageParser.parse(copiedMsg.getBytes());
+
+	std::string payload = {decodedMsg.data.begin(), decodedMsg.data.end()};
+	ASSERT_TRUE(message == payload);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestMessageBatch)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	NetworkMessage emptyMsg;
+	emptyMsg.header = 0x00;
+	emptyMsg.type = NetworkMessage::MessageType::AUTHORIZATION_FAILED;
+	emptyMsg.size = 0;
+
+	NetworkMessage flaggedMsg = msg;
+	flaggedMsg.type = NetworkMessage::MessageType::WIDGET_EVENT |
+		NetworkMessage::binaryArchiveFlag;
+
+	NetworkMessage batch;
+	batch.header = 0x00;
+	batch.type = NetworkMessage::MessageType::MESSAGE_BATCH;
+	messageBatch::append(batch.data, msg);
+	messageBatch::append(batch.data, emptyMsg);
+	messageBatch::append(batch.data, EncodedMessage{flaggedMsg});
+	batch.size = batch.data.size();
+
+	ASSERT_EQ(batch.data.size(),
+		3 * messageBatch::entryPrefixSize + 2 * msg.data.size());
+
+	std::vector<NetworkMessage> decodedMsgs;
+	m_MessageParser.setMessageReadyCallback(
+		[&decodedMsgs](const NetworkMessage& msg) {
+			decodedMsgs.push_back(msg);
+		});
+
+	// a batch is an ordinary frame, so it may arrive in pieces too
+	auto byteArray = batch.serialize();
+	m_MessageParser.parse(byteArray.mid(0, 10));
+	m_MessageParser.parse(byteArray.mid(10));
+
+	ASSERT_EQ(decodedMsgs.size(), 3);
+	ASSERT_EQ(decodedMsgs[0].type, NetworkMessage::MessageType::LASER_UPDATED);
+	ASSERT_EQ(decodedMsgs[0].size, msg.size);
+	ASSERT_TRUE(decodedMsgs[0].data == msg.data);
+	ASSERT_EQ(decodedMsgs[1].type,
+		NetworkMessage::MessageType::AUTHORIZATION_FAILED);
+	ASSERT_TRUE(decodedMsgs[1].data.empty());
+	ASSERT_EQ(decodedMsgs[2].type, flaggedMsg.type);
+	ASSERT_TRUE(decodedMsgs[2].data == msg.data);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestCorruptedMessageBatch)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::PLANE_EVENT;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	NetworkMessage batch;
+	batch.header = 0x00;
+	batch.type = NetworkMessage::MessageType::MESSAGE_BATCH;
+	messageBatch::append(batch.data, msg);
+	messageBatch::append(batch.data, msg);
+	batch.size = batch.data.size();
+
+	int msgCount = 0;
+	m_MessageParser.setMessageReadyCallback(
+		[&msgCount](const NetworkMessage&) { msgCount++; });
+
+	// a single checksum covers the whole batch, so none of it is delivered
+	auto byteArray = batch.serialize();
+	byteArray.data()[NetworkMessage::prefixSize + 3] ^= 0x01;
+	m_MessageParser.parse(byteArray);
+	ASSERT_EQ(msgCount, 0);
+
+	// a packed message overrunning the batch ends it, keeping what came
+	// before
+	batch.data.pop_back();
+	batch.size = batch.data.size();
+	m_MessageParser.parse(batch.serialize());
+	ASSERT_EQ(msgCount, 1);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestNestedMessageBatchIsSkipped)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::PLANE_EVENT;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	NetworkMessage inner;
+	inner.header = 0x00;
+	inner.type = NetworkMessage::MessageType::MESSAGE_BATCH;
+	messageBatch::append(inner.data, msg);
+	inner.size = inner.data.size();
+
+	// batches are not delivered whether or not the archive flag is set
+	NetworkMessage flaggedInner = inner;
+	flaggedInner.type |= NetworkMessage::binaryArchiveFlag;
+
+	NetworkMessage batch;
+	batch.header = 0x00;
+	batch.type = NetworkMessage::MessageType::MESSAGE_BATCH;
+	messageBatch::append(batch.data, inner);
+	messageBatch::append(batch.data, flaggedInner);
+	messageBatch::append(batch.data, msg);
+	batch.size = batch.data.size();
+
+	std::vector<NetworkMessage::DescriptorType> types;
+	ASSERT_TRUE(messageBatch::unpack(batch.data,
+		[&types](const NetworkMessage& msg) { types.push_back(msg.type); }));
+	ASSERT_EQ(types.size(), 1u);
+	EXPECT_EQ(types[0], NetworkMessage::MessageType::PLANE_EVENT);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestFrameV2)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	const auto format = NetworkMessage::FrameFormat::V2;
+	auto byteArray = msg.serialize(format);
+	auto segments = msg.serializeSegments(format);
+
+	ASSERT_EQ(static_cast<std::size_t>(byteArray.size()),
+		NetworkMessage::prefixSizeV2 + msg.data.size() +
+			NetworkMessage::trailerSize);
+	ASSERT_EQ(NetworkMessage::getPrefixSize(format),
+		NetworkMessage::prefixSizeV2);
+
+	QByteArray gathered;
+	gathered.append(reinterpret_cast<const char*>(segments.prefix.data()),
+		segments.prefix.size());
+	gathered.append(reinterpret_cast<const char*>(segments.payload),
+		segments.payloadSize);
+	gathered.append(reinterpret_cast<const char*>(segments.trailer.data()),
+		segments.trailer.size());
+
+	ASSERT_TRUE(gathered == byteArray);
+
+	std::vector<NetworkMessage> decodedMsgs;
+	m_MessageParser.setMessageReadyCallback(
+		[&decodedMsgs](const NetworkMessage& msg) {
+			decodedMsgs.push_back(msg);
+		});
+
+	// whole, then one byte at a time so that the prefix is split as well
+	m_MessageParser.parse(byteArray);
+	for (const auto& byte : byteArray) {
+		m_MessageParser.parse(QByteArray(&byte, 1));
+	}
+
+	ASSERT_EQ(decodedMsgs.size(), 2);
+	for (const auto& decodedMsg : decodedMsgs) {
+		ASSERT_EQ(decodedMsg.type, NetworkMessage::MessageType::LASER_UPDATED);
+		ASSERT_TRUE(decodedMsg.data == msg.data);
+	}
+	ASSERT_EQ(m_MessageParser.getCurrentMessageSize(), 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestFrameV2Resynchronizes)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::PLANE_EVENT;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	const auto frame = msg.serialize(NetworkMessage::FrameFormat::V2);
+
+	// garbage holding partial sync words and zero bytes, a frame whose
+	// prefix is corrupt, and one whose payload is
+	QByteArray byteArray;
+	byteArray.append("\xE9\x1C\x00\xE9\x1C\x5B\x00\x00", 8);
+	auto corruptPrefix = frame;
+	corruptPrefix.data()[5] ^= 0x01;
+	byteArray.append(corruptPrefix);
+	auto corruptPayload = frame;
+	corruptPayload.data()[NetworkMessage::prefixSizeV2 + 1] ^= 0x01;
+	byteArray.append(corruptPayload);
+	byteArray.append(frame);
+
+	int msgCount = 0;
+	m_MessageParser.setMessageReadyCallback(
+		[&msgCount, &msg](const NetworkMessage& decodedMsg) {
+			ASSERT_TRUE(decodedMsg.data == msg.data);
+			msgCount++;
+		});
+
+	m_MessageParser.parse(byteArray);
+	ASSERT_EQ(msgCount, 1);
+
+	// version 1 frames are ignored once the peer has sent version 2 ones
+	m_MessageParser.parse(msg.serialize());
+	m_MessageParser.parse(frame);
+	ASSERT_EQ(msgCount, 2);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestMaxPayloadSizePerType)
+{
+	ASSERT_LT(NetworkMessage::getMaxPayloadSize(
+				  NetworkMessage::MessageType::LASER_POSE),
+		NetworkMessage::getMaxPayloadSize(
+			NetworkMessage::MessageType::MESSAGE_BATCH));
+	ASSERT_LT(NetworkMessage::getMaxPayloadSize(
+				  NetworkMessage::MessageType::MESSAGE_BATCH),
+		NetworkMessage::getMaxPayloadSize(
+			NetworkMessage::MessageType::VOLUME_UPDATED));
+	ASSERT_LE(NetworkMessage::getMaxPayloadSize(
+				  NetworkMessage::MessageType::FULL_STATE),
+		NetworkMessage::maxPayloadSize);
+
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_POSE;
+	msg.data = {1, 2, 3, 4};
+	msg.size = msg.data.size();
+
+	int msgCount = 0;
+	m_MessageParser.setMessageReadyCallback(
+		[&msgCount](const NetworkMessage&) { msgCount++; });
+
+	// a pose claiming to be huge is dropped without reserving its payload,
+	// and the frame following it still arrives
+	for (const auto format :
+		{NetworkMessage::FrameFormat::V1, NetworkMessage::FrameFormat::V2}) {
+		auto oversized = msg;
+		oversized.size = NetworkMessage::getMaxPayloadSize(msg.type) + 1;
+
+		m_MessageParser.parse(oversized.serialize(format));
+		ASSERT_EQ(m_MessageParser.getCurrentMessageSize(), 0);
+
+		m_MessageParser.parse(msg.serialize(format));
+	}
+	ASSERT_EQ(msgCount, 2);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestEncodedMessageFrameFormat)
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::WIDGET_EVENT;
+	std::string message{"Hello world"};
+	msg.data = {message.begin(), message.end()};
+	msg.size = msg.data.size();
+
+	EncodedMessage encodedMsg{msg};
+	encodedMsg.setSupersedeKey(42);
+
+	auto convertedMsg =
+		encodedMsg.withFrameFormat(NetworkMessage::FrameFormat::V2);
+	ASSERT_EQ(convertedMsg.getFrameFormat(), NetworkMessage::FrameFormat::V2);
+	ASSERT_EQ(convertedMsg.getType(), msg.type);
+	ASSERT_EQ(convertedMsg.getSupersedeKey(), encodedMsg.getSupersedeKey());
+	ASSERT_TRUE(convertedMsg.getBytes() ==
+		msg.serialize(NetworkMessage::FrameFormat::V2));
+
+	// no copy when the format already matches
+	auto sameMsg =
+		convertedMsg.withFrameFormat(NetworkMessage::FrameFormat::V2);
+	ASSERT_EQ(sameMsg.getBytes().constData(),
+		convertedMsg.getBytes().constData());
+
+	// batches hold the same entries whichever format they were encoded in
+	NetworkMessage batch;
+	batch.header = 0x00;
+	batch.type = NetworkMessage::MessageType::MESSAGE_BATCH;
+	messageBatch::append(batch.data, encodedMsg);
+	messageBatch::append(batch.data, convertedMsg);
+	batch.size = batch.data.size();
+
+	const auto entrySize = messageBatch::entryPrefixSize + msg.data.size();
+	ASSERT_EQ(batch.data.size(), 2 * entrySize);
+	ASSERT_TRUE(std::equal(batch.data.begin(), batch.data.begin() + entrySize,
+		batch.data.begin() + entrySize));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(NetworkMessageParserTest, TestFuzzedStream)
+{
+	// Random corruption of a stream of frames must never crash the parser or
+	// deliver a damaged message, and it must pick up the frames following
+	// the damage
+	std::mt19937 generator{1234};
+	std::uniform_int_distribution<int> byteDistribution(0, 255);
+
+	std::vector<NetworkMessage> msgs;
+	for (int i = 0; i < 64; ++i) {
+		NetworkMessage msg;
+		msg.header = 0x00;
+		msg.type = (i % 2) ? NetworkMessage::MessageType::LASER_POSE
+						   : NetworkMessage::MessageType::WIDGET_EVENT;
+		msg.data.resize(i * 7 % 200);
+		for (auto& byte : msg.data) {
+			byte = static_cast<std::uint8_t>(byteDistribution(generator));
+		}
+		msg.size = msg.data.size();
+		msgs.push_back(std::move(msg));
+	}
+
+	const auto isSent = [&msgs](const NetworkMessage& decodedMsg) {
+		return std::any_of(msgs.begin(), msgs.end(), [&](const auto& msg) {
+			return (msg.type == decodedMsg.type) &&
+				(msg.data == decodedMsg.data);
+		});
+	};
+
+	for (int round = 0; round < 200; ++round) {
+		NetworkMessageParser parser;
+
+		bool allSent = true;
+		NetworkMessage lastMsg;
+		parser.setMessageReadyCallback([&](const NetworkMessage& msg) {
+			allSent = allSent && isSent(msg);
+			lastMsg = msg;
+		});
+
+		QByteArray stream;
+		for (const auto& msg : msgs) {
+			stream.append(msg.serialize(NetworkMessage::FrameFormat::V2));
+		}
+
+		// flip, overwrite or insert bytes in the first half
+		std::uniform_int_distribution<int> positionDistribution(
+			0, stream.size() / 2);
+		for (int i = 0; i < 1 + round % 16; ++i) {
+			const auto position = positionDistribution(generator);
+			const auto byte = static_cast<char>(byteDistribution(generator));
+
+			switch (i % 3) {
+				case 0: stream.data()[position] ^= 0x10; break;
+				case 1: stream.data()[position] = byte; break;
+				default: stream.insert(position, byte); break;
+			}
+		}
+
+		// an untouched frame follows
+		stream.append(msgs.back().serialize(NetworkMessage::FrameFormat::V2));
+
+		std::uniform_int_distribution<int> chunkDistribution(1, 64);
+		for (int offset = 0; offset < stream.size();) {
+			const auto chunkSize = chunkDistribution(generator);
+			parser.parse(stream.mid(offset, chunkSize));
+			offset += chunkSize;
+		}
+
+		ASSERT_TRUE(allSent);
+		ASSERT_EQ(lastMsg.type, msgs.back().type);
+		ASSERT_TRUE(lastMsg.data == msgs.back().data);
+		ASSERT_EQ(parser.getCurrentMessageSize(), 0);
+	}
+}
+//=============================================================================
+
 //=============================================================================
 int main(int argc, char* argv[])
 {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,129 @@
+#include "networking/messageStatistics.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+//=============================================================================
+TEST(MessageStatisticsTest, TestHistogramBuckets)
+{
+	using Histogram = MessageStatistics::Histogram;
+
+	EXPECT_EQ(Histogram::getBucket(0ns), 0u);
+	EXPECT_EQ(Histogram::getBucket(1023ns), 0u);
+	EXPECT_EQ(Histogram::getBucket(1024ns), 1u);
+	EXPECT_EQ(Histogram::getBucket(10s), Histogram::bucketCount - 1);
+
+	// Every latency lies within 25% below the limit of its bucket, and the
+	// buckets are ordered
+	std::size_t previousBucket{0};
+	for (auto latency = 1024ns; latency < 4s; latency = latency * 9 / 8) {
+		const auto bucket = Histogram::getBucket(latency);
+		const auto limit = Histogram::getBucketLimit(bucket);
+
+		EXPECT_GE(bucket, previousBucket);
+		EXPECT_GE(limit, latency);
+		EXPECT_LE(limit.count(), latency.count() * 5 / 4);
+
+		previousBucket = bucket;
+	}
+}
+//=============================================================================
+
+//=============================================================================
+TEST(MessageStatisticsTest, TestPercentiles)
+{
+	MessageStatistics statistics;
+	const auto type = NetworkMessage::LASER_POSE;
+	const auto stage = MessageStatistics::Stage::HANDLE;
+
+	for (int i = 0; i < 99; ++i) {
+		statistics.record(stage, type, 40, 10us);
+	}
+	statistics.record(stage, type, 40, 5ms);
+
+	const auto snapshot = statistics.getSnapshot();
+	const auto& entry = snapshot.get(type, stage);
+
+	EXPECT_EQ(entry.messages, 100u);
+	EXPECT_EQ(entry.bytes, 4000u);
+	EXPECT_EQ(entry.latency.getCount(), 100u);
+
+	EXPECT_GE(entry.latency.getPercentile(0.5), 10us);
+	EXPECT_LT(entry.latency.getPercentile(0.99), 13us);
+	EXPECT_GE(entry.latency.getPercentile(1.0), 5ms);
+
+	// Flagged types count as the type itself
+	const auto flaggedType = type | NetworkMessage::binaryArchiveFlag;
+	EXPECT_EQ(&snapshot.get(flaggedType, stage), &entry);
+	EXPECT_EQ(snapshot.get(type, MessageStatistics::Stage::PARSE).messages, 0u);
+
+	const auto report = MessageStatistics::format(snapshot);
+	EXPECT_NE(report.find("LASER_POSE handle n=100"), std::string::npos);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(MessageStatisticsTest, TestConcurrentRecording)
+{
+	MessageStatistics statistics;
+	const auto stage = MessageStatistics::Stage::PARSE;
+
+	constexpr int threadCount = 8;
+	constexpr int messageCount = 10000;
+
+	const auto before = statistics.getSnapshot();
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; ++i) {
+		threads.emplace_back([&statistics, stage, i] {
+			const auto type =
+				static_cast<NetworkMessage::DescriptorType>(i % 2);
+			for (int j = 0; j < messageCount; ++j) {
+				statistics.record(stage, type, 1, 1us);
+			}
+		});
+	}
+
+	// Snapshots may be taken while recording goes on
+	statistics.getSnapshot();
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	const auto difference = statistics.getSnapshot() - before;
+	EXPECT_EQ(difference.get(0, stage).messages,
+		threadCount / 2 * messageCount);
+	EXPECT_EQ(difference.get(1, stage).latency.getCount(),
+		threadCount / 2 * messageCount);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(MessageStatisticsTest, TestStageTimer)
+{
+	MessageStatistics statistics;
+	const auto type = NetworkMessage::WIDGET_EVENT;
+
+	{
+		MessageStatistics::StageTimer timer{
+			statistics, type, 16, MessageStatistics::Stage::DECODE};
+		timer.next(MessageStatistics::Stage::HANDLE);
+		std::this_thread::sleep_for(2ms);
+	}
+
+	const auto snapshot = statistics.getSnapshot();
+	const auto& decode = snapshot.get(type, MessageStatistics::Stage::DECODE);
+	const auto& handle = snapshot.get(type, MessageStatistics::Stage::HANDLE);
+
+	EXPECT_EQ(decode.messages, 1u);
+	EXPECT_EQ(handle.messages, 1u);
+	EXPECT_EQ(handle.bytes, 16u);
+	EXPECT_GE(handle.latency.getPercentile(1.0), 2ms);
+	EXPECT_LT(decode.latency.getPercentile(1.0), 2ms);
+}
+//=============================================================================
@@ -0,0 +1,77 @@
+#include "networking/payloadPool.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <utility>
+
+//=============================================================================
+TEST(PayloadPoolTest, TestReleasedBufferIsReused)
+{
+	PayloadPool pool;
+
+	auto buffer = pool.acquire();
+	EXPECT_EQ(buffer.capacity(), 0u);
+
+	buffer.resize(512);
+	const auto data = buffer.data();
+	pool.release(std::move(buffer));
+
+	auto recycled = pool.acquire();
+	EXPECT_TRUE(recycled.empty());
+	EXPECT_GE(recycled.capacity(), 512u);
+	EXPECT_EQ(recycled.data(), data);
+
+	auto statistics = pool.getStatistics();
+	EXPECT_EQ(statistics.acquired, 2u);
+	EXPECT_EQ(statistics.reused, 1u);
+	EXPECT_EQ(statistics.released, 1u);
+	EXPECT_EQ(statistics.discarded, 0u);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(PayloadPoolTest, TestLargeBufferIsDiscarded)
+{
+	PayloadPool pool;
+
+	PayloadPool::PayloadDataType buffer;
+	buffer.reserve(PayloadPool::maxBufferCapacity + 1);
+	pool.release(std::move(buffer));
+
+	EXPECT_EQ(pool.acquire().capacity(), 0u);
+	EXPECT_EQ(pool.getStatistics().discarded, 1u);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(PayloadPoolTest, TestSharedMessageReturnsPayload)
+{
+	PayloadPool pool;
+
+	NetworkMessage msg;
+	msg.type = NetworkMessage::LASER_UPDATED;
+	msg.data = {1, 2, 3, 4};
+	msg.size = msg.data.size();
+	const auto data = msg.data.data();
+
+	auto shared = pool.share(msg);
+	ASSERT_TRUE(shared);
+	EXPECT_EQ(shared->type, NetworkMessage::LASER_UPDATED);
+	EXPECT_EQ(shared->data, (NetworkMessage::PayloadDataType{1, 2, 3, 4}));
+	EXPECT_EQ(shared->data.data(), data);
+
+	// The message is ready to be parsed into again
+	EXPECT_TRUE(msg.data.empty());
+
+	auto copy = shared;
+	shared.reset();
+	EXPECT_EQ(pool.getStatistics().released, 0u);
+
+	copy.reset();
+	EXPECT_EQ(pool.getStatistics().released, 1u);
+
+	// The next message is parsed into the same buffer
+	pool.share(msg);
+	EXPECT_EQ(msg.data.data(), data);
+}
+//=============================================================================
@@ -0,0 +1,107 @@
+#include "common/propertyKey.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using common::PropertyId;
+using common::PropertyKey;
+
+namespace
+{
+// Allocations not yet freed, counted by the global operators below
+std::atomic<long> liveAllocations{0};
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+	void* ptr = std::malloc((size > 0) ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+
+	++liveAllocations;
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (ptr) {
+		--liveAllocations;
+		std::free(ptr);
+	}
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+//=============================================================================
+TEST(PropertyKeyTest, TestRegisteredNames)
+{
+	for (std::size_t i = 0; i < common::propertyNames.size(); ++i) {
+		const PropertyKey key{static_cast<PropertyId>(i)};
+
+		EXPECT_EQ(PropertyKey::fromName(key.getName()), key);
+		EXPECT_EQ(PropertyKey::fromName(key.getName()).getId(), key.getId());
+	}
+
+	EXPECT_EQ(PropertyKey{PropertyId::TRANSFORM}.getName(), "transform");
+}
+//=============================================================================
+
+//=============================================================================
+TEST(PropertyKeyTest, TestUnregisteredNameIsKept)
+{
+	std::string name{"opacity"};
+	const auto key = PropertyKey::fromName(name);
+
+	// The name outlives the string it was read from
+	name.clear();
+
+	EXPECT_EQ(key.getId(), PropertyId::UNKNOWN);
+	EXPECT_EQ(key.getName(), "opacity");
+
+	EXPECT_EQ(key, PropertyKey::fromName("opacity"));
+	EXPECT_NE(key, PropertyKey::fromName("window"));
+	EXPECT_NE(key, PropertyKey{PropertyId::UNKNOWN});
+	EXPECT_EQ(PropertyKey::fromName("unknown"), PropertyKey{});
+}
+//=============================================================================
+
+//=============================================================================
+TEST(PropertyKeyTest, TestUnregisteredId)
+{
+	// As read from the binary archive of a newer peer
+	const PropertyKey key{static_cast<PropertyId>(0x0100)};
+
+	EXPECT_EQ(key.getName(), "unknown");
+	EXPECT_NE(key, PropertyKey{PropertyId::UNKNOWN});
+}
+//=============================================================================
+
+//=============================================================================
+TEST(PropertyKeyTest, TestUnregisteredNamesAreNotKept)
+{
+	// Names of a hostile peer, each new and too long to be stored inline
+	const std::string prefix(32, 'x');
+	std::string name;
+	name.reserve(prefix.size() + 16);
+
+	const auto allocations = liveAllocations.load();
+	for (int i = 0; i < 100000; ++i) {
+		name.assign(prefix);
+		name.append(std::to_string(i));
+
+		const auto key = PropertyKey::fromName(name);
+		ASSERT_EQ(key.getId(), PropertyId::UNKNOWN);
+		ASSERT_EQ(key.getName(), name);
+	}
+
+	// Nothing of the names is left once their keys are gone
+	EXPECT_EQ(liveAllocations.load(), allocations);
+}
+//=============================================================================
@@ -0,0 +1,190 @@
+#include "appcore/sceneState.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using PropertyListType = common::PropertyListType;
+using PointType = common::Point3dType;
+using TransformType = common::TransformType;
+using VariantType = common::VariantType;
+using ObjectType = SceneState::ObjectType;
+
+TransformType makeTranslation(double x, double y, double z)
+{
+	TransformType transform{TransformType::Identity()};
+	transform.translation() = PointType{x, y, z};
+	return transform;
+}
+
+std::vector<VariantType> makeNodes(std::size_t count)
+{
+	std::vector<VariantType> nodes;
+	for (std::size_t i = 0; i < count; ++i) {
+		nodes.push_back(PointType{1.0 * i, 0.0, 0.0});
+	}
+
+	return nodes;
+}
+}  // namespace
+
+//=============================================================================
+TEST(SceneStateTest, TestObjectsAreSortedById)
+{
+	SceneState scene;
+
+	for (common::IdType id : {5, 1, 3}) {
+		scene.addLaser(id, {1.0, 0.0, 0.0});
+		scene.addWidget(id);
+	}
+
+	// Adding an existing object keeps it as it is
+	EXPECT_EQ(scene.addLaser(3, {0.0, 0.0, 1.0}).color[0], 1.0);
+
+	ASSERT_EQ(scene.getLasers().size(), 3);
+	EXPECT_EQ(scene.getLasers()[0].id, 1);
+	EXPECT_EQ(scene.getLasers()[1].id, 3);
+	EXPECT_EQ(scene.getLasers()[2].id, 5);
+
+	EXPECT_TRUE(scene.removeWidget(3));
+	EXPECT_FALSE(scene.removeWidget(3));
+	EXPECT_EQ(scene.findWidget(3), nullptr);
+	ASSERT_NE(scene.findWidget(5), nullptr);
+	EXPECT_EQ(scene.findWidget(5)->id, 5);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SceneStateTest, TestLaserUpdate)
+{
+	SceneState scene;
+	scene.addLaser(7, {0.0, 1.0, 0.0});
+
+	auto updates = scene.updateLaser(7,
+		{{PropertyId::BASE, PointType{1.0, 2.0, 3.0}},
+			{PropertyId::COLOR, common::ColorVectorType{2.0, 0.5, -1.0}},
+			{PropertyId::TRANSFORM, TransformType::Identity()}});
+
+	ASSERT_EQ(updates.size(), 1);
+	EXPECT_EQ(updates[0].type, ObjectType::LASER);
+	EXPECT_EQ(updates[0].id, 7);
+
+	// Lasers have no transform, and colors are clamped
+	const auto& propList = updates[0].propList;
+	ASSERT_EQ(propList.size(), 2);
+	EXPECT_TRUE(propList[0].first == PropertyId::BASE);
+	EXPECT_TRUE(propList[1].first == PropertyId::COLOR);
+	EXPECT_EQ(std::get<common::ColorVectorType>(propList[1].second),
+		(common::ColorVectorType{1.0, 0.5, 0.0}));
+
+	const auto laser = scene.findLaser(7);
+	ASSERT_NE(laser, nullptr);
+	EXPECT_TRUE(laser->base == PointType(1.0, 2.0, 3.0));
+	EXPECT_TRUE(laser->tip ==
+		PointType(0.0, 0.0, -SceneState::defaultLaserLength));
+
+	// Nothing to update for a peer without a laser
+	EXPECT_TRUE(scene.updateLaser(8, propList).empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SceneStateTest, TestInvalidValuesAreSkipped)
+{
+	SceneState scene;
+	scene.addLaser(1, {0.0, 1.0, 0.0});
+
+	const auto nan = std::numeric_limits<double>::quiet_NaN();
+
+	EXPECT_TRUE(scene.updateLaser(1,
+						 {{PropertyId::TIP, PointType{nan, 0.0, 0.0}},
+							 {PropertyId::BASE, std::string{"base"}}})
+					.empty());
+	EXPECT_TRUE(scene.findLaser(1)->base == PointType::Zero());
+
+	EXPECT_TRUE(
+		scene.updateVolume({{PropertyId::TRANSFORM, PointType::Zero()}})
+			.empty());
+	EXPECT_TRUE(scene.getVolume().transform.isApprox(
+		TransformType::Identity()));
+
+	auto transform = makeTranslation(0.0, 0.0, nan);
+	EXPECT_TRUE(
+		scene.updatePlane({{PropertyId::TRANSFORM, transform}}).empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SceneStateTest, TestWidgetNodes)
+{
+	SceneState scene;
+	scene.addWidget(0);
+
+	auto updates = scene.updateWidget(0,
+		{{PropertyId::TRANSFORM, makeTranslation(10.0, 0.0, 0.0)},
+			{PropertyId::NODES, makeNodes(3)}});
+	ASSERT_EQ(updates.size(), 1);
+	ASSERT_EQ(updates[0].propList.size(), 2);
+
+	// Nodes are given and echoed in scene coordinates
+	auto nodes = scene.findWidget(0)->getNodes();
+	ASSERT_EQ(nodes.size(), 3);
+	EXPECT_TRUE(nodes[2].isApprox(PointType(2.0, 0.0, 0.0)));
+
+	// Moving the widget moves its nodes along
+	scene.updateWidget(
+		0, {{PropertyId::TRANSFORM, makeTranslation(20.0, 0.0, 0.0)}});
+	nodes = scene.findWidget(0)->getNodes();
+	EXPECT_TRUE(nodes[2].isApprox(PointType(12.0, 0.0, 0.0)));
+
+	updates = scene.updateWidget(0,
+		{{PropertyId::NODE_POSITION,
+			 std::vector<VariantType>{
+				 std::uint16_t{1}, PointType{0.0, 5.0, 0.0}}},
+			{PropertyId::NODE_POSITION,
+				std::vector<VariantType>{
+					std::uint16_t{3}, PointType{0.0, 5.0, 0.0}}},
+			{PropertyId::NODES, std::vector<VariantType>{}}});
+
+	// Out of range nodes and empty node lists are skipped
+	ASSERT_EQ(updates.size(), 1);
+	ASSERT_EQ(updates[0].propList.size(), 1);
+	const auto& indexValuePair =
+		std::get<std::vector<VariantType>>(updates[0].propList[0].second);
+	EXPECT_EQ(std::get<std::uint16_t>(indexValuePair[0]), 1);
+	EXPECT_TRUE(std::get<PointType>(indexValuePair[1])
+					.isApprox(PointType(0.0, 5.0, 0.0)));
+
+	nodes = scene.findWidget(0)->getNodes();
+	ASSERT_EQ(nodes.size(), 3);
+	EXPECT_TRUE(nodes[1].isApprox(PointType(0.0, 5.0, 0.0)));
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SceneStateTest, TestWidgetsFollowVolume)
+{
+	SceneState scene;
+	scene.updateVolume(
+		{{PropertyId::TRANSFORM, makeTranslation(1.0, 0.0, 0.0)}});
+
+	// Created where the volume was, and keeping that offset
+	scene.addWidget(4);
+
+	auto updates = scene.updateVolume(
+		{{PropertyId::TRANSFORM, makeTranslation(3.0, 1.0, 0.0)}});
+	ASSERT_EQ(updates.size(), 2);
+	EXPECT_EQ(updates[0].type, ObjectType::VOLUME);
+	EXPECT_EQ(updates[1].type, ObjectType::WIDGET);
+	EXPECT_EQ(updates[1].id, 4);
+
+	const auto& transform =
+		std::get<TransformType>(updates[1].propList[0].second);
+	EXPECT_TRUE(transform.isApprox(makeTranslation(2.0, 1.0, 0.0)));
+	EXPECT_TRUE(scene.findWidget(4)->transform.isApprox(transform));
+}
+//=============================================================================
@@ -0,0 +1,101 @@
+#include "networking/sendQueue.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+EncodedMessage makeMessage(
+	const std::string& text, std::optional<std::uint64_t> supersedeKey = {})
+{
+	NetworkMessage msg;
+	msg.header = 0x00;
+	msg.type = NetworkMessage::MessageType::LASER_UPDATED;
+	msg.data = {text.begin(), text.end()};
+	msg.size = msg.data.size();
+
+	EncodedMessage encodedMsg{msg};
+	if (supersedeKey) {
+		encodedMsg.setSupersedeKey(*supersedeKey);
+	}
+
+	return encodedMsg;
+}
+
+std::vector<QByteArray> drain(SendQueue& queue)
+{
+	std::vector<QByteArray> contents;
+	while (!queue.isEmpty()) {
+		contents.push_back(queue.front().getBytes());
+		queue.pop();
+	}
+
+	return contents;
+}
+}  // namespace
+
+//=============================================================================
+TEST(SendQueueTest, TestNewerMessageSupersedesOlder)
+{
+	SendQueue queue;
+	ASSERT_TRUE(queue.push(makeMessage("laser 1 at A", 1)));
+	ASSERT_TRUE(queue.push(makeMessage("widget created")));
+	ASSERT_TRUE(queue.push(makeMessage("laser 2 at A", 2)));
+	ASSERT_TRUE(queue.push(makeMessage("laser 1 at B", 1)));
+
+	const auto& statistics = queue.getStatistics();
+	ASSERT_EQ(statistics.queuedMessages, 3);
+	ASSERT_EQ(statistics.supersededMessages, 1);
+
+	// The latest value goes where the newest message was queued
+	auto contents = drain(queue);
+	ASSERT_EQ(contents.size(), 3);
+	ASSERT_TRUE(contents[0] == makeMessage("widget created").getBytes());
+	ASSERT_TRUE(contents[1] == makeMessage("laser 2 at A").getBytes());
+	ASSERT_TRUE(contents[2] == makeMessage("laser 1 at B").getBytes());
+
+	ASSERT_EQ(statistics.queuedMessages, 0);
+	ASSERT_EQ(statistics.queuedBytes, 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SendQueueTest, TestMessagesWithoutKeyAreKept)
+{
+	SendQueue queue;
+	for (int i = 0; i < 10; ++i) {
+		ASSERT_TRUE(queue.push(makeMessage("full state")));
+	}
+
+	ASSERT_EQ(queue.getStatistics().queuedMessages, 10);
+	ASSERT_EQ(queue.getStatistics().supersededMessages, 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SendQueueTest, TestLimit)
+{
+	const auto msg = makeMessage(std::string(100, 'x'));
+	const auto msgSize = static_cast<std::size_t>(msg.getBytes().size());
+
+	// An empty queue takes a message of any size
+	SendQueue queue{msgSize / 2};
+	ASSERT_TRUE(queue.push(msg));
+	ASSERT_FALSE(queue.push(msg));
+	drain(queue);
+
+	// Superseding makes room before the limit is checked
+	const auto update = makeMessage(std::string(100, 'x'), 7);
+	SendQueue supersedingQueue{msgSize};
+	for (int i = 0; i < 10; ++i) {
+		ASSERT_TRUE(supersedingQueue.push(update));
+	}
+
+	const auto& statistics = supersedingQueue.getStatistics();
+	ASSERT_EQ(statistics.queuedMessages, 1);
+	ASSERT_EQ(statistics.queuedBytes, msgSize);
+	ASSERT_EQ(statistics.peakQueuedBytes, msgSize);
+	ASSERT_EQ(statistics.supersededMessages, 9);
+}
+//=============================================================================
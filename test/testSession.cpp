@@ -0,0 +1,374 @@
+#include "appcore/session.h"
+#include "appcore/compactTransformCodec.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+using IdType = common::IdType;
+using PropertyId = common::PropertyId;
+using PointType = common::Point3dType;
+using TransformType = common::TransformType;
+using ObjectType = Session::ObjectType;
+using RateClass = Session::RateClass;
+
+TransformType makeTranslation(double x, double y, double z)
+{
+	TransformType transform{TransformType::Identity()};
+	transform.translation() = PointType{x, y, z};
+	return transform;
+}
+
+// Broadcast of a volume transform with the encoder of the session for the
+// rate class, as ServerApp sends it
+NetworkMessage createVolumeTransformMsg(Session& session, RateClass rateClass,
+	const PeerCapabilities& capabilities, const TransformType& transform)
+{
+	return session.getEncoder(rateClass, capabilities)
+		.createVolumeUpdateMsg(
+			VolumeUpdate(VolumeUpdate::MessageType::PROPERTY_UPDATE,
+				{{PropertyId::TRANSFORM, transform}}));
+}
+
+bool isKeyframe(const NetworkMessage& msg)
+{
+	const auto header =
+		compactTransform::readHeader(msg.data.data(), msg.data.size());
+
+	return (msg.type == NetworkMessage::TRANSFORM_UPDATE) && header &&
+		header->keyframe;
+}
+}  // namespace
+
+//=============================================================================
+class SessionTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_First = &m_Sessions.create();
+		m_Second = &m_Sessions.create();
+
+		// Peers join by giving the code, as ServerApp routes their
+		// credentials
+		join(m_First->code, 1);
+		join(m_First->code, 2);
+		join(m_Second->code, 3);
+	}
+
+	Session* join(const std::string& code, IdType peerId)
+	{
+		auto session = m_Sessions.find(code);
+		if (session) {
+			session->addPeer(peerId, {1.0, 0.0, 0.0});
+		}
+
+		return session;
+	}
+
+	SessionRegistry m_Sessions;
+	Session* m_First = nullptr;
+	Session* m_Second = nullptr;
+};
+//=============================================================================
+
+//=============================================================================
+TEST(SessionRegistryTest, TestCodes)
+{
+	SessionRegistry sessions;
+
+	std::set<std::string> codes;
+	for (int i = 0; i < 100; ++i) {
+		const auto& code = sessions.create().code;
+
+		ASSERT_EQ(code.size(), SessionRegistry::codeLength);
+		EXPECT_TRUE(std::all_of(code.begin(), code.end(),
+			[](unsigned char c) { return std::isalnum(c) != 0; }));
+
+		codes.insert(code);
+	}
+
+	EXPECT_EQ(codes.size(), 100u);
+	EXPECT_EQ(sessions.getCodes(),
+		std::vector<std::string>(codes.begin(), codes.end()));
+
+	// Codes are unique regardless of case, but looked up exactly
+	ASSERT_NE(sessions.add("Review"), nullptr);
+	EXPECT_EQ(sessions.add("REVIEW"), nullptr);
+	EXPECT_EQ(sessions.add(""), nullptr);
+	EXPECT_TRUE(sessions.isTaken("review"));
+	EXPECT_EQ(sessions.find("review"), nullptr);
+	ASSERT_NE(sessions.find("Review"), nullptr);
+	EXPECT_EQ(sessions.find("Review")->code, "Review");
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestPeersJoinTheSessionOfTheirCode)
+{
+	EXPECT_NE(m_First->code, m_Second->code);
+	EXPECT_EQ(join("unknown", 4), nullptr);
+
+	ASSERT_EQ(m_First->peers.size(), 2u);
+	EXPECT_EQ(m_First->peers[0].id, 1);
+	EXPECT_EQ(m_First->peers[1].id, 2);
+	ASSERT_EQ(m_Second->peers.size(), 1u);
+	EXPECT_EQ(m_Second->peers[0].id, 3);
+
+	EXPECT_NE(m_First->findPeer(2), nullptr);
+	EXPECT_EQ(m_First->findPeer(3), nullptr);
+	EXPECT_EQ(m_Second->findPeer(1), nullptr);
+
+	// Each peer joins with a laser in the scene of its session only
+	EXPECT_NE(m_First->sceneState.findLaser(1), nullptr);
+	EXPECT_EQ(m_First->sceneState.findLaser(3), nullptr);
+	EXPECT_NE(m_Second->sceneState.findLaser(3), nullptr);
+	EXPECT_EQ(m_Second->sceneState.findLaser(1), nullptr);
+
+	// Joining twice changes nothing
+	join(m_First->code, 1);
+	EXPECT_EQ(m_First->peers.size(), 2u);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestScenesAreIsolated)
+{
+	const auto transform = makeTranslation(1.0, 2.0, 3.0);
+	auto updates =
+		m_First->sceneState.updateVolume({{PropertyId::TRANSFORM, transform}});
+	ASSERT_FALSE(updates.empty());
+
+	m_First->sceneState.addWidget(0);
+
+	EXPECT_TRUE(m_First->sceneState.getVolume().transform.isApprox(transform));
+	EXPECT_TRUE(m_Second->sceneState.getVolume().transform.isApprox(
+		TransformType::Identity()));
+	EXPECT_EQ(m_First->sceneState.getWidgets().size(), 1u);
+	EXPECT_TRUE(m_Second->sceneState.getWidgets().empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestOwnershipIsReleasedInTheSessionOfThePeer)
+{
+	m_First->volumeOwner = 1;
+	m_First->planeOwner = 1;
+	m_First->widgetOwnershipMap = {{0, 1}, {1, 2}};
+	m_Second->volumeOwner = 3;
+	m_Second->widgetOwnershipMap = {{0, 3}};
+
+	// Peers only leave the session they joined
+	EXPECT_FALSE(m_Second->removePeer(1));
+	EXPECT_EQ(m_Second->peers.size(), 1u);
+
+	EXPECT_TRUE(m_First->removePeer(1));
+	EXPECT_EQ(m_First->findPeer(1), nullptr);
+	EXPECT_EQ(m_First->sceneState.findLaser(1), nullptr);
+	EXPECT_EQ(m_First->volumeOwner, std::nullopt);
+	EXPECT_EQ(m_First->planeOwner, std::nullopt);
+	EXPECT_EQ(m_First->widgetOwnershipMap.at(0), std::nullopt);
+	EXPECT_EQ(m_First->widgetOwnershipMap.at(1), 2);
+
+	EXPECT_EQ(m_Second->volumeOwner, 3);
+	EXPECT_EQ(m_Second->widgetOwnershipMap.at(0), 3);
+	EXPECT_NE(m_Second->sceneState.findLaser(3), nullptr);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestBroadcastsReachTheSessionOnly)
+{
+	EXPECT_EQ(m_First->getSubscribers(RateClass::FULL_RATE, ObjectType::VOLUME,
+				  0),
+		(std::vector<IdType>{1, 2}));
+	EXPECT_EQ(m_Second->getSubscribers(
+				  RateClass::FULL_RATE, ObjectType::VOLUME, 0),
+		(std::vector<IdType>{3}));
+
+	// Updates are queued with the coalescer of the session they apply to
+	int sent = 0;
+	for (const auto& update : m_First->sceneState.updateVolume(
+			 {{PropertyId::TRANSFORM, makeTranslation(1.0, 0.0, 0.0)}})) {
+		m_First->updateCoalescer.add(update.type, update.id, update.propList,
+			[&sent](const common::PropertyListType&) { ++sent; });
+	}
+
+	EXPECT_FALSE(m_First->updateCoalescer.isEmpty());
+	EXPECT_TRUE(m_Second->updateCoalescer.isEmpty());
+
+	m_Second->updateCoalescer.flush();
+	EXPECT_EQ(sent, 0);
+
+	m_First->updateCoalescer.flush();
+	EXPECT_GT(sent, 0);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestTransformBaselinesAreIsolated)
+{
+	const PeerCapabilities capabilities{PeerCapabilities::COMPACT_TRANSFORM};
+	const auto transform = makeTranslation(1.0, 2.0, 3.0);
+
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::FULL_RATE, capabilities, transform)));
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_Second, RateClass::FULL_RATE, capabilities, transform)));
+	EXPECT_FALSE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::FULL_RATE, capabilities, transform)));
+
+	// A peer joining the second session leaves the streams of the first
+	// one alone
+	join(m_Second->code, 4);
+	m_Second->resetTransformBaselines(capabilities);
+
+	EXPECT_FALSE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::FULL_RATE, capabilities, transform)));
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_Second, RateClass::FULL_RATE, capabilities, transform)));
+
+	// Previews are a stream of their own
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::PREVIEW, capabilities, transform)));
+	EXPECT_FALSE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::PREVIEW, capabilities, transform)));
+
+	// which restarts along with the full rate one
+	m_First->resetTransformBaselines(capabilities);
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::FULL_RATE, capabilities, transform)));
+	EXPECT_TRUE(isKeyframe(createVolumeTransformMsg(
+		*m_First, RateClass::PREVIEW, capabilities, transform)));
+}
+//=============================================================================
+
+//=============================================================================
+TEST(SubscriptionTest, TestFilterIncludes)
+{
+	Subscription::Filter filter;
+	EXPECT_TRUE(filter.includes(0));
+	EXPECT_TRUE(filter.includes(42));
+
+	filter.ids = {1, 3};
+	EXPECT_FALSE(filter.includes(0));
+	EXPECT_TRUE(filter.includes(1));
+	EXPECT_TRUE(filter.includes(3));
+
+	filter.rateClass = RateClass::PREVIEW;
+	EXPECT_TRUE(filter.includes(1));
+	EXPECT_FALSE(filter.includes(2));
+
+	filter.rateClass = RateClass::EVENTS_ONLY;
+	EXPECT_FALSE(filter.includes(1));
+
+	filter.ids.clear();
+	EXPECT_FALSE(filter.includes(1));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestBroadcastRecipientsPerRateClass)
+{
+	join(m_First->code, 4);
+
+	// Peer 1 keeps the default, everything at full rate
+	Subscription preview;
+	preview.volume.rateClass = RateClass::PREVIEW;
+	preview.lasers.ids = {1};
+	m_First->setSubscription(2, preview);
+
+	Subscription eventsOnly;
+	eventsOnly.volume.rateClass = RateClass::EVENTS_ONLY;
+	eventsOnly.lasers.rateClass = RateClass::EVENTS_ONLY;
+	m_First->setSubscription(4, eventsOnly);
+
+	EXPECT_EQ(m_First->getSubscribers(RateClass::FULL_RATE, ObjectType::VOLUME,
+				  0),
+		(std::vector<IdType>{1}));
+	EXPECT_EQ(m_First->getSubscribers(RateClass::PREVIEW, ObjectType::VOLUME,
+				  0),
+		(std::vector<IdType>{2}));
+	EXPECT_FALSE(m_First->hasSubscribers(
+		RateClass::EVENTS_ONLY, ObjectType::VOLUME, 0));
+
+	EXPECT_EQ(m_First->getSubscribers(RateClass::FULL_RATE, ObjectType::LASER,
+				  1),
+		(std::vector<IdType>{1, 2}));
+	EXPECT_EQ(m_First->getSubscribers(RateClass::FULL_RATE, ObjectType::LASER,
+				  4),
+		(std::vector<IdType>{1}));
+	EXPECT_EQ(m_First->getSubscribers(RateClass::FULL_RATE, ObjectType::PLANE,
+				  0),
+		(std::vector<IdType>{1, 2, 4}));
+
+	// Subscriptions apply to the session of the peer only
+	EXPECT_TRUE(m_First->setSubscription(3, preview).empty());
+	EXPECT_EQ(m_Second->getSubscribers(
+				  RateClass::FULL_RATE, ObjectType::VOLUME, 0),
+		(std::vector<IdType>{3}));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionTest, TestWidenedSubscriptionAddsOnlyNewObjects)
+{
+	for (IdType id : {0, 1, 2}) {
+		m_First->sceneState.addWidget(id);
+		m_First->widgetOwnershipMap.insert({id, std::nullopt});
+	}
+
+	auto hasObject = [](const Session::ObjectListType& objects,
+						 ObjectType type, IdType id) {
+		return std::any_of(objects.begin(), objects.end(),
+			[&](const Session::Object& object) {
+				return (object.type == type) && (object.id == id);
+			});
+	};
+
+	Subscription narrow;
+	narrow.volume.rateClass = RateClass::EVENTS_ONLY;
+	narrow.plane.rateClass = RateClass::EVENTS_ONLY;
+	narrow.lasers.rateClass = RateClass::EVENTS_ONLY;
+	narrow.widgets.ids = {0};
+
+	// Narrowing adds nothing
+	EXPECT_TRUE(m_First->setSubscription(1, narrow).empty());
+
+	// Taking the same objects at another rate loses nothing either
+	auto preview = narrow;
+	preview.widgets.rateClass = RateClass::PREVIEW;
+	EXPECT_TRUE(m_First->setSubscription(1, preview).empty());
+
+	// Only the objects let through from now on are brought up to date,
+	// leaving out its own laser and the widget it is moving
+	m_First->widgetOwnershipMap.at(2) = 1;
+
+	Subscription wide;
+	wide.plane.rateClass = RateClass::EVENTS_ONLY;
+	const auto added = m_First->setSubscription(1, wide);
+
+	EXPECT_EQ(added.size(), 3u);
+	EXPECT_TRUE(hasObject(added, ObjectType::VOLUME, 0));
+	EXPECT_TRUE(hasObject(added, ObjectType::LASER, 2));
+	EXPECT_TRUE(hasObject(added, ObjectType::WIDGET, 1));
+	EXPECT_FALSE(hasObject(added, ObjectType::LASER, 1));
+	EXPECT_FALSE(hasObject(added, ObjectType::WIDGET, 0));
+	EXPECT_FALSE(hasObject(added, ObjectType::WIDGET, 2));
+	EXPECT_FALSE(hasObject(added, ObjectType::PLANE, 0));
+
+	// A volume the peer is interacting with is left alone as well
+	m_First->setSubscription(1, narrow);
+	m_First->volumeOwner = 1;
+	EXPECT_FALSE(hasObject(
+		m_First->setSubscription(1, wide), ObjectType::VOLUME, 0));
+
+	// Objects of other sessions never are
+	EXPECT_TRUE(m_Second->setSubscription(1, wide).empty());
+}
+//=============================================================================
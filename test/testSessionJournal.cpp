@@ -0,0 +1,223 @@
+#include "appcore/sessionJournal.h"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using PointType = common::Point3dType;
+using TransformType = common::TransformType;
+using VariantType = common::VariantType;
+
+TransformType makeTranslation(double x, double y, double z)
+{
+	TransformType transform{TransformType::Identity()};
+	transform.translation() = PointType{x, y, z};
+	return transform;
+}
+
+std::vector<VariantType> makeNodes(std::size_t count)
+{
+	std::vector<VariantType> nodes;
+	for (std::size_t i = 0; i < count; ++i) {
+		nodes.push_back(PointType{1.0 * i, 2.0, 0.0});
+	}
+
+	return nodes;
+}
+
+// Applies the updates to the scene and journals them, as ServerApp does
+void applyWidgetUpdate(SceneState& scene, SessionJournal& journal,
+	common::IdType id, const common::PropertyListType& propList)
+{
+	journal.recordUpdates(scene.updateWidget(id, propList));
+}
+}  // namespace
+
+//=============================================================================
+class SessionJournalTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		const auto* info =
+			::testing::UnitTest::GetInstance()->current_test_info();
+
+		m_Directory = std::filesystem::temp_directory_path() /
+			(std::string{"sessionJournal_"} + info->name());
+		std::filesystem::remove_all(m_Directory);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_Directory);
+	}
+
+	std::filesystem::path m_Directory;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionJournalTest, TestNothingToRecover)
+{
+	SceneState scene;
+	SessionJournal journal{m_Directory};
+
+	EXPECT_FALSE(journal.recover(scene).has_value());
+	EXPECT_TRUE(scene.getWidgets().empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionJournalTest, TestRecoverJournaledUpdates)
+{
+	SceneState scene;
+	{
+		SessionJournal journal{m_Directory};
+		ASSERT_TRUE(journal.start(scene));
+
+		journal.recordUpdates(scene.updateVolume(
+			{{PropertyId::TRANSFORM, makeTranslation(1.0, 0.0, 0.0)}}));
+
+		for (common::IdType id : {0, 1}) {
+			scene.addWidget(id);
+			journal.recordWidgetCreated(id);
+		}
+
+		applyWidgetUpdate(scene, journal, 0,
+			{{PropertyId::NODES, makeNodes(4)}});
+		applyWidgetUpdate(scene, journal, 1,
+			{{PropertyId::TRANSFORM, makeTranslation(0.0, 5.0, 0.0)}});
+
+		scene.removeWidget(1);
+		journal.recordWidgetDestroyed(1);
+
+		// Lasers are left out
+		scene.addLaser(3, {1.0, 0.0, 0.0});
+		journal.recordUpdates(scene.updateLaser(
+			3, {{PropertyId::BASE, PointType{1.0, 1.0, 1.0}}}));
+
+		journal.recordUpdates(scene.updatePlane(
+			{{PropertyId::TRANSFORM, makeTranslation(0.0, 0.0, 7.0)}}));
+
+		journal.stop();
+		EXPECT_EQ(journal.getStatistics().records, 7);
+		EXPECT_GE(journal.getStatistics().commits, 1);
+	}
+
+	SceneState recovered;
+	SessionJournal journal{m_Directory};
+	const auto replayed = journal.recover(recovered);
+	ASSERT_TRUE(replayed.has_value());
+	EXPECT_EQ(*replayed, 7);
+
+	EXPECT_TRUE(recovered.getLasers().empty());
+	ASSERT_EQ(recovered.getWidgets().size(), 1);
+	EXPECT_EQ(recovered.findWidget(1), nullptr);
+
+	const auto nodes = recovered.findWidget(0)->getNodes();
+	ASSERT_EQ(nodes.size(), 4);
+	EXPECT_TRUE(nodes[3].isApprox(PointType(3.0, 2.0, 0.0)));
+
+	EXPECT_TRUE(recovered.getVolume().transform.isApprox(
+		scene.getVolume().transform));
+	EXPECT_TRUE(recovered.getPlane().transform.isApprox(
+		scene.getPlane().transform));
+
+	// The widget still follows the volume from where it was created
+	auto updates = recovered.updateVolume(
+		{{PropertyId::TRANSFORM, makeTranslation(2.0, 0.0, 0.0)}});
+	ASSERT_EQ(updates.size(), 2);
+	EXPECT_TRUE(recovered.findWidget(0)->transform.isApprox(
+		makeTranslation(1.0, 0.0, 0.0)));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionJournalTest, TestSnapshotReplacesJournal)
+{
+	SceneState scene;
+	{
+		SessionJournal journal{m_Directory};
+		ASSERT_TRUE(journal.start(scene));
+
+		scene.addWidget(4);
+		journal.recordWidgetCreated(4);
+		applyWidgetUpdate(scene, journal, 4,
+			{{PropertyId::NODES, makeNodes(2)}});
+		EXPECT_EQ(journal.getRecordCountSinceSnapshot(), 2);
+
+		journal.recordSnapshot(scene);
+		EXPECT_EQ(journal.getRecordCountSinceSnapshot(), 0);
+
+		applyWidgetUpdate(scene, journal, 4,
+			{{PropertyId::TRANSFORM, makeTranslation(0.0, 3.0, 0.0)}});
+
+		journal.stop();
+		EXPECT_EQ(journal.getStatistics().snapshots, 1);
+	}
+
+	SceneState recovered;
+	SessionJournal journal{m_Directory};
+
+	// Only the update after the snapshot is replayed
+	const auto replayed = journal.recover(recovered);
+	ASSERT_TRUE(replayed.has_value());
+	EXPECT_EQ(*replayed, 1);
+
+	ASSERT_NE(recovered.findWidget(4), nullptr);
+	const auto nodes = recovered.findWidget(4)->getNodes();
+	ASSERT_EQ(nodes.size(), 2);
+	EXPECT_TRUE(nodes[1].isApprox(PointType(1.0, 5.0, 0.0)));
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(SessionJournalTest, TestTornRecordIsDropped)
+{
+	SceneState scene;
+	{
+		SessionJournal journal{m_Directory};
+		ASSERT_TRUE(journal.start(scene));
+
+		for (common::IdType id : {0, 1}) {
+			scene.addWidget(id);
+			journal.recordWidgetCreated(id);
+		}
+
+		journal.stop();
+	}
+
+	// As left by a server which died halfway through writing a record
+	const auto journalPath = m_Directory / SessionJournal::journalFileName;
+	std::filesystem::resize_file(
+		journalPath, std::filesystem::file_size(journalPath) - 3);
+
+	SceneState recovered;
+	{
+		SessionJournal journal{m_Directory};
+		const auto replayed = journal.recover(recovered);
+		ASSERT_TRUE(replayed.has_value());
+		EXPECT_EQ(*replayed, 1);
+		EXPECT_NE(recovered.findWidget(0), nullptr);
+		EXPECT_EQ(recovered.findWidget(1), nullptr);
+
+		// Starting over drops the torn record, so new ones follow on
+		ASSERT_TRUE(journal.start(recovered));
+		recovered.addWidget(2);
+		journal.recordWidgetCreated(2);
+		journal.stop();
+	}
+
+	SceneState restarted;
+	SessionJournal journal{m_Directory};
+	const auto replayed = journal.recover(restarted);
+	ASSERT_TRUE(replayed.has_value());
+	EXPECT_EQ(*replayed, 1);
+	EXPECT_EQ(restarted.getWidgets().size(), 2);
+	EXPECT_NE(restarted.findWidget(2), nullptr);
+}
+//=============================================================================
@@ -0,0 +1,156 @@
+#include "appcore/updateCoalescer.h"
+#include "gtest/gtest.h"
+
+#include <utility>
+#include <vector>
+
+namespace
+{
+using PropertyId = common::PropertyId;
+using PropertyListType = common::PropertyListType;
+using PointType = common::Point3dType;
+using ObjectType = UpdateCoalescer::ObjectType;
+
+common::PropertyVariantType makeNodePosition(
+	std::uint16_t index, const PointType& position)
+{
+	return std::vector<common::VariantType>{index, position};
+}
+}  // namespace
+
+//=============================================================================
+class UpdateCoalescerTest : public ::testing::Test
+{
+protected:
+	UpdateCoalescer::SendCallbackType recordAs(common::IdType id)
+	{
+		return [this, id](const PropertyListType& propList) {
+			m_Sent.push_back({id, propList});
+		};
+	}
+
+	UpdateCoalescer m_Coalescer;
+	std::vector<std::pair<common::IdType, PropertyListType>> m_Sent;
+};
+//=============================================================================
+
+//=============================================================================
+TEST_F(UpdateCoalescerTest, TestLatestValueWins)
+{
+	for (int i = 0; i < 10; ++i) {
+		m_Coalescer.add(ObjectType::LASER, 1,
+			{{PropertyId::BASE, PointType{1.0 * i, 0.0, 0.0}},
+				{PropertyId::TIP, PointType{0.0, 1.0 * i, 0.0}}},
+			recordAs(1));
+	}
+	ASSERT_TRUE(m_Sent.empty());
+
+	m_Coalescer.flush();
+	ASSERT_TRUE(m_Coalescer.isEmpty());
+	ASSERT_EQ(m_Sent.size(), 1);
+
+	const auto& propList = m_Sent[0].second;
+	ASSERT_EQ(propList.size(), 2);
+	ASSERT_TRUE(propList[0].first == PropertyId::BASE);
+	ASSERT_TRUE(std::get<PointType>(propList[0].second) ==
+		PointType(9.0, 0.0, 0.0));
+	ASSERT_TRUE(propList[1].first == PropertyId::TIP);
+	ASSERT_TRUE(std::get<PointType>(propList[1].second) ==
+		PointType(0.0, 9.0, 0.0));
+
+	const auto& statistics = m_Coalescer.getStatistics();
+	ASSERT_EQ(statistics.receivedUpdates, 10);
+	ASSERT_EQ(statistics.sentUpdates, 1);
+	ASSERT_EQ(statistics.coalescedUpdates, 9);
+	ASSERT_EQ(statistics.supersededProperties, 18);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(UpdateCoalescerTest, TestObjectsKeptApartInOrder)
+{
+	m_Coalescer.add(ObjectType::WIDGET, 4,
+		{{PropertyId::TRANSFORM, common::TransformType::Identity()}},
+		recordAs(4));
+	m_Coalescer.add(ObjectType::LASER, 4,
+		{{PropertyId::TIP, PointType{0.0, 0.0, 1.0}}}, recordAs(40));
+	m_Coalescer.add(ObjectType::WIDGET, 2,
+		{{PropertyId::TRANSFORM, common::TransformType::Identity()}},
+		recordAs(2));
+	m_Coalescer.add(ObjectType::WIDGET, 4,
+		{{PropertyId::TRANSFORM, common::TransformType::Identity()}},
+		recordAs(4));
+
+	m_Coalescer.flush();
+
+	ASSERT_EQ(m_Sent.size(), 3);
+	ASSERT_EQ(m_Sent[0].first, 4);
+	ASSERT_EQ(m_Sent[1].first, 40);
+	ASSERT_EQ(m_Sent[2].first, 2);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(UpdateCoalescerTest, TestNodePositionsCoalescePerNode)
+{
+	m_Coalescer.add(ObjectType::WIDGET, 1,
+		{{PropertyId::NODE_POSITION, makeNodePosition(0, {0.0, 0.0, 0.0})}},
+		recordAs(1));
+	m_Coalescer.add(ObjectType::WIDGET, 1,
+		{{PropertyId::NODE_POSITION, makeNodePosition(1, {1.0, 0.0, 0.0})}},
+		recordAs(1));
+	m_Coalescer.add(ObjectType::WIDGET, 1,
+		{{PropertyId::NODE_POSITION, makeNodePosition(0, {2.0, 0.0, 0.0})}},
+		recordAs(1));
+
+	m_Coalescer.flush();
+	ASSERT_EQ(m_Sent.size(), 1);
+	ASSERT_EQ(m_Sent[0].second.size(), 2);
+
+	// A new node list replaces every pending node position
+	m_Coalescer.add(ObjectType::WIDGET, 1,
+		{{PropertyId::NODE_POSITION, makeNodePosition(0, {3.0, 0.0, 0.0})}},
+		recordAs(1));
+	m_Coalescer.add(ObjectType::WIDGET, 1,
+		{{PropertyId::NODES, std::vector<common::VariantType>{}}},
+		recordAs(1));
+
+	m_Coalescer.flush();
+	ASSERT_EQ(m_Sent.size(), 2);
+	ASSERT_EQ(m_Sent[1].second.size(), 1);
+	ASSERT_TRUE(m_Sent[1].second[0].first == PropertyId::NODES);
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(UpdateCoalescerTest, TestDiscard)
+{
+	m_Coalescer.add(ObjectType::LASER, 7,
+		{{PropertyId::TIP, PointType{0.0, 0.0, 1.0}}}, recordAs(7));
+	m_Coalescer.discard(ObjectType::LASER, 7);
+
+	m_Coalescer.flush();
+	ASSERT_TRUE(m_Sent.empty());
+}
+//=============================================================================
+
+//=============================================================================
+TEST_F(UpdateCoalescerTest, TestUpdatesAddedWhileFlushingWait)
+{
+	m_Coalescer.add(ObjectType::VOLUME, 0,
+		{{PropertyId::TRANSFORM, common::TransformType::Identity()}},
+		[this](const PropertyListType& propList) {
+			m_Sent.push_back({0, propList});
+			m_Coalescer.flush();
+			m_Coalescer.add(ObjectType::VOLUME, 0, propList, recordAs(1));
+		});
+
+	m_Coalescer.flush();
+	ASSERT_EQ(m_Sent.size(), 1);
+	ASSERT_FALSE(m_Coalescer.isEmpty());
+
+	m_Coalescer.flush();
+	ASSERT_EQ(m_Sent.size(), 2);
+	ASSERT_EQ(m_Sent[1].first, 1);
+}
+//=============================================================================